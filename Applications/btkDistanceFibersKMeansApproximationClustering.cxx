@@ -67,122 +67,20 @@
 #include "itkPoint.h"
 #include "itkContinuousIndex.h"
 
+// VNL includes
+#include "vnl/vnl_matrix.h"
+#include "vnl/algo/vnl_symmetric_eigensystem.h"
+
+// Local includes
+#include "btkFiberDistanceEngine.h"
+
 typedef float PixelType;
 const unsigned int Dimension = 3;
 typedef itk::Image<PixelType,Dimension> Image3DType;
 typedef Image3DType::Pointer Image3DPointer;
 
-//
-// Function declaration
-//
-float Distance_measure(const std::vector<float>& f1,const std::vector<float>& f2,const char& type);
-float Orientation_measure(const std::vector<float>& f1,const std::vector<float>& f2);
-
-//
-// Distance measure (Asymmetric/Symmetric Chamfer or Hausdorff distance)
-float Distance_measure(const std::vector<float>& f1,const std::vector<float>& f2,const char& type)
-{
-    float distance;
-	
-    if(f1==f2) return 0; //same fiber --> distance = 0
-    else	
-    {
-	std::vector<float> di(f1.size()/3);
-	for(int i=0; i< f1.size()/3; i++)
-	{	
-		std::vector<float> dj(f2.size()/3);	
-		for(int j=0; j< f2.size()/3; j++)
-		{
-		dj[j] = sqrt(pow(f1[3*i+0]-f2[3*j+0],2)+pow(f1[3*i+1]-f2[3*j+1],2)+pow(f1[3*i+2]-f2[3*j+2],2));
-		}
-		di[i] = dj[min_element(dj.begin(), dj.end())-dj.begin()];
-                dj.clear();
-	}	
-
-	if(type == 'C') // Chamfer distance
-	{ 
-		distance = accumulate(di.begin(), di.end(),0.0)/di.size();
-	        di.clear(); 
-	}
-	
-	if(type == 'H') // Hausdorff distance
-	{
-		distance = std::max_element(di.begin(), di.end()) - di.begin();
-        	di.clear();
-	}
-
-	return distance;
-     }
-}
-
-//
-// Local orientation measure
-float Orientation_measure(const std::vector<float>& f1,const std::vector<float>& f2)
-{    
-  if(f1==f2) return 0; //same fiber --> Local orientation = 0
-  else	
-  {    
-        int length, pas;     
-        if(f1.size()<f2.size()) 
-	{
-	  length = f1.size()/3;
-	  pas = (int)(f2.size()/f1.size());
-	}
-        else 
-	{
-	  length = f2.size()/3;
-	  pas= (int)(f1.size()/f2.size());
-	}
-	
-	float V1x, V1y, V1z, V2x, V2y, V2z;
-	float orientation = 0;
-	
-	for(int i=0; i< length; i++)
-	{
-	  if(f1.size()<f2.size())
-	  { 
-	    V1x = f1[3*(i+1)+0]-f1[3*i+0]; 
-	    V1y = f1[3*(i+1)+1]-f1[3*i+1]; 
-	    V1z = f1[3*(i+1)+2]-f1[3*i+2];  
-	    V1x = V1x/sqrt(pow(V1x,2) + pow(V1y,2) + pow(V1z,2));
-	    V1y = V1y/sqrt(pow(V1x,2) + pow(V1y,2) + pow(V1z,2));
-	    V1z = V1z/sqrt(pow(V1x,2) + pow(V1y,2) + pow(V1z,2));
-
-	    V2x = f2[3*(pas*(i+1))+0]-f2[3*(i*pas)+0]; 
-	    V2y = f2[3*(pas*(i+1))+1]-f2[3*(i*pas)+1]; 
-	    V2z = f2[3*(pas*(i+1))+2]-f2[3*(i*pas)+2];
-	    V2x = V2x/sqrt(pow(V2x,2) + pow(V2y,2) + pow(V2z,2));
-	    V2y = V2y/sqrt(pow(V2x,2) + pow(V2y,2) + pow(V2z,2));
-	    V2z = V2z/sqrt(pow(V2x,2) + pow(V2y,2) + pow(V2z,2));
-	    
-	    orientation += 1-abs((V1x*V2x) + (V1y*V2y) + (V1z*V2z));
-	  }
-	  else
-	  {
-	    V2x = f2[3*(i+1)+0]-f2[3*i+0]; 
-	    V2y = f2[3*(i+1)+1]-f2[3*i+1]; 
-	    V2z = f2[3*(i+1)+2]-f2[3*i+2];
-	    V2x = V2x/sqrt(pow(V2x,2) + pow(V2y,2) + pow(V2z,2));
-	    V2y = V2y/sqrt(pow(V2x,2) + pow(V2y,2) + pow(V2z,2));
-	    V2z = V2z/sqrt(pow(V2x,2) + pow(V2y,2) + pow(V2z,2));
-	    
-	    V1x = f1[3*(pas*(i+1))+0]-f1[3*(i*pas)+0]; 
-
-	    V1y = f1[3*(pas*(i+1))+1]-f1[3*(i*pas)+1]; 
-	    V1z = f1[3*(pas*(i+1))+2]-f1[3*(i*pas)+2];
-	    V1x = V1x/sqrt(pow(V1x,2) + pow(V1y,2) + pow(V1z,2));
-	    V1y = V1y/sqrt(pow(V1x,2) + pow(V1y,2) + pow(V1z,2));
-	    V1z = V1z/sqrt(pow(V1x,2) + pow(V1y,2) + pow(V1z,2));
-	    
-	    orientation += 1-abs((V1x*V2x) + (V1y*V2y) + (V1z*V2z));
-	  }  
-	}
-    return orientation; 
-  }
-}
-
 // ---------------------------------
-// Usage   : btkDistanceFibersKMeansApproximationClustering -b fiber_tracts.vtk -d distance_measure -c number_of_clusters -a alpha -e eps -o fiber_clustering.vtk
+// Usage   : btkDistanceFibersKMeansApproximationClustering -b fiber_tracts.vtk -d distance_measure -c number_of_clusters -a alpha -e eps -n points -r radius -o fiber_clustering.vtk
 // Minimal Usage : btkDistanceFibersKMeansApproximationClustering -b fiber_tracts.vtk -d distance_measure -c number_of_clusters -o fiber_clustering.vtk
 // Example : btkDistanceFibersKMeansApproximationClustering -b fiber_tracts.vtk -d 7 -c 5 -o clustering2-fiber_tracts.vtk
 // ---------------------------------
@@ -200,6 +98,8 @@ int main ( int argc, char *argv[] )
   TCLAP::ValueArg<int> NumberOfClustersArg("c", "clusters", "Number of clusters", false, 1, "int",cmd);
   TCLAP::ValueArg<float> AlphaArg("a", "alpha", "Parameter in [0,1]: used to control the balance between the distance and orientation similarities", false, 0.5, "float",cmd);
   TCLAP::ValueArg<float> EpsilonArg("e", "epsilon", "Parameter in ]0,1[: used to fix the sampling parameter in the k-means approximation algorithm", false, 0.5, "float",cmd);
+  TCLAP::ValueArg<int> NumberOfPointsArg("n", "points", "Number of points of the resampled fibers", false, 20, "int",cmd);
+  TCLAP::ValueArg<float> RadiusArg("r", "radius", "Distances larger than this radius are not computed and set to the radius (negative value: all distances are computed)", false, -1, "float",cmd);
   TCLAP::ValueArg<std::string> outputFileNameArg("o", "output", "Fibers clustering (vtk file)", false, "", "string", cmd);
 
   // Parse arguments
@@ -212,6 +112,8 @@ int main ( int argc, char *argv[] )
   int NumberOfClusters = NumberOfClustersArg.getValue();
   float alpha = AlphaArg.getValue();
   float eps = EpsilonArg.getValue();
+  int NumberOfPoints = NumberOfPointsArg.getValue();
+  float radius = RadiusArg.getValue();
   std::string outputFileName = outputFileNameArg.getValue();
  
   // Load bundle (vtk file)
@@ -251,129 +153,148 @@ int main ( int argc, char *argv[] )
 std::cout << "\nNumber of fibers: " << bundle->GetNumberOfLines() << std::endl;
 
 //------------------------------------------------------------------------------
-// Distance data matrix
+// Resampled fibers and distance engine
 //------------------------------------------------------------------------------
 
-//------------------------------------------------------------------------------
-// OPTION (case 10): the computation of the threshold 
-// --> this threshold is used in the case 10 to control the use (or NOT) of the parameter alpha
-//------------------------------------------------------------------------------
-vnl_matrix<float> dist( number_fiber, number_fiber );
-float maxd = 0, threshold;
-if (ChoiceDistanceMetric == 10)
+if(ChoiceDistanceMetric < 1 || ChoiceDistanceMetric > 11)
 {
-  for( int c = 0; c < number_fiber; ++c )
-  {
-    for( int r = c; r < number_fiber; ++r )
-    {
-      if (c==r) dist(c,r) = 0;
-      else dist(c,r) = Distance_measure(tab_data[c],tab_data[r],'C');
-	
-      if (maxd < dist(c,r)) maxd = dist(c,r);
-      dist(r,c) = dist(c,r);
-    }
-      std::cout<<"\rComputation of the threshold: "
-	   <<100*(float)(c+1)/(float)number_fiber
-           <<"% "
-           <<std::flush;
-  }
+  std::cout<< "Error: ''the value of d must between 1 and 11'' \n. Choose 				\n"
+		  << "(1)  Asymmetric Chamfer distance								\n"
+		  << "(2)  Symmetric  Chamfer distance								\n"
+		  << "(3)  Asymmetric Hausdorff distance 							\n"
+		  << "(4)  Symmetric  Hausdorff distance							\n"
+		  << "(5)  Combined Chamfer-Hausdorff distances							\n"
+		  << "(6)  Combined Symmetric Chamfer-Symmetric Hausdorff distances				\n"
+		  << "(7)  Combined Local Orientation measure-Symmetric Chamfer distance			\n"
+		  << "(8)  Combined Local Orientation measure-Symmetric Hausdorff distance			\n"
+		  << "(9)  Loacl Orientation measure								\n"
+		  << "(10) Combined Local Orientation measure(if distance<threshold)-Symmetric Chamfer distance	\n"
+		  << "(11) Minimum average direct-flip distance							\n"
+		  <<std::endl; exit (EXIT_FAILURE);
+}
 
-std::cout << " --> done" << std::endl;
+btk::FiberDistanceEngine engine;
+engine.SetNumberOfPointsPerFiber(NumberOfPoints);
+engine.SetAlpha(alpha);
+engine.SetFibers(tab_data);
+std::vector< std::vector<float> >().swap(tab_data);
+
+// Case 10 is computed from the asymmetric Chamfer distance (see below)
+if (ChoiceDistanceMetric == 10)
+  engine.SetDistanceType(btk::FiberDistanceEngine::ASYMMETRIC_CHAMFER);
+else
+  engine.SetDistanceType(static_cast<btk::FiberDistanceEngine::DistanceType>(ChoiceDistanceMetric));
+
+std::cout << "Fibers resampled with " << engine.GetNumberOfPointsPerFiber() << " points" << std::endl;
 
-std::cout << "Maximum distance between fibers: " << maxd << std::endl;
-threshold = maxd/NumberOfClusters;
-std::cout << "Threshold: " << threshold;
-}
 //------------------------------------------------------------------------------
+// A randomized feature selection for the k-means clustering
+// Only the columns of the distance matrix selected for the k-means (distances
+// from the sampled fibers to all fibers) are computed.
+//------------------------------------------------------------------------------
+
+//sp is sampling parameter and eps is a parameter in ]0,1[
+int sp=(int)( NumberOfClusters*log(NumberOfClusters/eps)/pow(eps,2) );
+
+if(sp > number_fiber) sp = number_fiber;
+
+std::vector<unsigned int> rand_perm;
+for(i=0; i<number_fiber; ++i) rand_perm.push_back(i);
+std::random_shuffle( rand_perm.begin(), rand_perm.end() );// using built-in random generator:
+
+std::vector<unsigned int> idx(rand_perm.begin(), rand_perm.begin()+sp);
+
+// Reduced distance matrix (one row per sampled fiber): the distance from the sampled fiber idx[t] to the fiber r is stored in R_Distance_matrix(t,r).
+// With a positive radius, only the pairs of fibers closer than the radius are computed (the bounding
+// boxes of the fibers are used to skip the others) and larger distances are set to the radius.
+float fillValue = (radius < 0) ? 0 : radius;
+vnl_matrix<float> R_Distance_matrix( sp, number_fiber, fillValue );
 
-vnl_matrix<float> Distance_matrix( number_fiber, number_fiber );
 std::cout << std::endl;
+const int blockSize = 64;
+for( int t0 = 0; t0 < sp; t0 += blockSize )
+{
+    std::vector<unsigned int> queries(idx.begin()+t0, idx.begin()+std::min(t0+blockSize,sp));
 
-for( int c = 0; c < number_fiber; ++c )
-{   
-    for( int r = 0; r < number_fiber; ++r )
-    { 
-	switch(ChoiceDistanceMetric) 
-	{
-		case 1: Distance_matrix(r,c) = Distance_measure(tab_data[c],tab_data[r],'C');break;
-
-		case 2: Distance_matrix(r,c) = (Distance_measure(tab_data[c],tab_data[r],'C')+Distance_measure(tab_data[r],tab_data[c],'C'))/2;break;
-	
-		case 3: Distance_matrix(r,c) = Distance_measure(tab_data[c],tab_data[r],'H');break;
-		
-		case 4: Distance_matrix(r,c) = (Distance_measure(tab_data[c],tab_data[r],'H')+Distance_measure(tab_data[r],tab_data[c],'H'))/2; break;
-
-		case 5: Distance_matrix(r,c) = (alpha*Distance_measure(tab_data[c],tab_data[r],'H'))+((1-alpha)*(tab_data[c],tab_data[r],'C')); break;
-
-		case 6: Distance_matrix(r,c) = (alpha*(Distance_measure(tab_data[c],tab_data[r],'H')+Distance_measure(tab_data[r],tab_data[c],'H'))/2)+((1-alpha)*(Distance_measure(tab_data[c],tab_data[r],'C')+Distance_measure(tab_data[r],tab_data[c],'C'))/2);break;
-
-		case 7: Distance_matrix(r,c) = alpha*Orientation_measure(tab_data[c],tab_data[r])+((1-alpha)*(Distance_measure(tab_data[c],tab_data[r],'C')+Distance_measure(tab_data[r],tab_data[c],'C'))/2);break;
-
-		case 8: Distance_matrix(r,c) = alpha*Orientation_measure(tab_data[c],tab_data[r])+((1-alpha)*(Distance_measure(tab_data[c],tab_data[r],'H')+Distance_measure(tab_data[r],tab_data[c],'H'))/2);break;
-		
-		case 9: Distance_matrix(r,c) = Orientation_measure(tab_data[c],tab_data[r]); break;
-		
-		case 10: alpha = dist(c,r)/maxd;
-		  if (dist(c,r) < threshold) Distance_matrix(r,c) = (alpha*Orientation_measure(tab_data[c],tab_data[r]))+((1-alpha)*dist(c,r));
-		  else Distance_matrix(r,c) = dist(c,r);break;
-		
-		default: std::cout<< "Error: ''the value of d must between 1 and 10'' \n. Choose 				\n" 
-				  << "(1)  Asymmetric Chamfer distance								\n"
-				  << "(2)  Symmetric  Chamfer distance								\n"
-				  << "(3)  Asymmetric Hausdorff distance 							\n"				  
-				  << "(4)  Symmetric  Hausdorff distance							\n"
-				  << "(5)  Combined Chamfer-Hausdorff distances							\n"				  
-				  << "(6)  Combined Symmetric Chamfer-Symmetric Hausdorff distances				\n"
-				  << "(7)  Combined Local Orientation measure-Symmetric Chamfer distance			\n"
-				  << "(8)  Combined Local Orientation measure-Symmetric Hausdorff distance			\n"
-				  << "(9)  Loacl Orientation measure								\n"
-				  << "(10) Combined Local Orientation measure(if distance<threshold)-Symmetric Chamfer distance	\n"
-				  <<std::endl; exit (EXIT_FAILURE);
-	}
+    btk::FiberDistanceEngine::NeighborGraph graph;
+    engine.ComputeNeighborGraph(queries, radius, graph);
+
+    for( unsigned int q = 0; q < queries.size(); ++q )
+    {
+      for( unsigned long k = graph.pointers[q]; k < graph.pointers[q+1]; ++k )
+        R_Distance_matrix(t0+q, graph.indices[k]) = graph.distances[k];
     }
-    std::cout<<"\rComputation of the distance matrix: "
-	     <<100*(float)(c+1)/(float)number_fiber
+
+    std::cout<<"\rComputation of the reduced distance matrix: "
+	     <<100*(float)(t0+queries.size())/(float)sp
              <<"% "
              <<std::flush;
 }
-std::cout << " --> done";
+std::cout << " --> done" << std::endl;
 
 //------------------------------------------------------------------------------
-// A randomized feature selection for the k-means clustering 
+// OPTION (case 10): the computation of the threshold
+// --> this threshold is used in the case 10 to control the use (or NOT) of the parameter alpha
+// (the maximum distance is taken over the computed distances)
 //------------------------------------------------------------------------------
-vnl_svd<float> svd (Distance_matrix);
-vnl_matrix<float> R_Distance_matrix(number_fiber,NumberOfClusters);
-
-R_Distance_matrix=svd.V().extract(number_fiber,NumberOfClusters,0,0);
-// leverage scores
-vnl_vector<float> Score(number_fiber);
-for(unsigned int r=0; r<number_fiber; r++)
+if (ChoiceDistanceMetric == 10)
 {
-  float s=0;
-  for(unsigned int c=0; c<NumberOfClusters; c++)
-    s+=pow(R_Distance_matrix(r,c),2);
-  Score(r)=sqrt(s)/NumberOfClusters;
-}
+  float maxd = R_Distance_matrix.max_value();
+  float threshold = maxd/NumberOfClusters;
 
-//sp is sampling parameter and eps is a parameter in ]0,1[
-int sp=(int)( NumberOfClusters*log(NumberOfClusters/eps)/pow(eps,2) ); 
+  std::cout << "Maximum distance between fibers: " << maxd << std::endl;
+  std::cout << "Threshold: " << threshold << std::endl;
 
-if(sp > number_fiber) sp = number_fiber;
+  int t;
+  #pragma omp parallel for private(t) schedule(dynamic)
+  for( t = 0; t < sp; ++t )
+  {
+    for( int r = 0; r < number_fiber; ++r )
+    {
+      float d = R_Distance_matrix(t,r);
+      if (d < threshold)
+      {
+        float a = d/maxd;
+        R_Distance_matrix(t,r) = (a*engine.Orientation(idx[t],r))+((1-a)*d);
+      }
+    }
+  }
+}
 
-std::vector<int> rand_perm;
-for(i=1; i<number_fiber; ++i) rand_perm.push_back(i);
-std::random_shuffle( rand_perm.begin(), rand_perm.end() );// using built-in random generator:
+// leverage scores of the sampled columns: right singular vectors of the reduced
+// distance matrix, computed from its Gram matrix (sp x sp)
+vnl_matrix<double> Gram_matrix( sp, sp );
+int a;
+#pragma omp parallel for private(a) schedule(dynamic)
+for( a = 0; a < sp; ++a )
+{
+  for( int b = 0; b <= a; ++b )
+  {
+    const float *rowA = R_Distance_matrix[a], *rowB = R_Distance_matrix[b];
+    double s = 0;
+    for( int r = 0; r < number_fiber; ++r )
+      s += rowA[r]*rowB[r];
+    Gram_matrix(a,b) = Gram_matrix(b,a) = s;
+  }
+}
+
+vnl_symmetric_eigensystem<double> eigensystem(Gram_matrix);
+int numberOfComponents = std::min(NumberOfClusters, sp);
 
-vnl_vector<float> idx(number_fiber);
-unsigned int t=0;
-for (std::vector<int>::iterator it=rand_perm.begin(); it!=rand_perm.end(); ++it) 
-{idx(t)=*it;t++;}
+vnl_vector<float> Score(sp);
+for(int t=0; t<sp; t++)
+{
+  float s=0;
+  // eigenvalues are in increasing order
+  for(int c=sp-numberOfComponents; c<sp; c++)
+    s+=pow(eigensystem.V(t,c),2);
+  Score(t)=sqrt(s)/NumberOfClusters;
+}
 
 // get the points into the format needed for K-means
-vtkSmartPointer<vtkTable> inputData = vtkSmartPointer<vtkTable>::New(); 
-std::cout << std::endl;
+vtkSmartPointer<vtkTable> inputData = vtkSmartPointer<vtkTable>::New();
 for( int t = 0; t < sp; ++t )
-{   
+{
     std::stringstream colName;
     colName << "distance" << t;
     vtkSmartPointer<vtkDoubleArray> doubleArray = vtkSmartPointer<vtkDoubleArray>::New();
@@ -381,18 +302,13 @@ for( int t = 0; t < sp; ++t )
     doubleArray->SetName( colName.str().c_str() );
     doubleArray->SetNumberOfTuples(number_fiber);
     for( int r = 0; r < number_fiber; ++r )
-    { 
-      doubleArray->SetValue( r, Distance_matrix(r,idx(t))*pow(sp*Score(idx(t)),-0.5));
+    {
+      doubleArray->SetValue( r, R_Distance_matrix(t,r)*pow(sp*Score(t),-0.5));
     }
     inputData->AddColumn( doubleArray );
-        
-    std::cout<<"\rComputation of the reduced distance matrix: "
-	     <<100*(float)(t+1)/(float)sp
-             <<"% "
-             <<std::flush;
 }
+R_Distance_matrix.clear();
 
-std::cout << " --> done"<< std::endl;
 std::cout << "Size of the reduced distance matrix: [" << number_fiber << "," << sp << "]" << std::endl;
 
 //------------------------------------------------------------------------------
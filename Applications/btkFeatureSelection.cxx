@@ -119,6 +119,7 @@ int main(int argc, char *argv[])
         TCLAP::ValueArg< unsigned int > maxNumberOfParametersArg("n", "max_number_of_parameters", "Maximal number of parameters", false, 10, "unsigned int", cmd);
         TCLAP::ValueArg< float >              kernelBandwidthArg("b", "kernel_bandwidth", "Bandwidth of the kernel use for cost function", false, 1.0, "positive real", cmd);
         TCLAP::ValueArg< float >                    precisionArg("p", "precision", "Precision of the selection (in mm; corresponds to the mean vector error; default: 1 mm", false, 1.0, "positive real", cmd);
+        TCLAP::SwitchArg            exactBandwidthOptimizationArg("", "exact_bandwidth", "Optimize the kernel bandwidth with a Newton method reaching the minimum of the cost (default: gradient descent)", cmd);
 
         // Parsing arguments
         cmd.parse(argc, argv);
@@ -132,6 +133,7 @@ int main(int argc, char *argv[])
         unsigned int maxNumberOfParameters = maxNumberOfParametersArg.getValue();
         float              kernelBandwidth = kernelBandwidthArg.getValue();
         float                    precision = precisionArg.getValue();
+        bool    exactBandwidthOptimization = exactBandwidthOptimizationArg.getValue();
 
 
         //
@@ -248,6 +250,7 @@ int main(int argc, char *argv[])
         btk::NadarayaWatsonReconstructionErrorFunction::Pointer kernelCostFunction = btk::NadarayaWatsonReconstructionErrorFunction::New();
         kernelCostFunction->SetBandwidthMatrix(&H);
         kernelCostFunction->SetImagesWeightVector(&w);
+        kernelCostFunction->SetExactBandwidthOptimization(exactBandwidthOptimization);
         costFunction = kernelCostFunction;
 
         // Define optimizer for feature selection
@@ -398,9 +398,9 @@ int main( int argc, char *argv[] )
   {
     std::cout << "Iteration " << it << std::endl; std::cout.flush();
 
-    // Start registration
+    // Start registration (slice by slice registrations are parallelized over the slices of each image)
 
-    #pragma omp parallel for private(im) schedule(dynamic)
+    #pragma omp parallel for private(im) schedule(dynamic) if(rigid3D)
 
     for (im=0; im<numberOfImages; im++)
     {
@@ -436,6 +436,7 @@ int main( int argc, char *argv[] )
           registration[im] -> SetMovingImage( hrRefImage );
           registration[im] -> SetImageMask( imageMasks[im] );
           registration[im] -> SetTransform( transforms[im] );
+          registration[im] -> ParallelRegistrationOn();
 
           if (noreg)
             registration[im] -> SetIterations( 0 );
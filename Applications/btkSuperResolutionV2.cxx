@@ -155,6 +155,8 @@ int main(int argc, char * argv[])
 
     TCLAP::ValueArg<unsigned int> psfArg("","psf","Psf type -> 0 : BoxCar, 1: Gaussian (default), 2: Sinc, 3 : hybrid (sinc on x & y, gaussian on z)" ,false,1,"uint",cmd);
 
+    TCLAP::ValueArg<std::string> cacheArg("","hcache","Directory where the matrix H is stored and reloaded when the same inputs are used (no cache by default)" ,false,"","string",cmd);
+
 
     std::vector< std::string > input;
     std::vector< std::string > mask;
@@ -193,6 +195,8 @@ int main(int argc, char * argv[])
 
     float lambda = lambdaArg.getValue();
 
+    std::string cacheDirectory = cacheArg.getValue();
+
 
 
     inputsLRImages.resize(numberOfImages);
@@ -221,6 +225,8 @@ int main(int argc, char * argv[])
 
     SRFilter->SetLambda(lambda);
 
+    SRFilter->SetCacheDirectory(cacheDirectory);
+
     //If  simulation
     if(!simulation.empty())
     {
@@ -92,6 +92,7 @@ int main(int argc, char *argv[])
         TCLAP::ValueArg< std::string > outputFileNamePrefixArg("o", "output", "Prefix of the filenames of the outputs", false, "tractography", "string", cmd);
         TCLAP::SwitchArg            colorByLocalOrientationArg("", "local_orientation_color", "Color the output fibers by local orientation instead of mean orientation", cmd);
         TCLAP::ValueArg< unsigned int >     modelResolutionArg("", "model_resolution", "Resolution of the model (default: 300 points)", false, 300, "positive integer", cmd);
+        TCLAP::SwitchArg                         exactBasisArg("", "exact_sh_basis", "Evaluate the spherical harmonics basis analytically instead of using the tabulated basis (slower, for validation)", cmd, false);
 
         TCLAP::ValueArg< unsigned int >      shModelOrderArg("", "sh_model_order", "Order of the SH (spherical harmonics) model (default: 4, min,max: 2,8)", false, 4, "even integer between 2 and 8", cmd);
         TCLAP::ValueArg< double >   shModelRegularizationArg("", "sh_model_regularization", "Regularization of the SH (spherical harmonics) model estimation (default: 0.006)", false, 0.006, "positive real", cmd);
@@ -105,6 +106,7 @@ int main(int argc, char *argv[])
         TCLAP::ValueArg< unsigned int > numberOfParticlesArg("", "number_of_particles", "Number of particles used by the particle filtering (default: 200)", false, 200, "positive integer", cmd);
         TCLAP::ValueArg< double >     resamplingThresholdArg("", "resampling_threshold", "Resampling threshold of the particle filtering in percent (between 0 and 1) (default: 5% of the number of particles)", false, 0.05, "real between 0 and 1", cmd);
         TCLAP::ValueArg< double >         curveConstraintArg("", "curve_constraint", "Curve constraint of the particle filtering ; it is the concentration parameter of the von Mises-Fisher density (default: 30)", false, 30.0, "positive real", cmd);
+        TCLAP::ValueArg< unsigned int >         randomSeedArg("", "random_seed", "Seed of the random number generators of the particle filtering ; results only depend on this seed, not on the number of threads (default: 0)", false, 0, "positive integer", cmd);
 
         // Parsing arguments
         cmd.parse(argc, argv);
@@ -122,6 +124,7 @@ int main(int argc, char *argv[])
         std::string outputFileNamePrefix = outputFileNamePrefixArg.getValue();
         bool     colorByLocalOrientation = colorByLocalOrientationArg.getValue();
         unsigned int     modelResolution = modelResolutionArg.getValue();
+        bool                  exactBasis = exactBasisArg.getValue();
 
         unsigned int    shModelOrder = shModelOrderArg.getValue();
         double shModelRegularization = shModelRegularizationArg.getValue();
@@ -135,6 +138,7 @@ int main(int argc, char *argv[])
         unsigned int numberOfParticles = numberOfParticlesArg.getValue();
         double     resamplingThreshold = resamplingThresholdArg.getValue();
         double         curveConstraint = curveConstraintArg.getValue();
+        unsigned int        randomSeed = randomSeedArg.getValue();
 
 
         //
@@ -243,8 +247,17 @@ int main(int argc, char *argv[])
             odfModel->SetInputModelImage(shCoefficientsImage);
             odfModel->SetBValue(dwiSequence->GetBValues()[1]);
             odfModel->SetSphericalResolution(modelResolution);
+
+            if(exactBasis)
+            {
+                odfModel->UseExactBasisOn();
+            }
+
             odfModel->Update();
 
+            // Maxima of the ODF in the mask, used as mean directions by tractography algorithms
+            odfModel->ComputeMeanDirectionsCache(mask);
+
             model = odfModel;
 
             btkCoutMacro("done.");
@@ -281,6 +294,7 @@ int main(int argc, char *argv[])
             btkCoutMacro("\tResampling threshold: " << 100.0*resamplingThreshold << "%");
             btkCoutMacro("\tThreshold angle: " << 57.295779513083289*thresholdAngle << " °");
             btkCoutMacro("\tCurve constraint: " << curveConstraint);
+            btkCoutMacro("\tRandom seed: " << randomSeed);
 
             btk::ParticleFilteringTractographyAlgorithm::Pointer filterAlgorithm = btk::ParticleFilteringTractographyAlgorithm::New();
             filterAlgorithm->SetNumberOfParticles(numberOfParticles);
@@ -288,6 +302,7 @@ int main(int argc, char *argv[])
             filterAlgorithm->SetResamplingThreshold(resamplingThreshold*numberOfParticles);
             filterAlgorithm->SetCurveConstraint(curveConstraint);
             filterAlgorithm->SetThresholdAngle(thresholdAngle);
+            filterAlgorithm->SetRandomSeed(randomSeed);
 
             algorithm = filterAlgorithm;
 
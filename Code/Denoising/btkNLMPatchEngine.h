@@ -0,0 +1,197 @@
+/*
+Copyright or © or Copr. Université de Strasbourg - Centre National de la Recherche Scientifique
+
+18 october 2026
+agent@local
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#ifndef btkNLMPatchEngine_H
+#define btkNLMPatchEngine_H
+
+#include "itkImage.h"
+
+#include "vector"
+
+namespace btk
+{
+/**
+ * @class NLMPatchEngine
+ * @brief Patch access on the raw buffer of a 3D image, used by NLMTool.
+ * Patches lying fully inside the image are read as strided views into the image buffer
+ * (no copy). Patches crossing the image border are gathered into a caller-provided scratch
+ * array and zero padded, as done by NLMTool::GetPatch. Pixels are always visited in the
+ * same order as an itk::ImageRegionIterator (x first), so that the results are identical
+ * to the ones obtained with ITK patch images.
+ * @author agent
+ * @ingroup Denoising
+ */
+template <typename TPixelType>
+class NLMPatchEngine
+{
+ public:
+    /**
+     * @brief Image type.
+     */
+  typedef typename itk::Image< TPixelType, 3> itkTImage;
+    /**
+     * @brief Index type.
+     */
+  typedef typename itkTImage::IndexType IndexType;
+    /**
+     * @brief Size type.
+     */
+  typedef typename itkTImage::SizeType SizeType;
+
+  /**
+   * @brief Read-only view on a patch: rows along x are contiguous in memory.
+   */
+  struct PatchView
+  {
+    const TPixelType * data;  /**< first pixel of the patch */
+    long               rowStride;   /**< offset between two consecutive rows (y) */
+    long               sliceStride; /**< offset between two consecutive slices (z) */
+  };
+
+  /**
+   * @brief Per-thread scratch arrays, allocated once and reused for every voxel.
+   */
+  struct Workspace
+  {
+    std::vector<TPixelType> patch;          /**< denoised patch (estimate) */
+    std::vector<TPixelType> central;        /**< patch around the current voxel */
+    std::vector<TPixelType> centralRef;     /**< patch around the current voxel in the reference image */
+    std::vector<TPixelType> neighbour;      /**< scratch for border patches */
+    std::vector<TPixelType> neighbourRef;   /**< scratch for border patches of the reference image */
+  };
+
+  NLMPatchEngine();
+
+  /**
+   * @brief Set the size of the image the patches are extracted from.
+   * @param size Image size
+   */
+  void SetImageSize(const SizeType & size);
+  /**
+   * @brief Set the half size of the patches.
+   * @param halfPatchSize half patch size along each axis
+   */
+  void SetHalfPatchSize(const SizeType & halfPatchSize);
+  /**
+   * @brief Allocate the scratch arrays of a workspace for the current patch size.
+   * @param workspace workspace to allocate
+   */
+  void AllocateWorkspace(Workspace & workspace) const;
+  /**
+   * @brief Number of pixels of a full patch.
+   */
+  unsigned long GetNumberOfPixelsInPatch() const { return m_patchLength; }
+  /**
+   * @brief Position of the central pixel in a contiguous patch.
+   */
+  unsigned long GetCentralOffset() const { return m_centralOffset; }
+  /**
+   * @brief Linear offset of a pixel in the image buffer.
+   * @param p Index of the pixel
+   */
+  unsigned long ComputeOffset(const IndexType & p) const;
+  /**
+   * @brief Copy the (zero padded) patch centered on p into a contiguous array.
+   * @param buffer Image buffer
+   * @param p Center of the patch
+   * @param patch Output array of GetNumberOfPixelsInPatch() elements
+   */
+  void GetPatch(const TPixelType * buffer, const IndexType & p, TPixelType * patch) const;
+  /**
+   * @brief Get a view of the patch centered on p. No copy is done if the patch is fully inside the image.
+   * @param buffer Image buffer
+   * @param p Center of the patch
+   * @param scratch Array of GetNumberOfPixelsInPatch() elements used for border patches
+   */
+  PatchView GetPatchView(const TPixelType * buffer, const IndexType & p, TPixelType * scratch) const;
+  /**
+   * @brief View on a contiguous patch.
+   * @param patch Array of GetNumberOfPixelsInPatch() elements
+   */
+  PatchView GetContiguousView(const TPixelType * patch) const;
+  /**
+   * @brief Squared L2 distance between two patches.
+   */
+  double PatchDistance(const PatchView & p, const PatchView & q) const;
+  /**
+   * @brief Add a weighted patch to a contiguous patch estimate (patch += weight * q).
+   */
+  void AccumulatePatch(TPixelType * patch, const PatchView & q, double weight) const;
+  /**
+   * @brief Add a contiguous patch to an image buffer, and a weight to the weight buffer (only the part inside the image).
+   */
+  void AddPatchToImage(const IndexType & p, const TPixelType * patch, TPixelType * image, TPixelType * weightImage, double weight) const;
+  /**
+   * @brief Allocate a summed-area table (set to 0) covering the image extended by the half patch size on each side.
+   * @param table Summed-area table
+   */
+  void AllocateSummedAreaTable(std::vector<double> & table) const;
+  /**
+   * @brief Offset in the summed-area table of the value at position (x,y,z).
+   * The position may lie outside the image by at most the half patch size.
+   */
+  unsigned long ComputeTableOffset(long x, long y, long z) const;
+  /**
+   * @brief In-place cumulative sums of the table along x, y and z.
+   * @param table Table filled with values set using ComputeTableOffset
+   */
+  void ComputeSummedAreaTable(std::vector<double> & table) const;
+  /**
+   * @brief Sum of the values of the patch centered on p, in O(1) whatever the patch size.
+   * @param table Summed-area table (see ComputeSummedAreaTable)
+   * @param p Center of the patch
+   */
+  double BoxSum(const std::vector<double> & table, const IndexType & p) const;
+
+ private:
+  /**
+   * @brief Clip the patch centered on p to the image domain.
+   * @return true if the patch is fully inside the image
+   */
+  bool ComputePatchBounds(const IndexType & p, long start[3], long end[3]) const;
+
+  long          m_imageSize[3];     /**< size of the image */
+  long          m_halfPatchSize[3]; /**< half size of the patch */
+  long          m_fullPatchSize[3]; /**< 2 * halfPatchSize + 1 */
+  unsigned long m_patchLength;      /**< number of pixels in a patch */
+  unsigned long m_centralOffset;    /**< offset of the central pixel in a contiguous patch */
+  long          m_tableSize[3];     /**< size of the summed-area tables : imageSize + 2 * halfPatchSize + 1 */
+};
+}
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "btkNLMPatchEngine.txx"
+#endif
+
+
+#endif
@@ -0,0 +1,325 @@
+/*
+Copyright or © or Copr. Université de Strasbourg - Centre National de la Recherche Scientifique
+
+18 october 2026
+agent@local
+
+This software is governed by the CeCILL-B license under French law and
+abiding by the rules of distribution of free software.  You can  use,
+modify and/ or redistribute the software under the terms of the CeCILL-B
+license as circulated by CEA, CNRS and INRIA at the following URL
+"http://www.cecill.info".
+
+As a counterpart to the access to the source code and  rights to copy,
+modify and redistribute granted by the license, users are provided only
+with a limited warranty  and the software's author,  the holder of the
+economic rights,  and the successive licensors  have only  limited
+liability.
+
+In this respect, the user's attention is drawn to the risks associated
+with loading,  using,  modifying and/or developing or reproducing the
+software by the user in light of its specific status of free software,
+that may mean  that it is complicated to manipulate,  and  that  also
+therefore means  that it is reserved for developers  and  experienced
+professionals having in-depth computer knowledge. Users are therefore
+encouraged to load and test the software's suitability as regards their
+requirements in conditions enabling the security of their systems and/or
+data to be ensured and,  more generally, to use and operate it in the
+same conditions as regards security.
+
+The fact that you are presently reading this means that you have had
+knowledge of the CeCILL-B license and that you accept its terms.
+*/
+
+#ifndef __BTKNLMPATCHENGINE_TXX__
+#define __BTKNLMPATCHENGINE_TXX__
+
+#include "btkNLMPatchEngine.h"
+
+#include "algorithm"
+
+namespace btk
+{
+template <typename T>
+NLMPatchEngine<T>::NLMPatchEngine()
+{
+  for(unsigned int i=0; i<3; i++)
+  {
+    m_imageSize[i] = 0;
+    m_halfPatchSize[i] = 0;
+    m_fullPatchSize[i] = 1;
+    m_tableSize[i] = 1;
+  }
+  m_patchLength = 1;
+  m_centralOffset = 0;
+}
+
+template <typename T>
+void NLMPatchEngine<T>::SetImageSize(const SizeType & size)
+{
+  for(unsigned int i=0; i<3; i++)
+  {
+    m_imageSize[i] = size[i];
+    m_tableSize[i] = m_imageSize[i] + 2 * m_halfPatchSize[i] + 1;
+  }
+}
+
+template <typename T>
+void NLMPatchEngine<T>::SetHalfPatchSize(const SizeType & halfPatchSize)
+{
+  for(unsigned int i=0; i<3; i++)
+  {
+    m_halfPatchSize[i] = halfPatchSize[i];
+    m_fullPatchSize[i] = 2 * m_halfPatchSize[i] + 1;
+    m_tableSize[i] = m_imageSize[i] + 2 * m_halfPatchSize[i] + 1;
+  }
+  m_patchLength   = m_fullPatchSize[0] * m_fullPatchSize[1] * m_fullPatchSize[2];
+  m_centralOffset = m_halfPatchSize[0] + m_fullPatchSize[0] * ( m_halfPatchSize[1] + m_fullPatchSize[1] * m_halfPatchSize[2] );
+}
+
+template <typename T>
+void NLMPatchEngine<T>::AllocateWorkspace(Workspace & workspace) const
+{
+  workspace.patch.assign(m_patchLength, 0);
+  workspace.central.assign(m_patchLength, 0);
+  workspace.centralRef.assign(m_patchLength, 0);
+  workspace.neighbour.assign(m_patchLength, 0);
+  workspace.neighbourRef.assign(m_patchLength, 0);
+}
+
+template <typename T>
+unsigned long NLMPatchEngine<T>::ComputeOffset(const IndexType & p) const
+{
+  return p[0] + m_imageSize[0] * ( p[1] + m_imageSize[1] * p[2] );
+}
+
+template <typename T>
+bool NLMPatchEngine<T>::ComputePatchBounds(const IndexType & p, long start[3], long end[3]) const
+{
+  bool inside = true;
+  for(unsigned int i=0; i<3; i++)
+  {
+    start[i] = p[i] - m_halfPatchSize[i];
+    end[i]   = p[i] + m_halfPatchSize[i] + 1;
+    if(start[i] < 0)
+    {
+      start[i] = 0;
+      inside = false;
+    }
+    if(end[i] > m_imageSize[i])
+    {
+      end[i] = m_imageSize[i];
+      inside = false;
+    }
+  }
+  return inside;
+}
+
+template <typename T>
+void NLMPatchEngine<T>::GetPatch(const T * buffer, const IndexType & p, T * patch) const
+{
+  //equivalent to NLMTool::GetPatch : pixels outside the image are set to 0
+  long start[3], end[3];
+  bool inside = ComputePatchBounds(p, start, end);
+
+  if(!inside)
+  {
+    std::fill(patch, patch + m_patchLength, T(0));
+  }
+
+  for(long z = start[2]; z < end[2]; z++)
+  {
+    long pz = z - p[2] + m_halfPatchSize[2];
+    for(long y = start[1]; y < end[1]; y++)
+    {
+      long py = y - p[1] + m_halfPatchSize[1];
+      const T * row = buffer + start[0] + m_imageSize[0] * ( y + m_imageSize[1] * z );
+      T * out = patch + (start[0] - p[0] + m_halfPatchSize[0]) + m_fullPatchSize[0] * ( py + m_fullPatchSize[1] * pz );
+      std::copy(row, row + (end[0] - start[0]), out);
+    }
+  }
+}
+
+template <typename T>
+typename NLMPatchEngine<T>::PatchView
+NLMPatchEngine<T>::GetContiguousView(const T * patch) const
+{
+  PatchView view;
+  view.data        = patch;
+  view.rowStride   = m_fullPatchSize[0];
+  view.sliceStride = m_fullPatchSize[0] * m_fullPatchSize[1];
+  return view;
+}
+
+template <typename T>
+typename NLMPatchEngine<T>::PatchView
+NLMPatchEngine<T>::GetPatchView(const T * buffer, const IndexType & p, T * scratch) const
+{
+  long start[3], end[3];
+  if(ComputePatchBounds(p, start, end))
+  {
+    PatchView view;
+    view.data        = buffer + start[0] + m_imageSize[0] * ( start[1] + m_imageSize[1] * start[2] );
+    view.rowStride   = m_imageSize[0];
+    view.sliceStride = m_imageSize[0] * m_imageSize[1];
+    return view;
+  }
+
+  GetPatch(buffer, p, scratch);
+  return GetContiguousView(scratch);
+}
+
+template <typename T>
+double NLMPatchEngine<T>::PatchDistance(const PatchView & p, const PatchView & q) const
+{
+  double diff = 0;
+  double dist = 0;
+  const long nx = m_fullPatchSize[0];
+
+  for(long z = 0; z < m_fullPatchSize[2]; z++)
+  {
+    for(long y = 0; y < m_fullPatchSize[1]; y++)
+    {
+      const T * rp = p.data + y * p.rowStride + z * p.sliceStride;
+      const T * rq = q.data + y * q.rowStride + z * q.sliceStride;
+      for(long x = 0; x < nx; x++)
+      {
+        diff = rp[x] - rq[x];
+        dist += diff*diff;
+      }
+    }
+  }
+  return dist;
+}
+
+template <typename T>
+void NLMPatchEngine<T>::AccumulatePatch(T * patch, const PatchView & q, double weight) const
+{
+  const long nx = m_fullPatchSize[0];
+
+  for(long z = 0; z < m_fullPatchSize[2]; z++)
+  {
+    for(long y = 0; y < m_fullPatchSize[1]; y++)
+    {
+      const T * rq = q.data + y * q.rowStride + z * q.sliceStride;
+      T * rp = patch + nx * ( y + m_fullPatchSize[1] * z );
+      for(long x = 0; x < nx; x++)
+      {
+        rp[x] = rp[x] + rq[x] * weight;
+      }
+    }
+  }
+}
+
+template <typename T>
+void NLMPatchEngine<T>::AddPatchToImage(const IndexType & p, const T * patch, T * image, T * weightImage, double weight) const
+{
+  long start[3], end[3];
+  ComputePatchBounds(p, start, end);
+
+  for(long z = start[2]; z < end[2]; z++)
+  {
+    long pz = z - p[2] + m_halfPatchSize[2];
+    for(long y = start[1]; y < end[1]; y++)
+    {
+      long py = y - p[1] + m_halfPatchSize[1];
+      long offset = m_imageSize[0] * ( y + m_imageSize[1] * z );
+      const T * in = patch + (start[0] - p[0] + m_halfPatchSize[0]) + m_fullPatchSize[0] * ( py + m_fullPatchSize[1] * pz );
+      for(long x = start[0]; x < end[0]; x++, in++)
+      {
+        image[offset + x] = image[offset + x] + *in;
+        weightImage[offset + x] = weightImage[offset + x] + weight;
+      }
+    }
+  }
+}
+
+template <typename T>
+void NLMPatchEngine<T>::AllocateSummedAreaTable(std::vector<double> & table) const
+{
+  table.assign(m_tableSize[0] * m_tableSize[1] * m_tableSize[2], 0.0);
+}
+
+template <typename T>
+unsigned long NLMPatchEngine<T>::ComputeTableOffset(long x, long y, long z) const
+{
+  //the first row, column and slice of the table are kept to 0
+  return (x + m_halfPatchSize[0] + 1) + m_tableSize[0] * ( (y + m_halfPatchSize[1] + 1) + m_tableSize[1] * (z + m_halfPatchSize[2] + 1) );
+}
+
+template <typename T>
+void NLMPatchEngine<T>::ComputeSummedAreaTable(std::vector<double> & table) const
+{
+  const long nx = m_tableSize[0];
+  const long ny = m_tableSize[1];
+  const long nz = m_tableSize[2];
+  const long sliceSize = nx * ny;
+  double * data = &table[0];
+  long x,y,z;
+
+  //cumulative sum along x
+  #pragma omp parallel for private(x,y,z) schedule(static)
+  for(z=0; z < nz; z++)
+  {
+    for(y=0; y < ny; y++)
+    {
+      double * row = data + z * sliceSize + y * nx;
+      for(x=1; x < nx; x++)
+      {
+        row[x] += row[x-1];
+      }
+    }
+  }
+
+  //cumulative sum along y
+  #pragma omp parallel for private(x,y,z) schedule(static)
+  for(z=0; z < nz; z++)
+  {
+    double * slice = data + z * sliceSize;
+    for(y=1; y < ny; y++)
+    {
+      for(x=0; x < nx; x++)
+      {
+        slice[y * nx + x] += slice[(y-1) * nx + x];
+      }
+    }
+  }
+
+  //cumulative sum along z
+  #pragma omp parallel for private(x,y,z) schedule(static)
+  for(y=0; y < ny; y++)
+  {
+    for(z=1; z < nz; z++)
+    {
+      double * row         = data + z * sliceSize + y * nx;
+      const double * below = row - sliceSize;
+      for(x=0; x < nx; x++)
+      {
+        row[x] += below[x];
+      }
+    }
+  }
+}
+
+template <typename T>
+double NLMPatchEngine<T>::BoxSum(const std::vector<double> & table, const IndexType & p) const
+{
+  //the patch covers the table indices [p+1, p+2*halfPatchSize+1] along each axis
+  const long x0 = p[0], x1 = p[0] + m_fullPatchSize[0];
+  const long y0 = p[1], y1 = p[1] + m_fullPatchSize[1];
+  const long z0 = p[2], z1 = p[2] + m_fullPatchSize[2];
+  const long nx = m_tableSize[0];
+  const long sliceSize = m_tableSize[0] * m_tableSize[1];
+
+  return   table[x1 + nx * y1 + sliceSize * z1]
+         - table[x0 + nx * y1 + sliceSize * z1]
+         - table[x1 + nx * y0 + sliceSize * z1]
+         - table[x1 + nx * y1 + sliceSize * z0]
+         + table[x0 + nx * y0 + sliceSize * z1]
+         + table[x0 + nx * y1 + sliceSize * z0]
+         + table[x1 + nx * y0 + sliceSize * z0]
+         - table[x0 + nx * y0 + sliceSize * z0];
+}
+
+}
+#endif // btkNLMPatchEngine_TXX
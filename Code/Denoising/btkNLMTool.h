@@ -50,6 +50,9 @@ knowledge of the CeCILL-B license and that you accept its terms.
 #include "itkImageRegionIteratorWithIndex.h"
 #include "itkCastImageFilter.h"
 
+#include "btkNLMPatchEngine.h"
+#include "btkSlabSchedule.h"
+
 #include "string"
 #include "iomanip"
 #include "sstream"
@@ -96,6 +99,14 @@ class NLMTool
      * @brief itk ImageregionIteratorWithIndex type
      */
   typedef typename itk::ImageRegionIteratorWithIndex< itkTImage > itkTIteratorWithIndex;
+    /**
+     * @brief Patch engine type (flat buffer access to patches)
+     */
+  typedef NLMPatchEngine< TPixelType > PatchEngineType;
+    /**
+     * @brief Per-thread scratch arrays of the patch engine
+     */
+  typedef typename PatchEngineType::Workspace PatchWorkspaceType;
 
     /**
      * @brief Set Input Image
@@ -228,6 +239,15 @@ class NLMTool
    * @param Todo
    */
   double GetDenoisedPatchUsingTheReferenceImage(typename itkTImage::IndexType p, itkTPointer & patch);
+  /**
+   * @brief Compute the denoised patch around p using the flat-buffer patch engine.
+   * The result is stored in workspace.patch.
+   * @param p Index of the central pixel
+   * @param workspace Scratch arrays of the calling thread (see PatchEngineType::AllocateWorkspace)
+   * @param useTheReferenceImage Compute the patch distances on the reference image
+   * @return Sum of the weights
+   */
+  double GetDenoisedPatch(typename itkTImage::IndexType p, PatchWorkspaceType & workspace, bool useTheReferenceImage);
   /**
    * @brief Todo
    * @param Todo
@@ -243,6 +263,23 @@ class NLMTool
    * @param Todo
    */
   bool CheckSpeed(typename itkTImage::IndexType p, typename itkTImage::IndexType q);
+  /**
+   * @brief Compute the mean and variance images (optimized mode) using summed-area tables of the input image.
+   * The cost per voxel does not depend on the patch size.
+   */
+  void ComputeMeanAndVarianceUsingIntegralImages();
+  /**
+   * @brief Pointwise denoising (blockwise strategy 3) using one summed-area table of squared differences per search offset.
+   * Each patch distance is computed in O(1) whatever the patch size.
+   * @param denoisedImage Output image (only voxels of the mask are set)
+   */
+  void ComputeIntegralPointwiseOutput(itkTPointer & denoisedImage);
+  /**
+   * @brief Same as CheckSpeed, using linear offsets in the image buffers
+   * @param p Offset of the central pixel
+   * @param q Offset of the neighbour pixel
+   */
+  bool CheckSpeed(unsigned long p, unsigned long q);
 
 protected:
 
@@ -259,6 +296,8 @@ protected:
   typename itkTImage::SizeType    m_size;/**< size */
   typename itkTImage::RegionType  m_region;/**< region */
 
+  PatchEngineType m_patchEngine;/**< flat-buffer patch access */
+
 private :
 
   typename itkTImage::SizeType m_halfPatchSize;          /**< half of the patch size*/
@@ -268,7 +307,7 @@ private :
 
   float m_padding; /**< float value of padding */
   int   m_centralPointStrategy; /**< todo */
-  int   m_blockwise;/**< todo */
+  int   m_blockwise;/**< 0: pointwise, 1: blockwise, 2: fast blockwise, 3: pointwise using integral images */
   int   m_optimized;/**< todo */
   float m_lowerMeanThreshold;/**< todo */
   float m_lowerVarianceThreshold;/**< todo */
@@ -13,6 +13,7 @@ void NLMTool<T>::SetInput(itkTPointer inputImage)
   m_region  = m_inputImage->GetLargestPossibleRegion();
   m_size    = m_region.GetSize();
   m_spacing = m_inputImage->GetSpacing();
+  m_patchEngine.SetImageSize(m_size);
 
   //duplicate the input image into the output image to keep all header information
   typename itkTDuplicator::Pointer duplicator = itkTDuplicator::New();
@@ -75,6 +76,8 @@ void NLMTool<T>::SetPatchSize(int h)
   m_fullPatchSize[0] = 2 * m_halfPatchSize[0] + 1;
   m_fullPatchSize[1] = 2 * m_halfPatchSize[1] + 1;
   m_fullPatchSize[2] = 2 * m_halfPatchSize[2] + 1;
+
+  m_patchEngine.SetHalfPatchSize(m_halfPatchSize);
 }
 
 template <typename T>
@@ -206,39 +209,52 @@ void NLMTool<T>::SetOptimizationStrategy(int o)
         m_varianceImage->Allocate();
         m_varianceImage->FillBuffer(0);
 
-        int x,y,z;
-        #pragma omp parallel for private(x,y,z) schedule(dynamic)
+        if(m_blockwise == 3)
+        {
+            ComputeMeanAndVarianceUsingIntegralImages();
+            return;
+        }
 
-        for(z=0; z < (int)m_size[2]; z++)
+        const T * inputBuffer = m_inputImage->GetBufferPointer();
+        const T * maskBuffer  = m_maskImage->GetBufferPointer();
+        T * meanBuffer        = m_meanImage->GetBufferPointer();
+        T * varianceBuffer    = m_varianceImage->GetBufferPointer();
+        const int n = m_patchEngine.GetNumberOfPixelsInPatch();
+
+        int x,y,z;
+        #pragma omp parallel private(x,y,z)
         {
-            for(y=0; y < (int)m_size[1]; y++)
+            std::vector<T> patch(n);
+
+            #pragma omp for schedule(dynamic)
+            for(z=0; z < (int)m_size[2]; z++)
             {
-                for(x=0; x < (int)m_size[0]; x++)
+                for(y=0; y < (int)m_size[1]; y++)
                 {
-                    typename itkTImage::IndexType p;
-                    p[0] = x;
-                    p[1] = y;
-                    p[2] = z;
-
-                    if( m_maskImage->GetPixel(p) > 0 )
+                    for(x=0; x < (int)m_size[0]; x++)
                     {
-                        itkTPointer patch = itkTImage::New();
-                        CreatePatch(patch);
-                        GetPatch(p,patch);
-                        itkTIterator itp( patch, patch->GetRequestedRegion() );
-                        double m = 0;
-                        double m2= 0;
-                        for(itp.GoToBegin(); !itp.IsAtEnd(); ++itp)
+                        typename itkTImage::IndexType p;
+                        p[0] = x;
+                        p[1] = y;
+                        p[2] = z;
+                        unsigned long offset = m_patchEngine.ComputeOffset(p);
+
+                        if( maskBuffer[offset] > 0 )
                         {
-                            m += itp.Get();
-                            m2+= (itp.Get() * itp.Get());
-                        }
-                        int n = patch->GetLargestPossibleRegion().GetNumberOfPixels();
-                        float mean = m / n;
-                        float variance = (m2 / n) - (mean * mean) ;
+                            m_patchEngine.GetPatch(inputBuffer, p, &patch[0]);
+                            double m = 0;
+                            double m2= 0;
+                            for(int i=0; i<n; i++)
+                            {
+                                m += patch[i];
+                                m2+= (patch[i] * patch[i]);
+                            }
+                            float mean = m / n;
+                            float variance = (m2 / n) - (mean * mean) ;
 
-                        m_meanImage->SetPixel( p, mean );
-                        m_varianceImage->SetPixel( p, variance );
+                            meanBuffer[offset] = mean;
+                            varianceBuffer[offset] = variance;
+                        }
                     }
                 }
             }
@@ -472,48 +488,49 @@ void NLMTool<T>::ComputeOutput()
   itkTIterator denoisedIt( denoisedImage, denoisedImage->GetLargestPossibleRegion() );
   itkTIterator outputIt( m_outputImage, m_outputImage->GetLargestPossibleRegion());
 
+  T * denoisedBuffer = denoisedImage->GetBufferPointer();
+  const T * maskBuffer = m_maskImage->GetBufferPointer();
+  const unsigned long centralOffset = m_patchEngine.GetCentralOffset();
+
   int x,y,z;
 
   if(m_blockwise == 0)
   {
     std::cout<<"pointwise denoising"<<std::endl;
-    typename itkTImage::IndexType q;
-    for(unsigned int i=0; i!= q.GetIndexDimension(); i++)
-    {
-      q[i] = m_halfPatchSize[i];
-    }
-      #pragma omp parallel for private(x,y,z) schedule(dynamic)
-      for(z=0; z < (int)m_size[2]; z++)
+      #pragma omp parallel private(x,y,z)
       {
-        for(y=0; y < (int)m_size[1]; y++)
+        PatchWorkspaceType workspace;
+        m_patchEngine.AllocateWorkspace(workspace);
+
+        #pragma omp for schedule(dynamic)
+        for(z=0; z < (int)m_size[2]; z++)
         {
-          for(x=0; x < (int)m_size[0]; x++)
+          for(y=0; y < (int)m_size[1]; y++)
           {
-            typename itkTImage::IndexType p;
-            p[0] = x;
-            p[1] = y;
-            p[2] = z;
-
-            if( m_maskImage->GetPixel(p) > 0 )
+            for(x=0; x < (int)m_size[0]; x++)
             {
-              itkTPointer patch = itkTImage::New();
-              double sum = 0;
-              if(m_useTheReferenceImage==false)
-              {
-                  sum = GetDenoisedPatch(p, patch);
-              }
-              else
+              typename itkTImage::IndexType p;
+              p[0] = x;
+              p[1] = y;
+              p[2] = z;
+              unsigned long offset = m_patchEngine.ComputeOffset(p);
+
+              if( maskBuffer[offset] > 0 )
               {
-                  sum = GetDenoisedPatchUsingTheReferenceImage(p, patch);
+                GetDenoisedPatch(p, workspace, m_useTheReferenceImage);
+                denoisedBuffer[offset] = workspace.patch[centralOffset];
               }
-
-              denoisedImage->SetPixel( p, patch->GetPixel(q) );
             }
           }
         }
       }
   }
-  if(m_blockwise >= 1)
+  if(m_blockwise == 3)
+  {
+    std::cout<<"pointwise denoising using integral images"<<std::endl;
+    ComputeIntegralPointwiseOutput(denoisedImage);
+  }
+  if( (m_blockwise >= 1) && (m_blockwise <= 2) )
   {
     itkTPointer weightImage = itkTImage::New();
     weightImage->SetRegions(m_inputImage->GetLargestPossibleRegion());
@@ -522,88 +539,63 @@ void NLMTool<T>::ComputeOutput()
     weightImage->SetDirection( m_inputImage->GetDirection() );
     weightImage->Allocate();
     weightImage->FillBuffer(0);
+    T * weightBuffer = weightImage->GetBufferPointer();
 
+    //step between two processed voxels : 1 for blockwise, halfPatchSize+1 for fast blockwise
+    int step[3] = {1, 1, 1};
     if(m_blockwise == 1)
     {
       std::cout<<"blockwise denoising"<<std::endl;
-      #pragma omp parallel for private(x,y,z) schedule(dynamic)
-      for(z=0; z < (int)m_size[2]; z++)
+    }
+    if(m_blockwise == 2)
+    {
+      std::cout<<"fast blockwise denoising"<<std::endl;
+      for(unsigned int i=0; i<3; i++)
       {
-        for(y=0; y < (int)m_size[1]; y++)
-        {
-          for(x=0; x < (int)m_size[0]; x++)
-          {
-            typename itkTImage::IndexType p;
-            p[0] = x;
-            p[1] = y;
-            p[2] = z;
-
-            if( m_maskImage->GetPixel(p) > 0 )
-            {
-              itkTPointer patch = itkTImage::New();
-              double sum = 0;
-              if(m_useTheReferenceImage==false)
-              {
-                  sum = GetDenoisedPatch(p, patch);
-              }
-              else
-              {
-                  sum = GetDenoisedPatchUsingTheReferenceImage(p, patch);
-              }
-
-              double weight = 1.0;
-              #pragma omp critical
-              AddPatchToImage(p, patch, denoisedImage, weightImage, weight);
-            }
-          }
-        }
+        step[i] = m_halfPatchSize[i]+1;
       }
     }
-    if(m_blockwise == 2)
+
+    //patches centered in slabs of the same colour do not overlap : no lock is needed for the aggregation
+    SlabSchedule schedule(m_size[2], m_halfPatchSize[2]);
+
+    #pragma omp parallel private(x,y,z)
     {
-        std::cout<<"fast blockwise denoising"<<std::endl;
-        //TODO: Simplify this, there is to much for-if-for !
-        #pragma omp parallel for private(x,y,z) schedule(dynamic)
-        for(z=0; z < (int)m_size[2]; z++)
+      PatchWorkspaceType workspace;
+      m_patchEngine.AllocateWorkspace(workspace);
+
+      for(int color = 0; color < 2; color++)
+      {
+        #pragma omp for schedule(dynamic)
+        for(int slab = color; slab < schedule.GetNumberOfSlabs(); slab += 2)
         {
-            if( z%(m_halfPatchSize[2]+1) == 0)
+          for(z = schedule.GetSlabBegin(slab); z < schedule.GetSlabEnd(slab); z++)
+          {
+            if( z%step[2] != 0 )
             {
-                for(y=0; y < (int)m_size[1]; y++)
+              continue;
+            }
+            for(y=0; y < (int)m_size[1]; y+=step[1])
+            {
+              for(x=0; x < (int)m_size[0]; x+=step[0])
+              {
+                typename itkTImage::IndexType p;
+                p[0] = x;
+                p[1] = y;
+                p[2] = z;
+
+                if( maskBuffer[m_patchEngine.ComputeOffset(p)] > 0 )
                 {
-                    if( y%(m_halfPatchSize[1]+1) == 0)
-                    {
-                        for(x=0; x < (int)m_size[0]; x++)
-                        {
-                            if( x%(m_halfPatchSize[0]+1) == 0 )
-                            {
-                                typename itkTImage::IndexType p;
-                                p[0] = x;
-                                p[1] = y;
-                                p[2] = z;
-
-                                if( m_maskImage->GetPixel(p) > 0 )
-                                {
-                                    itkTPointer patch = itkTImage::New();
-                                    double sum = 0;
-                                    if(m_useTheReferenceImage==false)
-                                    {
-                                        sum = GetDenoisedPatch(p, patch);
-                                    }
-                                    else
-                                    {
-                                        sum = GetDenoisedPatchUsingTheReferenceImage(p, patch);
-                                    }
-
-                                    double weight = 1.0;
-                                    #pragma omp critical
-                                    AddPatchToImage(p, patch, denoisedImage, weightImage, weight);
-                                }
-                            }
-                        }
-                    }
+                  GetDenoisedPatch(p, workspace, m_useTheReferenceImage);
+
+                  double weight = 1.0;
+                  m_patchEngine.AddPatchToImage(p, &workspace.patch[0], denoisedBuffer, weightBuffer, weight);
                 }
+              }
             }
+          }
         }
+      }
     }
 
     itkTIterator weightIt( weightImage, weightImage->GetLargestPossibleRegion() );
@@ -766,93 +758,135 @@ double NLMTool<T>::PatchDistance(itkTPointer & p,itkTPointer & q)
 
 template <typename T>
 double NLMTool<T>::GetDenoisedPatch(typename itkTImage::IndexType p, itkTPointer & patch)
+{
+  //ITK interface of the patch engine : the denoised patch is copied into an itk image
+  PatchWorkspaceType workspace;
+  m_patchEngine.AllocateWorkspace(workspace);
+
+  double sum = GetDenoisedPatch(p, workspace, false);
+
+  CreatePatch(patch);
+  std::copy(workspace.patch.begin(), workspace.patch.end(), patch->GetBufferPointer());
+  return sum;
+}
+
+template <typename T>
+double NLMTool<T>::GetDenoisedPatchUsingTheReferenceImage(typename itkTImage::IndexType p, itkTPointer & patch)
+{
+  //ITK interface of the patch engine : the denoised patch is copied into an itk image
+  PatchWorkspaceType workspace;
+  m_patchEngine.AllocateWorkspace(workspace);
+
+  double sum = GetDenoisedPatch(p, workspace, true);
+
+  CreatePatch(patch);
+  std::copy(workspace.patch.begin(), workspace.patch.end(), patch->GetBufferPointer());
+  return sum;
+}
+
+template <typename T>
+double NLMTool<T>::GetDenoisedPatch(typename itkTImage::IndexType p, PatchWorkspaceType & workspace, bool useTheReferenceImage)
 {
   double wmax = 0; //maximum weight of patches
   double sum  = 0; //sum of weights (used for normalization purpose)
-  double rangeBandwidth = m_rangeBandwidthImage->GetPixel(p);
+  const unsigned long n = m_patchEngine.GetNumberOfPixelsInPatch();
+  const unsigned long pOffset = m_patchEngine.ComputeOffset(p);
+  double rangeBandwidth = m_rangeBandwidthImage->GetBufferPointer()[pOffset];
+
+  const T * inputBuffer = m_inputImage->GetBufferPointer();
+  //patch distances are computed on the reference image if any, patches are always taken from the input image
+  const T * distanceBuffer = inputBuffer;
+  if(useTheReferenceImage == true)
+  {
+    distanceBuffer = m_refImage->GetBufferPointer();
+  }
 
-  //create the patch and set the estimate to 0
-  CreatePatch(patch);
-  itkTIterator patchIt(patch, patch->GetRequestedRegion());
+  //set the estimate to 0
+  T * patch = &workspace.patch[0];
+  std::fill(patch, patch + n, T(0));
 
   //get the value of the patch around the current pixel
-  itkTPointer centralPatch = itkTImage::New();
-  CreatePatch(centralPatch);
-  GetPatch(p,centralPatch);
-  itkTIterator centralPatchIt(centralPatch, centralPatch->GetRequestedRegion());
+  T * centralPatch = &workspace.central[0];
+  m_patchEngine.GetPatch(inputBuffer, p, centralPatch);
+
+  typename PatchEngineType::PatchView centralView = m_patchEngine.GetContiguousView(centralPatch);
+  if(useTheReferenceImage == true)
+  {
+    m_patchEngine.GetPatch(distanceBuffer, p, &workspace.centralRef[0]);
+    centralView = m_patchEngine.GetContiguousView(&workspace.centralRef[0]);
+  }
 
   //set the search region around the current pixel
   typename itkTImage::RegionType searchRegion;
   ComputeSearchRegion(p,searchRegion);
+  typename itkTImage::IndexType start = searchRegion.GetIndex();
+  typename itkTImage::SizeType  size  = searchRegion.GetSize();
 
-  //create the patch for pixels in the neighbourhood of the current pixel
-  itkTPointer neighbourPatch = itkTImage::New();
-  CreatePatch(neighbourPatch);
-  itkTIterator neighbourPatchIt(neighbourPatch, neighbourPatch->GetRequestedRegion());
-
-  //go through the neighbourhood with a region iterator
-  itkTIteratorWithIndex it( m_inputImage, searchRegion);
+  //go through the neighbourhood (same order as an itk region iterator)
   typename itkTImage::IndexType neighbourPixelIndex;
 
-  for(it.GoToBegin(); !it.IsAtEnd(); ++it)
+  for(long k = 0; k < (long)size[2]; k++)
   {
-    neighbourPixelIndex = it.GetIndex();
-
-    bool goForIt = true;
-    if(m_optimized == 1)
+    neighbourPixelIndex[2] = start[2] + k;
+    for(long j = 0; j < (long)size[1]; j++)
     {
-      goForIt = CheckSpeed(p, neighbourPixelIndex);
-    }
+      neighbourPixelIndex[1] = start[1] + j;
+      for(long i = 0; i < (long)size[0]; i++)
+      {
+        neighbourPixelIndex[0] = start[0] + i;
 
-    if(goForIt == true)
-    {
+        bool goForIt = true;
+        if(m_optimized == 1)
+        {
+          goForIt = CheckSpeed(pOffset, m_patchEngine.ComputeOffset(neighbourPixelIndex));
+        }
+
+        if(goForIt == true)
+        {
+          typename PatchEngineType::PatchView neighbourView = m_patchEngine.GetPatchView(inputBuffer, neighbourPixelIndex, &workspace.neighbour[0]);
+          typename PatchEngineType::PatchView neighbourDistanceView = neighbourView;
+          if(useTheReferenceImage == true)
+          {
+            neighbourDistanceView = m_patchEngine.GetPatchView(distanceBuffer, neighbourPixelIndex, &workspace.neighbourRef[0]);
+          }
 
-      GetPatch(neighbourPixelIndex, neighbourPatch);
-      double weight = exp( - PatchDistance(centralPatch, neighbourPatch) / rangeBandwidth);
+          double weight = exp( - m_patchEngine.PatchDistance(centralView, neighbourDistanceView) / rangeBandwidth);
 
-      if(weight>wmax)
-      {
-          if( (p[0] != neighbourPixelIndex[0]) && (p[1] != neighbourPixelIndex[1]) && (p[2] != neighbourPixelIndex[2]) )//has to be modify
+          if(weight>wmax)
           {
+            if( (p[0] != neighbourPixelIndex[0]) && (p[1] != neighbourPixelIndex[1]) && (p[2] != neighbourPixelIndex[2]) )//has to be modify
+            {
               wmax = weight;
+            }
           }
-      }
 
-      sum += weight;
+          sum += weight;
 
-      //Add this patch to the current estimate using the computed weight
-      for(patchIt.GoToBegin(), neighbourPatchIt.GoToBegin(); !patchIt.IsAtEnd(); ++patchIt, ++neighbourPatchIt)
-      {
-        patchIt.Set( patchIt.Get() + neighbourPatchIt.Get() * weight );
+          //Add this patch to the current estimate using the computed weight
+          m_patchEngine.AccumulatePatch(patch, neighbourView, weight);
+        }
       }
     }
   }
 
-
   //consider now the special case of the central patch
   switch(m_centralPointStrategy)
   {
   case 0:                                        //remove the central patch to the estimated patch
-      for(patchIt.GoToBegin(), centralPatchIt.GoToBegin(); !patchIt.IsAtEnd(); ++patchIt, ++centralPatchIt)
+      for(unsigned long i=0; i<n; i++)
       {
-          patchIt.Set( patchIt.Get() -1.0 * centralPatchIt.Get() );
+          patch[i] = patch[i] -1.0 * centralPatch[i];
       }
       sum -= 1.0;
       break;
   case 1:
       break;                                 //nothing to do
   case -1:
-      for(patchIt.GoToBegin(), centralPatchIt.GoToBegin(); !patchIt.IsAtEnd(); ++patchIt, ++centralPatchIt)
-      {
-          patchIt.Set( patchIt.Get()  + (wmax -1.0) * centralPatchIt.Get() );
-      }
-      sum += (wmax - 1.0);
-      break;
   default:
-      //as in case -1
-      for(patchIt.GoToBegin(), centralPatchIt.GoToBegin(); !patchIt.IsAtEnd(); ++patchIt, ++centralPatchIt)
+      //default : as in case -1
+      for(unsigned long i=0; i<n; i++)
       {
-          patchIt.Set( patchIt.Get()  + (wmax -1.0) * centralPatchIt.Get() );
+          patch[i] = patch[i]  + (wmax -1.0) * centralPatch[i];
       }
       sum += (wmax - 1.0);
       break;
@@ -861,160 +895,237 @@ double NLMTool<T>::GetDenoisedPatch(typename itkTImage::IndexType p, itkTPointer
   if(sum>0.0001)
   {
     //Normalization of the denoised patch
-    for(patchIt.GoToBegin(); !patchIt.IsAtEnd(); ++patchIt)
+    for(unsigned long i=0; i<n; i++)
     {
-      patchIt.Set( patchIt.Get() / sum );
+      patch[i] = patch[i] / sum;
     }
   }
   else
   {
     //copy the central patch to the denoised patch
-    for(patchIt.GoToBegin(), centralPatchIt.GoToBegin(); !patchIt.IsAtEnd(); ++patchIt, ++centralPatchIt)
-    {
-      patchIt.Set( centralPatchIt.Get() );
-    }
+    std::copy(centralPatch, centralPatch + n, patch);
   }
 
   return sum;
 }
 
+
 template <typename T>
-double NLMTool<T>::GetDenoisedPatchUsingTheReferenceImage(typename itkTImage::IndexType p, itkTPointer & patch)
+void NLMTool<T>::ComputeMeanAndVarianceUsingIntegralImages()
 {
-    double wmax = 0; //maximum weight of patches
-    double sum  = 0; //sum of weights (used for normalization purpose)
-    double rangeBandwidth = m_rangeBandwidthImage->GetPixel(p);
-
-    //create the patch and set the estimate to 0
-    CreatePatch(patch);
-    itkTIterator patchIt(patch, patch->GetRequestedRegion());
-
-    //get the value of the patch around the current pixel
-    itkTPointer centralPatch = itkTImage::New();
-    CreatePatch(centralPatch);
-    GetPatch(p,centralPatch);
-    itkTIterator centralPatchIt(centralPatch, centralPatch->GetRequestedRegion());
-
-    //get the value of the patch around the current pixel in the reference image
-    itkTPointer centralPatchReferenceImage = itkTImage::New();
-    CreatePatch(centralPatchReferenceImage);
-    GetPatchFromReferenceImage(p,centralPatchReferenceImage);
-
-    //set the search region around the current pixel
-    typename itkTImage::RegionType searchRegion;
-    ComputeSearchRegion(p,searchRegion);
-
-    //create the patch for pixels in the neighbourhood of the current pixel
-    itkTPointer neighbourPatch = itkTImage::New();
-    CreatePatch(neighbourPatch);
-    itkTIterator neighbourPatchIt(neighbourPatch, neighbourPatch->GetRequestedRegion());
-
-    //create the patch for pixels in the neighbourhood of the current pixel in the reference image
-    itkTPointer neighbourPatchReferenceImage = itkTImage::New();
-    CreatePatch(neighbourPatchReferenceImage);
-
-    //go through the neighbourhood with a region iterator
-    itkTIteratorWithIndex it( m_inputImage, searchRegion);
-    typename itkTImage::IndexType neighbourPixelIndex;
-
-    for(it.GoToBegin(); !it.IsAtEnd(); ++it)
+  //local mean and variance of the (zero padded) patches using the summed-area tables of I and I^2
+  std::vector<double> sumTable;
+  std::vector<double> squareSumTable;
+  m_patchEngine.AllocateSummedAreaTable(sumTable);
+  m_patchEngine.AllocateSummedAreaTable(squareSumTable);
+
+  const T * inputBuffer = m_inputImage->GetBufferPointer();
+  const T * maskBuffer  = m_maskImage->GetBufferPointer();
+  T * meanBuffer        = m_meanImage->GetBufferPointer();
+  T * varianceBuffer    = m_varianceImage->GetBufferPointer();
+  const double n = m_patchEngine.GetNumberOfPixelsInPatch();
+
+  int x,y,z;
+  #pragma omp parallel for private(x,y,z) schedule(static)
+  for(z=0; z < (int)m_size[2]; z++)
+  {
+    for(y=0; y < (int)m_size[1]; y++)
     {
-        neighbourPixelIndex = it.GetIndex();
+      for(x=0; x < (int)m_size[0]; x++)
+      {
+        double value = inputBuffer[x + m_size[0] * ( y + m_size[1] * z )];
+        unsigned long offset = m_patchEngine.ComputeTableOffset(x,y,z);
+        sumTable[offset]       = value;
+        squareSumTable[offset] = value * value;
+      }
+    }
+  }
+  m_patchEngine.ComputeSummedAreaTable(sumTable);
+  m_patchEngine.ComputeSummedAreaTable(squareSumTable);
 
-        bool goForIt = true;
-        if(m_optimized == 1)
-            goForIt = CheckSpeed(p, neighbourPixelIndex);
+  #pragma omp parallel for private(x,y,z) schedule(static)
+  for(z=0; z < (int)m_size[2]; z++)
+  {
+    for(y=0; y < (int)m_size[1]; y++)
+    {
+      for(x=0; x < (int)m_size[0]; x++)
+      {
+        typename itkTImage::IndexType p;
+        p[0] = x;
+        p[1] = y;
+        p[2] = z;
+        unsigned long offset = m_patchEngine.ComputeOffset(p);
 
-        if(goForIt == true)
+        if( maskBuffer[offset] > 0 )
         {
+          float mean = m_patchEngine.BoxSum(sumTable, p) / n;
+          float variance = (m_patchEngine.BoxSum(squareSumTable, p) / n) - (mean * mean);
 
-            GetPatchFromReferenceImage(neighbourPixelIndex, neighbourPatchReferenceImage);
-            GetPatch(neighbourPixelIndex, neighbourPatch);
+          meanBuffer[offset] = mean;
+          varianceBuffer[offset] = variance;
+        }
+      }
+    }
+  }
+}
 
-            double weight = exp( - PatchDistance(centralPatchReferenceImage, neighbourPatchReferenceImage) / rangeBandwidth);
+template <typename T>
+void NLMTool<T>::ComputeIntegralPointwiseOutput(itkTPointer & denoisedImage)
+{
+  //Fast NLM (Darbon et al., 2008) : for each offset d of the search area, the squared difference image
+  //(I(x) - I(x+d))^2 is computed once, and the patch distances of all the voxels are obtained in O(1)
+  //by using its summed-area table.
+  const unsigned long numberOfPixels = m_size[0] * m_size[1] * m_size[2];
+  const T * inputBuffer = m_inputImage->GetBufferPointer();
+  const T * maskBuffer  = m_maskImage->GetBufferPointer();
+  const T * rangeBandwidthBuffer = m_rangeBandwidthImage->GetBufferPointer();
+  T * denoisedBuffer = denoisedImage->GetBufferPointer();
+
+  //patch distances are computed on the reference image if any
+  const T * distanceBuffer = inputBuffer;
+  if(m_useTheReferenceImage == true)
+  {
+    distanceBuffer = m_refImage->GetBufferPointer();
+  }
 
-            if(weight>wmax)
-            {
-                if( (p[0] != neighbourPixelIndex[0]) && (p[1] != neighbourPixelIndex[1]) && (p[2] != neighbourPixelIndex[2]) ) //has to be modify
-                {
-                    wmax = weight;
-                }
-            }
+  std::vector<double> numerator(numberOfPixels, 0.0);   //sum of the weighted neighbour values
+  std::vector<double> denominator(numberOfPixels, 0.0); //sum of the weights
+  std::vector<double> wmax(numberOfPixels, 0.0);        //maximum weight of patches (central point strategy)
 
-            sum += weight;
+  std::vector<double> table;
+  m_patchEngine.AllocateSummedAreaTable(table);
 
-            //Add this patch to the current estimate using the computed weight
-            for(patchIt.GoToBegin(), neighbourPatchIt.GoToBegin(); !patchIt.IsAtEnd(); ++patchIt, ++neighbourPatchIt)
-            {
-                patchIt.Set( patchIt.Get() + neighbourPatchIt.Get() * weight );
-            }
-        }
-    }
+  const long half[3] = { (long)m_halfPatchSize[0], (long)m_halfPatchSize[1], (long)m_halfPatchSize[2] };
+  const long size[3] = { (long)m_size[0], (long)m_size[1], (long)m_size[2] };
+  int x,y,z;
 
+  for(long dz = -(long)m_halfSpatialBandwidth[2]; dz <= (long)m_halfSpatialBandwidth[2]; dz++)
+  for(long dy = -(long)m_halfSpatialBandwidth[1]; dy <= (long)m_halfSpatialBandwidth[1]; dy++)
+  for(long dx = -(long)m_halfSpatialBandwidth[0]; dx <= (long)m_halfSpatialBandwidth[0]; dx++)
+  {
+    const long offsetD = dx + size[0] * ( dy + size[1] * dz );
 
-    //consider now the special case of the central patch
-    switch(m_centralPointStrategy)
+    //squared difference image over the image domain extended by the half patch size (zero padding)
+    #pragma omp parallel for private(x,y,z) schedule(static)
+    for(z = -half[2]; z < size[2] + half[2]; z++)
     {
-    case 0:                                        //remove the central patch to the estimated patch
-        for(patchIt.GoToBegin(), centralPatchIt.GoToBegin(); !patchIt.IsAtEnd(); ++patchIt, ++centralPatchIt)
-        {
-            patchIt.Set( patchIt.Get() -1.0 * centralPatchIt.Get() );
-        }
-        sum -= 1.0;
-        break;
-
-    case 1:
-        //nothing to do
-        break;
-
-    case -1:
-        for(patchIt.GoToBegin(), centralPatchIt.GoToBegin(); !patchIt.IsAtEnd(); ++patchIt, ++centralPatchIt)
-        {
-            patchIt.Set( patchIt.Get()  + (wmax -1.0) * centralPatchIt.Get() );
-        }
-        sum += (wmax - 1.0);
-        break;
+      for(y = -half[1]; y < size[1] + half[1]; y++)
+      {
+        bool insideYZ  = (z >= 0) && (z < size[2]) && (y >= 0) && (y < size[1]);
+        bool insideYZd = (z+dz >= 0) && (z+dz < size[2]) && (y+dy >= 0) && (y+dy < size[1]);
+        double * row = &table[m_patchEngine.ComputeTableOffset(0,y,z)];
 
-    default:
-        //as in case -1
-        for(patchIt.GoToBegin(), centralPatchIt.GoToBegin(); !patchIt.IsAtEnd(); ++patchIt, ++centralPatchIt)
+        for(x = -half[0]; x < size[0] + half[0]; x++)
         {
-            patchIt.Set( patchIt.Get()  + (wmax -1.0) * centralPatchIt.Get() );
+          long offset = x + size[0] * ( y + size[1] * z );
+          T p = 0;
+          T q = 0;
+          if( insideYZ && (x >= 0) && (x < size[0]) )
+          {
+            p = distanceBuffer[offset];
+          }
+          if( insideYZd && (x+dx >= 0) && (x+dx < size[0]) )
+          {
+            q = distanceBuffer[offset + offsetD];
+          }
+          double diff = p - q;
+          row[x] = diff * diff;
         }
-        sum += (wmax - 1.0);
-        break;
+      }
     }
+    m_patchEngine.ComputeSummedAreaTable(table);
+
+    //weights of the voxels whose neighbour x+d lies in the image
+    const bool offCenter = (dx != 0) && (dy != 0) && (dz != 0); //same test as GetDenoisedPatch (has to be modify)
 
-    if(sum>0.0001)
+    #pragma omp parallel for private(x,y,z) schedule(static)
+    for(z = std::max(0L, -dz); z < std::min(size[2], size[2] - dz); z++)
     {
-        //Normalization of the denoised patch
-        for(patchIt.GoToBegin(); !patchIt.IsAtEnd(); ++patchIt)
+      for(y = std::max(0L, -dy); y < std::min(size[1], size[1] - dy); y++)
+      {
+        for(x = std::max(0L, -dx); x < std::min(size[0], size[0] - dx); x++)
         {
-            patchIt.Set( patchIt.Get() / sum );
+          typename itkTImage::IndexType p;
+          p[0] = x;
+          p[1] = y;
+          p[2] = z;
+          unsigned long offset = m_patchEngine.ComputeOffset(p);
+
+          if( maskBuffer[offset] > 0 )
+          {
+            if( (m_optimized == 1) && (CheckSpeed(offset, offset + offsetD) == false) )
+            {
+              continue;
+            }
+
+            double weight = exp( - m_patchEngine.BoxSum(table, p) / rangeBandwidthBuffer[offset] );
+
+            if( offCenter && (weight > wmax[offset]) )
+            {
+              wmax[offset] = weight;
+            }
+            numerator[offset]   += weight * inputBuffer[offset + offsetD];
+            denominator[offset] += weight;
+          }
         }
+      }
     }
-    else
+  }
+
+  //consider now the special case of the central point, and normalize
+  long i;
+  #pragma omp parallel for private(i) schedule(static)
+  for(i = 0; i < (long)numberOfPixels; i++)
+  {
+    if( maskBuffer[i] > 0 )
     {
-        //copy the central patch to the denoised patch
-        for(patchIt.GoToBegin(), centralPatchIt.GoToBegin(); !patchIt.IsAtEnd(); ++patchIt, ++centralPatchIt)
-        {
-            patchIt.Set( centralPatchIt.Get() );
-        }
-    }
+      double sum = denominator[i];
+      double value = numerator[i];
 
-    return sum;
-}
+      switch(m_centralPointStrategy)
+      {
+      case 0:                                        //remove the central point
+          value -= inputBuffer[i];
+          sum -= 1.0;
+          break;
+      case 1:
+          break;                                 //nothing to do
+      case -1:
+      default:
+          value += (wmax[i] - 1.0) * inputBuffer[i];
+          sum += (wmax[i] - 1.0);
+          break;
+      }
 
+      if(sum>0.0001)
+      {
+        denoisedBuffer[i] = value / sum;
+      }
+      else
+      {
+        denoisedBuffer[i] = inputBuffer[i];
+      }
+    }
+  }
+}
 
 template <typename T>
 bool NLMTool<T>::CheckSpeed(typename itkTImage::IndexType p, typename itkTImage::IndexType q)
+{
+    return CheckSpeed(m_patchEngine.ComputeOffset(p), m_patchEngine.ComputeOffset(q));
+}
+
+template <typename T>
+bool NLMTool<T>::CheckSpeed(unsigned long p, unsigned long q)
 {
     bool goForIt = true;
+    const T * meanBuffer     = m_meanImage->GetBufferPointer();
+    const T * varianceBuffer = m_varianceImage->GetBufferPointer();
 
     float mSpeed = 0;
-    if(m_meanImage->GetPixel(q) ==0)
+    if(meanBuffer[q] ==0)
     {
-        if(m_meanImage->GetPixel(p) == 0)
+        if(meanBuffer[p] == 0)
         {
             mSpeed = 1;
         }
@@ -1025,7 +1136,7 @@ bool NLMTool<T>::CheckSpeed(typename itkTImage::IndexType p, typename itkTImage:
     }
     else
     {
-        mSpeed = m_meanImage->GetPixel(p) / m_meanImage->GetPixel(q);
+        mSpeed = meanBuffer[p] / meanBuffer[q];
     }
 
     if( (mSpeed < m_lowerMeanThreshold) || (mSpeed > 1/m_lowerMeanThreshold) )
@@ -1034,9 +1145,9 @@ bool NLMTool<T>::CheckSpeed(typename itkTImage::IndexType p, typename itkTImage:
     }
 
     float vSpeed = 0;
-    if(m_varianceImage->GetPixel(q) ==0)
+    if(varianceBuffer[q] ==0)
     {
-        if(m_varianceImage->GetPixel(p) == 0)
+        if(varianceBuffer[p] == 0)
         {
             vSpeed = 1;
         }
@@ -1047,7 +1158,7 @@ bool NLMTool<T>::CheckSpeed(typename itkTImage::IndexType p, typename itkTImage:
     }
     else
     {
-        vSpeed = m_varianceImage->GetPixel(p) / m_varianceImage->GetPixel(q);
+        vSpeed = varianceBuffer[p] / varianceBuffer[q];
     }
 
     if( (vSpeed < m_lowerVarianceThreshold) || (vSpeed > 1/m_lowerVarianceThreshold) )
@@ -36,6 +36,9 @@
 #include "btkDiffusionSequence.h"
 
 
+// STL includes
+#include "algorithm"
+
 // VNL includes
 #include "vnl/vnl_inverse.h"
 
@@ -43,7 +46,7 @@
 namespace btk
 {
 
-DiffusionSequence::DiffusionSequence()
+DiffusionSequence::DiffusionSequence() : m_VectorImage(NULL), m_VectorImageMTime(0), m_VectorImageSource(NULL)
 {
     // ----
 }
@@ -101,4 +104,97 @@ void DiffusionSequence::ConvertGradientTableToImageCoordinates()
     }
 }
 
+//----------------------------------------------------------------------------------------
+
+DiffusionSequence::VectorImageType::Pointer DiffusionSequence::GetVectorImage() const
+{
+    const short *buffer = this->GetBufferPointer();
+
+    unsigned long mtime = this->GetMTime();
+    if(this->GetPixelContainer() && this->GetPixelContainer()->GetMTime() > mtime)
+    {
+        mtime = this->GetPixelContainer()->GetMTime();
+    }
+
+    if(m_VectorImage.IsNotNull() && m_VectorImageMTime == mtime && m_VectorImageSource == buffer)
+    {
+        return m_VectorImage;
+    }
+
+    Superclass::RegionType    sequenceRegion = this->GetBufferedRegion();
+    Superclass::SpacingType  sequenceSpacing = this->GetSpacing();
+    Superclass::PointType     sequenceOrigin = this->GetOrigin();
+    Superclass::DirectionType sequenceDirection = this->GetDirection();
+
+    VectorImageType::RegionType       region;
+    VectorImageType::SpacingType     spacing;
+    VectorImageType::PointType        origin;
+    VectorImageType::DirectionType direction;
+
+    for(unsigned int i = 0; i < 3; i++)
+    {
+        region.SetIndex(i, sequenceRegion.GetIndex(i));
+        region.SetSize(i, sequenceRegion.GetSize(i));
+        spacing[i] = sequenceSpacing[i];
+        origin[i]  = sequenceOrigin[i];
+
+        for(unsigned int j = 0; j < 3; j++)
+        {
+            direction(i,j) = sequenceDirection(i,j);
+        }
+    }
+
+    unsigned int numberOfImages = sequenceRegion.GetSize(3);
+
+    VectorImageType::Pointer vectorImage = VectorImageType::New();
+    vectorImage->SetRegions(region);
+    vectorImage->SetSpacing(spacing);
+    vectorImage->SetOrigin(origin);
+    vectorImage->SetDirection(direction);
+    vectorImage->SetVectorLength(numberOfImages);
+    vectorImage->Allocate();
+
+    // The sequence stores the gradient images one after the other (x fastest, gradient slowest),
+    // the vector image stores the gradient values of a voxel together. The transpose is done
+    // by blocks of voxels, so that the reads of each gradient image and the writes stay in cache.
+    const long numberOfVoxels = region.GetNumberOfPixels();
+    const long      blockSize = 256;
+    const long numberOfBlocks = (numberOfVoxels + blockSize - 1) / blockSize;
+    short             *output = vectorImage->GetBufferPointer();
+
+    long b;
+
+    #pragma omp parallel for private(b) schedule(static)
+    for(b = 0; b < numberOfBlocks; b++)
+    {
+        long first = b * blockSize;
+        long  last = std::min(first + blockSize, numberOfVoxels);
+
+        for(unsigned int k = 0; k < numberOfImages; k++)
+        {
+            const short *input = buffer + k * numberOfVoxels;
+
+            for(long v = first; v < last; v++)
+            {
+                output[v * numberOfImages + k] = input[v];
+            }
+        }
+    }
+
+    m_VectorImage       = vectorImage;
+    m_VectorImageMTime  = mtime;
+    m_VectorImageSource = buffer;
+
+    return m_VectorImage;
+}
+
+//----------------------------------------------------------------------------------------
+
+void DiffusionSequence::ReleaseVectorImage()
+{
+    m_VectorImage       = NULL;
+    m_VectorImageMTime  = 0;
+    m_VectorImageSource = NULL;
+}
+
 } // namespace btk
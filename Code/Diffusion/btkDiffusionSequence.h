@@ -43,6 +43,7 @@
 #include "itkSmartPointer.h"
 #include "itkMacro.h"
 #include "itkImage.h"
+#include "itkVectorImage.h"
 
 // Local includes
 #include "btkMacro.h"
@@ -66,6 +67,9 @@ class DiffusionSequence : public itk::Image< short,4 >
 
         typedef std::vector< GradientDirection > GradientTable;
 
+        /** Voxel-interleaved representation of the sequence (one vector of gradient values per voxel). */
+        typedef itk::VectorImage< short,3 > VectorImageType;
+
         itkNewMacro(Self);
 
         itkTypeMacro(DiffusionSequence, itk::Image);
@@ -85,6 +89,21 @@ class DiffusionSequence : public itk::Image< short,4 >
          * @brief Convert the gradient table to image coordinates.
          */
         void ConvertGradientTableToImageCoordinates();
+
+        /**
+         * @brief Get the sequence as a voxel-interleaved vector image.
+         * The values of all the gradients of a voxel are contiguous in memory, which is the layout
+         * expected by the estimation filters. The image is built once (buffer transpose) and shared
+         * by all the callers until the sequence is modified (Modified() must be called if the
+         * pixel buffer is changed in place).
+         * @return Vector image of size (x,y,z) and vector length the number of gradient images.
+         */
+        VectorImageType::Pointer GetVectorImage() const;
+
+        /**
+         * @brief Release the memory of the voxel-interleaved vector image.
+         */
+        void ReleaseVectorImage();
         // TODO : check how to make a good usage of gradient table
 //        void UseWorldCoordinatesForGradientTable(); // Change gradient table to world coordinates if necessary
 //        void UseImageCoordinatesForGradientTable(); // Change gradient table to image coordinates if necessary
@@ -114,6 +133,15 @@ class DiffusionSequence : public itk::Image< short,4 >
 
         /** B-values of the diffusion sequence. */
         std::vector< unsigned short > m_BValues;
+
+        /** Cached voxel-interleaved vector image. */
+        mutable VectorImageType::Pointer m_VectorImage;
+
+        /** Modification time of the sequence when the vector image was built. */
+        mutable unsigned long m_VectorImageMTime;
+
+        /** Buffer of the sequence when the vector image was built. */
+        mutable const short *m_VectorImageSource;
 };
 
 } // namespace btk
@@ -36,10 +36,6 @@
 #include "btkDiffusionSequenceToDiffusionSignalFilter.h"
 
 
-// ITK includes
-#include "itkImageRegionIterator.h"
-
-
 namespace btk
 {
 
@@ -114,42 +110,40 @@ void DiffusionSequenceToDiffusionSignalFilter::GenerateData()
     this->AllocateOutputs();
 
 
-    typedef itk::ImageRegionIterator< OutputImageType > OutputImageIterator;
+    // The sequence is read through its voxel-interleaved representation, so that the signal
+    // of each voxel is computed from contiguous values.
+    DiffusionSequence::VectorImageType::Pointer sequence = m_InputDiffusionSequence->GetVectorImage();
+    OutputImageType::Pointer                      output = this->GetOutput();
 
-    // Extract reference and gradient images and give it to filter.
-    // This process assume that the given sequence is normalized (one reference image at first).
+    const unsigned int  inputLength = sequence->GetVectorLength();
+    const unsigned int outputLength = output->GetVectorLength();
+    const long       numberOfVoxels = output->GetLargestPossibleRegion().GetNumberOfPixels();
 
-    // Build a vector image from the diffusion sequence
-    OutputImageType::Pointer output = this->GetOutput();
-    OutputImageIterator it(output, output->GetLargestPossibleRegion());
+    const short *inputBuffer = sequence->GetBufferPointer();
+    double     *outputBuffer = output->GetBufferPointer();
 
-    for(it.GoToBegin(); !it.IsAtEnd(); ++it)
-    {
-        OutputImageType::IndexType vindex = it.GetIndex();
-        InputImageType::IndexType sindex;
-        sindex[0] = vindex[0]; sindex[1] = vindex[1]; sindex[2] = vindex[2];
+    long v;
 
-        OutputImageType::PixelType pixelValue;
-        pixelValue.SetSize(output->GetVectorLength());
+    #pragma omp parallel for private(v) schedule(static)
+    for(v = 0; v < numberOfVoxels; v++)
+    {
+        const short *in = inputBuffer + v * inputLength;
+        double     *out = outputBuffer + v * outputLength;
 
-        sindex[3] = 0;
-        InputImageType::PixelType B0 = m_InputDiffusionSequence->GetPixel(sindex);
+        // This process assume that the given sequence is normalized (one reference image at first).
+        short B0 = in[0];
 
-        for(unsigned int k = 0; k < output->GetVectorLength(); k++)
+        for(unsigned int k = 0; k < outputLength; k++)
         {
-            sindex[3] = k+1;
-
             if(B0 != 0)
             {
-                pixelValue[k] = static_cast< double >(m_InputDiffusionSequence->GetPixel(sindex)) / static_cast< double >(B0);
+                out[k] = static_cast< double >(in[k+1]) / static_cast< double >(B0);
             }
             else // B0 == 0
             {
-                pixelValue[k] = 0.0;
+                out[k] = 0.0;
             }
         }
-
-        it.Set(pixelValue);
     }
 }
 
@@ -36,15 +36,8 @@
 #include "btkDiffusionTensorReconstructionFilter.h"
 
 
-// ITK includes
-#include "itkExtractImageFilter.h"
-#include "itkImageRegionIterator.h"
-#include "itkImageRegionIteratorWithIndex.h"
-
 // Definitions
-typedef itk::ExtractImageFilter< btk::DiffusionSequence,itk::Image< short,3 > > ExtractImageFilter;
-typedef itk::VectorImage< short,3 > VectorImage;
-typedef itk::ImageRegionIterator< VectorImage > VectorImageIterator;
+typedef btk::DiffusionSequence::VectorImageType VectorImage;
 
 
 namespace btk
@@ -84,7 +77,6 @@ void DiffusionTensorReconstructionFilter::Update()
     // This process assume that the given sequence is normalized (one reference image at first).
     std::vector< btk::GradientDirection > gradientTable = this->m_InputDiffusionSequence->GetGradientTable();
     btk::DiffusionSequence::RegionType          region = this->m_InputDiffusionSequence->GetLargestPossibleRegion();
-    ExtractImageFilter::Pointer                extract = ExtractImageFilter::New();
 
     if(gradientTable.size() != region.GetSize(3))
     {
@@ -96,44 +88,8 @@ void DiffusionTensorReconstructionFilter::Update()
         throw(std::string("There are less than 6 gradient directions ! Cannot estimate tensors !"));
     }
 
-    // Get the reference image
-    region.SetSize(3,0);
-    extract->SetInput(this->m_InputDiffusionSequence);
-    extract->SetExtractionRegion(region);
-    extract->SetDirectionCollapseToSubmatrix();
-    extract->Update();
-
-    // Build a vector image from the diffusion sequence
-    // TODO : store diffusion sequence as vector image
-    // But test first if linear interpolation is ok
-    VectorImage::Pointer vectorImage = VectorImage::New();
-    vectorImage->SetRegions(extract->GetOutput()->GetLargestPossibleRegion());
-    vectorImage->SetSpacing(extract->GetOutput()->GetSpacing());
-    vectorImage->SetOrigin(extract->GetOutput()->GetOrigin());
-    vectorImage->SetDirection(extract->GetOutput()->GetDirection());
-    vectorImage->SetVectorLength(gradientTable.size());
-    vectorImage->Allocate();
-    vectorImage->FillBuffer(itk::VariableLengthVector< short >(0));
-
-    VectorImageIterator it(vectorImage, vectorImage->GetLargestPossibleRegion());
-
-    for(it.GoToBegin(); !it.IsAtEnd(); ++it)
-    {
-        VectorImage::IndexType vindex = it.GetIndex();
-        btk::DiffusionSequence::IndexType sindex;
-        sindex[0] = vindex[0]; sindex[1] = vindex[1]; sindex[2] = vindex[2];
-
-        VectorImage::PixelType pixelValue;
-        pixelValue.SetSize(vectorImage->GetVectorLength());
-
-        for(unsigned int k = 0; k < vectorImage->GetVectorLength(); k++)
-        {
-            sindex[3] = k;
-            pixelValue[k] = this->m_InputDiffusionSequence->GetPixel(sindex);
-        }
-
-        it.Set(pixelValue);
-    }
+    // Get the voxel-interleaved representation of the sequence (shared with the other filters)
+    VectorImage::Pointer vectorImage = this->m_InputDiffusionSequence->GetVectorImage();
 
     // Get the gradient table
     Self::GradientDirectionContainerType::Pointer directions = Self::GradientDirectionContainerType::New();
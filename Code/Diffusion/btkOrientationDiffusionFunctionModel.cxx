@@ -36,18 +36,25 @@
 #include "btkOrientationDiffusionFunctionModel.h"
 
 
+// STL includes
+#include "algorithm"
+
 // Local includes
 #include "btkSphericalHarmonics.h"
 #include "btkLegendrePolynomial.h"
 
 
-#define ACCESS(i,j) (phiRes*(i) + (j) + 1)
+#define NOT_COMPUTED 255
 
 
 namespace btk
 {
 
-OrientationDiffusionFunctionModel::OrientationDiffusionFunctionModel() : m_UseSharpModel(false)
+const unsigned int OrientationDiffusionFunctionModel::MaximumNumberOfMeanDirections;
+
+//----------------------------------------------------------------------------------------
+
+OrientationDiffusionFunctionModel::OrientationDiffusionFunctionModel() : m_UseSharpModel(false), m_UseExactBasis(false), m_BasisTableResolution(90), m_UseMeanDirectionsCache(true), m_MeanDirectionsCacheIsComplete(false)
 {
     // ----
 }
@@ -81,6 +88,15 @@ void OrientationDiffusionFunctionModel::Update()
     {
         this->ComputeModelSharpMatrix();
     }
+
+    if(!m_UseExactBasis)
+    {
+        this->ComputeBasisTables();
+    }
+
+    // Mean directions
+    this->ComputeDirectionsNeighbours();
+    this->InitializeMeanDirectionsCache();
 }
 
 //----------------------------------------------------------------------------------------
@@ -97,14 +113,15 @@ inline OrientationDiffusionFunctionModel::ContinuousIndex OrientationDiffusionFu
 
 float OrientationDiffusionFunctionModel::ModelAt(ModelImage::PixelType shCoefficients, btk::GradientDirection direction)
 {
-    // TODO : this code use the analytical form to compute exact signal in direction.
-    // We may use interpolation to improve computation speed...
-
     btk::SphericalDirection u = direction.GetSphericalDirection();
     float            response = 0.f;
     unsigned int            i = 0;
 
-    if(m_UseSharpModel)
+    if(!m_UseExactBasis)
+    {
+        response = m_ModelBasisTable.Evaluate(u, shCoefficients.GetDataPointer());
+    }
+    else if(m_UseSharpModel)
     {
         for(unsigned int l = 0; l <= m_SphericalHarmonicsOrder; l += 2)
         {
@@ -134,11 +151,20 @@ float OrientationDiffusionFunctionModel::ModelAt(ModelImage::PixelType shCoeffic
 
 std::vector< float > OrientationDiffusionFunctionModel::ModelAt(ModelImage::PixelType shCoefficients, std::vector< GradientDirection > &directions)
 {
-    // TODO : this code use the analytical form to compute exact signal in direction.
-    // We may use interpolation to improve computation speed...
+    unsigned int numberOfDirections = directions.size();
 
+    if(!m_UseExactBasis)
+    {
+        std::vector< float > response(numberOfDirections, 0.f);
 
-    unsigned int numberOfDirections = directions.size();
+        for(unsigned int i = 0; i < numberOfDirections; i++)
+        {
+            float value = m_ModelBasisTable.Evaluate(directions[i].GetSphericalDirection(), shCoefficients.GetDataPointer());
+            response[i] = (value >= 0.0 ? value : 0.0);
+        }
+
+        return response;
+    }
 
     // Compute spherical harmonics model
     Matrix sphericalHarmonicsMatrix(directions.size(), m_NumberOfSHCoefficients);
@@ -277,20 +303,24 @@ std::vector< float > OrientationDiffusionFunctionModel::ModelAt(PhysicalPoint po
 
 float OrientationDiffusionFunctionModel::SignalAt(ModelImage::PixelType shCoefficients, btk::GradientDirection direction)
 {
-    // TODO : this code use the analytical form to compute exact signal in direction.
-    // We may use interpolation to improve computation speed...
-
     btk::SphericalDirection u = direction.GetSphericalDirection();
     float            response = 0.f;
     unsigned int            i = 0;
 
-    for(unsigned int l = 0; l <= m_SphericalHarmonicsOrder; l += 2)
+    if(!m_UseExactBasis)
     {
-        for(int m = -(int)l; m <= (int)l; m++)
+        response = m_SignalBasisTable.Evaluate(u, shCoefficients.GetDataPointer());
+    }
+    else // m_UseExactBasis = true
+    {
+        for(unsigned int l = 0; l <= m_SphericalHarmonicsOrder; l += 2)
         {
-            response += btk::SphericalHarmonics::ComputeBasis(u,l,m) * shCoefficients[i++];
-        } // for m
-    } // for l
+            for(int m = -(int)l; m <= (int)l; m++)
+            {
+                response += btk::SphericalHarmonics::ComputeBasis(u,l,m) * shCoefficients[i++];
+            } // for m
+        } // for l
+    }
 
     return (response >= 0.0 ? response : 0.0);
 }
@@ -299,11 +329,21 @@ float OrientationDiffusionFunctionModel::SignalAt(ModelImage::PixelType shCoeffi
 
 std::vector< float > OrientationDiffusionFunctionModel::SignalAt(ModelImage::PixelType shCoefficients, std::vector< GradientDirection > &directions)
 {
-    // TODO : this code use the analytical form to compute exact signal in direction.
-    // We may use interpolation to improve computation speed...
-
     unsigned int numberOfDirections = directions.size();
 
+    if(!m_UseExactBasis)
+    {
+        std::vector< float > response(numberOfDirections, 0.f);
+
+        for(unsigned int i = 0; i < numberOfDirections; i++)
+        {
+            float value = m_SignalBasisTable.Evaluate(directions[i].GetSphericalDirection(), shCoefficients.GetDataPointer());
+            response[i] = (value >= 0.0 ? value : 0.0);
+        }
+
+        return response;
+    }
+
     // Compute spherical harmonics matrix
     Matrix sphericalHarmonicsMatrix(directions.size(), m_NumberOfSHCoefficients);
 
@@ -407,162 +447,128 @@ std::vector< float > OrientationDiffusionFunctionModel::SignalAt(PhysicalPoint p
 
 std::vector< btk::GradientDirection > OrientationDiffusionFunctionModel::MeanDirectionsAt(ContinuousIndex cindex)
 {
-    // TODO: improve speed with analytical space reduction (or interpolation of pre-computed data)
-
-    std::vector< float > Psi = this->ModelAt(cindex);
+    std::vector< btk::GradientDirection > meanDirections;
 
-    float min = Psi[0], max = Psi[0];
-    for(unsigned int i = 1; i < Psi.size(); i++)
+    if(!m_UseMeanDirectionsCache)
     {
-        if(min > Psi[i])
-            min = Psi[i];
+        // Maxima of the interpolated ODF on the sampling of the sphere
+        std::vector< float > Psi = this->ModelAt(cindex);
+        std::vector< unsigned int > maxima = this->FindMaxima(Psi);
 
-        if(max < Psi[i])
-            max = Psi[i];
+        for(unsigned int i = 0; i < maxima.size(); i++)
+        {
+            meanDirections.push_back(m_Directions[maxima[i]]);
+        }
+
+        return meanDirections;
     }
 
-    // Compute the regular step on the unit sphere
-    unsigned int thetaRes = static_cast< unsigned int >(std::ceil( std::sqrt(static_cast< float >(m_SphericalResolution)/2.f) ));
-    unsigned int   phiRes = 2*thetaRes;
+    //
+    // Trilinear blending of the mean directions of the eight surrounding voxels
+    //
 
-    std::vector< btk::GradientDirection > meanDirections;
+    ModelImage::RegionType region = m_InputModelImage->GetLargestPossibleRegion();
+    ModelImage::SizeType     size = region.GetSize();
+    ModelImage::IndexType   start = region.GetIndex();
+
+    long   base[3];
+    double fraction[3];
 
-    for(unsigned int i = 0; i < thetaRes; i++)
+    for(unsigned int d = 0; d < 3; d++)
     {
-        for(unsigned int j = 0; j < phiRes; j++)
+        base[d]     = static_cast< long >(std::floor(cindex[d]));
+        fraction[d] = cindex[d] - base[d];
+    }
+
+    // Clusters of close directions (sum of weighted directions and sum of weights)
+    std::vector< double > clusterDirections;
+    std::vector< double > clusterWeights;
+    double                totalWeight = 0.0;
+
+    float directions[3*MaximumNumberOfMeanDirections];
+
+    for(unsigned int corner = 0; corner < 8; corner++)
+    {
+        double weight = 1.0;
+        bool   inside = true;
+        long    index[3];
+
+        for(unsigned int d = 0; d < 3; d++)
         {
-            float odf1, odf2, odf3, odf4, odf5, odf6, odf7, odf8;
-            float odf = Psi[ACCESS(i,j)];
+            unsigned int shift = (corner >> d) & 1;
 
-            if(j == 0)
+            index[d] = base[d] + shift;
+            weight  *= shift ? fraction[d] : 1.0-fraction[d];
+
+            if(index[d] < start[d] || index[d] >= start[d] + static_cast< long >(size[d]))
             {
-                if(i == 0)
-                {
-                    odf1 = odf2 = odf3 = Psi[0];
-                }
-                else // i != 0
-                {
-                    odf1 = Psi[ACCESS(i-1,phiRes-1)];
-                    odf2 = Psi[ACCESS(i-1,0)];
-                    odf3 = Psi[ACCESS(i-1,1)];
-                }
+                inside = false;
+            }
+        }
 
-                odf4 = Psi[ACCESS(i,phiRes-1)];
-                odf5 = Psi[ACCESS(i,1)];
+        if(!inside || weight <= 0.0)
+        {
+            continue;
+        }
 
-                if(i == thetaRes-1)
-                {
-                    odf6 = odf7 = odf8 = Psi[Psi.size()-1];
-                }
-                else // i != thetaRes-1
-                {
-                    odf6 = Psi[ACCESS(i+1,phiRes-1)];
-                    odf7 = Psi[ACCESS(i+1,0)];
-                    odf8 = Psi[ACCESS(i+1,1)];
-                }
-            }
-            else if(j == phiRes-1)
-            {
-                if(i == 0)
-                {
-                    odf1 = odf2 = odf3 = Psi[0];
-                }
-                else // i != 0
-                {
-                    odf1 = Psi[ACCESS(i-1,j-1)];
-                    odf2 = Psi[ACCESS(i-1,j)];
-                    odf3 = Psi[ACCESS(i-1,0)];
-                }
+        unsigned long offset = (index[0]-start[0]) + size[0] * ( (index[1]-start[1]) + size[1] * (index[2]-start[2]) );
+        unsigned int numberOfDirections = this->GetCachedMeanDirections(offset, directions);
 
-                odf4 = Psi[ACCESS(i,j-1)];
-                odf5 = Psi[ACCESS(i,0)];
+        // Voxels without maximum (background) do not take part in the blending
+        if(numberOfDirections == 0)
+        {
+            continue;
+        }
 
-                if(i == thetaRes-1)
-                {
-                    odf6 = odf7 = odf8 = Psi[Psi.size()-1];
-                }
-                else // i != thetaRes-1
-                {
-                    odf6 = Psi[ACCESS(i+1,j-1)];
-                    odf7 = Psi[ACCESS(i+1,j)];
-                    odf8 = Psi[ACCESS(i+1,j+1)];
-                }
-            }
-            else // j != 0 && j != phiRes-1
-            {
-                if(i == 0)
-                {
-                    odf1 = odf2 = odf3 = Psi[0];
-                }
-                else // i != 0
-                {
-                    odf1 = Psi[ACCESS(i-1,j-1)];
-                    odf2 = Psi[ACCESS(i-1,j)];
-                    odf3 = Psi[ACCESS(i-1,j+1)];
-                }
+        totalWeight += weight;
 
-                odf4 = Psi[ACCESS(i,j-1)];
-                odf5 = Psi[ACCESS(i,j+1)];
+        for(unsigned int k = 0; k < numberOfDirections; k++)
+        {
+            const float *v = directions + 3*k;
 
-                if(i == thetaRes-1)
-                {
-                    odf6 = odf7 = odf8 = Psi[Psi.size()-1];
-                }
-                else // i != thetaRes-1
+            // Look for the closest cluster
+            int    closest = -1;
+            double maxDot  = 0.866025403784439; // cos(30 degrees)
+
+            for(unsigned int c = 0; c < clusterWeights.size(); c++)
+            {
+                const double *u = &clusterDirections[3*c];
+                double norm = std::sqrt(u[0]*u[0] + u[1]*u[1] + u[2]*u[2]);
+                double  dot = (u[0]*v[0] + u[1]*v[1] + u[2]*v[2]) / norm;
+
+                if(dot > maxDot)
                 {
-                    odf6 = Psi[ACCESS(i+1,j-1)];
-                    odf7 = Psi[ACCESS(i+1,j)];
-                    odf8 = Psi[ACCESS(i+1,j+1)];
+                    maxDot  = dot;
+                    closest = c;
                 }
             }
 
-            if(odf > odf1 && odf > odf2 && odf > odf3 && odf > odf4 && odf > odf5 && odf > odf6 && odf > odf7 && odf > odf8)
+            if(closest < 0)
             {
-                if((odf-min)/(max-min) > 0.9)
-                {
-                    meanDirections.push_back(m_Directions[ACCESS(i,j)]);
-                }
+                clusterDirections.push_back(0.0); clusterDirections.push_back(0.0); clusterDirections.push_back(0.0);
+                clusterWeights.push_back(0.0);
+                closest = clusterWeights.size()-1;
             }
-        } // for each phi
-    } // for each theta
 
-    // North pole
-    bool maxima = true;
-    unsigned int k = 1;
+            clusterDirections[3*closest  ] += weight * v[0];
+            clusterDirections[3*closest+1] += weight * v[1];
+            clusterDirections[3*closest+2] += weight * v[2];
+            clusterWeights[closest]        += weight;
+        } // for each direction of the voxel
+    } // for each corner
 
-    float odf = Psi[0];
-    while(maxima && k <= phiRes)
+    // Keep the directions supported by at least half of the weight
+    for(unsigned int c = 0; c < clusterWeights.size(); c++)
     {
-        if(odf < Psi[k++])
+        if(clusterWeights[c] >= 0.5 * totalWeight)
         {
-            maxima = false;
-        }
-    }
+            const double *u = &clusterDirections[3*c];
+            double norm = std::sqrt(u[0]*u[0] + u[1]*u[1] + u[2]*u[2]);
 
-    if(maxima && (odf-min)/(max-min) > 0.9)
-    {
-        meanDirections.push_back(m_Directions[0]);
-    }
-
-
-    // South pole
-    maxima = true;
-    k = Psi.size()-1;
-
-    odf = Psi[Psi.size()-1];
-    while(maxima && k >= Psi.size()-1-phiRes)
-    {
-        if(odf < Psi[k--])
-        {
-            maxima = false;
+            meanDirections.push_back(btk::GradientDirection(u[0]/norm, u[1]/norm, u[2]/norm));
         }
     }
 
-    if(maxima && (odf-min)/(max-min) > 0.9)
-    {
-        meanDirections.push_back(m_Directions[m_Directions.size()-1]);
-    }
-
     return meanDirections;
 }
 
@@ -625,6 +631,20 @@ void OrientationDiffusionFunctionModel::UseSharpModelOff()
 
 //----------------------------------------------------------------------------------------
 
+void OrientationDiffusionFunctionModel::UseExactBasisOn()
+{
+    m_UseExactBasis = true;
+}
+
+//----------------------------------------------------------------------------------------
+
+void OrientationDiffusionFunctionModel::UseExactBasisOff()
+{
+    m_UseExactBasis = false;
+}
+
+//----------------------------------------------------------------------------------------
+
 void OrientationDiffusionFunctionModel::ComputeLegendreMatrix()
 {
     // Resize the matrix (rows: number of SH coefficients, columns: number of SH coefficients).
@@ -747,4 +767,473 @@ void OrientationDiffusionFunctionModel::ComputeModelSharpMatrix()
     }
 }
 
+//----------------------------------------------------------------------------------------
+
+void OrientationDiffusionFunctionModel::ComputeBasisTables()
+{
+    // The diagonal matrices of the model are folded into the basis
+    std::vector< float > modelWeights(m_NumberOfSHCoefficients, 0.f);
+
+    for(unsigned int i = 0; i < m_NumberOfSHCoefficients; i++)
+    {
+        modelWeights[i] = m_LegendreMatrix(i,i) * (m_UseSharpModel ? m_ModelSharpMatrix(i,i) : 1.f);
+    }
+
+    m_ModelBasisTable.Initialize(m_SphericalHarmonicsOrder, m_BasisTableResolution, modelWeights);
+    m_SignalBasisTable.Initialize(m_SphericalHarmonicsOrder, m_BasisTableResolution);
+}
+
+//----------------------------------------------------------------------------------------
+
+void OrientationDiffusionFunctionModel::UseMeanDirectionsCacheOn()
+{
+    m_UseMeanDirectionsCache = true;
+}
+
+//----------------------------------------------------------------------------------------
+
+void OrientationDiffusionFunctionModel::UseMeanDirectionsCacheOff()
+{
+    m_UseMeanDirectionsCache = false;
+}
+
+//----------------------------------------------------------------------------------------
+
+void OrientationDiffusionFunctionModel::ComputeDirectionsNeighbours()
+{
+    unsigned int numberOfDirections = m_Directions.size();
+
+    m_DirectionsNeighbours.assign(numberOfDirections, std::vector< unsigned int >());
+
+    if(numberOfDirections < 3)
+    {
+        return;
+    }
+
+    // Rings of constant elevation between the poles (first and last directions)
+    std::vector< unsigned int > ringStarts;
+
+    for(unsigned int i = 1; i < numberOfDirections-1; i++)
+    {
+        if(i == 1 || std::abs(m_Directions[i].GetSphericalDirection()[0] - m_Directions[i-1].GetSphericalDirection()[0]) > 1e-4)
+        {
+            ringStarts.push_back(i);
+        }
+    }
+
+    ringStarts.push_back(numberOfDirections-1);
+
+    unsigned int numberOfRings = ringStarts.size()-1;
+    unsigned int northPole = 0, southPole = numberOfDirections-1;
+
+    for(unsigned int r = 0; r < numberOfRings; r++)
+    {
+        unsigned int ringSize = ringStarts[r+1] - ringStarts[r];
+
+        for(unsigned int j = 0; j < ringSize; j++)
+        {
+            std::vector< unsigned int > &neighbours = m_DirectionsNeighbours[ringStarts[r] + j];
+
+            // Same ring
+            neighbours.push_back(ringStarts[r] + (j+ringSize-1) % ringSize);
+            neighbours.push_back(ringStarts[r] + (j+1) % ringSize);
+
+            // Previous and next rings (three closest azimuths) or poles
+            for(int dr = -1; dr <= 1; dr += 2)
+            {
+                int rr = (int)r + dr;
+
+                if(rr < 0)
+                {
+                    neighbours.push_back(northPole);
+                    m_DirectionsNeighbours[northPole].push_back(ringStarts[r] + j);
+                }
+                else if(rr >= (int)numberOfRings)
+                {
+                    neighbours.push_back(southPole);
+                    m_DirectionsNeighbours[southPole].push_back(ringStarts[r] + j);
+                }
+                else
+                {
+                    unsigned int otherSize = ringStarts[rr+1] - ringStarts[rr];
+                    unsigned int k = static_cast< unsigned int >(std::floor(static_cast< double >(j) * otherSize / ringSize + 0.5)) % otherSize;
+
+                    neighbours.push_back(ringStarts[rr] + (k+otherSize-1) % otherSize);
+                    neighbours.push_back(ringStarts[rr] + k);
+                    neighbours.push_back(ringStarts[rr] + (k+1) % otherSize);
+                }
+            } // for previous and next rings
+        } // for each direction of the ring
+    } // for each ring
+}
+
+//----------------------------------------------------------------------------------------
+
+std::vector< unsigned int > OrientationDiffusionFunctionModel::FindMaxima(const std::vector< float > &Psi) const
+{
+    std::vector< unsigned int > maxima;
+
+    if(Psi.empty())
+    {
+        return maxima;
+    }
+
+    float min = Psi[0], max = Psi[0];
+    for(unsigned int i = 1; i < Psi.size(); i++)
+    {
+        if(min > Psi[i])
+            min = Psi[i];
+
+        if(max < Psi[i])
+            max = Psi[i];
+    }
+
+    unsigned int lastDirection = Psi.size()-1;
+
+    for(unsigned int i = 0; i < Psi.size(); i++)
+    {
+        const std::vector< unsigned int > &neighbours = m_DirectionsNeighbours[i];
+
+        bool  isPole = (i == 0 || i == lastDirection);
+        bool maximum = !neighbours.empty();
+
+        for(unsigned int k = 0; k < neighbours.size() && maximum; k++)
+        {
+            // Poles are compared to their whole ring, so the comparison is not strict
+            maximum = isPole ? (Psi[i] >= Psi[neighbours[k]]) : (Psi[i] > Psi[neighbours[k]]);
+        }
+
+        if(maximum && (Psi[i]-min)/(max-min) > 0.9)
+        {
+            maxima.push_back(i);
+        }
+    }
+
+    return maxima;
+}
+
+//----------------------------------------------------------------------------------------
+
+double OrientationDiffusionFunctionModel::EvaluateExactModel(const std::vector< double > &coefficients, const double direction[3]) const
+{
+    double theta = std::acos(std::max(-1.0, std::min(1.0, direction[2])));
+    double   phi = std::atan2(direction[1], direction[0]);
+
+    if(phi < 0)
+    {
+        phi += 2.0 * M_PI;
+    }
+
+    btk::SphericalDirection u(theta, phi);
+
+    double       value = 0.0;
+    unsigned int     i = 0;
+
+    for(unsigned int l = 0; l <= m_SphericalHarmonicsOrder; l += 2)
+    {
+        for(int m = -(int)l; m <= (int)l; m++)
+        {
+            value += btk::SphericalHarmonics::ComputeBasis(u,l,m) * coefficients[i++];
+        } // for m
+    } // for l
+
+    return value;
+}
+
+//----------------------------------------------------------------------------------------
+
+double OrientationDiffusionFunctionModel::RefineMaximum(const std::vector< double > &coefficients, double direction[3], double radius) const
+{
+    // Finite differences step (the spherical coordinates of the basis are computed in single precision)
+    const double h = 0.02;
+
+    double p[3] = { direction[0], direction[1], direction[2] };
+    double value = this->EvaluateExactModel(coefficients, p);
+
+    for(unsigned int iteration = 0; iteration < 5; iteration++)
+    {
+        // Orthonormal basis (e1,e2) of the tangent plane at p
+        double a[3] = { 0.0, 0.0, 0.0 };
+        a[ (std::abs(p[0]) < 0.9) ? 0 : 1 ] = 1.0;
+
+        double ap = a[0]*p[0] + a[1]*p[1] + a[2]*p[2];
+        double e1[3] = { a[0]-ap*p[0], a[1]-ap*p[1], a[2]-ap*p[2] };
+        double n1 = std::sqrt(e1[0]*e1[0] + e1[1]*e1[1] + e1[2]*e1[2]);
+        e1[0] /= n1; e1[1] /= n1; e1[2] /= n1;
+
+        double e2[3] = { p[1]*e1[2]-p[2]*e1[1], p[2]*e1[0]-p[0]*e1[2], p[0]*e1[1]-p[1]*e1[0] };
+
+        // ODF in the tangent plane: f(s,t) = ODF( (p + s.e1 + t.e2) / |p + s.e1 + t.e2| )
+        double f[3][3];
+
+        for(int i = -1; i <= 1; i++)
+        {
+            for(int j = -1; j <= 1; j++)
+            {
+                if(i == 0 && j == 0)
+                {
+                    f[1][1] = value;
+                    continue;
+                }
+
+                double q[3];
+                for(unsigned int d = 0; d < 3; d++)
+                {
+                    q[d] = p[d] + i*h*e1[d] + j*h*e2[d];
+                }
+
+                double nq = std::sqrt(q[0]*q[0] + q[1]*q[1] + q[2]*q[2]);
+                q[0] /= nq; q[1] /= nq; q[2] /= nq;
+
+                f[i+1][j+1] = this->EvaluateExactModel(coefficients, q);
+            }
+        }
+
+        // Gradient and Hessian
+        double gs  = (f[2][1] - f[0][1]) / (2.0*h);
+        double gt  = (f[1][2] - f[1][0]) / (2.0*h);
+        double hss = (f[2][1] - 2.0*f[1][1] + f[0][1]) / (h*h);
+        double htt = (f[1][2] - 2.0*f[1][1] + f[1][0]) / (h*h);
+        double hst = (f[2][2] - f[2][0] - f[0][2] + f[0][0]) / (4.0*h*h);
+        double det = hss*htt - hst*hst;
+
+        double ds, dt;
+
+        if(hss < 0 && det > 0)
+        {
+            // Newton step (the Hessian is negative definite)
+            ds = -( htt*gs - hst*gt) / det;
+            dt = -(-hst*gs + hss*gt) / det;
+        }
+        else
+        {
+            // Gradient step
+            double ng = std::sqrt(gs*gs + gt*gt);
+
+            if(ng <= 0)
+            {
+                break;
+            }
+
+            ds = h * gs / ng;
+            dt = h * gt / ng;
+        }
+
+        double step = std::sqrt(ds*ds + dt*dt);
+
+        if(step > radius)
+        {
+            ds *= radius / step;
+            dt *= radius / step;
+            step = radius;
+        }
+
+        double q[3];
+        for(unsigned int d = 0; d < 3; d++)
+        {
+            q[d] = p[d] + ds*e1[d] + dt*e2[d];
+        }
+
+        double nq = std::sqrt(q[0]*q[0] + q[1]*q[1] + q[2]*q[2]);
+        q[0] /= nq; q[1] /= nq; q[2] /= nq;
+
+        double newValue = this->EvaluateExactModel(coefficients, q);
+
+        if(newValue < value)
+        {
+            break;
+        }
+
+        p[0] = q[0]; p[1] = q[1]; p[2] = q[2];
+        value = newValue;
+
+        if(step < 1e-4)
+        {
+            break;
+        }
+    } // for each iteration
+
+    direction[0] = p[0]; direction[1] = p[1]; direction[2] = p[2];
+
+    return value;
+}
+
+//----------------------------------------------------------------------------------------
+
+std::vector< btk::GradientDirection > OrientationDiffusionFunctionModel::ComputeVoxelMeanDirections(ModelImage::PixelType shCoefficients) const
+{
+    // Coefficients of the ODF
+    std::vector< double > coefficients(m_NumberOfSHCoefficients, 0.0);
+
+    for(unsigned int j = 0; j < m_NumberOfSHCoefficients; j++)
+    {
+        coefficients[j] = shCoefficients[j] * m_LegendreMatrix(j,j) * (m_UseSharpModel ? m_ModelSharpMatrix(j,j) : 1.f);
+    }
+
+    // ODF on the sampling of the sphere
+    unsigned int numberOfDirections = m_Directions.size();
+    std::vector< float > Psi(numberOfDirections, 0.f);
+
+    for(unsigned int i = 0; i < numberOfDirections; i++)
+    {
+        double value = 0.0;
+
+        for(unsigned int j = 0; j < m_NumberOfSHCoefficients; j++)
+        {
+            value += m_SphericalHarmonicsBasisMatrix(i,j) * coefficients[j];
+        }
+
+        Psi[i] = (value >= 0.0 ? value : 0.0);
+    }
+
+    std::vector< unsigned int > maxima = this->FindMaxima(Psi);
+
+    // Refine the maxima (in a radius of half the sampling step)
+    unsigned int thetaResolution = static_cast< unsigned int >(std::ceil( std::sqrt(static_cast< float >(m_SphericalResolution)/2.f) ));
+    double                radius = 0.5 * M_PI / static_cast< double >(thetaResolution);
+
+    std::vector< double > values;
+    std::vector< btk::GradientDirection > refined;
+
+    for(unsigned int i = 0; i < maxima.size(); i++)
+    {
+        double direction[3] = { m_Directions[maxima[i]][0], m_Directions[maxima[i]][1], m_Directions[maxima[i]][2] };
+        double norm = std::sqrt(direction[0]*direction[0] + direction[1]*direction[1] + direction[2]*direction[2]);
+        direction[0] /= norm; direction[1] /= norm; direction[2] /= norm;
+
+        double value = this->RefineMaximum(coefficients, direction, radius);
+
+        // Two maxima of the sampling may converge to the same maximum
+        bool duplicate = false;
+
+        for(unsigned int k = 0; k < refined.size() && !duplicate; k++)
+        {
+            duplicate = (refined[k][0]*direction[0] + refined[k][1]*direction[1] + refined[k][2]*direction[2] > 0.999);
+        }
+
+        if(!duplicate)
+        {
+            // Sorted insertion by decreasing value
+            unsigned int position = 0;
+            while(position < values.size() && values[position] >= value)
+            {
+                position++;
+            }
+
+            values.insert(values.begin() + position, value);
+            refined.insert(refined.begin() + position, btk::GradientDirection(direction[0], direction[1], direction[2]));
+        }
+    } // for each maximum
+
+    if(refined.size() > MaximumNumberOfMeanDirections)
+    {
+        refined.resize(MaximumNumberOfMeanDirections);
+    }
+
+    return refined;
+}
+
+//----------------------------------------------------------------------------------------
+
+void OrientationDiffusionFunctionModel::InitializeMeanDirectionsCache()
+{
+    unsigned long numberOfVoxels = m_InputModelImage->GetLargestPossibleRegion().GetNumberOfPixels();
+
+    m_CachedMeanDirections.assign(numberOfVoxels * 3 * MaximumNumberOfMeanDirections, 0.f);
+    m_NumberOfCachedMeanDirections.assign(numberOfVoxels, NOT_COMPUTED);
+    m_MeanDirectionsCacheIsComplete = false;
+}
+
+//----------------------------------------------------------------------------------------
+
+void OrientationDiffusionFunctionModel::SetCachedMeanDirections(unsigned long offset, const std::vector< btk::GradientDirection > &meanDirections)
+{
+    float *directions = &m_CachedMeanDirections[offset * 3 * MaximumNumberOfMeanDirections];
+
+    for(unsigned int k = 0; k < meanDirections.size(); k++)
+    {
+        directions[3*k  ] = meanDirections[k][0];
+        directions[3*k+1] = meanDirections[k][1];
+        directions[3*k+2] = meanDirections[k][2];
+    }
+
+    m_NumberOfCachedMeanDirections[offset] = meanDirections.size();
+}
+
+//----------------------------------------------------------------------------------------
+
+unsigned int OrientationDiffusionFunctionModel::GetCachedMeanDirections(unsigned long offset, float directions[3*MaximumNumberOfMeanDirections])
+{
+    if(!m_MeanDirectionsCacheIsComplete)
+    {
+        // The voxel may be computed by another thread: the state is read under lock
+        m_MeanDirectionsCacheMutex.Lock();
+        bool computed = (m_NumberOfCachedMeanDirections[offset] != NOT_COMPUTED);
+        m_MeanDirectionsCacheMutex.Unlock();
+
+        if(!computed)
+        {
+            ModelImage::IndexType index = m_InputModelImage->ComputeIndex(offset);
+            std::vector< btk::GradientDirection > meanDirections = this->ComputeVoxelMeanDirections(m_InputModelImage->GetPixel(index));
+
+            m_MeanDirectionsCacheMutex.Lock();
+            if(m_NumberOfCachedMeanDirections[offset] == NOT_COMPUTED)
+            {
+                this->SetCachedMeanDirections(offset, meanDirections);
+            }
+            m_MeanDirectionsCacheMutex.Unlock();
+        }
+    }
+
+    // Once computed, the mean directions of a voxel are never modified
+    unsigned int numberOfDirections = m_NumberOfCachedMeanDirections[offset];
+    const float *cached = &m_CachedMeanDirections[offset * 3 * MaximumNumberOfMeanDirections];
+
+    std::copy(cached, cached + 3*numberOfDirections, directions);
+
+    return numberOfDirections;
+}
+
+//----------------------------------------------------------------------------------------
+
+void OrientationDiffusionFunctionModel::ComputeMeanDirectionsCache(MaskImage::Pointer mask)
+{
+    ModelImage::RegionType region = m_InputModelImage->GetLargestPossibleRegion();
+    long numberOfVoxels = region.GetNumberOfPixels();
+    long offset;
+
+    #pragma omp parallel for private(offset) schedule(dynamic,64)
+    for(offset = 0; offset < numberOfVoxels; offset++)
+    {
+        if(m_NumberOfCachedMeanDirections[offset] != NOT_COMPUTED)
+        {
+            continue;
+        }
+
+        ModelImage::IndexType index = m_InputModelImage->ComputeIndex(offset);
+        bool inside = true;
+
+        if(mask.IsNotNull())
+        {
+            ModelImage::PointType point;
+            m_InputModelImage->TransformIndexToPhysicalPoint(index, point);
+
+            MaskImage::IndexType maskIndex;
+            inside = mask->TransformPhysicalPointToIndex(point, maskIndex) && mask->GetPixel(maskIndex) != 0;
+        }
+
+        std::vector< btk::GradientDirection > meanDirections;
+
+        if(inside)
+        {
+            meanDirections = this->ComputeVoxelMeanDirections(m_InputModelImage->GetPixel(index));
+        }
+
+        // Each voxel is written by a single thread
+        this->SetCachedMeanDirections(offset, meanDirections);
+    } // for each voxel
+
+    m_MeanDirectionsCacheIsComplete = true;
+}
+
 } // namespace btk
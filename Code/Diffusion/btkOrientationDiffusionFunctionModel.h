@@ -41,10 +41,13 @@
 #include "itkMacro.h"
 #include "itkLinearInterpolateImageFunction.h"
 #include "itkVariableSizeMatrix.h"
+#include "itkImage.h"
+#include "itkFastMutexLock.h"
 
 // Local includes
 #include "btkDiffusionModel.h"
 #include "btkSphericalHarmonicsDiffusionDecompositionFilter.h"
+#include "btkSphericalHarmonicsTable.h"
 
 namespace btk
 {
@@ -68,6 +71,10 @@ class OrientationDiffusionFunctionModel : public btk::DiffusionModel
         typedef Superclass::ContinuousIndex                                          ContinuousIndex;
 
         typedef itk::VariableSizeMatrix< float > Matrix;
+        typedef itk::Image< short,3 >            MaskImage;
+
+        /** Maximal number of mean directions (maxima of the ODF) kept for a voxel. */
+        static const unsigned int MaximumNumberOfMeanDirections = 6;
 
         itkNewMacro(Self);
 
@@ -79,6 +86,9 @@ class OrientationDiffusionFunctionModel : public btk::DiffusionModel
         btkSetMacro(InputModelImage, ModelImage::Pointer);
         btkGetMacro(InputModelImage, ModelImage::Pointer);
 
+        btkSetMacro(BasisTableResolution, unsigned int);
+        btkGetMacro(BasisTableResolution, unsigned int);
+
         /**
          * @brief Update the process.
          */
@@ -218,6 +228,37 @@ class OrientationDiffusionFunctionModel : public btk::DiffusionModel
          */
         void UseSharpModelOff();
 
+        /**
+         * @brief Use the cache of mean directions (default).
+         * The maxima of the ODF are searched once per voxel of the model image (on the first use or by
+         * ComputeMeanDirectionsCache), and refined by Newton iterations on the spherical harmonics expansion.
+         * The mean directions at a continuous index are then obtained by trilinear blending of the mean
+         * directions of the eight surrounding voxels.
+         */
+        void UseMeanDirectionsCacheOn();
+
+        /**
+         * @brief Do not use the cache of mean directions: the maxima of the interpolated ODF are searched on the sampling of the sphere at each call.
+         */
+        void UseMeanDirectionsCacheOff();
+
+        /**
+         * @brief Compute the mean directions of all voxels of the model image in parallel.
+         * This method must be called after Update. Voxels outside the mask have no mean direction.
+         * @param mask Mask (in physical space) of the voxels to process (all voxels are processed if NULL).
+         */
+        void ComputeMeanDirectionsCache(MaskImage::Pointer mask = NULL);
+
+        /**
+         * @brief Evaluate the model and the signal in a direction with the analytical spherical harmonics basis (for validation).
+         */
+        void UseExactBasisOn();
+
+        /**
+         * @brief Evaluate the model and the signal in a direction with the tabulated spherical harmonics basis (default).
+         */
+        void UseExactBasisOff();
+
     protected:
         /**
          * @brief Constructor.
@@ -291,6 +332,67 @@ class OrientationDiffusionFunctionModel : public btk::DiffusionModel
          */
         void ComputeModelSharpMatrix();
 
+        /**
+         * @brief Compute the tabulated spherical harmonics basis of the model and of the signal.
+         */
+        void ComputeBasisTables();
+
+        /**
+         * @brief Compute the neighbours of each direction of the sampling of the sphere (rings of constant elevation and poles).
+         */
+        void ComputeDirectionsNeighbours();
+
+        /**
+         * @brief Find the local maxima of the ODF on the sampling of the sphere.
+         * @param Psi Values of the ODF on the sampling of the sphere.
+         * @return Indices of the directions of the maxima.
+         */
+        std::vector< unsigned int > FindMaxima(const std::vector< float > &Psi) const;
+
+        /**
+         * @brief Compute the mean directions of a voxel (maxima on the sampling of the sphere refined by Newton iterations).
+         * @param shCoefficients Spherical harmonics coefficients of the voxel.
+         * @return Mean directions (at most MaximumNumberOfMeanDirections, sorted by decreasing ODF value).
+         */
+        std::vector< btk::GradientDirection > ComputeVoxelMeanDirections(ModelImage::PixelType shCoefficients) const;
+
+        /**
+         * @brief Evaluate the ODF in a direction with the analytical spherical harmonics basis.
+         * @param coefficients Coefficients of the ODF (spherical harmonics coefficients multiplied by the diagonal matrices of the model).
+         * @param direction Unit direction.
+         * @return Value of the ODF.
+         */
+        double EvaluateExactModel(const std::vector< double > &coefficients, const double direction[3]) const;
+
+        /**
+         * @brief Refine a maximum of the ODF by Newton iterations in the tangent plane of the sphere.
+         * @param coefficients Coefficients of the ODF (see EvaluateExactModel).
+         * @param direction Unit direction of the maximum (input: maximum on the sampling, output: refined maximum).
+         * @param radius Maximal displacement (in radians).
+         * @return Value of the ODF at the refined maximum.
+         */
+        double RefineMaximum(const std::vector< double > &coefficients, double direction[3], double radius) const;
+
+        /**
+         * @brief Allocate the cache of mean directions (all voxels are marked as not computed).
+         */
+        void InitializeMeanDirectionsCache();
+
+        /**
+         * @brief Get the mean directions of a voxel from the cache (the mean directions are computed if needed).
+         * @param offset Offset of the voxel in the model image.
+         * @param directions Mean directions of the voxel (3 values per direction).
+         * @return Number of mean directions of the voxel.
+         */
+        unsigned int GetCachedMeanDirections(unsigned long offset, float directions[3*MaximumNumberOfMeanDirections]);
+
+        /**
+         * @brief Store the mean directions of a voxel in the cache.
+         * @param offset Offset of the voxel in the model image.
+         * @param meanDirections Mean directions of the voxel.
+         */
+        void SetCachedMeanDirections(unsigned long offset, const std::vector< btk::GradientDirection > &meanDirections);
+
     private:
         /**
          * @brief B-value used during the data acquisition.
@@ -322,6 +424,56 @@ class OrientationDiffusionFunctionModel : public btk::DiffusionModel
          */
         bool m_UseSharpModel;
 
+        /**
+         * @brief Flag for the analytical evaluation of the spherical harmonics basis.
+         */
+        bool m_UseExactBasis;
+
+        /**
+         * @brief Number of elevation steps of the tabulated basis (default: 90, i.e. 2 degrees).
+         */
+        unsigned int m_BasisTableResolution;
+
+        /**
+         * @brief Tabulated spherical harmonics basis of the model (Legendre and sharp matrices are included).
+         */
+        btk::SphericalHarmonicsTable m_ModelBasisTable;
+
+        /**
+         * @brief Tabulated spherical harmonics basis of the signal.
+         */
+        btk::SphericalHarmonicsTable m_SignalBasisTable;
+
+        /**
+         * @brief Neighbours of each direction of the sampling of the sphere.
+         */
+        std::vector< std::vector< unsigned int > > m_DirectionsNeighbours;
+
+        /**
+         * @brief Flag for the cache of mean directions.
+         */
+        bool m_UseMeanDirectionsCache;
+
+        /**
+         * @brief True if the cache has been computed for all voxels (it is then read without lock).
+         */
+        bool m_MeanDirectionsCacheIsComplete;
+
+        /**
+         * @brief Mean directions of the voxels (MaximumNumberOfMeanDirections directions of 3 values per voxel).
+         */
+        std::vector< float > m_CachedMeanDirections;
+
+        /**
+         * @brief Number of mean directions of the voxels (255 if the voxel has not been processed yet).
+         */
+        std::vector< unsigned char > m_NumberOfCachedMeanDirections;
+
+        /**
+         * @brief Mutex protecting the cache when voxels are computed on the first use.
+         */
+        itk::SimpleFastMutexLock m_MeanDirectionsCacheMutex;
+
         /**
          * @brief Legendre matrix of the model.
          */
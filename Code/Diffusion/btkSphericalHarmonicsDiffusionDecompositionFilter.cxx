@@ -40,15 +40,16 @@
 #include "btkSphericalHarmonics.h"
 
 // ITK includes
-#include "itkExtractImageFilter.h"
-#include "itkImageRegionIterator.h"
-#include "itkImageRegionIteratorWithIndex.h"
 #include "itkVectorImage.h"
 
+// STL includes
+#include "algorithm"
+
 // Definitions
-typedef itk::ExtractImageFilter< btk::DiffusionSequence,itk::Image< short,3 > > ExtractImageFilter;
-typedef itk::VectorImage< short,3 > VectorImage;
-typedef itk::ImageRegionIterator< VectorImage > VectorImageIterator;
+typedef btk::DiffusionSequence::VectorImageType VectorImage;
+
+// Number of voxels estimated together
+#define SH_DECOMPOSITION_TILE_SIZE 64
 
 
 namespace btk
@@ -208,113 +209,148 @@ void SphericalHarmonicsDiffusionDecompositionFilter::BeforeThreadedGenerateData(
     this->ComputeTransitionMatrix();
 
 
-    // Extract reference and gradient images and give it to filter.
-    // This process assume that the given sequence is normalized (one reference image at first).
-    std::vector< btk::GradientDirection > gradientTable = m_InputDiffusionSequence->GetGradientTable();
-    btk::DiffusionSequence::RegionType           region = m_InputDiffusionSequence->GetLargestPossibleRegion();
-    ExtractImageFilter::Pointer                 extract = ExtractImageFilter::New();
-
-    // Get the reference image
-    region.SetSize(3,0);
-    extract->SetInput(m_InputDiffusionSequence);
-    extract->SetExtractionRegion(region);
-    extract->SetDirectionCollapseToSubmatrix();
-    extract->Update();
-
-    // Build a vector image from the diffusion sequence
-    // TODO : store diffusion sequence as vector image
-    VectorImage::Pointer vectorImage = VectorImage::New();
-    vectorImage->SetRegions(extract->GetOutput()->GetLargestPossibleRegion());
-    vectorImage->SetSpacing(extract->GetOutput()->GetSpacing());
-    vectorImage->SetOrigin(extract->GetOutput()->GetOrigin());
-    vectorImage->SetDirection(extract->GetOutput()->GetDirection());
-    vectorImage->SetVectorLength(gradientTable.size());
-    vectorImage->Allocate();
-    vectorImage->FillBuffer(itk::VariableLengthVector< short >(0));
-
-    VectorImageIterator it(vectorImage, vectorImage->GetLargestPossibleRegion());
-
-    for(it.GoToBegin(); !it.IsAtEnd(); ++it)
-    {
-        VectorImage::IndexType vindex = it.GetIndex();
-        btk::DiffusionSequence::IndexType sindex;
-        sindex[0] = vindex[0]; sindex[1] = vindex[1]; sindex[2] = vindex[2];
+    // Get the voxel-interleaved representation of the sequence (shared with the other filters)
+    m_VectorImage = m_InputDiffusionSequence->GetVectorImage();
 
-        VectorImage::PixelType pixelValue;
-        pixelValue.SetSize(vectorImage->GetVectorLength());
+    // Copy the transition matrix in a contiguous array
+    unsigned int numberOfGradientDirections = m_TransitionMatrix.Cols();
+    m_TransitionPanel.resize(m_NumberOfSHCoefficients * numberOfGradientDirections);
 
-        for(unsigned int k = 0; k < vectorImage->GetVectorLength(); k++)
+    for(unsigned int i = 0; i < m_NumberOfSHCoefficients; i++)
+    {
+        for(unsigned int j = 0; j < numberOfGradientDirections; j++)
         {
-            sindex[3] = k;
-            pixelValue[k] = m_InputDiffusionSequence->GetPixel(sindex);
+            m_TransitionPanel[i*numberOfGradientDirections + j] = m_TransitionMatrix(i,j);
         }
-
-        it.Set(pixelValue);
     }
 
-    m_VectorImage = vectorImage;
+    // This assume that the sequence has only one B0 image at first.
+    std::vector< unsigned short > bValues = m_InputDiffusionSequence->GetBValues();
+    m_InverseBValues.resize(numberOfGradientDirections);
+
+    for(unsigned int i = 0; i < numberOfGradientDirections; i++)
+    {
+        m_InverseBValues[i] = 1.0 / static_cast< double >(bValues[i+1]);
+    }
 }
 
 //----------------------------------------------------------------------------------------
 
 void SphericalHarmonicsDiffusionDecompositionFilter::ThreadedGenerateData(const OutputImageRegionType &outputRegionForThread, itk::ThreadIdType threadId)
 {
-    // Estimate model
-    VectorImageIterator                                  it(m_VectorImage, outputRegionForThread);
-    itk::ImageRegionIterator< Self::OutputImageType > outIt(this->GetOutput(), outputRegionForThread);
+    Self::OutputImageType::Pointer output = this->GetOutput();
 
-    unsigned int gradienTableSize = m_VectorImage->GetVectorLength();
+    unsigned int numberOfGradientDirections = m_TransitionMatrix.Cols();
+    unsigned int                vectorLength = m_VectorImage->GetVectorLength();
+    const short                       *input = m_VectorImage->GetBufferPointer();
 
-    for(it.GoToBegin(), outIt.GoToBegin(); !it.IsAtEnd() && !outIt.IsAtEnd(); ++it, ++outIt)
-    {
-        VectorImage::PixelType signal = it.Get();
+    std::vector< float >         signalPanel(numberOfGradientDirections * SH_DECOMPOSITION_TILE_SIZE);
+    std::vector< float >   coefficientsPanel(m_NumberOfSHCoefficients * SH_DECOMPOSITION_TILE_SIZE);
+    std::vector< unsigned long > tileOffsets;
+    tileOffsets.reserve(SH_DECOMPOSITION_TILE_SIZE);
 
-        // Get signal matrix
-        Self::Matrix signalMatrix(gradienTableSize-1, 1);
+    Self::OutputImageType::IndexType start = outputRegionForThread.GetIndex();
+    Self::OutputImageType::SizeType   size = outputRegionForThread.GetSize();
 
-        for(unsigned int i = 0; i < signalMatrix.Rows(); i++)
+    // Gather the voxels by tiles (voxels with a null reference signal have null coefficients and are skipped)
+    for(unsigned int z = 0; z < size[2]; z++)
+    {
+        for(unsigned int y = 0; y < size[1]; y++)
         {
-            if(m_EstimationType == Self::APPARENT_DIFFUSION_PROFILE)
+            Self::OutputImageType::IndexType rowIndex = start;
+            rowIndex[1] += y;
+            rowIndex[2] += z;
+
+            unsigned long rowOffset = output->ComputeOffset(rowIndex);
+
+            for(unsigned int x = 0; x < size[0]; x++)
             {
-                double b0 = static_cast< float >(signal[0]);
+                unsigned long offset = rowOffset + x;
 
-                if(!btkFloatingEqual(b0, 0.0))
-                {
-                    signalMatrix(i,0) = -(1.0/m_InputDiffusionSequence->GetBValues()[i+1]) * std::log(static_cast< float >(signal[i+1]) / b0);
-                }
-                else
+                if(input[offset * vectorLength] != 0)
                 {
-                    signalMatrix(i,0) = 0.0;
+                    tileOffsets.push_back(offset);
+
+                    if(tileOffsets.size() == SH_DECOMPOSITION_TILE_SIZE)
+                    {
+                        this->EstimateTile(tileOffsets, &signalPanel[0], &coefficientsPanel[0]);
+                        tileOffsets.clear();
+                    }
                 }
             }
-            else // m_EstimationType == Self::DIFFUSION_SIGNAL
+        }
+    }
+
+    if(!tileOffsets.empty())
+    {
+        this->EstimateTile(tileOffsets, &signalPanel[0], &coefficientsPanel[0]);
+    }
+}
+
+//----------------------------------------------------------------------------------------
+
+void SphericalHarmonicsDiffusionDecompositionFilter::EstimateTile(const std::vector< unsigned long > &offsets, float *signalPanel, float *coefficientsPanel)
+{
+    unsigned int numberOfGradientDirections = m_TransitionMatrix.Cols();
+    unsigned int                vectorLength = m_VectorImage->GetVectorLength();
+    unsigned int          numberOfVoxels = offsets.size();
+    const short                       *input = m_VectorImage->GetBufferPointer();
+    float                            *output = this->GetOutput()->GetBufferPointer();
+
+    // Fill the signal panel (rows: gradient directions, columns: voxels)
+    for(unsigned int t = 0; t < numberOfVoxels; t++)
+    {
+        const short *signal = input + offsets[t] * vectorLength;
+        float            b0 = static_cast< float >(signal[0]);
+
+        if(m_EstimationType == Self::APPARENT_DIFFUSION_PROFILE)
+        {
+            for(unsigned int i = 0; i < numberOfGradientDirections; i++)
             {
-                double b0 = static_cast< float >(signal[0]);
+                signalPanel[i*numberOfVoxels + t] = -m_InverseBValues[i] * std::log(static_cast< float >(signal[i+1]) / b0);
+            }
+        }
+        else // m_EstimationType == Self::DIFFUSION_SIGNAL
+        {
+            float inverseB0 = 1.f / b0;
 
-                if(!btkFloatingEqual(b0, 0.0))
-                {
-                    signalMatrix(i,0) = static_cast< float >(signal[i+1]) / static_cast< float >(signal[0]);
-                }
-                else
-                {
-                    signalMatrix(i,0) = 0.0;
-                }
+            for(unsigned int i = 0; i < numberOfGradientDirections; i++)
+            {
+                signalPanel[i*numberOfVoxels + t] = static_cast< float >(signal[i+1]) * inverseB0;
             }
         }
+    }
 
-        // Compute coefficients matrix
-        Self::Matrix coefficientsMatrix(m_NumberOfSHCoefficients, 1);
-        coefficientsMatrix = m_TransitionMatrix * signalMatrix;
+    // Compute the coefficients panel (rows: coefficients, columns: voxels).
+    // The inner loop runs over contiguous voxels, so that it is vectorized by the compiler.
+    std::fill(coefficientsPanel, coefficientsPanel + m_NumberOfSHCoefficients*numberOfVoxels, 0.f);
 
-        // Set coefficients in pixel
-        Self::OutputImagePixelType coefficients(m_NumberOfSHCoefficients);
+    for(unsigned int k = 0; k < m_NumberOfSHCoefficients; k++)
+    {
+        const float *transition = &m_TransitionPanel[k*numberOfGradientDirections];
+        float     *coefficients = coefficientsPanel + k*numberOfVoxels;
 
-        for(unsigned int i = 0; i < coefficientsMatrix.Rows(); i++)
+        for(unsigned int i = 0; i < numberOfGradientDirections; i++)
         {
-            coefficients[i] = coefficientsMatrix(i,0);
+            const float  value = transition[i];
+            const float *signal = signalPanel + i*numberOfVoxels;
+
+            for(unsigned int t = 0; t < numberOfVoxels; t++)
+            {
+                coefficients[t] += value * signal[t];
+            }
         }
+    }
+
+    // Write the coefficients in the output image
+    for(unsigned int t = 0; t < numberOfVoxels; t++)
+    {
+        float *pixel = output + offsets[t] * m_NumberOfSHCoefficients;
 
-        outIt.Set(coefficients);
+        for(unsigned int k = 0; k < m_NumberOfSHCoefficients; k++)
+        {
+            pixel[k] = coefficientsPanel[k*numberOfVoxels + t];
+        }
     }
 }
 
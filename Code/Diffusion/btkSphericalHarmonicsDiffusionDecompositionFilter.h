@@ -36,6 +36,9 @@
 #ifndef BTK_SPHERICAL_HARMONICS_DIFFUSION_DECOMPOSITION_FILTER_H
 #define BTK_SPHERICAL_HARMONICS_DIFFUSION_DECOMPOSITION_FILTER_H
 
+// STL includes
+#include "vector"
+
 // ITK includes
 #include "itkImageToImageFilter.h"
 #include "itkVariableSizeMatrix.h"
@@ -137,6 +140,17 @@ class SphericalHarmonicsDiffusionDecompositionFilter : public itk::ImageToImageF
          */
         void ComputeTransitionMatrix();
 
+        /**
+         * @brief Estimate the coefficients of a tile of voxels.
+         * The signals of the voxels are gathered in a panel (rows: gradient directions, columns: voxels),
+         * which is multiplied by the transition matrix in one matrix-matrix product. The coefficients
+         * are written directly in the output buffer.
+         * @param offsets Offsets of the voxels of the tile in the image buffers.
+         * @param signalPanel Work array of size (number of gradient directions x number of voxels).
+         * @param coefficientsPanel Work array of size (number of coefficients x number of voxels).
+         */
+        void EstimateTile(const std::vector< unsigned long > &offsets, float *signalPanel, float *coefficientsPanel);
+
     private:
         /** Diffusion sequence. */
         btk::DiffusionSequence::Pointer m_InputDiffusionSequence;
@@ -159,6 +173,12 @@ class SphericalHarmonicsDiffusionDecompositionFilter : public itk::ImageToImageF
         /** Transition matrix for linear regression. */
         Self::Matrix m_TransitionMatrix;
 
+        /** Transition matrix stored contiguously by rows (used by the tile estimation). */
+        std::vector< float > m_TransitionPanel;
+
+        /** Inverse of the b-values of the gradient directions. */
+        std::vector< float > m_InverseBValues;
+
         /** Internal diffusion weighted image. */
         itk::VectorImage< short,3 >::Pointer m_VectorImage;
 
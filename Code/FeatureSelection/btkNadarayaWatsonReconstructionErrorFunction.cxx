@@ -38,12 +38,14 @@
 
 // STL includes
 #include "numeric"
+#include "limits"
+#include "algorithm"
 
 
 namespace btk
 {
 
-NadarayaWatsonReconstructionErrorFunction::NadarayaWatsonReconstructionErrorFunction() : m_BandwidthMatrix(NULL), Superclass()
+NadarayaWatsonReconstructionErrorFunction::NadarayaWatsonReconstructionErrorFunction() : m_BandwidthMatrix(NULL), m_ExactBandwidthOptimization(false), Superclass()
 {
     // ----
 }
@@ -55,6 +57,22 @@ void NadarayaWatsonReconstructionErrorFunction::ActivateParameters(unsigned int
     unsigned int index2 = index + m_NumberOfParameters;
     unsigned int index3 = index + m_TwoTimeNumberOfParameters;
 
+    // Replace the contribution of the current triplet by the input one in the distance matrix
+    if(m_DistanceMatrix.size() == m_NumberOfVectors*m_NumberOfVectors)
+    {
+        #pragma omp parallel for default(shared) schedule(dynamic)
+        for(unsigned int j = 0; j < m_NumberOfVectors; j++)
+        {
+            for(unsigned int k = j+1; k < m_NumberOfVectors; k++)
+            {
+                double delta = this->TripletSquaredDistance(*m_InputParameters, index, j, k) - this->TripletSquaredDistance(*m_CurrentParameters, index, j, k);
+
+                m_DistanceMatrix[j*m_NumberOfVectors + k] += delta;
+                m_DistanceMatrix[k*m_NumberOfVectors + j] += delta;
+            }
+        }
+    }
+
     #pragma omp parallel for default(shared) schedule(dynamic)
     for(unsigned int j = 0; j < m_NumberOfVectors; j++)
     {
@@ -73,6 +91,22 @@ void NadarayaWatsonReconstructionErrorFunction::DesactivateParameters(unsigned i
     unsigned int index2 = index + m_NumberOfParameters;
     unsigned int index3 = index + m_TwoTimeNumberOfParameters;
 
+    // Remove the contribution of the current triplet from the distance matrix
+    if(m_DistanceMatrix.size() == m_NumberOfVectors*m_NumberOfVectors)
+    {
+        #pragma omp parallel for default(shared) schedule(dynamic)
+        for(unsigned int j = 0; j < m_NumberOfVectors; j++)
+        {
+            for(unsigned int k = j+1; k < m_NumberOfVectors; k++)
+            {
+                double delta = this->TripletSquaredDistance(*m_CurrentParameters, index, j, k);
+
+                m_DistanceMatrix[j*m_NumberOfVectors + k] -= delta;
+                m_DistanceMatrix[k*m_NumberOfVectors + j] -= delta;
+            }
+        }
+    }
+
     #pragma omp parallel for default(shared) schedule(dynamic)
     for(unsigned int j = 0; j < m_NumberOfVectors; j++)
     {
@@ -91,11 +125,12 @@ double NadarayaWatsonReconstructionErrorFunction::Evaluate()
     // Compute the cost for each vector
     double value = 0;
 
+    #pragma omp parallel for default(shared) schedule(dynamic) reduction(+:value)
     for(unsigned int j = 0; j < m_NumberOfVectors; j++)
     {
-        vnl_vector< double > v = m_CurrentParameters->get_column(j);
+        std::vector< double > weights(m_NumberOfVectors);
 
-        value = value + m_ImagesWeightVector->get(j) * ( m_InputParameters->get_column(j) - this->NadarayaWatsonMultivariateKernelEstimator(*m_CurrentParameters, v, j) ).squared_magnitude();
+        value += m_ImagesWeightVector->get(j) * this->SampleReconstructionError(j, &m_DistanceMatrix[j*m_NumberOfVectors], &weights[0]);
     }
 
     return value;
@@ -131,7 +166,7 @@ double NadarayaWatsonReconstructionErrorFunction::ComputeMeanParameterError()
 
 double NadarayaWatsonReconstructionErrorFunction::FunctionEvaluate(double h)
 {
-    m_BandwidthMatrixInverse.fill_diagonal(1.0/h);
+    this->SetIsotropicBandwidth(h);
 
     return this->Evaluate();
 }
@@ -140,36 +175,66 @@ double NadarayaWatsonReconstructionErrorFunction::FunctionEvaluate(double h)
 
 double NadarayaWatsonReconstructionErrorFunction::GradientEvaluate(double h)
 {
-    double delta = 0.1/2.0;
+    double       derivative = 0.0;
+    double secondDerivative = 0.0;
 
-    // Use the finite centered difference with step=1 to approximage gradient
-    double fPlus = this->FunctionEvaluate(h+delta);
-    double fMinus = this->FunctionEvaluate(h-delta);
+    this->FunctionAndDerivativesEvaluate(h, derivative, secondDerivative);
 
-    return (fPlus - fMinus) / delta;
+    // Twice the derivative: the former centered difference was divided by the half step,
+    // and the steps and thresholds of the Wolfe search are tuned for this scale
+    return 2.0*derivative;
 }
 
 //----------------------------------------------------------------------------------------
 
-double NadarayaWatsonReconstructionErrorFunction::EvaluateActivation(unsigned int activatedIndex)
+double NadarayaWatsonReconstructionErrorFunction::FunctionAndDerivativesEvaluate(double h, double &derivative, double &secondDerivative)
 {
-    unsigned int activatedIndex2 = activatedIndex + m_NumberOfParameters;
-    unsigned int activatedIndex3 = activatedIndex + m_TwoTimeNumberOfParameters;
+    this->SetIsotropicBandwidth(h);
+
+    // Compute the cost and its derivatives for each vector
+    double  value = 0.0;
+    double    dh1 = 0.0;
+    double    dh2 = 0.0;
+
+    #pragma omp parallel for default(shared) schedule(dynamic) reduction(+:value,dh1,dh2)
+    for(unsigned int j = 0; j < m_NumberOfVectors; j++)
+    {
+        std::vector< double > weights(3*m_NumberOfVectors);
+        double sampleDerivative = 0.0, sampleSecondDerivative = 0.0;
+
+        double weight = m_ImagesWeightVector->get(j);
+        value += weight * this->SampleReconstructionErrorDerivatives(j, &m_DistanceMatrix[j*m_NumberOfVectors], h, &weights[0], sampleDerivative, sampleSecondDerivative);
+        dh1   += weight * sampleDerivative;
+        dh2   += weight * sampleSecondDerivative;
+    }
+
+    derivative       = dh1;
+    secondDerivative = dh2;
+
+    return value;
+}
 
+//----------------------------------------------------------------------------------------
+
+double NadarayaWatsonReconstructionErrorFunction::EvaluateActivation(unsigned int activatedIndex)
+{
+    std::vector< double > distances(m_NumberOfVectors);
+    std::vector< double >   weights(m_NumberOfVectors);
 
     // Compute the cost for each vector
     double value = 0;
 
     for(unsigned int j = 0; j < m_NumberOfVectors; j++)
     {
-        vnl_vector< double > v = m_CurrentParameters->get_column(j);
+        const double *currentDistances = &m_DistanceMatrix[j*m_NumberOfVectors];
 
         // Activate parameter
-        v(activatedIndex)  = (*m_InputParameters)(activatedIndex,j);
-        v(activatedIndex2) = (*m_InputParameters)(activatedIndex2,j);
-        v(activatedIndex3) = (*m_InputParameters)(activatedIndex3,j);
+        for(unsigned int k = 0; k < m_NumberOfVectors; k++)
+        {
+            distances[k] = currentDistances[k] - this->TripletSquaredDistance(*m_CurrentParameters, activatedIndex, j, k) + this->TripletSquaredDistance(*m_InputParameters, activatedIndex, j, k);
+        }
 
-        value = value + m_ImagesWeightVector->get(j) * ( m_InputParameters->get_column(j) - this->NadarayaWatsonMultivariateKernelEstimatorActivation(activatedIndex, v, j) ).squared_magnitude();
+        value = value + m_ImagesWeightVector->get(j) * this->SampleReconstructionError(j, &distances[0], &weights[0]);
     }
 
     return value;
@@ -179,26 +244,25 @@ double NadarayaWatsonReconstructionErrorFunction::EvaluateActivation(unsigned in
 
 double NadarayaWatsonReconstructionErrorFunction::EvaluateDesactivation(unsigned int desactivatedIndex)
 {
-    unsigned int desactivatedIndex2 = desactivatedIndex + m_NumberOfParameters;
-    unsigned int desactivatedIndex3 = desactivatedIndex + m_TwoTimeNumberOfParameters;
-
+    std::vector< double > distances(m_NumberOfVectors);
+    std::vector< double >   weights(m_NumberOfVectors);
 
     // Compute the cost for each vector
     double value = 0;
 
     for(unsigned int j = 0; j < m_NumberOfVectors; j++)
     {
-        vnl_vector< double > v = m_CurrentParameters->get_column(j);
+        const double *currentDistances = &m_DistanceMatrix[j*m_NumberOfVectors];
 
-        // Activate parameter
-        v(desactivatedIndex)  = 0;
-        v(desactivatedIndex2) = 0;
-        v(desactivatedIndex3) = 0;
+        // Desactivate parameter
+        for(unsigned int k = 0; k < m_NumberOfVectors; k++)
+        {
+            distances[k] = currentDistances[k] - this->TripletSquaredDistance(*m_CurrentParameters, desactivatedIndex, j, k);
+        }
 
-        value = value + m_ImagesWeightVector->get(j) * ( m_InputParameters->get_column(j) - this->NadarayaWatsonMultivariateKernelEstimatorDesactivation(desactivatedIndex, v, j) ).squared_magnitude();
+        value = value + m_ImagesWeightVector->get(j) * this->SampleReconstructionError(j, &distances[0], &weights[0]);
     }
 
-
     return value;
 }
 
@@ -251,15 +315,40 @@ void NadarayaWatsonReconstructionErrorFunction::Initialize()
 
     // Compute the coefficient of the gaussian kernel
     m_GaussianCoefficient = (1.0 / sqrt(2.0 * M_PI));
+
+    // Precompute the matrices used by the evaluations
+    this->ComputeGramMatrix();
+    this->ComputeDistanceMatrix();
 }
 
 //----------------------------------------------------------------------------------------
 
 std::string NadarayaWatsonReconstructionErrorFunction::OptimizeParameters()
 {
-    // Initialisation of gradient descent parameters
     double h = m_BandwidthMatrix->get(0,0); // Parameter to optimise
 
+    if(m_ExactBandwidthOptimization)
+    {
+        h = this->NewtonBandwidthSearch(h);
+    }
+    else // !m_ExactBandwidthOptimization
+    {
+        h = this->GradientDescentBandwidthSearch(h);
+    }
+
+    this->SetIsotropicBandwidth(h);
+
+    std::stringstream message;
+    message << "\tOptimized bandwidth: " << h;
+
+    return message.str();
+}
+
+//----------------------------------------------------------------------------------------
+
+double NadarayaWatsonReconstructionErrorFunction::GradientDescentBandwidthSearch(double h)
+{
+    // Initialisation of gradient descent parameters
     double     initialStep = 1e-1;  // Initial step of the gradient descent
     double         stepMin = 1e-2;  // Minimal step
     double         stepMax = 0.5;   // Maximal step
@@ -270,15 +359,13 @@ std::string NadarayaWatsonReconstructionErrorFunction::OptimizeParameters()
     double              m1 = 0.1;   // First constant of Wolfe's conditions
     double              m2 = 0.9;   // Second constant of Wolfe's conditions
 
-    double  gradient = this->GradientEvaluate(h);
-    double direction = (gradient < 0.0) ? 1 : -1;
+    // The cost and its gradient (on the scale of GradientEvaluate) come from a single evaluation
+    double       derivative = 0.0;
+    double secondDerivative = 0.0;
 
-//    btkCoutVariable(currentIteration);
-//    btkCoutVariable(h);
-//    btkCoutVariable(gradient);
-//    btkCoutVariable(direction);
-//    btkCoutVariable(initialStep);
-//    std::cerr << std::endl;
+    double         f = this->FunctionAndDerivativesEvaluate(h, derivative, secondDerivative);
+    double  gradient = 2.0*derivative;
+    double direction = (gradient < 0.0) ? 1 : -1;
 
     while(currentIteration <= maxNumOfIterations && std::abs(gradient) > epsilon)
     {
@@ -286,7 +373,6 @@ std::string NadarayaWatsonReconstructionErrorFunction::OptimizeParameters()
         bool  firstWolfeCondition = false;
         bool secondWolfeCondition = false;
         double               step = initialStep;
-        double                  f = this->FunctionEvaluate(h);
 
         do
         {
@@ -295,11 +381,11 @@ std::string NadarayaWatsonReconstructionErrorFunction::OptimizeParameters()
 
             double delta = step*direction;
 
-            firstWolfeCondition = this->FunctionEvaluate(h+delta) <= f + m1*delta*gradient;
+            firstWolfeCondition = this->FunctionAndDerivativesEvaluate(h+delta, derivative, secondDerivative) <= f + m1*delta*gradient;
 
             if(firstWolfeCondition)
             {
-                secondWolfeCondition = direction*this->GradientEvaluate(h+delta) >= m2*direction*gradient;
+                secondWolfeCondition = direction*2.0*derivative >= m2*direction*gradient;
 
                 if(!secondWolfeCondition)
                     step += stepIncrease;
@@ -310,24 +396,71 @@ std::string NadarayaWatsonReconstructionErrorFunction::OptimizeParameters()
         while((!firstWolfeCondition || !secondWolfeCondition) && (step > stepMin && step < stepMax));
 
         h += step*direction;
-        gradient = this->GradientEvaluate(h);
+        f = this->FunctionAndDerivativesEvaluate(h, derivative, secondDerivative);
+        gradient = 2.0*derivative;
         direction = (gradient < 0) ? 1 : -1;
         currentIteration++;
-
-//        btkCoutVariable(currentIteration);
-//        btkCoutVariable(h);
-//        btkCoutVariable(gradient);
-//        btkCoutVariable(direction);
-//        btkCoutVariable(step);
-//        std::cerr << std::endl;
     }
 
-    m_BandwidthMatrixInverse.fill_diagonal(1.0/h);
+    return h;
+}
 
-    std::stringstream message;
-    message << "\tOptimized bandwidth: " << h;
+//----------------------------------------------------------------------------------------
 
-    return message.str();
+double NadarayaWatsonReconstructionErrorFunction::NewtonBandwidthSearch(double h)
+{
+    // Initialisation of the safeguarded Newton method
+    double           stepMin = 1e-3;  // Minimal step (stop criterion)
+    double           stepMax = 0.5;   // Maximal step
+    double           hMin    = 1e-3;  // Minimal bandwidth
+    int   maxNumOfIterations = 30;    // Maximum number of iterations
+    int     currentIteration = 1;     // Current iteration number
+
+    double derivative = 0.0, secondDerivative = 0.0;
+    double f = this->FunctionAndDerivativesEvaluate(h, derivative, secondDerivative);
+
+    while(currentIteration <= maxNumOfIterations)
+    {
+        // Newton step when the function is locally convex, maximal step along the descent direction otherwise
+        double direction = (derivative < 0.0) ? 1 : -1;
+        double      step = stepMax;
+
+        if(secondDerivative > 0.0)
+        {
+            step = std::min(std::abs(derivative) / secondDerivative, stepMax);
+        }
+
+        // Keep the bandwidth positive
+        if(direction < 0)
+        {
+            step = std::min(step, 0.5*(h - hMin));
+        }
+
+        // Halve the step until the cost decreases
+        double fNew = this->FunctionEvaluate(h + direction*step);
+
+        while(fNew >= f && step > stepMin)
+        {
+            step /= 2.0;
+            fNew  = this->FunctionEvaluate(h + direction*step);
+        }
+
+        if(fNew >= f)
+        {
+            break;
+        }
+
+        h += direction*step;
+        f  = this->FunctionAndDerivativesEvaluate(h, derivative, secondDerivative);
+        currentIteration++;
+
+        if(step <= stepMin)
+        {
+            break;
+        }
+    }
+
+    return h;
 }
 
 //----------------------------------------------------------------------------------------
@@ -429,6 +562,272 @@ vnl_vector< double > NadarayaWatsonReconstructionErrorFunction::NadarayaWatsonMu
 
 //----------------------------------------------------------------------------------------
 
+void NadarayaWatsonReconstructionErrorFunction::ComputeGramMatrix()
+{
+    unsigned int numberOfRows = m_InputParameters->rows();
+
+    // The reconstruction error does not change if the same vector is removed from all samples
+    // (the normalized weights sum to one), so the samples are centered to reduce rounding errors.
+    vnl_vector< double > mean(numberOfRows, 0.0);
+
+    for(unsigned int j = 0; j < m_NumberOfVectors; j++)
+    {
+        mean += m_InputParameters->get_column(j);
+    }
+
+    mean /= static_cast< double >(m_NumberOfVectors);
+
+    std::vector< double > samples(m_NumberOfVectors * numberOfRows);
+
+    for(unsigned int j = 0; j < m_NumberOfVectors; j++)
+    {
+        for(unsigned int i = 0; i < numberOfRows; i++)
+        {
+            samples[j*numberOfRows + i] = (*m_InputParameters)(i,j) - mean(i);
+        }
+    }
+
+    m_GramMatrix.assign(m_NumberOfVectors*m_NumberOfVectors, 0.0);
+
+    #pragma omp parallel for default(shared) schedule(dynamic)
+    for(unsigned int j = 0; j < m_NumberOfVectors; j++)
+    {
+        const double *sampleJ = &samples[j*numberOfRows];
+
+        for(unsigned int k = j; k < m_NumberOfVectors; k++)
+        {
+            const double *sampleK = &samples[k*numberOfRows];
+            double        product = 0.0;
+
+            for(unsigned int i = 0; i < numberOfRows; i++)
+            {
+                product += sampleJ[i] * sampleK[i];
+            }
+
+            m_GramMatrix[j*m_NumberOfVectors + k] = product;
+            m_GramMatrix[k*m_NumberOfVectors + j] = product;
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------
+
+void NadarayaWatsonReconstructionErrorFunction::ComputeDistanceMatrix()
+{
+    unsigned int numberOfRows = m_CurrentParameters->rows();
+
+    m_DistanceMatrix.assign(m_NumberOfVectors*m_NumberOfVectors, 0.0);
+
+    if(m_BandwidthMatrixInverse.rows() != numberOfRows)
+    {
+        return;
+    }
+
+    // Samples scaled by the bandwidth and stored contiguously
+    std::vector< double > samples(m_NumberOfVectors * numberOfRows);
+
+    for(unsigned int j = 0; j < m_NumberOfVectors; j++)
+    {
+        for(unsigned int i = 0; i < numberOfRows; i++)
+        {
+            samples[j*numberOfRows + i] = m_BandwidthMatrixInverse(i,i) * (*m_CurrentParameters)(i,j);
+        }
+    }
+
+    #pragma omp parallel for default(shared) schedule(dynamic)
+    for(unsigned int j = 0; j < m_NumberOfVectors; j++)
+    {
+        const double *sampleJ = &samples[j*numberOfRows];
+
+        for(unsigned int k = j+1; k < m_NumberOfVectors; k++)
+        {
+            const double *sampleK = &samples[k*numberOfRows];
+            double       distance = 0.0;
+
+            for(unsigned int i = 0; i < numberOfRows; i++)
+            {
+                double difference = sampleJ[i] - sampleK[i];
+                distance += difference * difference;
+            }
+
+            m_DistanceMatrix[j*m_NumberOfVectors + k] = distance;
+            m_DistanceMatrix[k*m_NumberOfVectors + j] = distance;
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------
+
+void NadarayaWatsonReconstructionErrorFunction::SetIsotropicBandwidth(double h)
+{
+    double oldInverse = (m_BandwidthMatrixInverse.rows() > 0) ? m_BandwidthMatrixInverse(0,0) : 0.0;
+    bool    isotropic = true;
+
+    for(unsigned int i = 1; i < m_BandwidthMatrixInverse.rows() && isotropic; i++)
+    {
+        isotropic = (m_BandwidthMatrixInverse(i,i) == oldInverse);
+    }
+
+    double inverse = 1.0/h;
+    m_BandwidthMatrixInverse.fill_diagonal(inverse);
+
+    // The distances are proportional to the squared inverse of an isotropic bandwidth
+    if(isotropic && oldInverse != 0.0 && m_DistanceMatrix.size() == m_NumberOfVectors*m_NumberOfVectors)
+    {
+        double scale = (inverse*inverse) / (oldInverse*oldInverse);
+
+        for(unsigned int i = 0; i < m_DistanceMatrix.size(); i++)
+        {
+            m_DistanceMatrix[i] *= scale;
+        }
+    }
+    else
+    {
+        this->ComputeDistanceMatrix();
+    }
+}
+
+//----------------------------------------------------------------------------------------
+
+inline double NadarayaWatsonReconstructionErrorFunction::TripletSquaredDistance(const vnl_matrix< double > &parameters, unsigned int index, unsigned int j, unsigned int k) const
+{
+    double distance = 0.0;
+
+    for(unsigned int i = index; i < parameters.rows(); i += m_NumberOfParameters)
+    {
+        double difference = m_BandwidthMatrixInverse(i,i) * (parameters(i,j) - parameters(i,k));
+        distance += difference * difference;
+    }
+
+    return distance;
+}
+
+//----------------------------------------------------------------------------------------
+
+double NadarayaWatsonReconstructionErrorFunction::SampleReconstructionError(unsigned int j, const double *distances, double *weights) const
+{
+    // Normalized weights of the estimator (leave-one-out).
+    // The minimal distance is removed before the exponential, which does not change the
+    // normalized weights but avoids underflows when the bandwidth is small.
+    double minDistance = std::numeric_limits< double >::max();
+
+    for(unsigned int k = 0; k < m_NumberOfVectors; k++)
+    {
+        if(k != j && distances[k] < minDistance)
+        {
+            minDistance = distances[k];
+        }
+    }
+
+    double sumOfWeights = 0.0;
+
+    for(unsigned int k = 0; k < m_NumberOfVectors; k++)
+    {
+        weights[k]    = (k != j) ? std::exp(-0.5 * (distances[k] - minDistance)) : 0.0;
+        sumOfWeights += weights[k];
+    }
+
+    for(unsigned int k = 0; k < m_NumberOfVectors; k++)
+    {
+        weights[k] /= sumOfWeights;
+    }
+
+    // Squared norm of x_j - sum_k w_k x_k expressed with the Gram matrix G:
+    // G(j,j) - 2 sum_k w_k G(j,k) + sum_k sum_l w_k w_l G(k,l)
+    const double *gramJ = &m_GramMatrix[j*m_NumberOfVectors];
+    double    crossTerm = 0.0;
+    double    quadraticTerm = 0.0;
+
+    for(unsigned int k = 0; k < m_NumberOfVectors; k++)
+    {
+        if(weights[k] != 0.0)
+        {
+            const double *gramK = &m_GramMatrix[k*m_NumberOfVectors];
+            double          sum = 0.0;
+
+            for(unsigned int l = 0; l < m_NumberOfVectors; l++)
+            {
+                sum += gramK[l] * weights[l];
+            }
+
+            crossTerm     += weights[k] * gramJ[k];
+            quadraticTerm += weights[k] * sum;
+        }
+    }
+
+    return gramJ[j] - 2.0*crossTerm + quadraticTerm;
+}
+
+//----------------------------------------------------------------------------------------
+
+double NadarayaWatsonReconstructionErrorFunction::SampleReconstructionErrorDerivatives(unsigned int j, const double *distances, double h, double *weights, double &derivative, double &secondDerivative) const
+{
+    double *firstWeights  = weights + m_NumberOfVectors;
+    double *secondWeights = weights + 2*m_NumberOfVectors;
+
+    // Normalized weights of the estimator (leave-one-out)
+    this->SampleReconstructionError(j, distances, weights);
+
+    // With an isotropic bandwidth, the distances are proportional to 1/h², so that the derivative of
+    // the log of a kernel value is g_k = d_k/h. The derivatives of the normalized weights are:
+    // w'_k = w_k (g_k - mean(g)) and w''_k = w_k ((g_k - mean(g))² - var(g) - 3 (g_k - mean(g))/h).
+    double mean = 0.0;
+
+    for(unsigned int k = 0; k < m_NumberOfVectors; k++)
+    {
+        mean += weights[k] * distances[k] / h;
+    }
+
+    double variance = 0.0;
+
+    for(unsigned int k = 0; k < m_NumberOfVectors; k++)
+    {
+        double centered = distances[k] / h - mean;
+        variance += weights[k] * centered * centered;
+    }
+
+    for(unsigned int k = 0; k < m_NumberOfVectors; k++)
+    {
+        double centered = distances[k] / h - mean;
+
+        firstWeights[k]  = weights[k] * centered;
+        secondWeights[k] = weights[k] * (centered*centered - variance - 3.0*centered/h);
+    }
+
+    // With the Gram matrix G, the error is G(j,j) - 2 w.G(j) + w'Gw, so that:
+    // E'  = -2 w'.G(j) + 2 w'Gw
+    // E'' = -2 w''.G(j) + 2 w''Gw + 2 w'Gw'
+    const double *gramJ = &m_GramMatrix[j*m_NumberOfVectors];
+    double        value = gramJ[j];
+
+    derivative       = 0.0;
+    secondDerivative = 0.0;
+
+    for(unsigned int k = 0; k < m_NumberOfVectors; k++)
+    {
+        if(weights[k] != 0.0)
+        {
+            const double *gramK = &m_GramMatrix[k*m_NumberOfVectors];
+            double   gramWeights = 0.0;
+            double   gramFirstWeights = 0.0;
+
+            for(unsigned int l = 0; l < m_NumberOfVectors; l++)
+            {
+                gramWeights      += gramK[l] * weights[l];
+                gramFirstWeights += gramK[l] * firstWeights[l];
+            }
+
+            value            += weights[k] * (gramWeights - 2.0*gramJ[k]);
+            derivative       += 2.0 * firstWeights[k] * (gramWeights - gramJ[k]);
+            secondDerivative += 2.0 * secondWeights[k] * (gramWeights - gramJ[k]) + 2.0 * firstWeights[k] * gramFirstWeights;
+        }
+    }
+
+    return value;
+}
+
+//----------------------------------------------------------------------------------------
+
 inline double NadarayaWatsonReconstructionErrorFunction::MultivariateGaussianKernel(vnl_vector< double > v)
 {
     return this->GaussianKernel(v.two_norm());
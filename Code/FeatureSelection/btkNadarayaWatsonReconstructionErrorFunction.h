@@ -36,6 +36,9 @@
 #ifndef BTK_KERNEL_COST_FUNCTION_H
 #define BTK_KERNEL_COST_FUNCTION_H
 
+// STL includes
+#include "vector"
+
 // VNL includes
 #include "vnl/vnl_diag_matrix.h"
 
@@ -56,6 +59,11 @@ namespace btk
  * The Nadaraya-Watson estimator is used with a Gaussian kernel.
  * The complexity of this cost function is in O(K²p), where K and p are respectively the number
  * of samples and the number of features.
+ *
+ * The squared distances between the samples (current parameters scaled by the bandwidth) and the
+ * Gram matrix of the input parameters are kept in memory. Activating or desactivating a parameter
+ * only changes the distances by the contribution of its triplet, so that the matrix is updated in O(K²)
+ * and the cost of a candidate is evaluated in O(K³) without going through the p features.
  */
 class NadarayaWatsonReconstructionErrorFunction : public FeatureSelectionCostFunction
 {
@@ -71,6 +79,9 @@ class NadarayaWatsonReconstructionErrorFunction : public FeatureSelectionCostFun
         btkGetMacro(BandwidthMatrix, vnl_diag_matrix< double > *);
         btkSetMacro(BandwidthMatrix, vnl_diag_matrix< double > *);
 
+        btkGetMacro(ExactBandwidthOptimization, bool);
+        btkSetMacro(ExactBandwidthOptimization, bool);
+
 
         /**
          * @brief Evaluate the cost function with activated vectors.
@@ -93,11 +104,22 @@ class NadarayaWatsonReconstructionErrorFunction : public FeatureSelectionCostFun
 
         /**
          * @brief Evaluate the cost function gradient depending on the bandwidth parameter.
+         * The analytic derivative is scaled by 2, as the former centered difference divided by the half step.
          * @param h Bandwidth parameter.
          * @return Value of the cost function gradient with activated vectors.
          */
         virtual double GradientEvaluate(double h);
 
+        /**
+         * @brief Evaluate the cost function and its first and second derivatives depending on the bandwidth parameter.
+         * The derivatives are computed analytically in the same pass as the value.
+         * @param h Bandwidth parameter.
+         * @param derivative First derivative of the cost function with respect to h (output).
+         * @param secondDerivative Second derivative of the cost function with respect to h (output).
+         * @return Value of the cost function with activated vectors.
+         */
+        double FunctionAndDerivativesEvaluate(double h, double &derivative, double &secondDerivative);
+
         /**
          * @brief Evaluate cost function with parameter activation.
          * @param activatedIndex Index of the parameter to test activation.
@@ -147,6 +169,8 @@ class NadarayaWatsonReconstructionErrorFunction : public FeatureSelectionCostFun
 
         /**
          * @brief Optimize the bandwidth parameters with actual selected points.
+         * By default, a gradient descent with Wolfe's conditions is used. When the exact bandwidth
+         * optimization is enabled, a safeguarded Newton method reaches the minimum of the cost instead.
          * @return A message to display optimized parameters.
          */
         virtual std::string OptimizeParameters();
@@ -198,12 +222,79 @@ class NadarayaWatsonReconstructionErrorFunction : public FeatureSelectionCostFun
          */
         double GaussianKernel(double v);
 
+    private:
+        /**
+         * @brief Compute the Gram matrix of the input parameters (centered).
+         */
+        void ComputeGramMatrix();
+
+        /**
+         * @brief Compute the squared distances between samples of the current parameters scaled by the bandwidth.
+         */
+        void ComputeDistanceMatrix();
+
+        /**
+         * @brief Set an isotropic bandwidth and update the distance matrix.
+         * @param h Bandwidth parameter.
+         */
+        void SetIsotropicBandwidth(double h);
+
+        /**
+         * @brief Compute the squared distance between two samples for a triplet of parameters (scaled by the bandwidth).
+         * @param parameters Parameters matrix.
+         * @param index Index of the parameter triplet.
+         * @param j Index of the first sample.
+         * @param k Index of the second sample.
+         * @return The squared distance restricted to the triplet.
+         */
+        double TripletSquaredDistance(const vnl_matrix< double > &parameters, unsigned int index, unsigned int j, unsigned int k) const;
+
+        /**
+         * @brief Compute the leave-one-out reconstruction error of a sample from its distances to the other samples.
+         * @param j Index of the sample.
+         * @param distances Squared distances (scaled by the bandwidth) between the sample j and each sample.
+         * @param weights Work array (size: number of samples).
+         * @return Squared norm of the reconstruction error of the sample j.
+         */
+        double SampleReconstructionError(unsigned int j, const double *distances, double *weights) const;
+
+        /**
+         * @brief Compute the leave-one-out reconstruction error of a sample and its derivatives with respect to an isotropic bandwidth.
+         * @param j Index of the sample.
+         * @param distances Squared distances (scaled by the bandwidth h) between the sample j and each sample.
+         * @param h Bandwidth parameter.
+         * @param weights Work array (size: 3 x number of samples).
+         * @param derivative First derivative of the error (output).
+         * @param secondDerivative Second derivative of the error (output).
+         * @return Squared norm of the reconstruction error of the sample j.
+         */
+        double SampleReconstructionErrorDerivatives(unsigned int j, const double *distances, double h, double *weights, double &derivative, double &secondDerivative) const;
+
+        /**
+         * @brief Search the bandwidth by a gradient descent with Wolfe's conditions (gradient given by GradientEvaluate).
+         * @param h Initial bandwidth parameter.
+         * @return Optimized bandwidth parameter.
+         */
+        double GradientDescentBandwidthSearch(double h);
+
+        /**
+         * @brief Search the bandwidth by a safeguarded Newton method (analytic derivatives).
+         * @param h Initial bandwidth parameter.
+         * @return Optimized bandwidth parameter.
+         */
+        double NewtonBandwidthSearch(double h);
+
     private:
         /**
          * @brief Bandwidth matrix.
          */
         vnl_diag_matrix< double >* m_BandwidthMatrix;
 
+        /**
+         * @brief Use the Newton method to reach the minimum of the cost with respect to the bandwidth (default: false).
+         */
+        bool m_ExactBandwidthOptimization;
+
         /**
          * @brief Inverse of the bandwidth matrix.
          */
@@ -213,6 +304,16 @@ class NadarayaWatsonReconstructionErrorFunction : public FeatureSelectionCostFun
          * @brief Precomputed coefficient of the gaussian kernel.
          */
         double m_GaussianCoefficient;
+
+        /**
+         * @brief Gram matrix of the centered input parameters (samples x samples, stored by rows).
+         */
+        std::vector< double > m_GramMatrix;
+
+        /**
+         * @brief Squared distances between samples of the current parameters scaled by the bandwidth (samples x samples, stored by rows).
+         */
+        std::vector< double > m_DistanceMatrix;
 };
 
 } // namespace btk
@@ -0,0 +1,155 @@
+/*==========================================================================
+
+  © Université de Strasbourg - Centre National de la Recherche Scientifique
+
+  Date: 18/10/2026
+  Author(s): agent (agent@local)
+
+  This software is governed by the CeCILL-B license under French law and
+  abiding by the rules of distribution of free software.  You can  use,
+  modify and/ or redistribute the software under the terms of the CeCILL-B
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and  rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty  and the software's author,  the holder of the
+  economic rights,  and the successive licensors  have only  limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading,  using,  modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean  that it is complicated to manipulate,  and  that  also
+  therefore means  that it is reserved for developers  and  experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and,  more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL-B license and that you accept its terms.
+
+==========================================================================*/
+
+#ifndef BTK_LOCALMEANANDVARIANCENORMALIZATION_H
+#define BTK_LOCALMEANANDVARIANCENORMALIZATION_H
+
+#include "itkImage.h"
+
+#include "btkMacro.h"
+
+#include "vector"
+
+namespace btk
+{
+/**
+ * @class LocalMeanAndVarianceNormalization
+ * @brief Local histogram matching of an image on a reference image using local means and variances.
+ *
+ * This is the normalization of PatchTool::PatchIntensityNormalizationUsingMeanAndVariance applied
+ * to the patch of every voxel of the mask: in the patch centered on c, the input values are mapped
+ * by v -> a.v + b, with a = (meanRef - sigmaRef) / (meanInput - sigmaInput) and b = meanRef - a.meanInput,
+ * and clamped between the minimum and the maximum of the reference patch (values outside the image are 0).
+ *
+ * The local means, variances, minima and maxima of both images are computed at once with separable
+ * running sums (and running minima/maxima, van Herk / Gil-Werman), so the cost per voxel does not
+ * depend on the size of the patch.
+ *
+ * Pointwise mode: the output is the normalized value of the central voxel of each patch.
+ * Blockwise mode: the output is the mean of the normalized values of a voxel in all the patches containing
+ * it (centered on the voxels of the mask, on a grid of step BlockStep).
+ *
+ * @author agent
+ * @ingroup ImageFilter
+ */
+template <typename TPixelType>
+class LocalMeanAndVarianceNormalization
+{
+
+public:
+  /** Typedefs */
+  typedef typename itk::Image< TPixelType, 3> itkTImage;
+  typedef typename itkTImage::Pointer itkTPointer;
+  typedef typename itkTImage::SizeType itkTSize;
+
+  LocalMeanAndVarianceNormalization();
+
+  /** Set/Get the input image (image to normalize). */
+  btkSetMacro(InputImage, itkTPointer);
+  btkGetMacro(InputImage, itkTPointer);
+
+  /** Set/Get the reference image. */
+  btkSetMacro(ReferenceImage, itkTPointer);
+  btkGetMacro(ReferenceImage, itkTPointer);
+
+  /** Set/Get the mask image (patches are centered on voxels of the mask). */
+  btkSetMacro(MaskImage, itkTPointer);
+  btkGetMacro(MaskImage, itkTPointer);
+
+  /** Set/Get the half size of the patches (in voxels). */
+  btkSetMacro(HalfPatchSize, itkTSize);
+  btkGetMacro(HalfPatchSize, itkTSize);
+
+  /** Set/Get the blockwise mode (default false: pointwise). */
+  btkSetMacro(Blockwise, bool);
+  btkGetMacro(Blockwise, bool);
+
+  /** Set/Get the step of the grid of patch centers in blockwise mode (default 1: all the voxels). */
+  btkSetMacro(BlockStep, itkTSize);
+  btkGetMacro(BlockStep, itkTSize);
+
+  /** Get the output image. */
+  btkGetMacro(OutputImage, itkTPointer);
+
+  /** Compute the output image. */
+  void Update();
+
+  /**
+   * @brief Compute the mean and the standard deviation (unbiased) of the patch centered on each voxel.
+   * @param image Input image (values outside the image are 0).
+   * @param halfPatchSize Half size of the patches.
+   * @param mean Local means (one value per voxel, in buffer order).
+   * @param sigma Local standard deviations.
+   */
+  static void ComputeLocalMeanAndSigma(itkTImage * image, const itkTSize & halfPatchSize, std::vector< float > & mean, std::vector< float > & sigma);
+
+  /**
+   * @brief Compute the minimum and the maximum of the patch centered on each voxel.
+   * @param image Input image (values outside the image are 0).
+   * @param halfPatchSize Half size of the patches.
+   * @param minimum Local minima (one value per voxel, in buffer order).
+   * @param maximum Local maxima.
+   */
+  static void ComputeLocalMinimumAndMaximum(itkTImage * image, const itkTSize & halfPatchSize, std::vector< float > & minimum, std::vector< float > & maximum);
+
+private:
+
+  /** Index in the buffer of the first voxel of a line along axis. */
+  static unsigned long LineStart(unsigned long line, unsigned int axis, const itkTSize & size);
+
+  /** Replace each value by the sum of the 2h+1 values centered on it, along axis. */
+  template < typename TValue >
+  static void RunningSum(std::vector< TValue > & data, unsigned int axis, unsigned int h, const itkTSize & size);
+
+  /** Replace each value by the minimum (or maximum) of the 2h+1 values centered on it, along axis. */
+  static void RunningMinimumOrMaximum(std::vector< float > & data, unsigned int axis, unsigned int h, const itkTSize & size, bool maximum);
+
+  itkTPointer m_InputImage;
+  itkTPointer m_ReferenceImage;
+  itkTPointer m_MaskImage;
+  itkTPointer m_OutputImage;
+
+  itkTSize    m_HalfPatchSize;
+  itkTSize    m_BlockStep;
+  bool        m_Blockwise;
+};
+
+}
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "btkLocalMeanAndVarianceNormalization.txx"
+#endif
+
+#endif // BTK_LOCALMEANANDVARIANCENORMALIZATION_H
@@ -0,0 +1,365 @@
+/*==========================================================================
+
+  © Université de Strasbourg - Centre National de la Recherche Scientifique
+
+  Date: 18/10/2026
+  Author(s): agent (agent@local)
+
+  This software is governed by the CeCILL-B license under French law and
+  abiding by the rules of distribution of free software.  You can  use,
+  modify and/ or redistribute the software under the terms of the CeCILL-B
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and  rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty  and the software's author,  the holder of the
+  economic rights,  and the successive licensors  have only  limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading,  using,  modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean  that it is complicated to manipulate,  and  that  also
+  therefore means  that it is reserved for developers  and  experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and,  more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL-B license and that you accept its terms.
+
+==========================================================================*/
+
+#ifndef BTK_LOCALMEANANDVARIANCENORMALIZATION_TXX
+#define BTK_LOCALMEANANDVARIANCENORMALIZATION_TXX
+
+#include "btkLocalMeanAndVarianceNormalization.h"
+
+#include "cmath"
+#include "limits"
+#include "algorithm"
+
+namespace btk
+{
+
+template <typename TPixelType>
+LocalMeanAndVarianceNormalization<TPixelType>::LocalMeanAndVarianceNormalization()
+{
+  m_HalfPatchSize.Fill(1);
+  m_BlockStep.Fill(1);
+  m_Blockwise = false;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+template <typename TPixelType>
+void LocalMeanAndVarianceNormalization<TPixelType>::Update()
+{
+  itkTSize size = m_InputImage->GetLargestPossibleRegion().GetSize();
+  long numberOfVoxels = size[0]*size[1]*size[2];
+
+  std::vector< float > inputMean, inputSigma;
+  std::vector< float > refMean, refSigma;
+  std::vector< float > minimum, maximum;
+
+  ComputeLocalMeanAndSigma(m_InputImage, m_HalfPatchSize, inputMean, inputSigma);
+  ComputeLocalMeanAndSigma(m_ReferenceImage, m_HalfPatchSize, refMean, refSigma);
+  ComputeLocalMinimumAndMaximum(m_ReferenceImage, m_HalfPatchSize, minimum, maximum);
+
+  const TPixelType * input = m_InputImage->GetBufferPointer();
+  const TPixelType * mask  = m_MaskImage->GetBufferPointer();
+
+  //Coefficients of the normalization of the patch centered on each voxel: v -> a.v+b, clamped in [minimum,maximum]
+  //(a and b are stored in place of the input mean and sigma)
+  std::vector< float > & a = inputSigma;
+  std::vector< float > & b = inputMean;
+  std::vector< unsigned char > isCenter(numberOfVoxels, 0);
+
+  long i;
+  #pragma omp parallel for private(i) schedule(static)
+  for(i = 0; i < numberOfVoxels; i++)
+  {
+    if(mask[i] > 0)
+    {
+      if(m_Blockwise)
+      {
+        long x = i % size[0];
+        long y = (i / size[0]) % size[1];
+        long z = i / (size[0]*size[1]);
+
+        if(x % m_BlockStep[0] != 0 || y % m_BlockStep[1] != 0 || z % m_BlockStep[2] != 0)
+          continue;
+      }
+      isCenter[i] = 1;
+
+      float meanI = inputMean[i];
+      float sigmaI = inputSigma[i];
+
+      if( fabs(meanI - sigmaI) > 0.0000001 )
+      {
+        a[i] = (refMean[i] - refSigma[i]) / ( meanI - sigmaI );
+        b[i] = refMean[i] - a[i] * meanI;
+      }
+      else
+      {
+        //keep the old value
+        a[i] = 1;
+        b[i] = 0;
+        minimum[i] = -std::numeric_limits< float >::max();
+        maximum[i] = std::numeric_limits< float >::max();
+      }
+    }
+  }
+
+  m_OutputImage = itkTImage::New();
+  m_OutputImage->SetRegions(m_InputImage->GetLargestPossibleRegion());
+  m_OutputImage->CopyInformation(m_InputImage);
+  m_OutputImage->Allocate();
+  m_OutputImage->FillBuffer(0);
+
+  TPixelType * output = m_OutputImage->GetBufferPointer();
+
+  if(!m_Blockwise)
+  {
+    #pragma omp parallel for private(i) schedule(static)
+    for(i = 0; i < numberOfVoxels; i++)
+    {
+      if(isCenter[i])
+      {
+        float newValue = a[i]*input[i]+b[i];
+        if(newValue < minimum[i])
+          newValue = minimum[i];
+        if(newValue > maximum[i])
+          newValue = maximum[i];
+        output[i] = (TPixelType)newValue;
+      }
+    }
+  }
+  else
+  {
+    //Mean of the estimates of each voxel given by all the patches containing it
+    long h[3], step[3];
+    for(unsigned int d = 0; d < 3; d++)
+    {
+      h[d] = m_HalfPatchSize[d];
+      step[d] = m_BlockStep[d];
+    }
+
+    long z;
+    #pragma omp parallel for private(z) schedule(dynamic)
+    for(z = 0; z < (long)size[2]; z++)
+    {
+      //first center of the grid in the window, and last voxel of the window
+      long firstZ = std::max(0L, z-h[2]);
+      firstZ = ((firstZ + step[2] - 1) / step[2]) * step[2];
+      long lastZ = std::min((long)size[2]-1, z+h[2]);
+
+      for(long y = 0; y < (long)size[1]; y++)
+      {
+        long firstY = std::max(0L, y-h[1]);
+        firstY = ((firstY + step[1] - 1) / step[1]) * step[1];
+        long lastY = std::min((long)size[1]-1, y+h[1]);
+
+        for(long x = 0; x < (long)size[0]; x++)
+        {
+          long firstX = std::max(0L, x-h[0]);
+          firstX = ((firstX + step[0] - 1) / step[0]) * step[0];
+          long lastX = std::min((long)size[0]-1, x+h[0]);
+
+          long v = x + size[0]*(y + size[1]*z);
+          float value = input[v];
+
+          double sum = 0;
+          unsigned int weight = 0;
+
+          for(long cz = firstZ; cz <= lastZ; cz += step[2])
+            for(long cy = firstY; cy <= lastY; cy += step[1])
+              for(long cx = firstX; cx <= lastX; cx += step[0])
+              {
+                long c = cx + size[0]*(cy + size[1]*cz);
+                if(isCenter[c])
+                {
+                  float newValue = a[c]*value+b[c];
+                  if(newValue < minimum[c])
+                    newValue = minimum[c];
+                  if(newValue > maximum[c])
+                    newValue = maximum[c];
+                  sum += newValue;
+                  weight++;
+                }
+              }
+
+          if(weight > 0)
+            output[v] = (TPixelType)(sum / weight);
+        }
+      }
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+template <typename TPixelType>
+void LocalMeanAndVarianceNormalization<TPixelType>::ComputeLocalMeanAndSigma(itkTImage * image, const itkTSize & halfPatchSize, std::vector< float > & mean, std::vector< float > & sigma)
+{
+  itkTSize size = image->GetLargestPossibleRegion().GetSize();
+  long numberOfVoxels = size[0]*size[1]*size[2];
+  const TPixelType * buffer = image->GetBufferPointer();
+
+  std::vector< double > sum(numberOfVoxels);
+  std::vector< double > sumOfSquares(numberOfVoxels);
+
+  long i;
+  #pragma omp parallel for private(i) schedule(static)
+  for(i = 0; i < numberOfVoxels; i++)
+  {
+    double value = buffer[i];
+    sum[i] = value;
+    sumOfSquares[i] = value*value;
+  }
+
+  double numberOfPatchVoxels = 1;
+  for(unsigned int d = 0; d < 3; d++)
+  {
+    RunningSum(sum, d, halfPatchSize[d], size);
+    RunningSum(sumOfSquares, d, halfPatchSize[d], size);
+    numberOfPatchVoxels *= 2*halfPatchSize[d]+1;
+  }
+
+  mean.resize(numberOfVoxels);
+  sigma.resize(numberOfVoxels);
+
+  #pragma omp parallel for private(i) schedule(static)
+  for(i = 0; i < numberOfVoxels; i++)
+  {
+    double variance = 0;
+    if(numberOfPatchVoxels > 1)
+      variance = (sumOfSquares[i] - sum[i]*sum[i]/numberOfPatchVoxels) / (numberOfPatchVoxels-1);
+
+    mean[i] = sum[i] / numberOfPatchVoxels;
+    sigma[i] = (variance > 0) ? sqrt(variance) : 0;
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+template <typename TPixelType>
+void LocalMeanAndVarianceNormalization<TPixelType>::ComputeLocalMinimumAndMaximum(itkTImage * image, const itkTSize & halfPatchSize, std::vector< float > & minimum, std::vector< float > & maximum)
+{
+  itkTSize size = image->GetLargestPossibleRegion().GetSize();
+  long numberOfVoxels = size[0]*size[1]*size[2];
+  const TPixelType * buffer = image->GetBufferPointer();
+
+  minimum.assign(buffer, buffer + numberOfVoxels);
+  maximum.assign(buffer, buffer + numberOfVoxels);
+
+  for(unsigned int d = 0; d < 3; d++)
+  {
+    RunningMinimumOrMaximum(minimum, d, halfPatchSize[d], size, false);
+    RunningMinimumOrMaximum(maximum, d, halfPatchSize[d], size, true);
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+template <typename TPixelType>
+unsigned long LocalMeanAndVarianceNormalization<TPixelType>::LineStart(unsigned long line, unsigned int axis, const itkTSize & size)
+{
+  if(axis == 0)
+    return line * size[0];
+  else if(axis == 1)
+    return (line % size[0]) + (line / size[0]) * size[0] * size[1];
+  else
+    return line;
+}
+
+//-------------------------------------------------------------------------------------------------
+
+template <typename TPixelType>
+template < typename TValue >
+void LocalMeanAndVarianceNormalization<TPixelType>::RunningSum(std::vector< TValue > & data, unsigned int axis, unsigned int h, const itkTSize & size)
+{
+  long n = size[axis];
+  long stride = (axis == 0) ? 1 : ( (axis == 1) ? size[0] : size[0]*size[1] );
+  long numberOfLines = (size[0]*size[1]*size[2]) / n;
+
+  #pragma omp parallel
+  {
+    //prefix sums of the current line
+    std::vector< TValue > prefix(n+1);
+
+    long l;
+    #pragma omp for private(l) schedule(static)
+    for(l = 0; l < numberOfLines; l++)
+    {
+      TValue * line = &data[LineStart(l, axis, size)];
+
+      prefix[0] = 0;
+      for(long i = 0; i < n; i++)
+        prefix[i+1] = prefix[i] + line[i*stride];
+
+      for(long i = 0; i < n; i++)
+      {
+        long first = std::max(0L, i-(long)h);
+        long last  = std::min(n, i+(long)h+1);
+        line[i*stride] = prefix[last] - prefix[first];
+      }
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+template <typename TPixelType>
+void LocalMeanAndVarianceNormalization<TPixelType>::RunningMinimumOrMaximum(std::vector< float > & data, unsigned int axis, unsigned int h, const itkTSize & size, bool maximum)
+{
+  long n = size[axis];
+  long stride = (axis == 0) ? 1 : ( (axis == 1) ? size[0] : size[0]*size[1] );
+  long numberOfLines = (size[0]*size[1]*size[2]) / n;
+
+  //van Herk / Gil-Werman: the line padded with h zeros on each side is cut into blocks of w values,
+  //a window of w values covers the end of a block and the beginning of the next one.
+  long w = 2*h+1;
+  long m = n + 2*h;
+
+  #pragma omp parallel
+  {
+    std::vector< float > padded(m), forward(m), backward(m);
+
+    long l;
+    #pragma omp for private(l) schedule(static)
+    for(l = 0; l < numberOfLines; l++)
+    {
+      float * line = &data[LineStart(l, axis, size)];
+
+      for(long j = 0; j < m; j++)
+        padded[j] = (j < (long)h || j >= n+(long)h) ? 0 : line[(j-h)*stride];
+
+      for(long j = 0; j < m; j++)
+      {
+        if(j % w == 0)
+          forward[j] = padded[j];
+        else
+          forward[j] = maximum ? std::max(forward[j-1], padded[j]) : std::min(forward[j-1], padded[j]);
+      }
+
+      for(long j = m-1; j >= 0; j--)
+      {
+        if(j == m-1 || (j+1) % w == 0)
+          backward[j] = padded[j];
+        else
+          backward[j] = maximum ? std::max(backward[j+1], padded[j]) : std::min(backward[j+1], padded[j]);
+      }
+
+      for(long i = 0; i < n; i++)
+        line[i*stride] = maximum ? std::max(backward[i], forward[i+w-1]) : std::min(backward[i], forward[i+w-1]);
+    }
+  }
+}
+
+} // namespace btk
+
+#endif // BTK_LOCALMEANANDVARIANCENORMALIZATION_TXX
@@ -39,6 +39,7 @@
 // STL includes
 #include "vector"
 #include "limits"
+#include "algorithm"
 
 // ITK includes
 #include "itkImage.h"
@@ -48,6 +49,9 @@
 #include "itkEuler3DTransform.h"
 #include "itkMinimumMaximumImageCalculator.h"
 
+// VNL includes
+#include "vnl/vnl_inverse.h"
+
 #include "btkPandoraBoxTransform.h"
 #include "btkJointHistogram.h"
 
@@ -91,24 +95,52 @@ namespace btk
 
     btk::JointHistogram jointHistogram;
 
+    //Number of voxels transformed and interpolated together by the sampler
+    enum { SamplerBatchSize = 256 };
+
+    //Masked reference voxels, stored once as a structure of arrays (index coordinates, values and mask weights)
+    std::vector< float > sampleX;
+    std::vector< float > sampleY;
+    std::vector< float > sampleZ;
+    std::vector< float > sampleValue;
+    std::vector< float > sampleWeight;
+    bool                 samplesInitialized;
+
+    //Moving image buffer and valid domain of the interpolation (continuous indices)
+    const float * movingBuffer;
+    long          movingSize[3];
+    long          movingStartIndex[3];
+    double        movingStartContinuousIndex[3];
+    double        movingEndContinuousIndex[3];
+
     PandoraBoxCostFunction()
     {
       this->center[0] = 0;
       this->center[1] = 0;
       this->center[2] = 0;
+
+      this->samplesInitialized = false;
+      this->movingBuffer       = NULL;
+    }
+
+    virtual ~PandoraBoxCostFunction()
+    {
     }
     
     void SetReferenceImage(itkFloatImagePointer & inputImage){
       referenceImage = inputImage;
+      samplesInitialized = false;
       
       transform = itkTransformType::New();
     }
     void SetReferenceMask(itkFloatImagePointer & inputImage){
       referenceMask = inputImage;
+      samplesInitialized = false;
     }
     
     void SetMovingImage(itkFloatImagePointer & inputImage){
       movingImage = inputImage;
+      samplesInitialized = false;
       
       //Use currently a linear interpolation in the moving image
       bsInterpolatorMovingImage = itk::BSplineInterpolateImageFunction<itkFloatImage, double, double>::New();
@@ -151,53 +183,193 @@ namespace btk
 
     }
 
-    void FillJointHistogram(vnl_vector<double>  params){
-
-        jointHistogram.ClearJointHistogram();
+    //Compact the masked reference voxels and get the moving image buffer.
+    //Called automatically by the cost functions when the images have changed.
+    void InitializeSamples(){
 
-        btk::PandoraBoxTransform::ConvertParametersToMatrix(transform, params, this->center);
+        sampleX.clear();
+        sampleY.clear();
+        sampleZ.clear();
+        sampleValue.clear();
+        sampleWeight.clear();
 
         itkFloatIteratorWithIndex itReference(referenceImage,referenceImage->GetLargestPossibleRegion());
         itkFloatIteratorWithIndex itMask(referenceMask,referenceMask->GetLargestPossibleRegion());
-        itkFloatImage::IndexType refIndex; //index of the current voxel in the reference image
-        itkFloatImage::PointType refPoint; //physical point location of reference image
 
-        itkFloatImage::PointType transformedPoint; //Physical point location after applying transform
-        itkContinuousIndex       inputContIndex;   //continuous index in the 3D image
-
-        double res = 0;
-        double weightedSum=0;
-        double weight = 0;
-
-        //loop over slice voxels
         for(itReference.GoToBegin(), itMask.GoToBegin(); !itReference.IsAtEnd(); ++itReference, ++itMask)
         {
           if(itMask.Get() > 0)
           {
-            //Coordinate (index) of the current pixel in the current image
-            refIndex = itReference.GetIndex();
+            itkFloatImage::IndexType refIndex = itReference.GetIndex();
+
+            sampleX.push_back(refIndex[0]);
+            sampleY.push_back(refIndex[1]);
+            sampleZ.push_back(refIndex[2]);
+            sampleValue.push_back(itReference.Get());
+            sampleWeight.push_back(itMask.Get());
+          }
+        }
 
-            //Coordinate in the physical world (mm)
-            referenceImage->TransformIndexToPhysicalPoint(refIndex,refPoint);
+        itkFloatImage::RegionType movingRegion = movingImage->GetBufferedRegion();
+        movingBuffer = movingImage->GetBufferPointer();
 
-            //Apply affine transform
-            transformedPoint = transform->TransformPoint(refPoint);
+        for(unsigned int i=0; i<3; i++)
+        {
+          movingSize[i]                 = movingRegion.GetSize(i);
+          movingStartIndex[i]           = movingRegion.GetIndex(i);
+          movingStartContinuousIndex[i] = bsInterpolatorMovingImage->GetStartContinuousIndex()[i];
+          movingEndContinuousIndex[i]   = bsInterpolatorMovingImage->GetEndContinuousIndex()[i];
+        }
 
-            //Coordinate in the 3D image (continuous index)
-            movingImage->TransformPhysicalPointToContinuousIndex(transformedPoint,inputContIndex);
+        samplesInitialized = true;
+    }
 
-            //Should we symmetrized the criterion?
-            //Take max(w1,w2) instead of w1, or w1*w2
+    //Compose reference index -> reference physical point -> transform -> moving continuous index
+    //into a single affine mapping (3x4 matrix stored by rows)
+    void ComputeIndexToIndexMatrix(vnl_vector<double> & params, double matrix[12]){
 
-            //Simple version, taking only into account for reference mask -------------------------------------------
-            if(bsInterpolatorMovingImage->IsInsideBuffer(inputContIndex))
-            {
-              double interpolatedValueImage = bsInterpolatorMovingImage->EvaluateAtContinuousIndex(inputContIndex);
-              weight = itMask.Get();
-              //weightedSum += weight;
-              //res += weight * pow(interpolatedValueImage - itReference.Get(), 2.0);
-              jointHistogram.AddSample( itReference.Get(), interpolatedValueImage, weight );
-            }
+        btk::PandoraBoxTransform::ConvertParametersToMatrix(transform, params, this->center);
+
+        vnl_matrix_fixed< double,3,3 > referenceIndexToPhysicalPoint;
+        vnl_matrix_fixed< double,3,3 > movingIndexToPhysicalPoint;
+
+        for(unsigned int i=0; i<3; i++)
+          for(unsigned int j=0; j<3; j++)
+          {
+            referenceIndexToPhysicalPoint(i,j) = referenceImage->GetDirection()(i,j) * referenceImage->GetSpacing()[j];
+            movingIndexToPhysicalPoint(i,j)    = movingImage->GetDirection()(i,j) * movingImage->GetSpacing()[j];
+          }
+
+        vnl_matrix_fixed< double,3,3 > movingPhysicalPointToIndex = vnl_inverse(movingIndexToPhysicalPoint);
+        vnl_matrix_fixed< double,3,3 > transformMatrix            = transform->GetMatrix().GetVnlMatrix();
+
+        vnl_matrix_fixed< double,3,3 > linear = movingPhysicalPointToIndex * transformMatrix * referenceIndexToPhysicalPoint;
+
+        vnl_vector_fixed< double,3 > translation;
+        for(unsigned int i=0; i<3; i++)
+          translation[i] = transform->GetOffset()[i] - movingImage->GetOrigin()[i];
+
+        vnl_vector_fixed< double,3 > referenceOrigin;
+        for(unsigned int i=0; i<3; i++)
+          referenceOrigin[i] = referenceImage->GetOrigin()[i];
+
+        translation = movingPhysicalPointToIndex * (transformMatrix * referenceOrigin + translation);
+
+        for(unsigned int i=0; i<3; i++)
+        {
+          matrix[4*i]   = linear(i,0);
+          matrix[4*i+1] = linear(i,1);
+          matrix[4*i+2] = linear(i,2);
+          matrix[4*i+3] = translation[i];
+        }
+    }
+
+    //Mirror boundary conditions (same as itk::BSplineInterpolateImageFunction)
+    static inline long MirrorIndex(long index, long size){
+
+        if(size == 1)
+          return 0;
+
+        long size2 = 2*size - 2;
+
+        if(index < 0)
+          index = -index - size2 * ((-index) / size2);
+        else
+          index = index - size2 * (index / size2);
+
+        if(index >= size)
+          index = size2 - index;
+
+        return index;
+    }
+
+    //Interpolate the moving image at the samples [first,last) mapped by the index to index matrix.
+    //The interpolation is linear, as the moving image interpolator (spline of order 1).
+    //inside[k] is set to 0 when the sample first+k falls outside the moving image.
+    void SampleMovingImage(const double matrix[12], unsigned int first, unsigned int last, double * values, unsigned char * inside) const{
+
+        const unsigned int n = last - first;
+
+        double cx[SamplerBatchSize];
+        double cy[SamplerBatchSize];
+        double cz[SamplerBatchSize];
+
+        const float * px = &sampleX[first];
+        const float * py = &sampleY[first];
+        const float * pz = &sampleZ[first];
+
+        //Affine mapping of the batch (vectorized by the compiler)
+        for(unsigned int k=0; k<n; k++)
+        {
+          cx[k] = matrix[0]*px[k] + matrix[1]*py[k] + matrix[2]*pz[k]  + matrix[3];
+          cy[k] = matrix[4]*px[k] + matrix[5]*py[k] + matrix[6]*pz[k]  + matrix[7];
+          cz[k] = matrix[8]*px[k] + matrix[9]*py[k] + matrix[10]*pz[k] + matrix[11];
+        }
+
+        const long sliceSize = movingSize[0] * movingSize[1];
+
+        for(unsigned int k=0; k<n; k++)
+        {
+          //Test written to reject NaN
+          inside[k] = ( cx[k] >= movingStartContinuousIndex[0] && cx[k] < movingEndContinuousIndex[0] &&
+                        cy[k] >= movingStartContinuousIndex[1] && cy[k] < movingEndContinuousIndex[1] &&
+                        cz[k] >= movingStartContinuousIndex[2] && cz[k] < movingEndContinuousIndex[2] );
+
+          if(!inside[k])
+            continue;
+
+          double x = cx[k] - movingStartIndex[0];
+          double y = cy[k] - movingStartIndex[1];
+          double z = cz[k] - movingStartIndex[2];
+
+          long ix = (long)std::floor(x);
+          long iy = (long)std::floor(y);
+          long iz = (long)std::floor(z);
+
+          double fx = x - ix;
+          double fy = y - iy;
+          double fz = z - iz;
+
+          long x0 = MirrorIndex(ix, movingSize[0]), x1 = MirrorIndex(ix+1, movingSize[0]);
+          long y0 = MirrorIndex(iy, movingSize[1]) * movingSize[0], y1 = MirrorIndex(iy+1, movingSize[1]) * movingSize[0];
+          long z0 = MirrorIndex(iz, movingSize[2]) * sliceSize, z1 = MirrorIndex(iz+1, movingSize[2]) * sliceSize;
+
+          double v00 = (1-fx) * movingBuffer[x0+y0+z0] + fx * movingBuffer[x1+y0+z0];
+          double v10 = (1-fx) * movingBuffer[x0+y1+z0] + fx * movingBuffer[x1+y1+z0];
+          double v01 = (1-fx) * movingBuffer[x0+y0+z1] + fx * movingBuffer[x1+y0+z1];
+          double v11 = (1-fx) * movingBuffer[x0+y1+z1] + fx * movingBuffer[x1+y1+z1];
+
+          values[k] = (1-fz) * ( (1-fy) * v00 + fy * v10 ) + fz * ( (1-fy) * v01 + fy * v11 );
+        }
+    }
+
+    void FillJointHistogram(vnl_vector<double>  params){
+
+        jointHistogram.ClearJointHistogram();
+
+        if(!samplesInitialized)
+          this->InitializeSamples();
+
+        double matrix[12];
+        this->ComputeIndexToIndexMatrix(params, matrix);
+
+        double        values[SamplerBatchSize];
+        unsigned char inside[SamplerBatchSize];
+
+        const unsigned int numberOfSamples = sampleValue.size();
+
+        //loop over masked voxels, by batches
+        for(unsigned int first = 0; first < numberOfSamples; first += SamplerBatchSize)
+        {
+          unsigned int last = std::min(first + (unsigned int)SamplerBatchSize, numberOfSamples);
+
+          this->SampleMovingImage(matrix, first, last, values, inside);
+
+          for(unsigned int k = first; k < last; k++)
+          {
+            //Simple version, taking only into account for reference mask
+            if(inside[k-first])
+              jointHistogram.AddSample( sampleValue[k], values[k-first], sampleWeight[k] );
           }
         }
 
@@ -206,15 +378,19 @@ namespace btk
     void FillJointHistogramOpenMP(vnl_vector<double>  params){
 
         jointHistogram.ClearJointHistogram();
-        vnl_matrix< double >  data = jointHistogram.GetData();
-        btk::PandoraBoxTransform::ConvertParametersToMatrix(transform, params, this->center);
+
+        if(!samplesInitialized)
+          this->InitializeSamples();
+
+        double matrix[12];
+        this->ComputeIndexToIndexMatrix(params, matrix);
 
         //solution : créer un vecteur de joint histogram
         //remplir chaque joint histogram independamment
         //faire la somme et l'affecter au membre joint histogram
         std::vector< btk::JointHistogram > jhVector;
-        itkFloatImage::SizeType    size    = referenceImage->GetLargestPossibleRegion().GetSize();
-        int x,y,z;
+        const unsigned int numberOfSamples = sampleValue.size();
+        const int          numberOfBatches = (numberOfSamples + SamplerBatchSize - 1) / SamplerBatchSize;
         double weightedSum=0;
 
         #pragma omp parallel
@@ -234,36 +410,21 @@ namespace btk
                 jhVector[i].SetBy(jointHistogram.GetBy());
             }
 
-            #pragma omp for private(x,y,z)
-            for(z=0; z < (int)size[2]; z++)
-            for(y=0; y < (int)size[1]; y++)
-            for(x=0; x < (int)size[0]; x++)
+            #pragma omp for schedule(static)
+            for(int b=0; b < numberOfBatches; b++)
             {
-              itkFloatImage::IndexType refIndex; //index of the current voxel in the reference image
-              refIndex[0] = x;
-              refIndex[1] = y;
-              refIndex[2] = z;
+              double        values[SamplerBatchSize];
+              unsigned char inside[SamplerBatchSize];
 
-              if(referenceMask->GetPixel( refIndex ) > 0)
-              {
-                  itkFloatImage::PointType refPoint; //physical point location of reference image
-                  referenceImage->TransformIndexToPhysicalPoint(refIndex,refPoint);
-
-                  itkFloatImage::PointType transformedPoint; //Physical point location after applying transform
-                  transformedPoint = transform->TransformPoint(refPoint);
-
-                  itkContinuousIndex       inputContIndex;   //continuous index in the 3D image
-                  movingImage->TransformPhysicalPointToContinuousIndex(transformedPoint,inputContIndex);
-
-                  if(bsInterpolatorMovingImage->IsInsideBuffer(inputContIndex))
-                  {
-                    double interpolatedValueImage = bsInterpolatorMovingImage->EvaluateAtContinuousIndex(inputContIndex);
-                    double weight = referenceMask->GetPixel( refIndex );
+              unsigned int first = b * SamplerBatchSize;
+              unsigned int last  = std::min(first + (unsigned int)SamplerBatchSize, numberOfSamples);
 
-                    double currentReferenceValue = referenceImage->GetPixel( refIndex );
+              this->SampleMovingImage(matrix, first, last, values, inside);
 
-                    jhVector[ithread].AddSample(currentReferenceValue, interpolatedValueImage, weight);
-                  }
+              for(unsigned int k = first; k < last; k++)
+              {
+                if(inside[k-first])
+                  jhVector[ithread].AddSample(sampleValue[k], values[k-first], sampleWeight[k]);
               }
             }
 
@@ -293,6 +454,17 @@ namespace btk
     }
 
     virtual double operator () (vnl_vector<double> params)=0;
+
+    //Copy of the cost function that can be evaluated concurrently with this one
+    //(images and interpolators are shared, samples and joint histogram are copied)
+    virtual PandoraBoxCostFunction * Clone() const = 0;
+
+    //Give its own transform to a copy of the cost function
+    PandoraBoxCostFunction * InitializeClone(PandoraBoxCostFunction * clone) const
+    {
+      clone->transform = itkTransformType::New();
+      return clone;
+    }
     //protected:
     
     //private:
@@ -303,6 +475,11 @@ namespace btk
   {
   public:
 
+    virtual PandoraBoxCostFunction * Clone() const
+    {
+      return this->InitializeClone(new PandoraBoxCostFunctionMI(*this));
+    }
+
     virtual double operator () (vnl_vector<double>  params)
     {
       this->FillJointHistogram(params);
@@ -314,6 +491,11 @@ namespace btk
   {
   public:
 
+    virtual PandoraBoxCostFunction * Clone() const
+    {
+      return this->InitializeClone(new PandoraBoxCostFunctionMIOpenMP(*this));
+    }
+
     virtual double operator () (vnl_vector<double>  params)
     {
       this->FillJointHistogramOpenMP(params);
@@ -325,6 +507,11 @@ namespace btk
   {
   public:
 
+    virtual PandoraBoxCostFunction * Clone() const
+    {
+      return this->InitializeClone(new PandoraBoxCostFunctionNMI(*this));
+    }
+
     virtual double operator () (vnl_vector<double>  params)
     {
       this->FillJointHistogram(params);
@@ -336,6 +523,11 @@ namespace btk
   {
   public:
 
+    virtual PandoraBoxCostFunction * Clone() const
+    {
+      return this->InitializeClone(new PandoraBoxCostFunctionNMIOpenMP(*this));
+    }
+
     virtual double operator () (vnl_vector<double>  params)
     {
       this->FillJointHistogramOpenMP(params);
@@ -346,78 +538,46 @@ namespace btk
   class PandoraBoxCostFunctionMSE : public PandoraBoxCostFunction
   {
   public:
+
+    virtual PandoraBoxCostFunction * Clone() const
+    {
+      return this->InitializeClone(new PandoraBoxCostFunctionMSE(*this));
+    }
     
     
     virtual double operator () (vnl_vector<double>  params)
     {
-      btk::PandoraBoxTransform::ConvertParametersToMatrix(transform, params, this->center);
-            
-      itkFloatIteratorWithIndex itReference(referenceImage,referenceImage->GetLargestPossibleRegion());
-      itkFloatIteratorWithIndex itMask(referenceMask,referenceMask->GetLargestPossibleRegion());
-      itkFloatImage::IndexType refIndex; //index of the current voxel in the reference image
-      itkFloatImage::PointType refPoint; //physical point location of reference image
-      
-      itkFloatImage::PointType transformedPoint; //Physical point location after applying transform
-      itkContinuousIndex       inputContIndex;   //continuous index in the 3D image
+      if(!samplesInitialized)
+        this->InitializeSamples();
+
+      double matrix[12];
+      this->ComputeIndexToIndexMatrix(params, matrix);
 
       double res = 0;
       double weightedSum=0;
-      double weight = 0;
 
-      //loop over slice voxels
-      for(itReference.GoToBegin(), itMask.GoToBegin(); !itReference.IsAtEnd(); ++itReference, ++itMask)
+      double        values[SamplerBatchSize];
+      unsigned char inside[SamplerBatchSize];
+
+      const unsigned int numberOfSamples = sampleValue.size();
+
+      //loop over masked voxels, by batches
+      for(unsigned int first = 0; first < numberOfSamples; first += SamplerBatchSize)
       {
-        if(itMask.Get() > 0)
-        {
-          //Coordinate (index) of the current pixel in the current image
-          refIndex = itReference.GetIndex();
-        
-          //Coordinate in the physical world (mm)
-          referenceImage->TransformIndexToPhysicalPoint(refIndex,refPoint);
-        
-          //Apply affine transform
-          transformedPoint = transform->TransformPoint(refPoint);
-        
-          //Coordinate in the 3D image (continuous index)
-          movingImage->TransformPhysicalPointToContinuousIndex(transformedPoint,inputContIndex);
-        
-          //Should we symmetrized the criterion?
-          //Take max(w1,w2) instead of w1, or w1*w2
-
-          //Simple version, taking only into account for reference mask -------------------------------------------
-          if(bsInterpolatorMovingImage->IsInsideBuffer(inputContIndex))
-          {
-            double interpolatedValueImage = bsInterpolatorMovingImage->EvaluateAtContinuousIndex(inputContIndex);
-            weight = itMask.Get();
-            weightedSum += weight;
-            res += weight * pow(interpolatedValueImage - itReference.Get(), 2.0);
-          }
+        unsigned int last = std::min(first + (unsigned int)SamplerBatchSize, numberOfSamples);
 
-          //max(wref,wmov)-----------------------------------------------------------------------------------------
-          /*
-          double interpolatedValueMask = bsInterpolatorMovingMask->EvaluateAtContinuousIndex(inputContIndex);
-          double interpolatedValueImage = bsInterpolatorMovingImage->EvaluateAtContinuousIndex(inputContIndex);
-          weight = itMask.Get();
-          if(weight < interpolatedValueMask)
-              weight = interpolatedValueMask;
-          weightedSum += weight;
-          res += weight * pow(interpolatedValueImage - itReference.Get(), 2.0);
-            */
-
-          //Compute only the cost function if masks intersect
-          /*
-          double interpolatedValueMask = bsInterpolatorMovingMask->EvaluateAtContinuousIndex(inputContIndex);
-          if(interpolatedValueMask > 0)
-          {
-            double interpolatedValueImage = bsInterpolatorMovingImage->EvaluateAtContinuousIndex(inputContIndex);
-            //Weighted MSE using image mask value
+        this->SampleMovingImage(matrix, first, last, values, inside);
 
-            //weight = itMask.Get() * interpolatedValueMask; // very bad option ... this is very unstable
-            weight = itMask.Get();
+        for(unsigned int k = first; k < last; k++)
+        {
+          //Simple version, taking only into account for reference mask
+          if(inside[k-first])
+          {
+            double weight     = sampleWeight[k];
+            double difference = values[k-first] - sampleValue[k];
             weightedSum += weight;
-            res += weight * pow(interpolatedValueImage - itReference.Get(), 2.0);
+            res += weight * difference * difference;
           }
-          */
         }
       }
       if(weightedSum == 0)
@@ -432,54 +592,47 @@ namespace btk
   {
   public:
 
+    virtual PandoraBoxCostFunction * Clone() const
+    {
+      return this->InitializeClone(new PandoraBoxCostFunctionMSEOpenMP(*this));
+    }
+
 
     virtual double operator () (vnl_vector<double>  params)
     {
-      btk::PandoraBoxTransform::ConvertParametersToMatrix(transform, params, this->center);
+      if(!samplesInitialized)
+        this->InitializeSamples();
 
-//      itkFloatIteratorWithIndex itReference(referenceImage,referenceImage->GetLargestPossibleRegion());
-//      itkFloatIteratorWithIndex itMask(referenceMask,referenceMask->GetLargestPossibleRegion());
-//      itkFloatImage::IndexType refIndex; //index of the current voxel in the reference image
-//      itkFloatImage::PointType refPoint; //physical point location of reference image
-
-//      itkFloatImage::PointType transformedPoint; //Physical point location after applying transform
-//      itkContinuousIndex       inputContIndex;   //continuous index in the 3D image
+      double matrix[12];
+      this->ComputeIndexToIndexMatrix(params, matrix);
 
       double res = 0;
       double weightedSum=0;
 
-      int x,y,z;
-      itkFloatImage::SizeType    size    = referenceImage->GetLargestPossibleRegion().GetSize();
+      const unsigned int numberOfSamples = sampleValue.size();
+      const int          numberOfBatches = (numberOfSamples + SamplerBatchSize - 1) / SamplerBatchSize;
+      int b;
 
-      #pragma omp parallel for private(x,y,z) reduction(+: res,weightedSum)
-      for(z=0; z < (int)size[2]; z++)
-      for(y=0; y < (int)size[1]; y++)
-      for(x=0; x < (int)size[0]; x++)
+      #pragma omp parallel for private(b) reduction(+: res,weightedSum) schedule(static)
+      for(b=0; b < numberOfBatches; b++)
       {
-        itkFloatImage::IndexType refIndex; //index of the current voxel in the reference image
-        refIndex[0] = x;
-        refIndex[1] = y;
-        refIndex[2] = z;
-        if(referenceMask->GetPixel( refIndex ) > 0)
-        {
-            itkFloatImage::PointType refPoint; //physical point location of reference image
-            referenceImage->TransformIndexToPhysicalPoint(refIndex,refPoint);
+        double        values[SamplerBatchSize];
+        unsigned char inside[SamplerBatchSize];
 
-            itkFloatImage::PointType transformedPoint; //Physical point location after applying transform
-            transformedPoint = transform->TransformPoint(refPoint);
+        unsigned int first = b * SamplerBatchSize;
+        unsigned int last  = std::min(first + (unsigned int)SamplerBatchSize, numberOfSamples);
 
-            itkContinuousIndex       inputContIndex;   //continuous index in the 3D image
-            movingImage->TransformPhysicalPointToContinuousIndex(transformedPoint,inputContIndex);
+        this->SampleMovingImage(matrix, first, last, values, inside);
 
-            if(bsInterpolatorMovingImage->IsInsideBuffer(inputContIndex))
-            {
-                double interpolatedValueImage = bsInterpolatorMovingImage->EvaluateAtContinuousIndex(inputContIndex);
-                double weight = referenceMask->GetPixel( refIndex );
-                double mse = weight * pow(interpolatedValueImage - referenceImage->GetPixel( refIndex ), 2.0);
-
-                weightedSum += weight;
-                res += mse;
-            }
+        for(unsigned int k = first; k < last; k++)
+        {
+          if(inside[k-first])
+          {
+            double weight     = sampleWeight[k];
+            double difference = values[k-first] - sampleValue[k];
+            weightedSum += weight;
+            res += weight * difference * difference;
+          }
         }
       }
       if(weightedSum == 0)
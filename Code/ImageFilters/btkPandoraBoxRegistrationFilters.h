@@ -97,11 +97,21 @@ class PandoraBoxRegistrationFilters
     static void GenerateRandomParameters(vnl_vector< double > & inputParameters, vnl_vector< double > & outputParameters, vnl_vector< double > & parameterRange);
     static void GenerateUniformlyDistributedParameters(vnl_vector< double > & inputParameters, std::vector< vnl_vector< double > > & outputParameters, vnl_vector< double > & parameterRange, int samplingRate);
 
+    static void GeneratePerturbedParameters(vnl_vector< double > & inputParameters, std::vector< vnl_vector< double > > & outputParameters, vnl_vector< double > & parameterRange, unsigned int numberOfPerturbations);
+
     static void MultiStart3DRegistration(PandoraBoxCostFunction & costFunction, vnl_vector< double > & inputParameters, vnl_vector< double > & outputParameters, vnl_vector< double > & parameterRange, unsigned int numberOfPerturbations, vnl_vector< double > toleranceVector, double tolerance);
 
     //Coarse3DRegistration explores the domain (i.e. possible rotation values) of registration parameters
     static void Coarse3DRegistration(PandoraBoxCostFunction & costFunction, vnl_vector< double > & inputParameters, vnl_vector< double > & outputParameters, vnl_vector< double > & parameterRange, unsigned int numberOfIncrements, vnl_vector< double > toleranceVector, double tolerance);
 
+    //RegisterStartingPoints runs a registration from each starting point and returns every result with its cost.
+    //With OpenMP, the starting points are processed concurrently, each thread using its own copy of the cost function.
+    //The results are the same as the serial run.
+    static void RegisterStartingPoints(PandoraBoxCostFunction & costFunction, std::vector< vnl_vector< double > > & startingPoints, std::vector< vnl_vector< double > > & outputParameters, std::vector< double > & costs, vnl_vector< double > & parameterRange, vnl_vector< double > toleranceVector, double tolerance, bool useOpenMP);
+
+    //RegisterFromStartingPoints keeps the best result of RegisterStartingPoints (the earliest starting point in case of equality).
+    static void RegisterFromStartingPoints(PandoraBoxCostFunction & costFunction, std::vector< vnl_vector< double > > & startingPoints, vnl_vector< double > & outputParameters, vnl_vector< double > & parameterRange, vnl_vector< double > toleranceVector, double tolerance, bool useOpenMP);
+
     //Slice motion estimation using a observation model
 
     //Slice motion estimation using a set of slices
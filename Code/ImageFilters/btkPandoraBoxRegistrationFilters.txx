@@ -93,66 +93,95 @@ namespace btk
         }
   }
 
-  void PandoraBoxRegistrationFilters::MultiStart3DRegistration(PandoraBoxCostFunction & costFunction, vnl_vector< double > & inputParameters, vnl_vector< double > & outputParameters, vnl_vector< double > & parameterRange, unsigned int numberOfPerturbations, vnl_vector< double > toleranceVector=vnl_vector<double>(), double tolerance=1e-3)
+  void PandoraBoxRegistrationFilters::RegisterStartingPoints(PandoraBoxCostFunction & costFunction, std::vector< vnl_vector< double > > & startingPoints, std::vector< vnl_vector< double > > & outputParameters, std::vector< double > & costs, vnl_vector< double > & parameterRange, vnl_vector< double > toleranceVector, double tolerance, bool useOpenMP)
   {
-    //Generer un ensemble de possibilite
-    //Ensuite calculer le recalage pour chacun d'entre eux
-    //Classer et selectionner
+    int numberOfStartingPoints = startingPoints.size();
 
-    vnl_vector< double > tmpParameters(inputParameters.size(),0);
-    vnl_vector< double > currentParameters(inputParameters.size(),0);
-    //Init random generator C++11 style
-    //std::default_random_engine generator;
-    //std::uniform_real_distribution<double> distribution(-1.0,1.0);
-    //srand (time(NULL)); //Need to be done outside this function to be sure to get different random numbers!
+    outputParameters.resize(numberOfStartingPoints);
+    costs.resize(numberOfStartingPoints);
 
-    for(unsigned int i=0; i < numberOfPerturbations; i++)
+    if(useOpenMP)
     {
-      std::cout<<"Multistart registration, iteration "<<i+1<<std::endl;
-      //Perturb the input parameters according to min and max range for each parameter
-      for(unsigned int j=0; j < inputParameters.size(); j++)
-        //tmpParameters(j) = inputParameters(j) + distribution(generator) * parameterRange(j) ;
-        tmpParameters(j) = inputParameters(j) + 2 * ((rand() * 1.0 / RAND_MAX) - 0.5) * parameterRange(j);
-
-      //Then run registration process
-      Register3DImages(costFunction, tmpParameters, currentParameters, parameterRange, toleranceVector, tolerance);
-
-      //Do we get a better result?
-      //If yes, set the output parameters as best estimates found
-      if(i==0)
-        outputParameters = currentParameters;
-      else
+      //Compute the samples once, so that every copy of the cost function gets them
+      if(!costFunction.samplesInitialized)
+        costFunction.InitializeSamples();
+
+      int i;
+
+      #pragma omp parallel private(i)
       {
-        double currentCost = costFunction(currentParameters);
-        double bestCost    = costFunction(outputParameters);
-        if(currentCost < bestCost)
-          outputParameters = currentParameters;
+        //Each thread works with its own cost function (transform and joint histogram)
+        PandoraBoxCostFunction * threadCostFunction = costFunction.Clone();
+
+        #pragma omp for schedule(dynamic)
+        for(i=0; i < numberOfStartingPoints; i++)
+        {
+          Register3DImages(*threadCostFunction, startingPoints[i], outputParameters[i], parameterRange, toleranceVector, tolerance);
+          costs[i] = (*threadCostFunction)(outputParameters[i]);
+        }
+
+        delete threadCostFunction;
+      }
+    }
+    else
+    {
+      for(int i=0; i < numberOfStartingPoints; i++)
+      {
+        Register3DImages(costFunction, startingPoints[i], outputParameters[i], parameterRange, toleranceVector, tolerance);
+        costs[i] = costFunction(outputParameters[i]);
       }
     }
   }
 
-  void PandoraBoxRegistrationFilters::Coarse3DRegistration(PandoraBoxCostFunction & costFunction, vnl_vector< double > & inputParameters, vnl_vector< double > & outputParameters, vnl_vector< double > & parameterRange, unsigned int numberOfIncrements, vnl_vector< double > toleranceVector=vnl_vector<double>(), double tolerance=1e-3)
+  void PandoraBoxRegistrationFilters::RegisterFromStartingPoints(PandoraBoxCostFunction & costFunction, std::vector< vnl_vector< double > > & startingPoints, vnl_vector< double > & outputParameters, vnl_vector< double > & parameterRange, vnl_vector< double > toleranceVector, double tolerance, bool useOpenMP)
   {
-    vnl_vector< double > tmpParameters(inputParameters.size(),0);
-    vnl_vector< double > currentParameters(inputParameters.size(),0);
+    int numberOfStartingPoints = startingPoints.size();
+    if(numberOfStartingPoints == 0)
+      return;
 
-    //Loop over all possible initialization of rotation parameters
-    for(unsigned int i=0; i < numberOfIncrements; i++)
-      for(unsigned int j=0; j < numberOfIncrements; j++)
-        for(unsigned int k=0; k < numberOfIncrements; k++)
-        {
-          tmpParameters(0) = inputParameters(0) + (1.0 * i / (numberOfIncrements-1) - 0.5) * 2 * parameterRange(0);
-          tmpParameters(1) = inputParameters(1) + (1.0 * j / (numberOfIncrements-1) - 0.5) * 2 * parameterRange(1);
-          tmpParameters(2) = inputParameters(2) + (1.0 * k / (numberOfIncrements-1) - 0.5) * 2 * parameterRange(2);
+    std::vector< vnl_vector< double > > results;
+    std::vector< double >               costs;
 
-          for(unsigned int l=3; l < inputParameters.size(); l++)
-            tmpParameters(l) = inputParameters(l);
+    RegisterStartingPoints(costFunction, startingPoints, results, costs, parameterRange, toleranceVector, tolerance, useOpenMP);
 
-          std::cout<<tmpParameters<<std::endl;
+    //Keep the best result (the first one in case of equality)
+    int best = 0;
+    for(int i=1; i < numberOfStartingPoints; i++)
+      if(costs[i] < costs[best])
+        best = i;
 
-        }
+    outputParameters = results[best];
+  }
 
+  void PandoraBoxRegistrationFilters::GeneratePerturbedParameters(vnl_vector< double > & inputParameters, std::vector< vnl_vector< double > > & outputParameters, vnl_vector< double > & parameterRange, unsigned int numberOfPerturbations)
+  {
+    //srand (time(NULL)); //Need to be done outside this function to be sure to get different random numbers!
+    outputParameters.resize(numberOfPerturbations);
+
+    //Perturb the input parameters according to min and max range for each parameter
+    //(same sequence of random numbers as a serial multi-start run)
+    for(unsigned int i=0; i < numberOfPerturbations; i++)
+      GenerateRandomParameters(inputParameters, outputParameters[i], parameterRange);
+  }
+
+  void PandoraBoxRegistrationFilters::MultiStart3DRegistration(PandoraBoxCostFunction & costFunction, vnl_vector< double > & inputParameters, vnl_vector< double > & outputParameters, vnl_vector< double > & parameterRange, unsigned int numberOfPerturbations, vnl_vector< double > toleranceVector=vnl_vector<double>(), double tolerance=1e-3)
+  {
+    //Generer un ensemble de possibilite
+    //Ensuite calculer le recalage pour chacun d'entre eux
+    //Classer et selectionner
+    std::vector< vnl_vector< double > > startingPoints;
+    GeneratePerturbedParameters(inputParameters, startingPoints, parameterRange, numberOfPerturbations);
+
+    RegisterFromStartingPoints(costFunction, startingPoints, outputParameters, parameterRange, toleranceVector, tolerance, false);
+  }
+
+  void PandoraBoxRegistrationFilters::Coarse3DRegistration(PandoraBoxCostFunction & costFunction, vnl_vector< double > & inputParameters, vnl_vector< double > & outputParameters, vnl_vector< double > & parameterRange, unsigned int numberOfIncrements, vnl_vector< double > toleranceVector=vnl_vector<double>(), double tolerance=1e-3)
+  {
+    //Loop over all possible initialization of rotation parameters
+    std::vector< vnl_vector< double > > startingPoints;
+    GenerateUniformlyDistributedParameters(inputParameters, startingPoints, parameterRange, numberOfIncrements);
 
+    RegisterFromStartingPoints(costFunction, startingPoints, outputParameters, parameterRange, toleranceVector, tolerance, false);
   }
 
 } // namespace btk
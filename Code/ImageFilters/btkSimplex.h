@@ -218,6 +218,15 @@ public:
                 }
             }
         }
+
+        //Maximum number of evaluations reached: return the best vertex of the current simplex
+        unsigned int lowestValueIndex = 0;
+        for(unsigned int i=1; i < this->GetDimension()+1; i++)
+            if(m_FunctionValues(i) < m_FunctionValues(lowestValueIndex))
+                lowestValueIndex = i;
+        this->SetMinimumValue( m_FunctionValues(lowestValueIndex) );
+        min = m_CurrentSimplex.get_row(lowestValueIndex);
+        return min;
     }
 
     template <class T> double TryAndReplace(vnl_vector<double> & sum, int index, double factor, T&f)
@@ -35,6 +35,8 @@
 
 #include "btkMathFunctions.h"
 
+#include "btkRandomNumberGenerator.h"
+
 namespace btk
 {
 
@@ -58,12 +60,15 @@ double MathFunctions::DegreesToRadians(double deg)
 //-------------------------------------------------------------------------------------------------
 double MathFunctions::Random()
 {
-    return static_cast< double >(rand()) / static_cast< double >(RAND_MAX);
+    // Shared generator, seeded with the current time (not thread safe, as rand() was)
+    static RandomNumberGenerator generator(RandomNumberGenerator::GetTimeSeed(), 0);
+
+    return generator.GenerateUniform();
 }
 //-------------------------------------------------------------------------------------------------
 double MathFunctions::Random(double min , double max)
 {
-    return static_cast< double >(rand())/(static_cast< double >(RAND_MAX)/std::abs(max - min)) - std::abs(min);
+    return Random() * std::abs(max - min) - std::abs(min);
 }
 //-------------------------------------------------------------------------------------------------
 double MathFunctions::Round(double value)
@@ -86,11 +86,25 @@ double NormalProbabilityDensity::Evaluate(double sigma, double x)
 
 double NormalProbabilityDensity::Simulate()
 {
-    // Box-Muller algorithm
-    double u = static_cast< double >(rand()) / static_cast< double >(RAND_MAX);
-    double v = static_cast< double >(rand()) / static_cast< double >(RAND_MAX);
+    return this->Simulate(m_Generator);
+}
+
+//----------------------------------------------------------------------------------------
+
+double NormalProbabilityDensity::Simulate(RandomNumberGenerator &generator)
+{
+    // Box-Muller algorithm (u in (0,1] so that log(u) is finite)
+    double u = 1.0 - generator.GenerateUniform();
+    double v = generator.GenerateUniform();
 
     return m_Sigma * std::sqrt(-2.0 * std::log(u)) * std::cos(m_2pi * v) + m_Mu;
 }
 
+//----------------------------------------------------------------------------------------
+
+void NormalProbabilityDensity::SetSeed(unsigned long long seed)
+{
+    m_Generator.Initialize(seed, 0);
+}
+
 } // namespace btk
@@ -40,6 +40,7 @@
 // Local includes
 #include "btkMacro.h"
 #include "btkProbabilityDensity.h"
+#include "btkRandomNumberGenerator.h"
 
 
 namespace btk
@@ -87,11 +88,24 @@ class NormalProbabilityDensity : public ProbabilityDensity< double >
         double Evaluate(double sigma, double x);
 
         /**
-         * @brief Simulate the distribution.
+         * @brief Simulate the distribution (with the generator of the density).
          * @return Simulated point.
          */
         double Simulate();
 
+        /**
+         * @brief Simulate the distribution.
+         * @param generator Random number generator (one per thread).
+         * @return Simulated point.
+         */
+        double Simulate(RandomNumberGenerator &generator);
+
+        /**
+         * @brief Set the seed of the generator of the density.
+         * @param seed Seed.
+         */
+        void SetSeed(unsigned long long seed);
+
     private:
         /**
          * @brief Initialize the density by precomputing some constants.
@@ -128,6 +142,11 @@ class NormalProbabilityDensity : public ProbabilityDensity< double >
          * @brief Precomputed variance.
          */
         double m_Sigma2;
+
+        /**
+         * @brief Random number generator used by Simulate().
+         */
+        RandomNumberGenerator m_Generator;
 };
 
 } // namespace btk
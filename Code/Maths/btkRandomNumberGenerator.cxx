@@ -0,0 +1,132 @@
+/*==========================================================================
+
+  © Université de Strasbourg - Centre National de la Recherche Scientifique
+
+  Date: 18/10/2026
+  Author(s): agent (agent@local)
+
+  This software is governed by the CeCILL-B license under French law and
+  abiding by the rules of distribution of free software.  You can  use,
+  modify and/ or redistribute the software under the terms of the CeCILL-B
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and  rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty  and the software's author,  the holder of the
+  economic rights,  and the successive licensors  have only  limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading,  using,  modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean  that it is complicated to manipulate,  and  that  also
+  therefore means  that it is reserved for developers  and  experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and,  more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL-B license and that you accept its terms.
+
+==========================================================================*/
+
+#include "btkRandomNumberGenerator.h"
+
+
+// STL includes
+#include "ctime"
+
+
+// Definitions
+#define BTK_RNG_GOLDEN_GAMMA 0x9E3779B97F4A7C15ULL
+
+
+namespace btk
+{
+
+RandomNumberGenerator::RandomNumberGenerator() : m_Key(0), m_Counter(0)
+{
+    this->Initialize(0, 0);
+}
+
+//----------------------------------------------------------------------------------------
+
+RandomNumberGenerator::RandomNumberGenerator(unsigned long long seed, unsigned long long stream) : m_Key(0), m_Counter(0)
+{
+    this->Initialize(seed, stream);
+}
+
+//----------------------------------------------------------------------------------------
+
+void RandomNumberGenerator::Initialize(unsigned long long seed, unsigned long long stream)
+{
+    // Two different (seed,stream) couples give two unrelated keys
+    m_Key     = Mix(Mix(seed) ^ (stream * BTK_RNG_GOLDEN_GAMMA + BTK_RNG_GOLDEN_GAMMA));
+    m_Counter = 0;
+}
+
+//----------------------------------------------------------------------------------------
+
+unsigned long long RandomNumberGenerator::Mix(unsigned long long x)
+{
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+
+    return x ^ (x >> 31);
+}
+
+//----------------------------------------------------------------------------------------
+
+unsigned long long RandomNumberGenerator::GenerateInteger()
+{
+    m_Counter++;
+
+    return Mix(m_Key + m_Counter * BTK_RNG_GOLDEN_GAMMA);
+}
+
+//----------------------------------------------------------------------------------------
+
+double RandomNumberGenerator::GenerateUniform()
+{
+    // Use the 53 upper bits (precision of a double)
+    return static_cast< double >(this->GenerateInteger() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//----------------------------------------------------------------------------------------
+
+double RandomNumberGenerator::GenerateUniform(double min, double max)
+{
+    return min + (max - min) * this->GenerateUniform();
+}
+
+//----------------------------------------------------------------------------------------
+
+void RandomNumberGenerator::GenerateUniform(double *values, unsigned int numberOfValues)
+{
+    // The values only depend on the counter, so the loop has no dependency between iterations
+    for(unsigned int i = 0; i < numberOfValues; i++)
+    {
+        values[i] = static_cast< double >(Mix(m_Key + (m_Counter + i + 1) * BTK_RNG_GOLDEN_GAMMA) >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    m_Counter += numberOfValues;
+}
+
+//----------------------------------------------------------------------------------------
+
+unsigned int RandomNumberGenerator::GenerateInteger(unsigned int n)
+{
+    return static_cast< unsigned int >(this->GenerateUniform() * n);
+}
+
+//----------------------------------------------------------------------------------------
+
+unsigned long long RandomNumberGenerator::GetTimeSeed()
+{
+    return Mix(static_cast< unsigned long long >(std::time(NULL)));
+}
+
+} // namespace btk
@@ -0,0 +1,151 @@
+/*==========================================================================
+
+  © Université de Strasbourg - Centre National de la Recherche Scientifique
+
+  Date: 18/10/2026
+  Author(s): agent (agent@local)
+
+  This software is governed by the CeCILL-B license under French law and
+  abiding by the rules of distribution of free software.  You can  use,
+  modify and/ or redistribute the software under the terms of the CeCILL-B
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and  rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty  and the software's author,  the holder of the
+  economic rights,  and the successive licensors  have only  limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading,  using,  modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean  that it is complicated to manipulate,  and  that  also
+  therefore means  that it is reserved for developers  and  experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and,  more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL-B license and that you accept its terms.
+
+==========================================================================*/
+
+#ifndef BTK_RANDOM_NUMBER_GENERATOR_H
+#define BTK_RANDOM_NUMBER_GENERATOR_H
+
+// Local includes
+#include "btkMacro.h"
+
+
+namespace btk
+{
+/**
+ * @class RandomNumberGenerator
+ * @brief Counter-based pseudo-random number generator.
+ *
+ * The n-th number of a stream is a hash (SplitMix64 finalizer) of a key built from (seed,stream)
+ * and of the counter n. Streams are independent of each other and there is no shared state,
+ * so each task of a parallel process (for instance each seed of a tractography) can own its
+ * generator and the results do not depend on the number of threads nor on the scheduling.
+ * @author agent
+ * @ingroup Maths
+ */
+class RandomNumberGenerator
+{
+    public:
+        typedef RandomNumberGenerator Self;
+
+        /**
+         * @brief Constructor (seed and stream are set to 0).
+         */
+        RandomNumberGenerator();
+
+        /**
+         * @brief Constructor.
+         * @param seed Global seed.
+         * @param stream Index of the stream (for instance the index of a task).
+         */
+        RandomNumberGenerator(unsigned long long seed, unsigned long long stream);
+
+        /**
+         * @brief Restart the generator on a new stream.
+         * @param seed Global seed.
+         * @param stream Index of the stream.
+         */
+        void Initialize(unsigned long long seed, unsigned long long stream);
+
+        btkGetMacro(Counter, unsigned long long);
+
+        /**
+         * @brief Move to a position of the stream (skip ahead or go back).
+         * @param counter Number of values already generated.
+         */
+        btkSetMacro(Counter, unsigned long long);
+
+        /**
+         * @brief Generate an integer uniformly distributed on 64 bits.
+         * @return Random integer.
+         */
+        unsigned long long GenerateInteger();
+
+        /**
+         * @brief Generate a real number uniformly distributed in [0,1).
+         * @return Random real number.
+         */
+        double GenerateUniform();
+
+        /**
+         * @brief Generate a real number uniformly distributed in [min,max).
+         * @param min Lower bound.
+         * @param max Upper bound.
+         * @return Random real number.
+         */
+        double GenerateUniform(double min, double max);
+
+        /**
+         * @brief Generate several real numbers uniformly distributed in [0,1).
+         * The values are the same as the ones of successive calls to GenerateUniform().
+         * @param values Array of random real numbers (output).
+         * @param numberOfValues Number of values to generate.
+         */
+        void GenerateUniform(double *values, unsigned int numberOfValues);
+
+        /**
+         * @brief Generate an integer uniformly distributed in [0,n).
+         * @param n Number of possible values.
+         * @return Random integer.
+         */
+        unsigned int GenerateInteger(unsigned int n);
+
+        /**
+         * @brief Get a seed depending on the current time (for runs which are not meant to be reproduced).
+         * @return Seed.
+         */
+        static unsigned long long GetTimeSeed();
+
+    private:
+        /**
+         * @brief Mixing function of SplitMix64.
+         * @param x Value to mix.
+         * @return Mixed value.
+         */
+        static unsigned long long Mix(unsigned long long x);
+
+    private:
+        /**
+         * @brief Key of the stream.
+         */
+        unsigned long long m_Key;
+
+        /**
+         * @brief Number of values generated in the stream.
+         */
+        unsigned long long m_Counter;
+};
+
+} // namespace btk
+
+#endif // BTK_RANDOM_NUMBER_GENERATOR_H
@@ -0,0 +1,190 @@
+/*==========================================================================
+
+  © Université de Strasbourg - Centre National de la Recherche Scientifique
+
+  Date: 18/10/2026
+  Author(s): agent (agent@local)
+
+  This software is governed by the CeCILL-B license under French law and
+  abiding by the rules of distribution of free software.  You can  use,
+  modify and/ or redistribute the software under the terms of the CeCILL-B
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and  rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty  and the software's author,  the holder of the
+  economic rights,  and the successive licensors  have only  limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading,  using,  modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean  that it is complicated to manipulate,  and  that  also
+  therefore means  that it is reserved for developers  and  experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and,  more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL-B license and that you accept its terms.
+
+==========================================================================*/
+
+#include "btkSphericalHarmonicsTable.h"
+
+
+// STL includes
+#include "cmath"
+
+// Local includes
+#include "btkSphericalHarmonics.h"
+
+
+namespace btk
+{
+
+SphericalHarmonicsTable::SphericalHarmonicsTable() : m_Order(0), m_NumberOfCoefficients(0), m_ThetaResolution(0), m_PhiResolution(0), m_InverseThetaStep(0), m_InversePhiStep(0), m_UseInterpolation(true), m_Basis()
+{
+    // ----
+}
+
+//----------------------------------------------------------------------------------------
+
+void SphericalHarmonicsTable::Initialize(unsigned int order, unsigned int thetaResolution, const std::vector< float > &weights)
+{
+    m_Order                = order;
+    m_NumberOfCoefficients = (order+1)*(order+2)/2;
+    m_ThetaResolution      = (thetaResolution > 0) ? thetaResolution : 1;
+    m_PhiResolution        = 2*m_ThetaResolution;
+    m_InverseThetaStep     = static_cast< double >(m_ThetaResolution) / M_PI;
+    m_InversePhiStep       = static_cast< double >(m_PhiResolution) / (2.0 * M_PI);
+
+    // Nodes: theta = i*pi/thetaResolution (i in [0,thetaResolution]), phi = j*2pi/phiResolution (j in [0,phiResolution[)
+    m_Basis.resize((m_ThetaResolution+1) * m_PhiResolution * m_NumberOfCoefficients);
+
+    int i;
+
+    #pragma omp parallel for private(i) schedule(dynamic)
+    for(i = 0; i <= (int)m_ThetaResolution; i++)
+    {
+        for(unsigned int j = 0; j < m_PhiResolution; j++)
+        {
+            btk::SphericalDirection u(static_cast< float >(i * M_PI / m_ThetaResolution), static_cast< float >(j * 2.0 * M_PI / m_PhiResolution));
+            float *node = &m_Basis[(i*m_PhiResolution + j) * m_NumberOfCoefficients];
+            unsigned int k = 0;
+
+            for(unsigned int l = 0; l <= m_Order; l += 2)
+            {
+                for(int m = -(int)l; m <= (int)l; m++)
+                {
+                    node[k] = btk::SphericalHarmonics::ComputeBasis(u, l, m) * (weights.empty() ? 1.f : weights[k]);
+                    k++;
+                } // for m
+            } // for l
+        } // for j
+    } // for i
+}
+
+//----------------------------------------------------------------------------------------
+
+void SphericalHarmonicsTable::UseInterpolationOn()
+{
+    m_UseInterpolation = true;
+}
+
+//----------------------------------------------------------------------------------------
+
+void SphericalHarmonicsTable::UseInterpolationOff()
+{
+    m_UseInterpolation = false;
+}
+
+//----------------------------------------------------------------------------------------
+
+bool SphericalHarmonicsTable::IsInitialized() const
+{
+    return !m_Basis.empty();
+}
+
+//----------------------------------------------------------------------------------------
+
+inline const float *SphericalHarmonicsTable::GetNode(unsigned int i, unsigned int j) const
+{
+    return &m_Basis[(i*m_PhiResolution + j) * m_NumberOfCoefficients];
+}
+
+//----------------------------------------------------------------------------------------
+
+double SphericalHarmonicsTable::Evaluate(const btk::SphericalDirection &u, const float *coefficients) const
+{
+    // Position in the grid
+    double t = u[0] * m_InverseThetaStep;
+    double p = u[1] * m_InversePhiStep;
+
+    t = (t < 0) ? 0 : ((t > m_ThetaResolution) ? m_ThetaResolution : t);
+    p = p - std::floor(p / m_PhiResolution) * m_PhiResolution; // azimuth is periodic
+
+    if(!m_UseInterpolation)
+    {
+        unsigned int i = static_cast< unsigned int >(t + 0.5);
+        unsigned int j = static_cast< unsigned int >(p + 0.5) % m_PhiResolution;
+
+        return DotProduct(this->GetNode(i,j), coefficients, m_NumberOfCoefficients);
+    }
+
+    unsigned int i0 = static_cast< unsigned int >(t);
+    unsigned int j0 = static_cast< unsigned int >(p);
+
+    if(i0 >= m_ThetaResolution)
+    {
+        i0 = m_ThetaResolution-1;
+    }
+
+    if(j0 >= m_PhiResolution)
+    {
+        j0 = m_PhiResolution-1;
+    }
+
+    double dt = t - i0;
+    double dp = p - j0;
+
+    unsigned int j1 = (j0+1 < m_PhiResolution) ? j0+1 : 0;
+
+    // Bilinear interpolation of the values (the interpolation is linear in the coefficients, so
+    // interpolating the values at the nodes is equivalent to interpolating the basis)
+    double v00 = DotProduct(this->GetNode(i0,j0),   coefficients, m_NumberOfCoefficients);
+    double v01 = DotProduct(this->GetNode(i0,j1),   coefficients, m_NumberOfCoefficients);
+    double v10 = DotProduct(this->GetNode(i0+1,j0), coefficients, m_NumberOfCoefficients);
+    double v11 = DotProduct(this->GetNode(i0+1,j1), coefficients, m_NumberOfCoefficients);
+
+    return (1.0-dt) * ((1.0-dp) * v00 + dp * v01) + dt * ((1.0-dp) * v10 + dp * v11);
+}
+
+//----------------------------------------------------------------------------------------
+
+double SphericalHarmonicsTable::DotProduct(const float *a, const float *b, unsigned int n)
+{
+    // Four independent partial sums, so that the compiler can use vector instructions
+    float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+    unsigned int k = 0;
+
+    for(; k+4 <= n; k += 4)
+    {
+        s0 += a[k]   * b[k];
+        s1 += a[k+1] * b[k+1];
+        s2 += a[k+2] * b[k+2];
+        s3 += a[k+3] * b[k+3];
+    }
+
+    for(; k < n; k++)
+    {
+        s0 += a[k] * b[k];
+    }
+
+    return (s0 + s1) + (s2 + s3);
+}
+
+} // namespace btk
@@ -0,0 +1,164 @@
+/*==========================================================================
+
+  © Université de Strasbourg - Centre National de la Recherche Scientifique
+
+  Date: 18/10/2026
+  Author(s): agent (agent@local)
+
+  This software is governed by the CeCILL-B license under French law and
+  abiding by the rules of distribution of free software.  You can  use,
+  modify and/ or redistribute the software under the terms of the CeCILL-B
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and  rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty  and the software's author,  the holder of the
+  economic rights,  and the successive licensors  have only  limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading,  using,  modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean  that it is complicated to manipulate,  and  that  also
+  therefore means  that it is reserved for developers  and  experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and,  more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL-B license and that you accept its terms.
+
+==========================================================================*/
+
+#ifndef BTK_SPHERICAL_HARMONICS_TABLE_H
+#define BTK_SPHERICAL_HARMONICS_TABLE_H
+
+// STL includes
+#include "vector"
+
+// Local includes
+#include "btkMacro.h"
+#include "btkSphericalDirection.h"
+
+namespace btk
+{
+
+/**
+ * @brief Spherical harmonics basis tabulated on a regular (theta,phi) grid.
+ *
+ * The values of the real spherical harmonics basis of even orders (see SphericalHarmonics::ComputeBasis)
+ * are computed once on the nodes of the grid. A function given by its SH coefficients is then evaluated
+ * in a direction by a dot product between the coefficients and the basis at the closest node(s) of the
+ * grid, instead of the analytical evaluation of the Legendre polynomials and trigonometric functions.
+ *
+ * Each basis function can be scaled by a weight, so that a diagonal operator in the SH space (such as
+ * the Funk-Radon transform) can be folded into the table.
+ * @author agent
+ * @ingroup Maths
+ */
+class SphericalHarmonicsTable
+{
+    public:
+        typedef SphericalHarmonicsTable Self;
+
+        /**
+         * @brief Constructor.
+         */
+        SphericalHarmonicsTable();
+
+        /**
+         * @brief Compute the table.
+         * @param order Order of the spherical harmonics (even).
+         * @param thetaResolution Number of steps of the grid in elevation (there are 2*thetaResolution steps in azimuth).
+         * @param weights Weights of the basis functions (no weight if empty).
+         */
+        void Initialize(unsigned int order, unsigned int thetaResolution, const std::vector< float > &weights = std::vector< float >());
+
+        btkGetMacro(Order, unsigned int);
+        btkGetMacro(NumberOfCoefficients, unsigned int);
+        btkGetMacro(ThetaResolution, unsigned int);
+
+        /**
+         * @brief Use bilinear interpolation between the four surrounding nodes (default) instead of the nearest node.
+         */
+        void UseInterpolationOn();
+
+        /**
+         * @brief Use the nearest node of the grid.
+         */
+        void UseInterpolationOff();
+
+        /**
+         * @brief Return true if the table has been computed.
+         */
+        bool IsInitialized() const;
+
+        /**
+         * @brief Evaluate a function given by its SH coefficients in a direction.
+         * @param u Direction.
+         * @param coefficients Spherical harmonics coefficients (GetNumberOfCoefficients() values).
+         * @return Value of the function in direction u.
+         */
+        double Evaluate(const btk::SphericalDirection &u, const float *coefficients) const;
+
+        /**
+         * @brief Dot product of two vectors.
+         * @param a First vector.
+         * @param b Second vector.
+         * @param n Size of the vectors.
+         * @return Dot product of a and b.
+         */
+        static double DotProduct(const float *a, const float *b, unsigned int n);
+
+    private:
+        /**
+         * @brief Get the basis values at a node of the grid.
+         * @param i Index of elevation (between 0 and m_ThetaResolution).
+         * @param j Index of azimuth (between 0 and m_PhiResolution-1).
+         * @return Pointer on the basis values of the node.
+         */
+        const float *GetNode(unsigned int i, unsigned int j) const;
+
+    private:
+        /**
+         * @brief Order of the spherical harmonics.
+         */
+        unsigned int m_Order;
+
+        /**
+         * @brief Number of coefficients (basis functions).
+         */
+        unsigned int m_NumberOfCoefficients;
+
+        /**
+         * @brief Number of steps in elevation (the poles are nodes of the grid).
+         */
+        unsigned int m_ThetaResolution;
+
+        /**
+         * @brief Number of steps in azimuth.
+         */
+        unsigned int m_PhiResolution;
+
+        /**
+         * @brief Inverse of the steps of the grid.
+         */
+        double m_InverseThetaStep, m_InversePhiStep;
+
+        /**
+         * @brief Flag for bilinear interpolation.
+         */
+        bool m_UseInterpolation;
+
+        /**
+         * @brief Basis values of the nodes (the coefficients of a node are contiguous).
+         */
+        std::vector< float > m_Basis;
+};
+
+} // namespace btk
+
+#endif // BTK_SPHERICAL_HARMONICS_TABLE_H
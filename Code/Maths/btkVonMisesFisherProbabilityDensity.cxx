@@ -40,6 +40,11 @@
 #include "btkSphericalDirection.h"
 
 
+// STL includes
+#include "cmath"
+#include "algorithm"
+
+
 namespace btk
 {
 
@@ -83,45 +88,117 @@ double VonMisesFisherProbabilityDensity::Evaluate(GradientDirection x)
 
 GradientDirection VonMisesFisherProbabilityDensity::Simulate()
 {
-    // Simulate the vMF distribution with mean (0,0,1)
-    double        y = static_cast< double >(std::rand()) / static_cast< double >(RAND_MAX);
-    double        w = m_InverseKappa * std::log( m_SimulationTerm + m_SimulationCoefficient * y);
-    double    theta = ( static_cast< double >(std::rand()) / static_cast< double >(RAND_MAX)) * m_2pi;
-    double constant = std::sqrt(1-w*w);
+    return this->Simulate(m_Generator);
+}
+
+//----------------------------------------------------------------------------------------
+
+GradientDirection VonMisesFisherProbabilityDensity::Simulate(RandomNumberGenerator &generator)
+{
+    GradientDirection x;
+    Self::Simulate(m_Mu, m_Kappa, generator, 1, &x);
 
-    GradientDirection x(constant*std::cos(theta), constant*std::sin(theta), w);
+    return x;
+}
 
-    // Rotate if necessary
-    if(m_Mu[0] != 0 || m_Mu[1] != 0 || m_Mu[2] != 1) // modal direction is not (0,0,1)
+//----------------------------------------------------------------------------------------
+
+void VonMisesFisherProbabilityDensity::Simulate(RandomNumberGenerator &generator, unsigned int numberOfSamples, std::vector< GradientDirection > &samples)
+{
+    samples.resize(numberOfSamples);
+
+    if(numberOfSamples > 0)
     {
-        SphericalDirection mu = m_Mu.GetSphericalDirection();
-
-        // Rotations from (0,0,1) to current modal direction
-        double cosTheta = std::cos(mu[0]);
-        double sinTheta = std::sin(mu[0]);
-        double cosPhi   = std::cos(mu[1]);
-        double sinPhi   = std::sin(mu[1]);
-
-        // Ry(theta)
-        // | cos(theta)  0  sin(theta)  |   |x|
-        // |     0       1       0      | . |y|
-        // |-sin(theta)  0   cos(theta) |   |z|
-        double Ryx = cosTheta * x[0] + sinTheta * x[2];
-        double Ryy = x[1];
-        double Ryz = -sinTheta * x[0] + cosTheta * x[2];
-
-        // Rz(phi)
-        // | cos(phi)  -sin(phi)  0 |   |x|
-        // | sin(phi)   cos(phi)  0 | . |y|
-        // |    0          0      1 |   |z|
-        x[0] = cosPhi * Ryx - sinPhi * Ryy;
-        x[1] = sinPhi * Ryx + cosPhi * Ryy;
-        x[2] = Ryz;
-
-        x.UpdateSphericalCoordinates();
+        Self::Simulate(m_Mu, m_Kappa, generator, numberOfSamples, &samples[0]);
     }
+}
 
-    return x;
+//----------------------------------------------------------------------------------------
+
+void VonMisesFisherProbabilityDensity::Simulate(GradientDirection mu, double kappa, RandomNumberGenerator &generator, unsigned int numberOfSamples, GradientDirection *samples)
+{
+    if(numberOfSamples == 0)
+    {
+        return;
+    }
+
+    // Rotation from (0,0,1) to the modal direction: R = Rz(phi).Ry(theta)
+    // | cos(phi)cos(theta)  -sin(phi)  cos(phi)sin(theta) |
+    // | sin(phi)cos(theta)   cos(phi)  sin(phi)sin(theta) |
+    // |    -sin(theta)          0          cos(theta)     |
+    double R[3][3] = { { 1.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0 }, { 0.0, 0.0, 1.0 } };
+
+    if(mu[0] != 0 || mu[1] != 0 || mu[2] != 1) // modal direction is not (0,0,1)
+    {
+        SphericalDirection sphericalMu = mu.GetSphericalDirection();
+
+        double cosT = std::cos(sphericalMu[0]);
+        double sinT = std::sin(sphericalMu[0]);
+        double cosP = std::cos(sphericalMu[1]);
+        double sinP = std::sin(sphericalMu[1]);
+
+        R[0][0] = cosP * cosT; R[0][1] = -sinP; R[0][2] = cosP * sinT;
+        R[1][0] = sinP * cosT; R[1][1] =  cosP; R[1][2] = sinP * sinT;
+        R[2][0] = -sinT;       R[2][1] =   0.0; R[2][2] = cosT;
+    }
+
+    // w = log(exp(-kappa) + (exp(kappa) - exp(-kappa)).y) / kappa, written so that exp(kappa) never overflows
+    double inverseKappa = 1.0 / kappa;
+    double    expMinus2 = std::exp(-2.0 * kappa);
+
+    // Samples are simulated by blocks in stack buffers (no allocation, even for a single sample).
+    // Uniform numbers: u[2k] for w and u[2k+1] for theta of the k-th sample of the block
+    const unsigned int blockSize = 64;
+
+    double u[2*blockSize];
+    double w[blockSize], constant[blockSize], cosTheta[blockSize], sinTheta[blockSize];
+
+    for(unsigned int first = 0; first < numberOfSamples; first += blockSize)
+    {
+        unsigned int n = std::min(blockSize, numberOfSamples - first);
+
+        generator.GenerateUniform(u, 2*n);
+
+        // Simulate the vMF distribution with mean (0,0,1)
+        for(unsigned int k = 0; k < n; k++)
+        {
+            double y = u[2*k];
+            w[k] = 1.0 + inverseKappa * std::log(y + (1.0 - y) * expMinus2);
+        }
+
+        for(unsigned int k = 0; k < n; k++)
+        {
+            constant[k] = std::sqrt(std::max(0.0, 1.0 - w[k]*w[k]));
+        }
+
+        for(unsigned int k = 0; k < n; k++)
+        {
+            cosTheta[k] = std::cos(u[2*k+1] * m_2pi);
+        }
+
+        for(unsigned int k = 0; k < n; k++)
+        {
+            sinTheta[k] = std::sin(u[2*k+1] * m_2pi);
+        }
+
+        for(unsigned int k = 0; k < n; k++)
+        {
+            double x0 = constant[k] * cosTheta[k];
+            double x1 = constant[k] * sinTheta[k];
+            double x2 = w[k];
+
+            samples[first+k] = GradientDirection(R[0][0]*x0 + R[0][1]*x1 + R[0][2]*x2,
+                                                 R[1][0]*x0 + R[1][1]*x1 + R[1][2]*x2,
+                                                 R[2][0]*x0 + R[2][1]*x1 + R[2][2]*x2);
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------
+
+void VonMisesFisherProbabilityDensity::SetSeed(unsigned long long seed)
+{
+    m_Generator.Initialize(seed, 0);
 }
 
 } // namespace btk
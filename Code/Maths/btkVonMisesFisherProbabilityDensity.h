@@ -40,6 +40,11 @@
 #include "btkMacro.h"
 #include "btkProbabilityDensity.h"
 #include "btkGradientDirection.h"
+#include "btkRandomNumberGenerator.h"
+
+
+// STL includes
+#include "vector"
 
 
 namespace btk
@@ -87,11 +92,44 @@ class VonMisesFisherProbabilityDensity : public ProbabilityDensity< GradientDire
         double Evaluate(GradientDirection x);
 
         /**
-         * @brief Simulate the distribution.
+         * @brief Simulate the distribution (with the generator of the density).
          * @return Simulated point.
          */
         GradientDirection Simulate();
 
+        /**
+         * @brief Simulate the distribution.
+         * @param generator Random number generator (one per thread).
+         * @return Simulated point.
+         */
+        GradientDirection Simulate(RandomNumberGenerator &generator);
+
+        /**
+         * @brief Simulate several points of the distribution.
+         * @param generator Random number generator (one per thread).
+         * @param numberOfSamples Number of points to simulate.
+         * @param samples Simulated points (output).
+         */
+        void Simulate(RandomNumberGenerator &generator, unsigned int numberOfSamples, std::vector< GradientDirection > &samples);
+
+        /**
+         * @brief Simulate several points of a vMF distribution.
+         * The uniform numbers are drawn at once (two per point, in order) and the rotation from (0,0,1)
+         * to the mean direction is computed once for all the points.
+         * @param mu Mean direction.
+         * @param kappa Concentration.
+         * @param generator Random number generator (one per thread).
+         * @param numberOfSamples Number of points to simulate.
+         * @param samples Array of simulated points (output, numberOfSamples elements).
+         */
+        static void Simulate(GradientDirection mu, double kappa, RandomNumberGenerator &generator, unsigned int numberOfSamples, GradientDirection *samples);
+
+        /**
+         * @brief Set the seed of the generator of the density.
+         * @param seed Seed.
+         */
+        void SetSeed(unsigned long long seed);
+
     private:
         /**
          * @brief Initialize the density.
@@ -133,6 +171,11 @@ class VonMisesFisherProbabilityDensity : public ProbabilityDensity< GradientDire
          * @brief Precomputed constant.
          */
         double m_InverseKappa;
+
+        /**
+         * @brief Random number generator used by Simulate().
+         */
+        RandomNumberGenerator m_Generator;
 };
 
 } // namespace btk
@@ -28,7 +28,7 @@ SuperResolutionFilter::~SuperResolutionFilter()
 void SuperResolutionFilter::Initialize()
 {
 
-    m_H = new vnl_sparse_matrix< PrecisionType >();
+    m_H = new H_Filter::SparseMatrixType();
     m_Y = new vnl_vector< PrecisionType >();
 
 
@@ -86,10 +86,9 @@ void SuperResolutionFilter::Update()
 
 
     // such as Min(f(y - H*x) + lambda g(x))
-    vnl_vector< PrecisionType > HtY;
-    // Premult H with Y
+    // Ht*Y is computed (or reloaded from the cache) with H
     //Since m_H is a pointer to H matrix H_Filter don't need to return it !!
-    m_H->pre_mult(*m_Y,HtY);
+    vnl_vector< PrecisionType > HtY = m_H_Filter->GetHtY();
 
 
     // Cost Function
@@ -130,7 +129,7 @@ void SuperResolutionFilter::Update()
     this->GenerateOutputData();
 
    // clear all
-    m_H->clear();
+    m_H->Clear();
     m_Y->clear();
     HtY.clear();
 
@@ -144,7 +143,7 @@ void SuperResolutionFilter::SimulateLRImages()
     // H should previoulsy be computed
     vnl_vector< PrecisionType > simY;
 
-    m_H->mult(m_Xfloat,simY);
+    m_H->Mult(m_Xfloat,simY);
 
     //Temporary variables
 
@@ -185,6 +185,12 @@ class SuperResolutionFilter: public itk::Object
             m_H_Filter->SetPSF(_p);
         }
 
+        /** Set the directory where H is stored and reloaded (no cache if empty) */
+        void SetCacheDirectory(const std::string & _directory)
+        {
+            m_H_Filter->SetCacheDirectory(_directory);
+        }
+
 
     protected:
         /** Simulate LR Images with the precalculated H */
@@ -224,7 +230,7 @@ class SuperResolutionFilter: public itk::Object
 
         btk::PSF::Pointer                       m_PSF;
 
-        vnl_sparse_matrix< PrecisionType >*     m_H;
+        H_Filter::SparseMatrixType*             m_H;
 
         vnl_vector< PrecisionType >*            m_Y;
 
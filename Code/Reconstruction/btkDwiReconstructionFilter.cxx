@@ -35,6 +35,11 @@
 
 
 #include "btkDwiReconstructionFilter.h"
+
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+#include "algorithm"
+
 namespace btk
 {
 
@@ -44,6 +49,8 @@ DwiReconstructionFilter::DwiReconstructionFilter()
     m_VolumeRegistration = true;
     m_SliceRegistration  = false;
     m_NumberOfIterations = 100;
+    m_ParallelVolumeRegistration = false;
+    m_NumberOfVolumesPerBlock = 4;
 
 }
 
@@ -138,36 +145,24 @@ void DwiReconstructionFilter::Update()
         JoinerR -> SetSpacing(m_InputSequence->GetSpacing()[3] );
         //Joiner -> SetInput(0,   m_ResampledImages[0]);
 
-        for(unsigned int i=0; i< size4D[3]-1; i++)
-        {
+        int numberOfVolumes = size4D[3]-1;
+        ImageVector registeredDwi(numberOfVolumes);
 
+        // A sequence made of the B0 volume only has nothing to register
+        if(numberOfVolumes > 0)
+        {
             ////////////////////////////////////////////////////////////////////////////
-            // Extract the Nth Dwi
+            // Center of the transforms (same grid for all the Dwi)
             ////////////////////////////////////////////////////////////////////////////
-            SequenceType::RegionType  DwiRegion =region4D; // m_InputSequence -> GetLargestPossibleRegion();
-            DwiRegion.SetSize(3,0);
-            DwiRegion.SetIndex(3,i+1);
-
-            ExtractorPointer DwiExtractor = ExtractorType::New();
-            DwiExtractor -> SetInput(m_InputSequence);
-            DwiExtractor -> SetExtractionRegion(DwiRegion);
-            DwiExtractor -> SetDirectionCollapseToSubmatrix();
-            DwiExtractor -> Update();
-
-            ImagePointer DiffusionImage = DwiExtractor->GetOutput();
+            ImagePointer firstDwi = this -> GetDwiVolume(1);
 
             ImageType::IndexType centerIndex;
-            centerIndex[0] = DwiRegion.GetIndex(0) + DwiRegion.GetSize(0) / 2.0;
-            centerIndex[1] = DwiRegion.GetIndex(1) + DwiRegion.GetSize(1) / 2.0;
-            centerIndex[2] = DwiRegion.GetIndex(2) + DwiRegion.GetSize(2) / 2.0;
+            centerIndex[0] = region4D.GetIndex(0) + region4D.GetSize(0) / 2.0;
+            centerIndex[1] = region4D.GetIndex(1) + region4D.GetSize(1) / 2.0;
+            centerIndex[2] = region4D.GetIndex(2) + region4D.GetSize(2) / 2.0;
 
             ImageType::PointType  centerPoint;
-            DiffusionImage->TransformIndexToPhysicalPoint(centerIndex, centerPoint);
-
-            initialTransforms[i]=TransformType::New();
-            initialTransforms[i] -> SetIdentity();
-            initialTransforms[i] -> SetCenter(centerPoint);
-
+            firstDwi->TransformIndexToPhysicalPoint(centerIndex, centerPoint);
 
             ////////////////////////////////////////////////////////////////////////////
             // Initialize loop through the image resolution
@@ -176,25 +171,23 @@ void DwiReconstructionFilter::Update()
             unsigned int lastResolution = 2;  // Set the last resolution
             unsigned int numberOfStep = ((startResolution -lastResolution) /2) +1;
 
+            std::vector< unsigned int > resolutions(numberOfStep);
+            ImageVector referencePyramid(numberOfStep);
+
             unsigned int resolution = startResolution;
             for(unsigned int j=0;j<numberOfStep; j++)
             {
-
-                std::cout<<" \r -> Volume "<<i<<" - Resolution "<<resolution<<" ... "<<std::flush;
+                resolutions[j] = resolution;
 
                 ////////////////////////////////////////////////////////////////////////////
-                //Resample gradient images with the given resolution
+                // Resample the reference image on the grid of the resampled gradients
+                // (this grid only depends on the geometry of the sequence, so it is done once)
                 ////////////////////////////////////////////////////////////////////////////
                 ResolutionFilterType::Pointer ResolutionSampler = ResolutionFilterType::New();
-                ResolutionSampler -> SetInputImage(DiffusionImage.GetPointer());
+                ResolutionSampler -> SetInputImage(firstDwi.GetPointer());
                 ResolutionSampler -> SetResolution(resolution);
                 ResolutionSampler -> Update();
 
-                ImagePointer resampledDwi = ResolutionSampler->GetOutput();
-
-                ////////////////////////////////////////////////////////////////////////////
-                // Resample the reference image on the same grid of resampled gradients
-                ////////////////////////////////////////////////////////////////////////////
                 TransformPointer id = TransformType::New();
                 id -> SetIdentity();
 
@@ -202,71 +195,96 @@ void DwiReconstructionFilter::Update()
                 resampler->SetTransform(id);
                 resampler->SetInput(m_ReferenceImage);
                 resampler->SetUseReferenceImage(true);
-                resampler->SetReferenceImage(resampledDwi);
+                resampler->SetReferenceImage(ResolutionSampler->GetOutput());
                 resampler->SetDefaultPixelValue(0);
                 resampler->Update();
 
-                ImagePointer resampledRef  = resampler -> GetOutput();
-                ImageType::RegionType region  = resampledRef -> GetLargestPossibleRegion();
+                // Shared by all the registrations: disconnected so that metrics do not update the pipeline
+                referencePyramid[j] = resampler -> GetOutput();
+                referencePyramid[j] -> DisconnectPipeline();
 
-                ////////////////////////////////////////////////////////////////////////////
-                //Initialize optimizer
-                ////////////////////////////////////////////////////////////////////////////
-                PowellOptimizerPointer optimizer = PowellOptimizerType::New();
-                optimizer->SetMaximize(false);
-                optimizer->SetStepLength(0.1);
-                optimizer->SetStepTolerance( 1e-4);
-                optimizer->SetValueTolerance(1e-4 );
-                optimizer->SetMaximumIteration( m_NumberOfIterations );
+                resolution-=2;
+                if(resolution <= 0)
+                {
+                    resolution =1;
+                }
+            }
 
+            if(!m_ParallelVolumeRegistration)
+            {
+                for(int i=0; i< numberOfVolumes; i++)
+                {
+                    ImagePointer DiffusionImage = this -> GetDwiVolume(i+1);
 
-                ////////////////////////////////////////////////////////////////////////////
-                // Initialize metric
-                ////////////////////////////////////////////////////////////////////////////
-                MattesMetricPointer metric = MattesMetricType::New();
-                metric -> SetNumberOfHistogramBins( 64/resolution);
-                metric -> SetNumberOfSpatialSamples(0.5*region.GetNumberOfPixels());
+                    initialTransforms[i]=TransformType::New();
+                    initialTransforms[i] -> SetIdentity();
+                    initialTransforms[i] -> SetCenter(centerPoint);
 
+                    registeredDwi[i] = this -> RegisterDwiVolume(i, DiffusionImage, initialTransforms[i], resolutions, referencePyramid, false);
+                } // end for loop
+            }
+            else
+            {
                 ////////////////////////////////////////////////////////////////////////////
-                // Initialize interpolator
+                // Blocks of consecutive volumes are registered concurrently, each volume
+                // of a block starting from the transform of the previous one
                 ////////////////////////////////////////////////////////////////////////////
-                InterPolatorPointer interpolator = InterpolatorType::New();
+                int volumesPerBlock = std::max(1u, m_NumberOfVolumesPerBlock);
+                int numberOfBlocks = (numberOfVolumes + volumesPerBlock - 1) / volumesPerBlock;
+                int b;
 
-                ////////////////////////////////////////////////////////////////////////////
-                // Connect components
-                ////////////////////////////////////////////////////////////////////////////
-                RegistrationPointer registration = RegistrationType::New();
-                registration -> SetInitialTransformParameters(initialTransforms[i] -> GetParameters() );
-                registration -> SetTransform(   initialTransforms[i] );
-                registration -> SetMetric(       metric );
-                registration -> SetOptimizer(    optimizer );
-                registration -> SetInterpolator( interpolator );
-                registration -> SetFixedImage(   resampledRef );
-                registration -> SetMovingImage(  resampledDwi);
-                registration -> SetFixedImageRegion(resampledDwi -> GetLargestPossibleRegion());
-                registration -> Initialize();
-                registration -> Update();
+                int failedVolume = -1;
+                itk::ExceptionObject error;
 
-                initialTransforms[i] -> SetParameters(registration -> GetLastTransformParameters());
+                #pragma omp parallel for private(b) schedule(dynamic)
+                for(b = 0; b < numberOfBlocks; b++)
+                {
+                    int first = b * volumesPerBlock;
+                    int last = std::min(numberOfVolumes, first + volumesPerBlock);
+
+                    for(int i = first; i < last; i++)
+                    {
+                        ImagePointer DiffusionImage = this -> GetDwiVolume(i+1);
+
+                        initialTransforms[i]=TransformType::New();
+                        initialTransforms[i] -> SetIdentity();
+                        initialTransforms[i] -> SetCenter(centerPoint);
+
+                        if(i > first)
+                        {
+                            initialTransforms[i] -> SetParameters(initialTransforms[i-1] -> GetParameters());
+                        }
+
+                        try
+                        {
+                            registeredDwi[i] = this -> RegisterDwiVolume(i, DiffusionImage, initialTransforms[i], resolutions, referencePyramid, true);
+                        }
+                        catch(itk::ExceptionObject & err)
+                        {
+                            #pragma omp critical
+                            {
+                                if(failedVolume < 0 || i < failedVolume)
+                                {
+                                    failedVolume = i;
+                                    error = err;
+                                }
+                            }
+                            break;
+                        }
+                    }
+                }
 
-                resolution-=2;
-                if(resolution <= 0)
+                if(failedVolume >= 0)
                 {
-                    resolution =1;
+                    throw error;
                 }
             }
+        }
 
-            ResamplerType::Pointer resampler = ResamplerType::New();
-            resampler->SetTransform(initialTransforms[i]);
-            resampler->SetInput(DiffusionImage);
-            resampler->SetUseReferenceImage(true);
-            resampler->SetReferenceImage(DiffusionImage);
-            resampler->SetDefaultPixelValue(0);
-            resampler->Update();
-            JoinerR -> SetInput(i,resampler->GetOutput());
-
-        } // end for loop
-
+        for(int i=0; i< numberOfVolumes; i++)
+        {
+            JoinerR -> SetInput(i,registeredDwi[i]);
+        }
 
         JoinerR -> Update();
         std::ostringstream osR;
@@ -457,4 +475,159 @@ void DwiReconstructionFilter::Update()
 }
 
 
+//----------------------------------------------------------------------------------------
+
+DwiReconstructionFilter::ImagePointer DwiReconstructionFilter::GetDwiVolume(unsigned int n) const
+{
+    // Same geometry as the output of an extractor with SetDirectionCollapseToSubmatrix(),
+    // but the pixels are those of the sequence (no copy).
+    SequenceType::RegionType region4D = m_InputSequence -> GetBufferedRegion();
+
+    ImageType::RegionType     region;
+    ImageType::SpacingType    spacing;
+    ImageType::PointType      origin;
+    ImageType::DirectionType  direction;
+
+    for(unsigned int d = 0; d < 3; d++)
+    {
+        region.SetIndex(d, region4D.GetIndex(d));
+        region.SetSize(d, region4D.GetSize(d));
+        spacing[d] = m_InputSequence -> GetSpacing()[d];
+        origin[d] = m_InputSequence -> GetOrigin()[d];
+
+        for(unsigned int e = 0; e < 3; e++)
+        {
+            direction(d,e) = m_InputSequence -> GetDirection()(d,e);
+        }
+    }
+
+    unsigned long numberOfPixels = region.GetNumberOfPixels();
+    ImageType::PixelType *buffer = const_cast< ImageType::PixelType * >(m_InputSequence -> GetBufferPointer()) + (n - region4D.GetIndex(3)) * numberOfPixels;
+
+    ImagePointer volume = ImageType::New();
+    volume -> SetRegions(region);
+    volume -> SetSpacing(spacing);
+    volume -> SetOrigin(origin);
+    volume -> SetDirection(direction);
+    volume -> GetPixelContainer() -> SetImportPointer(buffer, numberOfPixels, false);
+
+    return volume;
+}
+
+//----------------------------------------------------------------------------------------
+
+DwiReconstructionFilter::ImagePointer DwiReconstructionFilter::RegisterDwiVolume(unsigned int i, ImagePointer DiffusionImage, TransformPointer transform, const std::vector< unsigned int > & resolutions, const ImageVector & referencePyramid, bool singleThreaded) const
+{
+    for(unsigned int j=0;j<resolutions.size(); j++)
+    {
+        unsigned int resolution = resolutions[j];
+
+        #pragma omp critical
+        std::cout<<" \r -> Volume "<<i<<" - Resolution "<<resolution<<" ... "<<std::flush;
+
+        ////////////////////////////////////////////////////////////////////////////
+        //Resample gradient images with the given resolution
+        ////////////////////////////////////////////////////////////////////////////
+        ResolutionFilterType::Pointer ResolutionSampler = ResolutionFilterType::New();
+        if(singleThreaded)
+        {
+            ResolutionSampler -> SetNumberOfThreads(1);
+        }
+        ResolutionSampler -> SetInputImage(DiffusionImage.GetPointer());
+        ResolutionSampler -> SetResolution(resolution);
+        ResolutionSampler -> Update();
+
+        ImagePointer resampledDwi = ResolutionSampler->GetOutput();
+
+        ////////////////////////////////////////////////////////////////////////////
+        // Reference image resampled on the same grid (computed once in Update())
+        ////////////////////////////////////////////////////////////////////////////
+        ImagePointer resampledRef  = referencePyramid[j];
+        ImageType::RegionType region  = resampledRef -> GetLargestPossibleRegion();
+
+        ////////////////////////////////////////////////////////////////////////////
+        //Initialize optimizer
+        ////////////////////////////////////////////////////////////////////////////
+        PowellOptimizerPointer optimizer = PowellOptimizerType::New();
+        optimizer->SetMaximize(false);
+        optimizer->SetStepLength(0.1);
+        optimizer->SetStepTolerance( 1e-4);
+        optimizer->SetValueTolerance(1e-4 );
+        optimizer->SetMaximumIteration( m_NumberOfIterations );
+
+
+        ////////////////////////////////////////////////////////////////////////////
+        // Initialize metric
+        ////////////////////////////////////////////////////////////////////////////
+        MattesMetricPointer metric = MattesMetricType::New();
+        metric -> SetNumberOfHistogramBins( 64/resolution);
+        if(singleThreaded)
+        {
+            metric -> SetNumberOfThreads(1);
+
+            // The random sampling of the metric draws from a generator shared by all the threads:
+            // concurrent registrations use a fixed sample set instead (one voxel out of two, as a checkerboard)
+            MattesMetricType::FixedImageIndexContainer samples;
+            samples.reserve(region.GetNumberOfPixels()/2 + 1);
+
+            itk::ImageRegionConstIteratorWithIndex< ImageType > sampleIt(resampledRef, resampledDwi -> GetLargestPossibleRegion());
+            for(sampleIt.GoToBegin(); !sampleIt.IsAtEnd(); ++sampleIt)
+            {
+                ImageType::IndexType index = sampleIt.GetIndex();
+
+                if(((index[0] + index[1] + index[2]) & 1) == 0)
+                {
+                    samples.push_back(index);
+                }
+            }
+
+            metric -> SetFixedImageIndexes(samples);
+        }
+        else
+        {
+            metric -> SetNumberOfSpatialSamples(0.5*region.GetNumberOfPixels());
+        }
+
+        ////////////////////////////////////////////////////////////////////////////
+        // Initialize interpolator
+        ////////////////////////////////////////////////////////////////////////////
+        InterPolatorPointer interpolator = InterpolatorType::New();
+
+        ////////////////////////////////////////////////////////////////////////////
+        // Connect components
+        ////////////////////////////////////////////////////////////////////////////
+        RegistrationPointer registration = RegistrationType::New();
+        if(singleThreaded)
+        {
+            registration -> SetNumberOfThreads(1);
+        }
+        registration -> SetInitialTransformParameters(transform -> GetParameters() );
+        registration -> SetTransform(   transform );
+        registration -> SetMetric(       metric );
+        registration -> SetOptimizer(    optimizer );
+        registration -> SetInterpolator( interpolator );
+        registration -> SetFixedImage(   resampledRef );
+        registration -> SetMovingImage(  resampledDwi);
+        registration -> SetFixedImageRegion(resampledDwi -> GetLargestPossibleRegion());
+        registration -> Initialize();
+        registration -> Update();
+
+        transform -> SetParameters(registration -> GetLastTransformParameters());
+    }
+
+    ResamplerType::Pointer resampler = ResamplerType::New();
+    if(singleThreaded)
+    {
+        resampler -> SetNumberOfThreads(1);
+    }
+    resampler->SetTransform(transform);
+    resampler->SetInput(DiffusionImage);
+    resampler->SetUseReferenceImage(true);
+    resampler->SetReferenceImage(DiffusionImage);
+    resampler->SetDefaultPixelValue(0);
+    resampler->Update();
+
+    return resampler->GetOutput();
+}
+
 } // end namespace btk
@@ -198,6 +198,22 @@ class DwiReconstructionFilter: public itk::ProcessObject
         btkSetMacro(VolumeRegistration,bool);
 
 
+        /**
+         * @brief Set/Get parallel volume registration boolean (default false).
+         * Blocks of consecutive Dwi volumes are registered concurrently (OpenMP), each volume of a block
+         * starting from the transform of the previous one. In serial mode each volume starts from the identity.
+         * @param ParallelVolumeRegistration.
+         */
+        btkSetMacro(ParallelVolumeRegistration,bool);
+        btkGetMacro(ParallelVolumeRegistration,bool);
+
+        /**
+         * @brief Set/Get the number of consecutive volumes registered by the same thread in parallel mode (default 4).
+         * @param NumberOfVolumesPerBlock.
+         */
+        btkSetMacro(NumberOfVolumesPerBlock,unsigned int);
+        btkGetMacro(NumberOfVolumesPerBlock,unsigned int);
+
         /**
          * @brief Set slice registration boolean.
          * @param SliceRegistration.
@@ -241,6 +257,26 @@ class DwiReconstructionFilter: public itk::ProcessObject
         /** Intialize method */
         void Initialize();
 
+        /**
+         * @brief Get a Dwi volume of the input sequence.
+         * The volume shares the buffer of the sequence (no copy).
+         * @param n Index of the volume in the sequence (0 is the B0).
+         * @return 3D image of the volume.
+         */
+        ImagePointer GetDwiVolume(unsigned int n) const;
+
+        /**
+         * @brief Register a Dwi volume on the reference image through the image resolutions.
+         * @param i Index of the Dwi volume (for display).
+         * @param DiffusionImage Dwi volume.
+         * @param transform Initial transform, updated with the result of the registration.
+         * @param resolutions Resolutions (mm per voxel's side).
+         * @param referencePyramid Reference image resampled at each resolution.
+         * @param singleThreaded Use one thread in ITK filters and a fixed sample set in the metric (when volumes are registered concurrently).
+         * @return Dwi volume resampled with the transform.
+         */
+        ImagePointer RegisterDwiVolume(unsigned int i, ImagePointer DiffusionImage, TransformPointer transform, const std::vector< unsigned int > & resolutions, const ImageVector & referencePyramid, bool singleThreaded) const;
+
     private:
 
         /** Volume registration boolean */
@@ -249,6 +285,12 @@ class DwiReconstructionFilter: public itk::ProcessObject
         /** Slice registration boolean */
         bool              m_SliceRegistration;
 
+        /** Parallel volume registration boolean */
+        bool              m_ParallelVolumeRegistration;
+
+        /** Number of consecutive volumes registered by the same thread */
+        unsigned int      m_NumberOfVolumesPerBlock;
+
         /** Number of iterations */
         unsigned int      m_NumberOfIterations;
 
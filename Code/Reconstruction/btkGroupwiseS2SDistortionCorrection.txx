@@ -296,6 +296,7 @@ GroupwiseS2SDistortionCorrection<TSequence>
   // Create registration object
 
   m_Registration = RegistrationType::New();
+  m_Registration -> ParallelRegistrationOn();
 
   // Set fixed image region
   // Here we swap fixed and moving images to perform slice by slice registration
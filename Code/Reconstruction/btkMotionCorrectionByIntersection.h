@@ -49,6 +49,7 @@
 #include "btkEulerSliceBySliceTransform.h"
 #include "btkSlicesIntersectionITKCostFunction.hxx"
 #include "btkMathFunctions.h"
+#include "btkRandomNumberGenerator.h"
 #include "btkOptimizer.h"
 #include "btkRigidRegistration.h"
 #include "btkSimulatedAnnealingOptimizer.h"
@@ -179,6 +180,8 @@ private:
 
     unsigned int m_NumberOfParameters;
 
+    btk::RandomNumberGenerator m_Generator; /** Generator of SimulateMotion (seeded with the current time) */
+
 
 };
 
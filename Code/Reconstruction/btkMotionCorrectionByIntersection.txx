@@ -12,6 +12,7 @@ namespace btk
 template<typename TImage>
 MotionCorrectionByIntersection<TImage>::MotionCorrectionByIntersection():m_VerboseMode(true),m_MaxLoop(3),m_VerboseDbg(false)
   ,m_CurrentError(0.0),m_UseSliceExclusion(true),m_NumberOfParameters(6)
+  ,m_Generator(btk::RandomNumberGenerator::GetTimeSeed(), 0)
 {
     // Activate VerboseDbg when running debug mode
 #ifndef NDEBUG
@@ -241,11 +242,11 @@ TransformType::ParametersType MotionCorrectionByIntersection<TImage>::SimulateMo
     {
         if(i < 3)
         {
-            params[i] = rand()/((double)RAND_MAX/std::abs(_Rmax - _Rmin)) - std::abs(_Rmin);
+            params[i] = m_Generator.GenerateUniform() * std::abs(_Rmax - _Rmin) - std::abs(_Rmin);
         }
         else
         {
-            params[i] = rand()/((double)RAND_MAX/std::abs(_Tmax - _Tmin)) - std::abs(_Tmin);
+            params[i] = m_Generator.GenerateUniform() * std::abs(_Tmax - _Tmin) - std::abs(_Tmin);
         }
 
     }
@@ -53,6 +53,15 @@
 
 #include "vnl/vnl_inverse.h"
 
+#include "btkSlabSchedule.h"
+
+#include "climits"
+#include "algorithm"
+
+#ifdef _OPENMP
+#include "omp.h"
+#endif
+
 namespace btk
 {
 
@@ -153,247 +162,401 @@ ResampleImageByInjectionFilter<TInputImage, TOutputImage, TInterpolatorPrecision
 
   m_OutputSpacing = referenceImage -> GetSpacing();
 
-  // Weighted sum
-  FloatImagePointer sumImage = FloatImageType::New();
+  // Creates output image (its geometry is used during the injection)
 
-  sumImage -> SetRegions( outputRegion );
-  sumImage -> Allocate();
-  sumImage -> FillBuffer(0.0);
+  outputPtr -> SetRegions(outputRegion);
+  outputPtr -> Allocate();
+  outputPtr -> FillBuffer(0);
 
-  sumImage -> SetOrigin( referenceImage -> GetOrigin() );
-  sumImage -> SetSpacing( referenceImage -> GetSpacing() );
-  sumImage -> SetDirection( referenceImage -> GetDirection() );
+  outputPtr -> SetOrigin( referenceImage -> GetOrigin() );
+  outputPtr -> SetSpacing( referenceImage -> GetSpacing() );
+  outputPtr -> SetDirection( referenceImage -> GetDirection() );
 
+  const long nx = outputSize[0];
+  const long ny = outputSize[1];
+  const long nz = outputSize[2];
+  const long numberOfVoxels = nx * ny * nz;
 
-  // Image of weights
-  FloatImagePointer wtImage = FloatImageType::New();
+  // Rasterized mask : the spatial object is evaluated once for each voxel of the
+  // output image (IsInside is not thread safe and is too slow to be called for each PSF voxel)
+  typename MaskType::Pointer mask = MaskType::New();
+  mask -> SetImage (m_ImageMask);
 
-  wtImage -> SetRegions( outputRegion );
-  wtImage -> Allocate();
-  wtImage -> FillBuffer(0.0);
+  std::vector< unsigned char > maskBuffer(numberOfVoxels, 0);
+  {
+    IndexType index;
+    PointType point;
+    long k = 0;
+
+    for(index[2] = 0; index[2] < nz; index[2]++)
+    for(index[1] = 0; index[1] < ny; index[1]++)
+    for(index[0] = 0; index[0] < nx; index[0]++, k++)
+    {
+      outputPtr -> TransformIndexToPhysicalPoint( index, point );
+      maskBuffer[k] = mask -> IsInside(point);
+    }
+  }
 
-  wtImage -> SetOrigin( referenceImage -> GetOrigin() );
-  wtImage -> SetSpacing( referenceImage -> GetSpacing() );
-  wtImage -> SetDirection( referenceImage -> GetDirection() );
+  // Physical displacement corresponding to one voxel along each axis of the output image
+  DirectionType outputDirection = referenceImage -> GetDirection();
+  VnlVectorType outputStep[3];
+  for(unsigned int d = 0; d < 3; d++)
+  {
+    outputStep[d].set_size(3);
+    outputStep[d][0] = outputDirection(0,d) * m_OutputSpacing[d];
+    outputStep[d][1] = outputDirection(1,d) * m_OutputSpacing[d];
+    outputStep[d][2] = outputDirection(2,d) * m_OutputSpacing[d];
+  }
 
-  // Create gaussian (psf)
+  double cst = 2*sqrt(2*log(2.0)); //TODO: switch for a const var ? value never changed
 
-  typedef GaussianSpatialFunction< double, ImageDimension, PointType > GaussianFunctionType;
-  typename GaussianFunctionType::Pointer gaussian = GaussianFunctionType::New();
+  // The slices of all the input images are injected in parallel
+  std::vector< unsigned int > sliceImage;
+  std::vector< unsigned int > sliceIndex;
 
-  gaussian -> SetNormalized(false);
+  for(unsigned int im = 0; im < m_ImageArray.size(); im++)
+  {
+    IndexType inputIndex = m_InputImageRegion[im].GetIndex();
+    SizeType  inputSize  = m_InputImageRegion[im].GetSize();
 
-  typedef FixedArray<double,ImageDimension> ArrayType;
+    for ( unsigned int i=inputIndex[2]; i < inputIndex[2] + inputSize[2]; i++ )
+    {
+      sliceImage.push_back(im);
+      sliceIndex.push_back(i);
+    }
+  }
 
-  ArrayType mean;
-  mean[0] = 0; mean[1] = 0; mean[2] = 0;
-  gaussian -> SetMean( mean  );
+  const unsigned int numberOfSlices = sliceImage.size();
 
-  ArrayType sigma;
-  double cst = 2*sqrt(2*log(2.0)); //TODO: switch for a const var ? value never changed
+  // Kernel table of each input image : for each voxel of the PSF neighborhood, its offset in the
+  // output buffer and its offset along each axis. The table is ordered by z, so the voxels of a
+  // range of z are contiguous.
+  std::vector< std::vector< long > > imageRadius(m_ImageArray.size());
+  std::vector< std::vector< long > > imageKernelStride(m_ImageArray.size());
+  std::vector< std::vector< long > > imageKernelOffset(m_ImageArray.size());
 
-  // Create spatial object for injecting in the mask only
-  typename MaskType::Pointer mask = MaskType::New();
-  mask -> SetImage (m_ImageMask);
+  for(unsigned int im = 0; im < m_ImageArray.size(); im++)
+  {
+    SpacingType inputSpacing = m_ImageArray[im] -> GetSpacing();
+
+    //radius = maximum size of the bounding box in the HR space
+    std::vector< long > & radius = imageRadius[im];
+    radius.resize(3);
+    radius[0] = ceil(inputSpacing[2] / m_OutputSpacing[0]);
+    radius[1] = ceil(inputSpacing[2] / m_OutputSpacing[1]);
+    radius[2] = ceil(inputSpacing[2] / m_OutputSpacing[2]);
 
-  unsigned int im;
-  #pragma omp parallel for private(im) schedule(dynamic)
+    const long kernelSize = (2*radius[0]+1) * (2*radius[1]+1) * (2*radius[2]+1);
+    imageKernelStride[im].resize(kernelSize);
+    imageKernelOffset[im].resize(3*kernelSize);
 
-  for(im = 0; im < m_ImageArray.size(); im++)
+    long n = 0;
+    for(long dz = -radius[2]; dz <= radius[2]; dz++)
+    for(long dy = -radius[1]; dy <= radius[1]; dy++)
+    for(long dx = -radius[0]; dx <= radius[0]; dx++, n++)
+    {
+      imageKernelStride[im][n]     = dx + nx * ( dy + ny * dz );
+      imageKernelOffset[im][3*n]   = dx;
+      imageKernelOffset[im][3*n+1] = dy;
+      imageKernelOffset[im][3*n+2] = dz;
+    }
+  }
+
+  // Each input slice is moved in the output image once : for each pixel, its central output voxel,
+  // the displacement from the transformed point to this voxel projected on the PSF axes, and its value.
+  // Pixels are sorted by the z of their central voxel, so a slab only visits the pixels whose PSF reaches it.
+  std::vector< std::vector< double > > sliceKernelAxes(numberOfSlices);
+  std::vector< std::vector< long > >   slicePixelIndex(numberOfSlices);
+  std::vector< std::vector< double > > slicePixelShift(numberOfSlices);
+  std::vector< std::vector< float > >  slicePixelValue(numberOfSlices);
+  std::vector< std::vector< long > >   sliceBucketBegin(numberOfSlices);
+  std::vector< long > sliceFirstCenterZ(numberOfSlices, 0);
+  std::vector< long > sliceLastCenterZ(numberOfSlices, -1);
+
+  int s;
+  #pragma omp parallel for private(s) schedule(dynamic)
+
+  for(s = 0; s < (int)numberOfSlices; s++)
   {
+    unsigned int im = sliceImage[s];
+    unsigned int i  = sliceIndex[s];
+
     // ijk directions for gaussian orientation
 
     DirectionType inputDirection = m_ImageArray[im] -> GetDirection();
+    SpacingType   inputSpacing   = m_ImageArray[im] -> GetSpacing();
 
-    PointType idir;
-    idir[0] =  inputDirection(0,0);
-    idir[1] =  inputDirection(1,0);
-    idir[2] =  inputDirection(2,0);
+    // Get the rotation of the rigid transform for the rotation of the Gaussian PSF
+    VnlMatrixType NQd;
+    NQd = m_Transform[im] -> GetSliceTransform(i) -> GetMatrix().GetVnlMatrix();
 
-    PointType jdir;
-    jdir[0] =  inputDirection(0,1);
-    jdir[1] =  inputDirection(1,1);
-    jdir[2] =  inputDirection(2,1);
+    // Axes of the rotated Gaussian PSF, divided by the standard deviation along each axis,
+    // so that the PSF value at a displacement v is exp(-0.5 * sum_d <v,axis[d]>^2)
+    VnlVectorType axis[3];
+    for(unsigned int d = 0; d < 3; d++)
+    {
+      VnlVectorType dir(3);
+      dir[0] = inputDirection(0,d);
+      dir[1] = inputDirection(1,d);
+      dir[2] = inputDirection(2,d);
 
-    PointType kdir;
-    kdir[0] =  inputDirection(0,2);
-    kdir[1] =  inputDirection(1,2);
-    kdir[2] =  inputDirection(2,2);
+      double sigma = inputSpacing[d]/cst;
+      axis[d] = (NQd*dir) / sigma;
+    }
 
-    // Neighborhood iterators on output and weights
+    // Displacement of each voxel of the neighborhood from the central voxel, projected on the PSF axes
+    const std::vector< long > & kernelOffset = imageKernelOffset[im];
+    const long kernelSize = imageKernelStride[im].size();
 
-    typename NeighborhoodIteratorType::RadiusType radius;
+    std::vector< double > & kernelAxes = sliceKernelAxes[s];
+    kernelAxes.resize(3*kernelSize);
 
-    SpacingType inputSpacing = m_ImageArray[im] -> GetSpacing();
+    for(long n = 0; n < kernelSize; n++)
+    {
+      VnlVectorType displacement = outputStep[0]*(double)kernelOffset[3*n] + outputStep[1]*(double)kernelOffset[3*n+1]
+                                 + outputStep[2]*(double)kernelOffset[3*n+2];
 
-    //radius = maximum size of the bounding box in the HR space
-    radius[0] = ceil(inputSpacing[2] / m_OutputSpacing[0]);
-    radius[1] = ceil(inputSpacing[2] / m_OutputSpacing[1]);
-    radius[2] = ceil(inputSpacing[2] / m_OutputSpacing[2]);
+      kernelAxes[3*n]   = dot_product(displacement, axis[0]);
+      kernelAxes[3*n+1] = dot_product(displacement, axis[1]);
+      kernelAxes[3*n+2] = dot_product(displacement, axis[2]);
+    }
 
-    FloatNeighborhoodIteratorType nbIt( radius, sumImage,
-                                      sumImage -> GetLargestPossibleRegion() );
-    nbIt.NeedToUseBoundaryConditionOff();
+    InputImageRegionType wholeSliceRegion;
+    wholeSliceRegion = m_InputImageRegion[im];
 
-    FloatNeighborhoodIteratorType nbWtIt( radius, wtImage,
-                                        wtImage -> GetLargestPossibleRegion() );
-    nbWtIt.NeedToUseBoundaryConditionOff();
+    IndexType  wholeSliceRegionIndex = wholeSliceRegion.GetIndex();
+    SizeType   wholeSliceRegionSize  = wholeSliceRegion.GetSize();
 
-    // Division of outputImage into regions (for iteration over neighborhoods)
-    FaceCalculatorType faceCalculator;
-    FaceListType faceList;
+    wholeSliceRegionIndex[2]= i;
+    wholeSliceRegionSize[2] = 1;
 
-    faceList = faceCalculator( sumImage, sumImage -> GetLargestPossibleRegion(),
-                               radius);
-    typename FaceCalculatorType::FaceListType::iterator fit;
-    fit=faceList.begin();
+    wholeSliceRegion.SetIndex(wholeSliceRegionIndex);
+    wholeSliceRegion.SetSize(wholeSliceRegionSize);
 
-    // Change Gaussian parameters (in case of inputs with different spaces)
-    sigma[0] = inputSpacing[0]/cst;
-    sigma[1] = inputSpacing[1]/cst;
-    sigma[2] = inputSpacing[2]/cst;
+    const long numberOfPixels = wholeSliceRegion.GetNumberOfPixels();
 
-    gaussian -> SetSigma( sigma );
+    if(numberOfPixels == 0)
+    {
+      continue;
+    }
 
-    IndexType inputIndex = m_InputImageRegion[im].GetIndex();
-    SizeType  inputSize  = m_InputImageRegion[im].GetSize();
+    std::vector< long >   pixelIndex(3*numberOfPixels);
+    std::vector< double > pixelShift(3*numberOfPixels);
+    std::vector< float >  pixelValue(numberOfPixels);
 
-    //TODO: Can we parallelize this ?
-    //Iteration over the slices of the LR images
-    for ( unsigned int i=inputIndex[2]; i < inputIndex[2] + inputSize[2]; i++ )
+    ConstIteratorType fixedIt( m_ImageArray[im], wholeSliceRegion);
+
+    IndexType fixedIndex;
+    IndexType outputIndex;
+    PointType physicalPoint;
+    PointType centerPoint;
+    PointType transformedPoint;
+
+    long firstCenterZ = LONG_MAX;
+    long lastCenterZ  = LONG_MIN;
+    long p = 0;
+
+    //Loop over pixels of the current slice
+    for(fixedIt.GoToBegin(); !fixedIt.IsAtEnd(); ++fixedIt, p++)
     {
-      // Get the rotation of the rigid transform for the rotation of the Gaussian PSF
-      VnlMatrixType NQd;
-      NQd = m_Transform[im] -> GetSliceTransform(i) -> GetMatrix().GetVnlMatrix();
+      //Put in the world coordinates
+      fixedIndex = fixedIt.GetIndex();
+      m_ImageArray[im] -> TransformIndexToPhysicalPoint( fixedIndex, physicalPoint );
 
-      VnlVectorType idirTransformed = NQd*idir.GetVnlVector();
-      VnlVectorType jdirTransformed = NQd*jdir.GetVnlVector();
-      VnlVectorType kdirTransformed = NQd*kdir.GetVnlVector();
+      //Put in the HR image space
+      transformedPoint = m_Transform[im] -> TransformPointOfSlice( i, physicalPoint );
+      outputPtr -> TransformPhysicalPointToIndex( transformedPoint, outputIndex);
+      outputPtr -> TransformIndexToPhysicalPoint( outputIndex, centerPoint );
 
-      InputImageRegionType wholeSliceRegion;
-      wholeSliceRegion = m_InputImageRegion[im];
+      // Displacement from the transformed point to the central voxel, projected on the PSF axes
+      VnlVectorType centerDisplacement = centerPoint.GetVnlVector() - transformedPoint.GetVnlVector();
 
-      IndexType  wholeSliceRegionIndex = wholeSliceRegion.GetIndex();
-      SizeType   wholeSliceRegionSize  = wholeSliceRegion.GetSize();
+      for(unsigned int d = 0; d < 3; d++)
+      {
+        pixelIndex[3*p+d] = outputIndex[d];
+        pixelShift[3*p+d] = dot_product(centerDisplacement, axis[d]);
+      }
+      pixelValue[p] = fixedIt.Get();
+
+      firstCenterZ = std::min(firstCenterZ, (long)outputIndex[2]);
+      lastCenterZ  = std::max(lastCenterZ,  (long)outputIndex[2]);
+    }
+
+    // Counting sort of the pixels by the z of their central voxel (pixels of a same z keep their order)
+    std::vector< long > & bucketBegin = sliceBucketBegin[s];
+    bucketBegin.assign(lastCenterZ - firstCenterZ + 2, 0);
+
+    for(p = 0; p < numberOfPixels; p++)
+    {
+      bucketBegin[pixelIndex[3*p+2] - firstCenterZ + 1]++;
+    }
+    for(unsigned int b = 1; b < bucketBegin.size(); b++)
+    {
+      bucketBegin[b] += bucketBegin[b-1];
+    }
+
+    std::vector< long > bucketEnd(bucketBegin.begin(), bucketBegin.end()-1);
+
+    slicePixelIndex[s].resize(3*numberOfPixels);
+    slicePixelShift[s].resize(3*numberOfPixels);
+    slicePixelValue[s].resize(numberOfPixels);
+
+    for(p = 0; p < numberOfPixels; p++)
+    {
+      const long q = bucketEnd[pixelIndex[3*p+2] - firstCenterZ]++;
+
+      for(unsigned int d = 0; d < 3; d++)
+      {
+        slicePixelIndex[s][3*q+d] = pixelIndex[3*p+d];
+        slicePixelShift[s][3*q+d] = pixelShift[3*p+d];
+      }
+      slicePixelValue[s][q] = pixelValue[p];
+    }
+
+    sliceFirstCenterZ[s] = firstCenterZ;
+    sliceLastCenterZ[s]  = lastCenterZ;
+  }
 
-      wholeSliceRegionIndex[2]= i;
-      wholeSliceRegionSize[2] = 1;
+  // Weighted sum and sum of weights. The output is cut into z-slabs and each slab is filled by one
+  // thread with the contributions of all the slices reaching it. Slabs do not overlap, so the buffers
+  // are shared (the memory does not depend on the number of threads), and each voxel receives its
+  // contributions in the same order whatever the number of threads.
+  std::vector< float > sumBuffer(numberOfVoxels, 0.0);
+  std::vector< float > weightBuffer(numberOfVoxels, 0.0);
 
-      wholeSliceRegion.SetIndex(wholeSliceRegionIndex);
-      wholeSliceRegion.SetSize(wholeSliceRegionSize);
+  int numberOfThreads = 1;
+#ifdef _OPENMP
+  numberOfThreads = omp_get_max_threads();
+#endif
+  // About 4 slabs per thread, of at least 4 slices (the schedule takes half the slab thickness)
+  SlabSchedule slabs(nz, std::max(2L, (long)ceil((double)nz / (8*numberOfThreads))));
+
+  int slab;
+  #pragma omp parallel for private(slab) schedule(dynamic)
 
-      ConstIteratorType fixedIt( m_ImageArray[im], wholeSliceRegion);
+  for(slab = 0; slab < slabs.GetNumberOfSlabs(); slab++)
+  {
+    const long zBegin = slabs.GetSlabBegin(slab);
+    const long zEnd   = slabs.GetSlabEnd(slab);
 
-      IndexType fixedIndex;
-      IndexType outputIndex;
-      IndexType nbIndex;
-      PointType physicalPoint;
-      PointType nbPoint;
-      PointType diffPoint;
-      PointType rotPoint;
-      PointType transformedPoint;
+    for(unsigned int s = 0; s < numberOfSlices; s++)
+    {
+      unsigned int im = sliceImage[s];
 
-      double value;
-      //Loop over pixels of the current slice
-      for(fixedIt.GoToBegin(); !fixedIt.IsAtEnd(); ++fixedIt)
+      const std::vector< long > & radius = imageRadius[im];
+
+      // Central z of the pixels whose PSF reaches the slab
+      const long firstZ = std::max(sliceFirstCenterZ[s], zBegin - radius[2]);
+      const long lastZ  = std::min(sliceLastCenterZ[s], zEnd - 1 + radius[2]);
+
+      if(firstZ > lastZ)
       {
-        //Put in the world coordinates
-        fixedIndex = fixedIt.GetIndex();
-        m_ImageArray[im] -> TransformIndexToPhysicalPoint( fixedIndex, physicalPoint );
+        continue;
+      }
+
+      const long planeSize = (2*radius[0]+1) * (2*radius[1]+1);
 
-        //Put in the HR image space
-        transformedPoint = m_Transform[im]-> TransformPoint( physicalPoint );
-        sumImage -> TransformPhysicalPointToIndex( transformedPoint, outputIndex);
+      const long *   kernelStride = &imageKernelStride[im][0];
+      const long *   kernelOffset = &imageKernelOffset[im][0];
+      const double * kernelAxes   = &sliceKernelAxes[s][0];
+
+      const long pBegin = sliceBucketBegin[s][firstZ - sliceFirstCenterZ[s]];
+      const long pEnd   = sliceBucketBegin[s][lastZ - sliceFirstCenterZ[s] + 1];
+
+      for(long p = pBegin; p < pEnd; p++)
+      {
+        const long * outputIndex = &slicePixelIndex[s][3*p];
 
-        nbIt.SetLocation(outputIndex);
-        nbWtIt.SetLocation(outputIndex);
+        // Part of the PSF inside the slab
+        long dzBegin = std::max(-radius[2], zBegin - outputIndex[2]);
+        long dzEnd   = std::min( radius[2], zEnd - 1 - outputIndex[2]);
 
-        if ( (*fit).IsInside(outputIndex) )
+        const long nBegin = (dzBegin + radius[2]) * planeSize;
+        const long nEnd   = (dzEnd + radius[2] + 1) * planeSize;
+
+        double b0 = slicePixelShift[s][3*p];
+        double b1 = slicePixelShift[s][3*p+1];
+        double b2 = slicePixelShift[s][3*p+2];
+
+        float value = slicePixelValue[s][p];
+
+        // The z range of the PSF is already restricted to the slab
+        bool inside = true;
+        for(unsigned int d = 0; d < 2; d++)
         {
-          //Loop over the Gaussian PSF
-          for(unsigned int i=0; i<nbIt.Size(); i++)
+          if( (outputIndex[d] - radius[d] < 0) || (outputIndex[d] + radius[d] >= (long)outputSize[d]) )
           {
-            nbIndex = nbIt.GetIndex(i);
+            inside = false;
+          }
+        }
 
-            sumImage -> TransformIndexToPhysicalPoint( nbIndex, nbPoint );
+        //Loop over the Gaussian PSF
+        if(inside)
+        {
+          const long center = outputIndex[0] + nx * ( outputIndex[1] + ny * outputIndex[2] );
 
-            if ( mask -> IsInside(nbPoint))
-            {
-              VnlVectorType diffPoint = nbPoint.GetVnlVector() - transformedPoint.GetVnlVector();
-              rotPoint[0] = dot_product(diffPoint,idirTransformed);
-              rotPoint[1] = dot_product(diffPoint,jdirTransformed);
-              rotPoint[2] = dot_product(diffPoint,kdirTransformed);
+          for(long n = nBegin; n < nEnd; n++)
+          {
+            const long k = center + kernelStride[n];
 
-              value = gaussian->Evaluate( rotPoint );
+            if(maskBuffer[k])
+            {
+              double r0 = kernelAxes[3*n]   + b0;
+              double r1 = kernelAxes[3*n+1] + b1;
+              double r2 = kernelAxes[3*n+2] + b2;
+              double weight = exp( -0.5 * (r0*r0 + r1*r1 + r2*r2) );
 
-              //TODO: check if this is fast
-              nbIt.SetPixel(i, fixedIt.Get() *value + nbIt.GetPixel(i) );
-              nbWtIt.SetPixel(i, value + nbWtIt.GetPixel(i) );
+              sumBuffer[k]    += value * weight;
+              weightBuffer[k] += weight;
             }
           }
         }
         else
         {
-          for(unsigned int i=0; i<nbIt.Size(); i++)
+          for(long n = nBegin; n < nEnd; n++)
           {
-            nbIndex = nbIt.GetIndex(i);
+            long x = outputIndex[0] + kernelOffset[3*n];
+            long y = outputIndex[1] + kernelOffset[3*n+1];
+            long z = outputIndex[2] + kernelOffset[3*n+2];
 
-            if ( outputRegion.IsInside(nbIndex) )
+            if( (x < 0) || (x >= nx) || (y < 0) || (y >= ny) )
             {
+              continue;
+            }
 
-              sumImage -> TransformIndexToPhysicalPoint( nbIndex, nbPoint );
-
-              if ( mask -> IsInside(nbPoint))
-              {
-                VnlVectorType diffPoint = nbPoint.GetVnlVector() - transformedPoint.GetVnlVector();
-                rotPoint[0] = dot_product(diffPoint,idirTransformed);
-                rotPoint[1] = dot_product(diffPoint,jdirTransformed);
-                rotPoint[2] = dot_product(diffPoint,kdirTransformed);
-
-                value = gaussian->Evaluate( rotPoint );
+            const long k = x + nx * ( y + ny * z );
 
-                //TODO: check if this is fast
-                nbIt.SetPixel(i, fixedIt.Get() *value + nbIt.GetPixel(i) );
-                nbWtIt.SetPixel(i, value + nbWtIt.GetPixel(i) );
-              }
+            if(maskBuffer[k])
+            {
+              double r0 = kernelAxes[3*n]   + b0;
+              double r1 = kernelAxes[3*n+1] + b1;
+              double r2 = kernelAxes[3*n+2] + b2;
+              double weight = exp( -0.5 * (r0*r0 + r1*r1 + r2*r2) );
 
+              sumBuffer[k]    += value * weight;
+              weightBuffer[k] += weight;
             }
-
           }
-
         }
 
       }
 
-    }
-
-  }
-
-  // Creates output image
-
-  outputPtr -> SetRegions(outputRegion);
-  outputPtr -> Allocate();
-  outputPtr -> FillBuffer(0);
+    } // for each slice
 
-  outputPtr -> SetOrigin( referenceImage -> GetOrigin() );
-  outputPtr -> SetSpacing( referenceImage -> GetSpacing() );
-  outputPtr -> SetDirection( referenceImage -> GetDirection() );
+  } // for each slab
 
   // Normalization
 
-  IteratorType outputIt(outputPtr,outputRegion);
-  ConstFloatIteratorType sumIt(sumImage,outputRegion);
-  ConstFloatIteratorType wtIt(wtImage,outputRegion);
+  PixelType * outputBuffer = outputPtr -> GetBufferPointer();
+  long k;
 
-  float weight;
-
-  for( outputIt.GoToBegin(), wtIt.GoToBegin(), sumIt.GoToBegin(); !wtIt.IsAtEnd(); ++wtIt, ++outputIt, ++sumIt  )
+  #pragma omp parallel for private(k) schedule(static)
+  for(k = 0; k < numberOfVoxels; k++)
   {
-     weight = wtIt.Get();
-     if (weight != 0)
-     {
-        outputIt.Set( sumIt.Get()/weight );
-     }
+    if (weightBuffer[k] != 0)
+    {
+      outputBuffer[k] = sumBuffer[k]/weightBuffer[k];
+    }
   }
 
   return;
@@ -291,7 +291,7 @@ ResampleLabelsByInjectionFilter<TInputImage,TOutputImage,TInterpolatorPrecisionT
         fixedIndex = fixedIt.GetIndex();
         m_ImageArray[im] -> TransformIndexToPhysicalPoint( fixedIndex, physicalPoint );
 
-        transformedPoint = m_Transform[im] -> TransformPoint( physicalPoint);
+        transformedPoint = m_Transform[im] -> TransformPointOfSlice( i, physicalPoint );
         outputPtr -> TransformPhysicalPointToIndex( transformedPoint, outputIndex);
 
         nbIt.SetLocation(outputIndex);
@@ -0,0 +1,331 @@
+/*==========================================================================
+
+  © Université de Strasbourg - Centre National de la Recherche Scientifique
+
+  Date: 18/10/2026
+  Author(s): agent (agent@local)
+
+  This software is governed by the CeCILL-B license under French law and
+  abiding by the rules of distribution of free software.  You can  use,
+  modify and/ or redistribute the software under the terms of the CeCILL-B
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and  rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty  and the software's author,  the holder of the
+  economic rights,  and the successive licensors  have only  limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading,  using,  modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean  that it is complicated to manipulate,  and  that  also
+  therefore means  that it is reserved for developers  and  experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and,  more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL-B license and that you accept its terms.
+
+==========================================================================*/
+
+#ifndef BTKSRHMATRIXCACHE_H
+#define BTKSRHMATRIXCACHE_H
+
+#include "vnl/vnl_vector.h"
+
+#include "btkSparseMatrixCSR.hxx"
+
+#include "vector"
+#include "string"
+#include "sstream"
+#include "fstream"
+#include "iostream"
+#include "cstdio"
+#include "algorithm"
+
+namespace btk
+{
+/**
+ * @class SRHMatrixCache
+ * @brief Persistent cache of the super-resolution observation matrix H.
+ *
+ * The cache file is named after a key computed from everything H depends on (LR images and masks,
+ * transforms, PSF, geometry of the HR image). Headers and pixel values are both hashed: the
+ * LR values are used to skip background voxels, so two acquisitions sharing the same header
+ * must not share H.
+ *
+ * The file contains a list of float vectors (such as y or Ht.y), which are copied on loading,
+ * followed by H, which is mapped in memory (see SparseMatrixCSR::MapFile).
+ * @code
+ * btk::SRHMatrixCache cache;
+ * cache.SetDirectory(directory);
+ * cache.AddImage(image, true); cache.AddTransform(transform); ...
+ * if(!cache.Load(H, vectors)) { compute H and the vectors; cache.Save(H, vectors); }
+ * @endcode
+ * @author agent
+ * @ingroup Reconstruction
+ */
+class SRHMatrixCache
+{
+    public:
+        typedef unsigned long long KeyType;
+
+        SRHMatrixCache()
+        {
+            this->Reset();
+        }
+
+        /** Set the directory of the cache files (an empty directory disables the cache). */
+        void SetDirectory(const std::string & directory) { m_Directory = directory; }
+
+        /** Get the directory of the cache files. */
+        const std::string & GetDirectory() const { return m_Directory; }
+
+        /** Return true if a directory is set. */
+        bool IsEnabled() const { return !m_Directory.empty(); }
+
+        /** Restart the computation of the key. */
+        void Reset()
+        {
+            m_Key = 14695981039346656037ULL; // FNV-1a 64 bits offset basis
+        }
+
+        /** Add raw data to the key (FNV-1a 64 bits). */
+        void AddData(const void * data, unsigned long bytes)
+        {
+            const unsigned char * p = static_cast< const unsigned char * >(data);
+
+            for(unsigned long i = 0; i < bytes; i++)
+            {
+                m_Key = (m_Key ^ p[i]) * 1099511628211ULL;
+            }
+        }
+
+        /** Add a value to the key. */
+        template < class T >
+        void AddValue(const T & value)
+        {
+            this->AddData(&value, sizeof(T));
+        }
+
+        /** Add a string to the key. */
+        void AddString(const std::string & value)
+        {
+            this->AddValue(static_cast< unsigned long long >(value.size()));
+            this->AddData(value.c_str(), value.size());
+        }
+
+        /**
+         * @brief Add an image to the key.
+         * @param image Image (region, spacing, origin and direction are used).
+         * @param withPixels Add also the pixel values.
+         */
+        template < class TImage >
+        void AddImage(const TImage * image, bool withPixels)
+        {
+            typename TImage::RegionType region = image->GetLargestPossibleRegion();
+
+            for(unsigned int i = 0; i < TImage::ImageDimension; i++)
+            {
+                this->AddValue(static_cast< long long >(region.GetIndex()[i]));
+                this->AddValue(static_cast< unsigned long long >(region.GetSize()[i]));
+                this->AddValue(static_cast< double >(image->GetSpacing()[i]));
+                this->AddValue(static_cast< double >(image->GetOrigin()[i]));
+
+                for(unsigned int j = 0; j < TImage::ImageDimension; j++)
+                {
+                    this->AddValue(static_cast< double >(image->GetDirection()(i,j)));
+                }
+            }
+
+            if(withPixels)
+            {
+                this->AddData(image->GetBufferPointer(), region.GetNumberOfPixels() * sizeof(typename TImage::PixelType));
+            }
+        }
+
+        /** Add a transform to the key (class name, parameters and fixed parameters). */
+        template < class TTransform >
+        void AddTransform(const TTransform * transform)
+        {
+            this->AddString(transform->GetNameOfClass());
+
+            typename TTransform::ParametersType parameters = transform->GetParameters();
+            this->AddValue(static_cast< unsigned long long >(parameters.Size()));
+            for(unsigned int i = 0; i < parameters.Size(); i++)
+            {
+                this->AddValue(static_cast< double >(parameters[i]));
+            }
+
+            typename TTransform::ParametersType fixedParameters = transform->GetFixedParameters();
+            this->AddValue(static_cast< unsigned long long >(fixedParameters.Size()));
+            for(unsigned int i = 0; i < fixedParameters.Size(); i++)
+            {
+                this->AddValue(static_cast< double >(fixedParameters[i]));
+            }
+        }
+
+        /** Get the key. */
+        KeyType GetKey() const { return m_Key; }
+
+        /** Get the name of the cache file corresponding to the current key. */
+        std::string GetFileName() const
+        {
+            std::ostringstream fileName;
+            fileName << m_Directory << "/btkH_" << std::hex;
+            fileName.width(16);
+            fileName.fill('0');
+            fileName << m_Key << ".bin";
+            return fileName.str();
+        }
+
+        /**
+         * @brief Load H and the vectors from the cache file of the current key.
+         * @return false if there is no valid file for this key.
+         */
+        template < class TValue >
+        bool Load(SparseMatrixCSR< TValue > & H, std::vector< vnl_vector< float > > & vectors) const
+        {
+            if(!this->IsEnabled())
+            {
+                return false;
+            }
+
+            std::string fileName = this->GetFileName();
+            std::ifstream file(fileName.c_str(), std::ios::in | std::ios::binary);
+
+            if(!file.is_open())
+            {
+                return false;
+            }
+
+            char magic[8];
+            KeyType key = 0;
+            unsigned long long numberOfVectors = 0;
+
+            file.read(magic, sizeof(magic));
+            file.read(reinterpret_cast< char * >(&key), sizeof(key));
+            file.read(reinterpret_cast< char * >(&numberOfVectors), sizeof(numberOfVectors));
+
+            if(!file.good() || !std::equal(magic, magic + sizeof(magic), Magic()) || key != m_Key)
+            {
+                return false;
+            }
+
+            std::vector< unsigned long long > sizes(numberOfVectors);
+            if(numberOfVectors > 0)
+            {
+                file.read(reinterpret_cast< char * >(&sizes[0]), numberOfVectors * sizeof(unsigned long long));
+            }
+
+            vectors.resize(numberOfVectors);
+            for(unsigned int i = 0; i < numberOfVectors && file.good(); i++)
+            {
+                vectors[i].set_size(sizes[i]);
+                if(sizes[i] > 0)
+                {
+                    file.read(reinterpret_cast< char * >(vectors[i].data_block()), sizes[i] * sizeof(float));
+                }
+                file.seekg(AlignedSize(sizes[i] * sizeof(float)) - sizes[i] * sizeof(float), std::ios::cur);
+            }
+
+            if(!file.good())
+            {
+                return false;
+            }
+
+            unsigned long matrixOffset = file.tellg();
+            file.close();
+
+            if(!H.MapFile(fileName, matrixOffset))
+            {
+                return false;
+            }
+
+            std::cout<<"H loaded from "<<fileName<<std::endl;
+            return true;
+        }
+
+        /**
+         * @brief Save H and the vectors in the cache file of the current key.
+         * The file is written under a temporary name and then renamed, so that a partially
+         * written file is never read.
+         */
+        template < class TValue >
+        bool Save(const SparseMatrixCSR< TValue > & H, const std::vector< vnl_vector< float > > & vectors) const
+        {
+            if(!this->IsEnabled())
+            {
+                return false;
+            }
+
+            std::string fileName = this->GetFileName();
+            std::string temporaryFileName = fileName + ".tmp";
+            std::ofstream file(temporaryFileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+            if(!file.is_open())
+            {
+                std::cerr<<"Unable to write the cache file "<<temporaryFileName<<std::endl;
+                return false;
+            }
+
+            const char zeros[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+            unsigned long long numberOfVectors = vectors.size();
+
+            file.write(Magic(), 8);
+            file.write(reinterpret_cast< const char * >(&m_Key), sizeof(m_Key));
+            file.write(reinterpret_cast< const char * >(&numberOfVectors), sizeof(numberOfVectors));
+
+            for(unsigned int i = 0; i < vectors.size(); i++)
+            {
+                unsigned long long size = vectors[i].size();
+                file.write(reinterpret_cast< const char * >(&size), sizeof(size));
+            }
+
+            for(unsigned int i = 0; i < vectors.size(); i++)
+            {
+                unsigned long bytes = vectors[i].size() * sizeof(float);
+                if(bytes > 0)
+                {
+                    file.write(reinterpret_cast< const char * >(vectors[i].data_block()), bytes);
+                }
+                file.write(zeros, AlignedSize(bytes) - bytes);
+            }
+
+            H.Write(file);
+            file.close();
+
+            if(!file.good() || std::rename(temporaryFileName.c_str(), fileName.c_str()) != 0)
+            {
+                std::cerr<<"Unable to write the cache file "<<fileName<<std::endl;
+                std::remove(temporaryFileName.c_str());
+                return false;
+            }
+
+            std::cout<<"H saved in "<<fileName<<std::endl;
+            return true;
+        }
+
+    private:
+
+        static const char * Magic()
+        {
+            return "BTKHCACH";
+        }
+
+        static unsigned long AlignedSize(unsigned long bytes)
+        {
+            return (bytes + 7) & ~7UL;
+        }
+
+        std::string m_Directory;
+        KeyType     m_Key;
+};
+}
+
+#endif // BTKSRHMATRIXCACHE_H
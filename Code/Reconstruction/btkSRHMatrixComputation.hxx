@@ -55,6 +55,8 @@
 #include "btkSincPSF.h"
 #include "btkHybridPSF.h"
 #include "btkImageHelper.h"
+#include "btkSparseMatrixCSR.hxx"
+#include "btkSRHMatrixCache.h"
 
 
 #include "iostream"
@@ -94,6 +96,8 @@ class SRHMatrixComputation: public itk::Object
 
         typedef float                           PrecisionType;
 
+        typedef btk::SparseMatrixCSR< PrecisionType > SparseMatrixType;
+
         typedef ContinuousIndex<double, TImage::ImageDimension> ContinuousIndexType;
 
         typedef itk::ImageMaskSpatialObject< TImage::ImageDimension > MaskType;
@@ -139,12 +143,22 @@ class SRHMatrixComputation: public itk::Object
         btkSetMacro(InverseTransforms, std::vector< typename TransformType::Pointer >);
         btkGetMacro(InverseTransforms, std::vector< typename TransformType::Pointer >);
 
-        btkSetMacro(H,vnl_sparse_matrix< PrecisionType >*);
+        btkSetMacro(H,SparseMatrixType*);
 
         btkSetMacro(PSF,btk::PSF::Pointer);
 
         btkSetMacro(Y,vnl_vector< PrecisionType >*);
 
+        /** Directory where H, y and Ht.y are stored and reloaded when the inputs are the same (no cache if empty) */
+        btkSetMacro(CacheDirectory, std::string);
+        btkGetMacro(CacheDirectory, std::string);
+
+        /** Get Ht.y (computed with H) */
+        const vnl_vector< PrecisionType > & GetHtY() const
+        {
+            return m_HtY;
+        }
+
         /**
          * @brief SetOutliers
          * @param _outliers is a vector of vector of boolean
@@ -181,7 +195,7 @@ class SRHMatrixComputation: public itk::Object
            unsigned int depth;
         }m_XSize;
 
-        vnl_sparse_matrix< PrecisionType >* m_H;
+        SparseMatrixType* m_H;
         vnl_vector< PrecisionType >* m_Y;
         vnl_vector< PrecisionType > m_SimY;
         vnl_vector< PrecisionType > m_HtY;
@@ -208,6 +222,7 @@ class SRHMatrixComputation: public itk::Object
         std::vector< PSF::Pointer >        m_PSFs;
 
         bool                               m_IsHComputed;
+        std::string                        m_CacheDirectory;
 
         unsigned int m_NumberOfLRImages;
 };
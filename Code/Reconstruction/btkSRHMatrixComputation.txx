@@ -77,13 +77,6 @@ void SRHMatrixComputation< TImage >::Update()
 
     //We use linear interpolation for the estimation of point influence in matrix H
     typedef itk::BSplineInterpolationWeightFunction<double, 3, 1> itkBSplineFunction;
-    itkBSplineFunction::Pointer bsplineFunction = itkBSplineFunction::New();
-    itkBSplineFunction::WeightsType bsplineWeights;
-    bsplineWeights.SetSize(8); // (bsplineOrder + 1)^3
-    itkBSplineFunction::IndexType   bsplineStartIndex;
-    itkBSplineFunction::IndexType   bsplineEndIndex;
-    itkBSplineFunction::SizeType    bsplineSize;
-    RegionType                      bsplineRegion;
 
 
     IndexType start_hr  = m_OutputImageRegion.GetIndex();
@@ -109,7 +102,7 @@ void SRHMatrixComputation< TImage >::Update()
         nrows += m_Images[im]->GetLargestPossibleRegion().GetNumberOfPixels();
     }
 
-    m_H->set_size(nrows, ncols);
+    m_H->SetSize(nrows, ncols);
 
     m_Y->set_size(nrows);
     m_Y->fill(0.0);
@@ -121,26 +114,28 @@ void SRHMatrixComputation< TImage >::Update()
     typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
     interpolator->SetInputImage(m_ReferenceImage);
 
-    unsigned int lrLinearIndex = 0;
-    unsigned int hrLinearIndex = 0;
-    unsigned int offset = 0;
-    double psfValue;
+    RegionType hrRegion = m_ReferenceImage->GetLargestPossibleRegion();
 
+    // The PSF is only translated from one LR voxel to another : for each LR image, the non-null values
+    // of the PSF and the position of the PSF voxels with respect to the PSF center are computed once.
+    std::vector< std::vector< double > >                               psfValues(m_NumberOfLRImages);
+    std::vector< std::vector< typename PointType::VectorType > >       psfOffsets(m_NumberOfLRImages);
 
+    // H is filled by blocks of rows (one block for each slice of each LR image), in parallel
+    std::vector< unsigned int > blockImage;
+    std::vector< unsigned int > blockSlice;
+    std::vector< unsigned int > imageOffset(m_NumberOfLRImages);
 
+    unsigned int offset = 0;
     unsigned int im;
-    //FIXME : add critical part for H and PSF
-    // Not Sure that parallel for is necessary here !
-    //#pragma omp parallel for private(im) schedule(dynamic)
 
     for(im = 0; im < m_Images.size(); im++)
     {
-
         std::cout<<"Processing image "<<im+1<<std::endl;
 
         SizeType lrSize = m_Images[im]->GetLargestPossibleRegion().GetSize();
         SpacingType lrSpacing = m_Images[im]->GetSpacing();
-        ConstIteratorType lrIt( m_Images[im], m_Images[im]->GetLargestPossibleRegion() );
+
         //Initialization of the PSF
         m_PSF->SetDirection(m_Images[im]->GetDirection());
         m_PSF->SetLrSpacing(lrSpacing);
@@ -154,146 +149,176 @@ void SRHMatrixComputation< TImage >::Update()
         m_PSF->SetSize(psfSize);
         m_PSF->ConstructImage();
 
-        // for all voxels
-        for(lrIt.GoToBegin(); !lrIt.IsAtEnd(); ++lrIt)
-        {
-            IndexType lrIndex = lrIt.GetIndex();
-            PointType lrPoint;
-            m_Images[im]->TransformIndexToPhysicalPoint(lrIndex, lrPoint);
-            PointType srPoint = m_Transforms[im]->TransformPoint(lrPoint);
+        // PSF centered on the physical origin
+        PointType center;
+        center.Fill(0.0);
+        m_PSF->SetCenter(center);
+        PSF = m_PSF->GetPsfImage();
 
-            // if point is not in the mask we skip it
-            if((!m_Masks[im]->GetImage()->GetPixel(lrIndex)) > 0)
+        ImageRegionConstIteratorWithIndex< itk::Image< float, 3 > > itPsf(PSF, PSF->GetLargestPossibleRegion());
+        for(itPsf.GoToBegin(); !itPsf.IsAtEnd(); ++itPsf)
+        {
+            if(itPsf.Get() <= 0.0)
             {
                 continue;
             }
 
-            // if point is not in the sr image we skip it
-            if(!interpolator->IsInsideBuffer(srPoint))
-            {
-                continue;
-            }
+            PointType psfPoint;
+            PSF->TransformIndexToPhysicalPoint(itPsf.GetIndex(), psfPoint);
 
-            //compute the linear index corresponding to the index of lr image
-            lrLinearIndex =  lrIndex[0] + lrIndex[1]*lrSize[0]
-                            + lrIndex[2]*lrSize[0]*lrSize[1] + offset;
+            psfValues[im].push_back(itPsf.Get());
+            psfOffsets[im].push_back(psfPoint - center);
+        }
 
-            //Fill Y
-            m_Y->operator()(lrLinearIndex) = lrIt.Get();
+        imageOffset[im] = offset;
+        offset += m_Images[im]->GetLargestPossibleRegion().GetNumberOfPixels();
+        assert(offset < UINT_MAX);
 
+        for(unsigned int z = 0; z < lrSize[2]; z++)
+        {
+            blockImage.push_back(im);
+            blockSlice.push_back(z);
+        }
+    }
 
-            m_PSF->SetCenter(lrPoint);
-             //m_PSF->ConstructImage(); //We construct an image at each voxel, time-consuming !!!
-            //std::cout<<lrPoint<<std::endl;
-            // Get PSF support (image)
-            PSF = m_PSF->GetPsfImage();
-            // Save the result (do that with a break point in debug mode,
-            // otherwise PSF is saved at each voxel).
-           // btk::ImageHelper< itk::Image< float, 3 > >::WriteImage(PSF,"PSFImage.nii.gz");
+    // H (with y and Ht.y) is reloaded if it has been computed for the same inputs
+    SRHMatrixCache cache;
+    cache.SetDirectory(m_CacheDirectory);
 
-            ImageRegionConstIteratorWithIndex< itk::Image< float, 3 > > itPsf(PSF, PSF->GetLargestPossibleRegion());
-            // Loop over PSF voxels
-            for(itPsf.GoToBegin(); !itPsf.IsAtEnd(); ++itPsf)
-            {
-                IndexType psfIndex = itPsf.GetIndex();
-                PointType psfInLrSpacePoint, transformedPoint;
-                //Physical point of psf Index, in Lr Space
-                PSF->TransformIndexToPhysicalPoint(psfIndex,psfInLrSpacePoint);
+    if(cache.IsEnabled())
+    {
+        cache.AddImage(m_ReferenceImage.GetPointer(), false);
 
-                psfValue = itPsf.Get();
+        for(im = 0; im < m_NumberOfLRImages; im++)
+        {
+            cache.AddImage(m_Images[im].GetPointer(), true);
+            cache.AddImage(m_Masks[im]->GetImage(), true);
+            cache.AddTransform(m_Transforms[im].GetPointer());
 
-                if(psfValue <= 0.0)
-                {
-                    continue;
-                }
+            cache.AddValue(static_cast< unsigned long long >(psfValues[im].size()));
+            for(unsigned int p = 0; p < psfValues[im].size(); p++)
+            {
+                cache.AddValue(psfValues[im][p]);
+                cache.AddValue(static_cast< double >(psfOffsets[im][p][0]));
+                cache.AddValue(static_cast< double >(psfOffsets[im][p][1]));
+                cache.AddValue(static_cast< double >(psfOffsets[im][p][2]));
+            }
+        }
 
-                // psfPoint in sr space
-                transformedPoint = m_Transforms[im]->TransformPoint(psfInLrSpacePoint);
+        std::vector< vnl_vector< PrecisionType > > vectors;
 
-                // if point is not in the sr image we skip it
-                if(interpolator->IsInsideBuffer(transformedPoint))
-                {
-                    ContinuousIndexType srContIndex;
-//                    // continuous index in sr image
-                    m_ReferenceImage->TransformPhysicalPointToContinuousIndex(transformedPoint, srContIndex);
+        if(cache.Load(*m_H, vectors))
+        {
+            if(vectors.size() == 2 && vectors[0].size() == nrows && vectors[1].size() == ncols
+               && m_H->Rows() == nrows && m_H->Cols() == ncols)
+            {
+                *m_Y  = vectors[0];
+                m_HtY = vectors[1];
 
+                m_IsHComputed = true;
+                return;
+            }
 
-                    // STAN VERSION :
+            std::cout<<"The cache file does not match the input data, H is computed."<<std::endl;
+            m_H->SetSize(nrows, ncols);
+        }
+    }
 
+    std::vector< typename SparseMatrixType::RowBlock > blocks(blockImage.size());
+    long b;
 
-//                    bool isInsideHR = true;
+    #pragma omp parallel for private(b) schedule(dynamic)
+    for(b = 0; b < (long)blocks.size(); b++)
+    {
+        unsigned int i = blockImage[b];
+        unsigned int z = blockSlice[b];
 
-//                    // FIXME This checking should be done for all points first, and discard the point
-//                    // if al least one point is out of the reference image
+        SizeType lrSize = m_Images[i]->GetLargestPossibleRegion().GetSize();
 
-//                    if ( (srContIndex[0] < start_hr[0]) || (srContIndex[0] > end_hr[0]) ||
-//                         (srContIndex[1] < start_hr[1]) || (srContIndex[1] > end_hr[1]) ||
-//                         (srContIndex[2] < start_hr[2]) || (srContIndex[2] > end_hr[2]) )
-//                       isInsideHR = false;
+        //B-spline weight function (one for each thread)
+        itkBSplineFunction::Pointer bsplineFunction = itkBSplineFunction::New();
+        itkBSplineFunction::WeightsType bsplineWeights;
+        bsplineWeights.SetSize(8); // (bsplineOrder + 1)^3
+        itkBSplineFunction::IndexType   bsplineStartIndex;
+        itkBSplineFunction::IndexType   bsplineEndIndex;
+        itkBSplineFunction::SizeType    bsplineSize = bsplineFunction->GetSupportSize();
 
-//                    if ( isInsideHR )
-//                    {
+        unsigned int lrLinearIndex = 0;
+        unsigned int hrLinearIndex = 0;
 
-//                      double hrValue = interpolator -> Evaluate( transformedPoint );
+        blocks[b].Initialize(imageOffset[i] + z*lrSize[0]*lrSize[1], lrSize[0]*lrSize[1]);
 
-//                      for(unsigned int n=0; n<interpolator -> GetContributingNeighbors(); n++)
-//                      {
-//                        IndexType hrIndex = interpolator -> GetIndex(n);
-//                        IndexType hrDiffIndex;
+        RegionType sliceRegion = m_Images[i]->GetLargestPossibleRegion();
+        sliceRegion.SetIndex(2, z);
+        sliceRegion.SetSize(2, 1);
 
-////                        hrDiffIndex[0] = hrIndex[0] - start_hr[0];
-////                        hrDiffIndex[1] = hrIndex[1] - start_hr[1];
-////                        hrDiffIndex[2] = hrIndex[2] - start_hr[2];
+        ConstIteratorType lrIt( m_Images[i], sliceRegion );
 
-//                        //hrLinearIndex = hrDiffIndex[0] + hrDiffIndex[1]*size_hr[0] + hrDiffIndex[2]*size_hr[0]*size_hr[1];
-//                        hrLinearIndex = hrIndex[0] + hrIndex[1]*size_hr[0] + hrIndex[2]*size_hr[0]*size_hr[1];
-//                        //std::cout<<"old value in H("<<lrLinearIndex<<","<<hrLinearIndex<<") : "<<m_H->operator()(lrLinearIndex, hrLinearIndex)<<std::endl;
+        // for all voxels of the slice
+        for(lrIt.GoToBegin(); !lrIt.IsAtEnd(); ++lrIt)
+        {
+            IndexType lrIndex = lrIt.GetIndex();
+            PointType lrPoint;
+            m_Images[i]->TransformIndexToPhysicalPoint(lrIndex, lrPoint);
+            PointType srPoint = m_Transforms[i]->TransformPoint(lrPoint);
 
-//                        m_H->operator()(lrLinearIndex, hrLinearIndex) += psfValue * interpolator->GetOverlap(n);
+            // if point is not in the mask we skip it
+            if((!m_Masks[i]->GetImage()->GetPixel(lrIndex)) > 0)
+            {
+                continue;
+            }
 
-//                       //std::cout<<"new value in H("<<lrLinearIndex<<","<<hrLinearIndex<<") : "<<m_H->operator()(lrLinearIndex, hrLinearIndex)<<std::endl;
+            // if point is not in the sr image we skip it
+            if(!interpolator->IsInsideBuffer(srPoint))
+            {
+                continue;
+            }
+
+            //compute the linear index corresponding to the index of lr image
+            lrLinearIndex =  lrIndex[0] + lrIndex[1]*lrSize[0]
+                            + lrIndex[2]*lrSize[0]*lrSize[1] + imageOffset[i];
 
+            //Fill Y
+            m_Y->operator()(lrLinearIndex) = lrIt.Get();
 
-//                } //end of loop over the support region
+            // Loop over PSF voxels (PSF centered on lrPoint)
+            for(unsigned int p = 0; p < psfValues[i].size(); p++)
+            {
+                PointType psfInLrSpacePoint = lrPoint + psfOffsets[i][p];
 
-//            }// end if bspline index inside sr image
+                // psfPoint in sr space
+                PointType transformedPoint = m_Transforms[i]->TransformPoint(psfInLrSpacePoint);
 
-                    //FRANCOIS VERSION :
+                // if point is not in the sr image we skip it
+                if(interpolator->IsInsideBuffer(transformedPoint))
+                {
+                    ContinuousIndexType srContIndex;
+                    // continuous index in sr image
+                    m_ReferenceImage->TransformPhysicalPointToContinuousIndex(transformedPoint, srContIndex);
 
                     //Get the interpolation weight using itkBSplineInterpolationWeightFunction
                     bsplineFunction->Evaluate(srContIndex,bsplineWeights,bsplineStartIndex);
 
-                    //Get the support size for interpolation
-                    bsplineSize = bsplineFunction->GetSupportSize();
-
                     //Check if the bspline support region is inside the HR image
                     bsplineEndIndex[0] = bsplineStartIndex[0] + bsplineSize[0];
                     bsplineEndIndex[1] = bsplineStartIndex[1] + bsplineSize[1];
                     bsplineEndIndex[2] = bsplineStartIndex[2] + bsplineSize[2];
 
-                    if(m_ReferenceImage->GetLargestPossibleRegion().IsInside(bsplineStartIndex)
-                            && m_ReferenceImage->GetLargestPossibleRegion().IsInside(bsplineEndIndex))
+                    if(hrRegion.IsInside(bsplineStartIndex) && hrRegion.IsInside(bsplineEndIndex))
                     {
-                        //Set the support region
-                        bsplineRegion.SetSize(bsplineSize);
-                        bsplineRegion.SetIndex(bsplineStartIndex);
-
-                        //Instantiate an iterator on HR image over the bspline region
-                        ImageRegionConstIteratorWithIndex< ImageType > itHRImage(m_ReferenceImage,bsplineRegion);
-
                         //linear index of bspline weights
                         unsigned int weightLinearIndex = 0;
 
-                        //Loop over the support region
-                        for(itHRImage.GoToBegin(); !itHRImage.IsAtEnd(); ++itHRImage)
+                        //Loop over the support region (x first, as itk iterators)
+                        for(unsigned int sz = 0; sz < bsplineSize[2]; sz++)
+                        for(unsigned int sy = 0; sy < bsplineSize[1]; sy++)
+                        for(unsigned int sx = 0; sx < bsplineSize[0]; sx++)
                         {
-
-                            //Get coordinate in HR image
-                            IndexType hrIndex = itHRImage.GetIndex();
                             //Compute the corresponding linear index
-                            hrLinearIndex = hrIndex[0] + hrIndex[1]*size_hr[0] + hrIndex[2]*size_hr[0]*size_hr[1];
+                            hrLinearIndex = (bsplineStartIndex[0]+sx) + (bsplineStartIndex[1]+sy)*size_hr[0]
+                                          + (bsplineStartIndex[2]+sz)*size_hr[0]*size_hr[1];
                             //Add weight*PSFValue to the corresponding element in H
-                            m_H->operator()(lrLinearIndex, hrLinearIndex)  += psfValue * bsplineWeights[weightLinearIndex];
+                            blocks[b].Add(lrLinearIndex, hrLinearIndex, psfValues[i][p] * bsplineWeights[weightLinearIndex]);
                             weightLinearIndex++;
 
                         } //end of loop over the support region
@@ -306,32 +331,27 @@ void SRHMatrixComputation< TImage >::Update()
 
         }//for voxels
 
-        offset += m_Images[im]->GetLargestPossibleRegion().GetNumberOfPixels();
-        assert(offset < UINT_MAX);
-    }//for im
+        blocks[b].Finish();
 
+    }//for blocks
 
+    m_H->SetRowBlocks(blocks);
 
     // normalization of H
-    for (unsigned int i = 0; i < m_H->rows(); i++)
-    {
-        double sum = 0.0;
-        sum = m_H->sum_row(i);
-
-        vnl_sparse_matrix< PrecisionType >::row & r = m_H->get_row(i);
-        vnl_sparse_matrix< PrecisionType >::row::iterator col_iter = r.begin();
-        for ( ;col_iter != r.end(); ++col_iter)
-        {
-
-            (*col_iter).second = (*col_iter).second / sum;
-
-        }
+    m_H->NormalizeRows();
 
+    // transposed H (used for Ht.y)
+    m_H->ComputeTranspose();
+    m_H->TransposeMult(*m_Y, m_HtY);
 
+    if(cache.IsEnabled())
+    {
+        std::vector< vnl_vector< PrecisionType > > vectors(2);
+        vectors[0] = *m_Y;
+        vectors[1] = m_HtY;
+        cache.Save(*m_H, vectors);
     }
 
-
-
     m_IsHComputed = true;
     std::cout<<"H computed !"<<std::endl;
 
@@ -427,7 +447,7 @@ SRHMatrixComputation< TImage >::SimulateY()
     vnl_vector< PrecisionType > SimY;
 
 
-    m_H->mult(m_X, SimY);
+    m_H->Mult(m_X, SimY);
 
 
     std::cout<<"Simulation Y is 0 : "<<SimY.is_zero()<<std::endl;
@@ -0,0 +1,261 @@
+/*==========================================================================
+
+  © Université de Strasbourg - Centre National de la Recherche Scientifique
+
+  Date: 18/10/2026
+  Author(s): agent (agent@local)
+
+  This software is governed by the CeCILL-B license under French law and
+  abiding by the rules of distribution of free software.  You can  use,
+  modify and/ or redistribute the software under the terms of the CeCILL-B
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and  rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty  and the software's author,  the holder of the
+  economic rights,  and the successive licensors  have only  limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading,  using,  modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean  that it is complicated to manipulate,  and  that  also
+  therefore means  that it is reserved for developers  and  experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and,  more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL-B license and that you accept its terms.
+
+==========================================================================*/
+
+#ifndef BTKSPARSEMATRIXCSR_H
+#define BTKSPARSEMATRIXCSR_H
+
+#include "vnl/vnl_vector.h"
+#include "vnl/vnl_sparse_matrix.h"
+
+#include "btkMacro.h"
+
+#include "vector"
+#include "utility"
+#include "string"
+#include "ostream"
+
+namespace btk
+{
+/**
+ * @class SparseMatrixCSR
+ * @brief Compressed sparse row matrix used for the observation matrix H of super-resolution (y = Hx).
+ *
+ * Compared to vnl_sparse_matrix, the non-zero values are stored in three flat arrays
+ * (row pointers, column indices, values) with 32 bits indices, and the matrix is built
+ * at once from independent row blocks, so that each block (one LR image, or a part of it)
+ * can be filled by a different thread.
+ *
+ * H.x and Ht.y are computed with OpenMP. Ht.y uses a transposed copy of the matrix
+ * (compressed sparse column storage of H) computed by ComputeTranspose(), so that each
+ * thread writes its own output values and no atomic operation is needed.
+ *
+ * The matrix can be written to a file (Write) and mapped back in memory (MapFile) without
+ * reading or copying the values, which is used to keep H between two runs (see SRHMatrixCache).
+ *
+ * A common use of this class is :
+ * @code
+ * std::vector< btk::SparseMatrixCSR< float >::RowBlock > blocks(numberOfBlocks);
+ * #pragma omp parallel for private(b) schedule(dynamic)
+ * for(b = 0; b < numberOfBlocks; b++)
+ * {
+ *   blocks[b].Initialize(firstRow, numberOfRows);
+ *   ... blocks[b].Add(row, column, value); (rows in increasing order) ...
+ *   blocks[b].Finish();
+ * }
+ * H.SetSize(nrows, ncols);
+ * H.SetRowBlocks(blocks);
+ * H.NormalizeRows();
+ * H.ComputeTranspose();
+ * @endcode
+ * @author agent
+ * @ingroup Reconstruction
+ */
+template < class TValue >
+class SparseMatrixCSR
+{
+    public:
+        typedef SparseMatrixCSR< TValue >   Self;
+        typedef TValue                      ValueType;
+        typedef unsigned int                IndexType;
+
+        /**
+         * @class RowBlock
+         * @brief Set of consecutive rows of the matrix, filled by a single thread.
+         * Values added several times at the same position are summed (as H(i,j) += v).
+         */
+        class RowBlock
+        {
+            public:
+                RowBlock();
+
+                /**
+                 * @brief Initialize the block.
+                 * @param firstRow First row of the block.
+                 * @param numberOfRows Number of rows of the block.
+                 */
+                void Initialize(IndexType firstRow, IndexType numberOfRows);
+
+                /**
+                 * @brief Add a value at the position (row, column). Rows must be filled in increasing order.
+                 */
+                void Add(IndexType row, IndexType column, ValueType value);
+
+                /**
+                 * @brief Store the last row. Must be called once all the values are added.
+                 */
+                void Finish();
+
+                /** Get the first row of the block. */
+                IndexType GetFirstRow() const { return m_FirstRow; }
+
+                /** Get the number of rows of the block. */
+                IndexType GetNumberOfRows() const { return m_NumberOfRows; }
+
+            private:
+                friend class SparseMatrixCSR;
+
+                /** Sort the entries of the current row and merge the duplicates. */
+                void FlushCurrentRow();
+
+                IndexType m_FirstRow;
+                IndexType m_NumberOfRows;
+                IndexType m_CurrentRow;
+
+                std::vector< IndexType > m_RowSizes;
+                std::vector< IndexType > m_Columns;
+                std::vector< ValueType > m_Values;
+
+                std::vector< std::pair< IndexType, double > > m_CurrentEntries;
+        };
+
+        SparseMatrixCSR();
+
+        ~SparseMatrixCSR();
+
+        /** Set the size of the matrix (all values are removed). */
+        void SetSize(IndexType rows, IndexType cols);
+
+        /** Number of rows. */
+        IndexType Rows() const { return m_NumberOfRows; }
+
+        /** Number of columns. */
+        IndexType Cols() const { return m_NumberOfColumns; }
+
+        /** Number of stored values. */
+        IndexType GetNumberOfNonZeros() const { return m_NumberOfNonZeros; }
+
+        /**
+         * @brief Fill the matrix from row blocks (rows that do not belong to any block are empty).
+         * The blocks must not overlap. They are emptied by this method.
+         */
+        void SetRowBlocks(std::vector< RowBlock > & blocks);
+
+        /** Divide each row by the sum of its values. */
+        void NormalizeRows();
+
+        /** Sum of the values of a row. */
+        double SumRow(IndexType row) const;
+
+        /** Compute the transposed matrix used by TransposeMult. Must be called again if the matrix is modified. */
+        void ComputeTranspose();
+
+        /** Return true if the transposed matrix is up to date. */
+        bool IsTransposeComputed() const { return m_IsTransposeComputed; }
+
+        /** Value at the position (row, column) (0 if not stored). */
+        ValueType operator()(IndexType row, IndexType column) const;
+
+        /** Compute y = H.x */
+        template < class TVectorValue >
+        void Mult(const vnl_vector< TVectorValue > & x, vnl_vector< TVectorValue > & y) const;
+
+        /** Compute x = Ht.y */
+        template < class TVectorValue >
+        void TransposeMult(const vnl_vector< TVectorValue > & y, vnl_vector< TVectorValue > & x) const;
+
+        /** Copy the matrix into a vnl sparse matrix (for vnl algorithms such as vnl_sparse_lu). */
+        template < class TVnlValue >
+        void GetVnlSparseMatrix(vnl_sparse_matrix< TVnlValue > & matrix) const;
+
+        /** Remove all values and free memory. */
+        void Clear();
+
+        /**
+         * @brief Write the matrix (and its transpose if computed) to a binary stream.
+         * The stream position must be a multiple of 8 bytes (arrays are aligned on 8 bytes).
+         */
+        void Write(std::ostream & os) const;
+
+        /**
+         * @brief Map a matrix written by Write in memory.
+         * The values are not read: pages of the file are loaded when they are used, and modifications
+         * are not written back to the file. Not available on Windows.
+         * @param fileName File containing the matrix.
+         * @param offset Position of the matrix in the file (multiple of 8 bytes).
+         * @return false if the file can not be mapped or does not contain a matrix.
+         */
+        bool MapFile(const std::string & fileName, unsigned long offset);
+
+        /** Return true if the values are mapped from a file. */
+        bool IsMapped() const { return m_MappedFile != NULL; }
+
+    private:
+
+        /** Copy is not allowed (the arrays may be mapped from a file). */
+        SparseMatrixCSR(const Self &);
+        void operator=(const Self &);
+
+        /** Compute output = M.input where M is stored in compressed rows (rowPointers, columns, values). */
+        template < class TVectorValue >
+        static void CompressedMult(IndexType numberOfRows, const IndexType * rowPointers, const IndexType * columns,
+                                   const ValueType * values, const TVectorValue * input, TVectorValue * output);
+
+        /** Point the data arrays to the std::vector storage. */
+        void UpdateDataPointers();
+
+        /** Unmap the file (if any). */
+        void ReleaseMappedFile();
+
+        IndexType                  m_NumberOfRows;
+        IndexType                  m_NumberOfColumns;
+        IndexType                  m_NumberOfNonZeros;
+        bool                       m_IsTransposeComputed;
+
+        /** Storage of the matrix built in memory */
+        std::vector< IndexType >   m_RowPointers;
+        std::vector< IndexType >   m_Columns;
+        std::vector< ValueType >   m_Values;
+        std::vector< IndexType >   m_TransposeRowPointers;
+        std::vector< IndexType >   m_TransposeColumns;
+        std::vector< ValueType >   m_TransposeValues;
+
+        /** Arrays used by all computations (std::vector storage or mapped file) */
+        IndexType *                m_RowPointersData;
+        IndexType *                m_ColumnsData;
+        ValueType *                m_ValuesData;
+        IndexType *                m_TransposeRowPointersData;
+        IndexType *                m_TransposeColumnsData;
+        ValueType *                m_TransposeValuesData;
+
+        void *                     m_MappedFile;
+        unsigned long              m_MappedFileSize;
+};
+}
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "btkSparseMatrixCSR.txx"
+#endif
+
+#endif // BTKSPARSEMATRIXCSR_H
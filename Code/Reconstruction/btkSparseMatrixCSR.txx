@@ -0,0 +1,569 @@
+/*==========================================================================
+
+  © Université de Strasbourg - Centre National de la Recherche Scientifique
+
+  Date: 18/10/2026
+  Author(s): agent (agent@local)
+
+  This software is governed by the CeCILL-B license under French law and
+  abiding by the rules of distribution of free software.  You can  use,
+  modify and/ or redistribute the software under the terms of the CeCILL-B
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and  rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty  and the software's author,  the holder of the
+  economic rights,  and the successive licensors  have only  limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading,  using,  modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean  that it is complicated to manipulate,  and  that  also
+  therefore means  that it is reserved for developers  and  experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and,  more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL-B license and that you accept its terms.
+
+==========================================================================*/
+
+#include "btkSparseMatrixCSR.hxx"
+
+#include "algorithm"
+#include "sstream"
+#include "limits.h"
+#include "assert.h"
+
+#if !defined(_WIN32)
+#include "fcntl.h"
+#include "unistd.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+#endif
+
+namespace btk
+{
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+SparseMatrixCSR< TValue >::RowBlock::RowBlock():m_FirstRow(0),m_NumberOfRows(0),m_CurrentRow(0)
+{
+
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+void SparseMatrixCSR< TValue >::RowBlock::Initialize(IndexType firstRow, IndexType numberOfRows)
+{
+    m_FirstRow     = firstRow;
+    m_NumberOfRows = numberOfRows;
+    m_CurrentRow   = firstRow;
+
+    m_RowSizes.assign(numberOfRows, 0);
+    m_Columns.clear();
+    m_Values.clear();
+    m_CurrentEntries.clear();
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+void SparseMatrixCSR< TValue >::RowBlock::Add(IndexType row, IndexType column, ValueType value)
+{
+    assert(row >= m_CurrentRow && row < m_FirstRow + m_NumberOfRows);
+
+    if(row != m_CurrentRow)
+    {
+        this->FlushCurrentRow();
+        m_CurrentRow = row;
+    }
+
+    m_CurrentEntries.push_back(std::make_pair(column, static_cast< double >(value)));
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+void SparseMatrixCSR< TValue >::RowBlock::Finish()
+{
+    this->FlushCurrentRow();
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+void SparseMatrixCSR< TValue >::RowBlock::FlushCurrentRow()
+{
+    if(m_CurrentEntries.empty())
+    {
+        return;
+    }
+
+    std::sort(m_CurrentEntries.begin(), m_CurrentEntries.end());
+
+    IndexType rowSize = 0;
+    unsigned int i = 0;
+    while(i < m_CurrentEntries.size())
+    {
+        IndexType column = m_CurrentEntries[i].first;
+        double    value  = 0.0;
+
+        for( ; i < m_CurrentEntries.size() && m_CurrentEntries[i].first == column; i++)
+        {
+            value += m_CurrentEntries[i].second;
+        }
+
+        m_Columns.push_back(column);
+        m_Values.push_back(static_cast< ValueType >(value));
+        rowSize++;
+    }
+
+    m_RowSizes[m_CurrentRow - m_FirstRow] = rowSize;
+    m_CurrentEntries.clear();
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+SparseMatrixCSR< TValue >::SparseMatrixCSR():m_NumberOfRows(0),m_NumberOfColumns(0),m_NumberOfNonZeros(0),m_IsTransposeComputed(false),
+    m_MappedFile(NULL),m_MappedFileSize(0)
+{
+    m_RowPointers.assign(1, 0);
+    this->UpdateDataPointers();
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+SparseMatrixCSR< TValue >::~SparseMatrixCSR()
+{
+    this->ReleaseMappedFile();
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+void SparseMatrixCSR< TValue >::UpdateDataPointers()
+{
+    m_RowPointersData = m_RowPointers.empty() ? NULL : &m_RowPointers[0];
+    m_ColumnsData     = m_Columns.empty() ? NULL : &m_Columns[0];
+    m_ValuesData      = m_Values.empty() ? NULL : &m_Values[0];
+
+    m_TransposeRowPointersData = m_TransposeRowPointers.empty() ? NULL : &m_TransposeRowPointers[0];
+    m_TransposeColumnsData     = m_TransposeColumns.empty() ? NULL : &m_TransposeColumns[0];
+    m_TransposeValuesData      = m_TransposeValues.empty() ? NULL : &m_TransposeValues[0];
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+void SparseMatrixCSR< TValue >::ReleaseMappedFile()
+{
+    if(m_MappedFile != NULL)
+    {
+#if !defined(_WIN32)
+        munmap(m_MappedFile, m_MappedFileSize);
+#endif
+        m_MappedFile     = NULL;
+        m_MappedFileSize = 0;
+    }
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+void SparseMatrixCSR< TValue >::SetSize(IndexType rows, IndexType cols)
+{
+    this->Clear();
+
+    m_NumberOfRows    = rows;
+    m_NumberOfColumns = cols;
+    m_RowPointers.assign(rows + 1, 0);
+    this->UpdateDataPointers();
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+void SparseMatrixCSR< TValue >::SetRowBlocks(std::vector< RowBlock > & blocks)
+{
+    const long numberOfBlocks = blocks.size();
+    long b;
+
+    // The matrix is built in memory, the mapped file (if any) is not used anymore
+    this->ReleaseMappedFile();
+
+    // Size of each row
+    m_RowPointers.assign(m_NumberOfRows + 1, 0);
+
+    for(b = 0; b < numberOfBlocks; b++)
+    {
+        assert(blocks[b].m_FirstRow + blocks[b].m_NumberOfRows <= m_NumberOfRows);
+        std::copy(blocks[b].m_RowSizes.begin(), blocks[b].m_RowSizes.end(), m_RowPointers.begin() + blocks[b].m_FirstRow + 1);
+    }
+
+    // Cumulative sum (row pointers)
+    unsigned long numberOfNonZeros = 0;
+    for(unsigned int i = 0; i < m_NumberOfRows; i++)
+    {
+        numberOfNonZeros += m_RowPointers[i+1];
+
+        if(numberOfNonZeros > UINT_MAX)
+        {
+            btkException("SparseMatrixCSR: too many non-zero values for 32 bits indices !");
+        }
+
+        m_RowPointers[i+1] = numberOfNonZeros;
+    }
+
+    m_NumberOfNonZeros = numberOfNonZeros;
+    m_Columns.resize(numberOfNonZeros);
+    m_Values.resize(numberOfNonZeros);
+
+    // Copy of the values (each block is copied at its own place)
+    #pragma omp parallel for private(b) schedule(dynamic)
+    for(b = 0; b < numberOfBlocks; b++)
+    {
+        RowBlock & block = blocks[b];
+        IndexType  start = m_RowPointers[block.m_FirstRow];
+
+        std::copy(block.m_Columns.begin(), block.m_Columns.end(), m_Columns.begin() + start);
+        std::copy(block.m_Values.begin(), block.m_Values.end(), m_Values.begin() + start);
+
+        // free memory of the block
+        std::vector< IndexType >().swap(block.m_RowSizes);
+        std::vector< IndexType >().swap(block.m_Columns);
+        std::vector< ValueType >().swap(block.m_Values);
+    }
+
+    m_IsTransposeComputed = false;
+    std::vector< IndexType >().swap(m_TransposeRowPointers);
+    std::vector< IndexType >().swap(m_TransposeColumns);
+    std::vector< ValueType >().swap(m_TransposeValues);
+
+    this->UpdateDataPointers();
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+void SparseMatrixCSR< TValue >::NormalizeRows()
+{
+    const long numberOfRows = m_NumberOfRows;
+    long i;
+
+    #pragma omp parallel for private(i) schedule(dynamic,1024)
+    for(i = 0; i < numberOfRows; i++)
+    {
+        double sum = this->SumRow(i);
+
+        if(sum != 0.0)
+        {
+            for(IndexType k = m_RowPointersData[i]; k < m_RowPointersData[i+1]; k++)
+            {
+                m_ValuesData[k] = m_ValuesData[k] / sum;
+            }
+        }
+    }
+
+    m_IsTransposeComputed = false;
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+double SparseMatrixCSR< TValue >::SumRow(IndexType row) const
+{
+    double sum = 0.0;
+
+    for(IndexType k = m_RowPointersData[row]; k < m_RowPointersData[row+1]; k++)
+    {
+        sum += m_ValuesData[k];
+    }
+
+    return sum;
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+void SparseMatrixCSR< TValue >::ComputeTranspose()
+{
+    const IndexType numberOfNonZeros = m_NumberOfNonZeros;
+
+    m_TransposeRowPointers.assign(m_NumberOfColumns + 1, 0);
+    m_TransposeColumns.resize(numberOfNonZeros);
+    m_TransposeValues.resize(numberOfNonZeros);
+
+    // Number of values in each column
+    for(IndexType k = 0; k < numberOfNonZeros; k++)
+    {
+        m_TransposeRowPointers[m_ColumnsData[k] + 1]++;
+    }
+
+    for(IndexType j = 0; j < m_NumberOfColumns; j++)
+    {
+        m_TransposeRowPointers[j+1] += m_TransposeRowPointers[j];
+    }
+
+    // Rows are visited in increasing order, so row indices are sorted in each column
+    std::vector< IndexType > position(m_TransposeRowPointers.begin(), m_TransposeRowPointers.end() - 1);
+
+    for(IndexType i = 0; i < m_NumberOfRows; i++)
+    {
+        for(IndexType k = m_RowPointersData[i]; k < m_RowPointersData[i+1]; k++)
+        {
+            IndexType p = position[m_ColumnsData[k]]++;
+            m_TransposeColumns[p] = i;
+            m_TransposeValues[p]  = m_ValuesData[k];
+        }
+    }
+
+    // The matrix itself may be mapped from a file, only the transpose pointers are updated
+    m_TransposeRowPointersData = &m_TransposeRowPointers[0];
+    m_TransposeColumnsData     = m_TransposeColumns.empty() ? NULL : &m_TransposeColumns[0];
+    m_TransposeValuesData      = m_TransposeValues.empty() ? NULL : &m_TransposeValues[0];
+
+    m_IsTransposeComputed = true;
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+typename SparseMatrixCSR< TValue >::ValueType
+SparseMatrixCSR< TValue >::operator()(IndexType row, IndexType column) const
+{
+    const IndexType * first = m_ColumnsData + m_RowPointersData[row];
+    const IndexType * last  = m_ColumnsData + m_RowPointersData[row+1];
+    const IndexType * it    = std::lower_bound(first, last, column);
+
+    if(it != last && *it == column)
+    {
+        return m_ValuesData[it - m_ColumnsData];
+    }
+
+    return 0;
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+template < class TVectorValue >
+void SparseMatrixCSR< TValue >::CompressedMult(IndexType numberOfRows, const IndexType * rowPointers, const IndexType * columns,
+                                               const ValueType * values, const TVectorValue * input, TVectorValue * output)
+{
+    const long n = numberOfRows;
+    long i;
+
+    #pragma omp parallel for private(i) schedule(dynamic,1024)
+    for(i = 0; i < n; i++)
+    {
+        double sum = 0.0;
+
+        for(IndexType k = rowPointers[i]; k < rowPointers[i+1]; k++)
+        {
+            sum += values[k] * input[columns[k]];
+        }
+
+        output[i] = sum;
+    }
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+template < class TVectorValue >
+void SparseMatrixCSR< TValue >::Mult(const vnl_vector< TVectorValue > & x, vnl_vector< TVectorValue > & y) const
+{
+    assert(x.size() == m_NumberOfColumns);
+
+    y.set_size(m_NumberOfRows);
+    Self::CompressedMult(m_NumberOfRows, m_RowPointersData, m_ColumnsData, m_ValuesData, x.data_block(), y.data_block());
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+template < class TVectorValue >
+void SparseMatrixCSR< TValue >::TransposeMult(const vnl_vector< TVectorValue > & y, vnl_vector< TVectorValue > & x) const
+{
+    assert(y.size() == m_NumberOfRows);
+
+    x.set_size(m_NumberOfColumns);
+
+    if(m_IsTransposeComputed)
+    {
+        Self::CompressedMult(m_NumberOfColumns, m_TransposeRowPointersData, m_TransposeColumnsData, m_TransposeValuesData,
+                             y.data_block(), x.data_block());
+    }
+    else
+    {
+        // Without the transposed matrix, the values of x are scattered (single thread)
+        x.fill(0);
+        for(IndexType i = 0; i < m_NumberOfRows; i++)
+        {
+            for(IndexType k = m_RowPointersData[i]; k < m_RowPointersData[i+1]; k++)
+            {
+                x[m_ColumnsData[k]] += m_ValuesData[k] * y[i];
+            }
+        }
+    }
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+template < class TVnlValue >
+void SparseMatrixCSR< TValue >::GetVnlSparseMatrix(vnl_sparse_matrix< TVnlValue > & matrix) const
+{
+    matrix.set_size(m_NumberOfRows, m_NumberOfColumns);
+
+    for(IndexType i = 0; i < m_NumberOfRows; i++)
+    {
+        if(m_RowPointersData[i] == m_RowPointersData[i+1])
+        {
+            continue;
+        }
+
+        std::vector< int >       cols(m_ColumnsData + m_RowPointersData[i], m_ColumnsData + m_RowPointersData[i+1]);
+        std::vector< TVnlValue > vals(m_ValuesData + m_RowPointersData[i], m_ValuesData + m_RowPointersData[i+1]);
+
+        matrix.set_row(i, cols, vals);
+    }
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+void SparseMatrixCSR< TValue >::Clear()
+{
+    this->ReleaseMappedFile();
+
+    m_NumberOfRows     = 0;
+    m_NumberOfColumns  = 0;
+    m_NumberOfNonZeros = 0;
+
+    std::vector< IndexType >(1, 0).swap(m_RowPointers);
+    std::vector< IndexType >().swap(m_Columns);
+    std::vector< ValueType >().swap(m_Values);
+
+    m_IsTransposeComputed = false;
+    std::vector< IndexType >().swap(m_TransposeRowPointers);
+    std::vector< IndexType >().swap(m_TransposeColumns);
+    std::vector< ValueType >().swap(m_TransposeValues);
+
+    this->UpdateDataPointers();
+}
+//-------------------------------------------------------------------------------------------------
+// File layout (all arrays start on a multiple of 8 bytes) :
+// "BTKCSR01", rows, cols, nnz, transpose flag, sizeof(value), 0 (unsigned int)
+// row pointers (rows+1), columns (nnz), values (nnz)
+// if transposed : row pointers (cols+1), columns (nnz), values (nnz)
+//-------------------------------------------------------------------------------------------------
+static const char         SparseMatrixCSRMagic[8]     = { 'B', 'T', 'K', 'C', 'S', 'R', '0', '1' };
+static const unsigned int SparseMatrixCSRHeaderLength = 6;
+
+inline unsigned long SparseMatrixCSRAlignedSize(unsigned long bytes)
+{
+    return (bytes + 7) & ~7UL;
+}
+
+inline void SparseMatrixCSRWriteArray(std::ostream & os, const void * data, unsigned long bytes)
+{
+    static const char zeros[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+
+    if(bytes > 0)
+    {
+        os.write(static_cast< const char * >(data), bytes);
+    }
+    os.write(zeros, SparseMatrixCSRAlignedSize(bytes) - bytes);
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+void SparseMatrixCSR< TValue >::Write(std::ostream & os) const
+{
+    const unsigned long nnz = m_NumberOfNonZeros;
+
+    IndexType header[SparseMatrixCSRHeaderLength] = { m_NumberOfRows, m_NumberOfColumns, m_NumberOfNonZeros,
+                                                      m_IsTransposeComputed ? 1u : 0u, sizeof(ValueType), 0 };
+
+    os.write(SparseMatrixCSRMagic, sizeof(SparseMatrixCSRMagic));
+    os.write(reinterpret_cast< const char * >(header), sizeof(header));
+
+    SparseMatrixCSRWriteArray(os, m_RowPointersData, (m_NumberOfRows + 1UL) * sizeof(IndexType));
+    SparseMatrixCSRWriteArray(os, m_ColumnsData, nnz * sizeof(IndexType));
+    SparseMatrixCSRWriteArray(os, m_ValuesData, nnz * sizeof(ValueType));
+
+    if(m_IsTransposeComputed)
+    {
+        SparseMatrixCSRWriteArray(os, m_TransposeRowPointersData, (m_NumberOfColumns + 1UL) * sizeof(IndexType));
+        SparseMatrixCSRWriteArray(os, m_TransposeColumnsData, nnz * sizeof(IndexType));
+        SparseMatrixCSRWriteArray(os, m_TransposeValuesData, nnz * sizeof(ValueType));
+    }
+}
+//-------------------------------------------------------------------------------------------------
+template < class TValue >
+bool SparseMatrixCSR< TValue >::MapFile(const std::string & fileName, unsigned long offset)
+{
+    this->Clear();
+
+#if defined(_WIN32)
+    (void)fileName;
+    (void)offset;
+    return false;
+#else
+    int file = open(fileName.c_str(), O_RDONLY);
+    if(file < 0)
+    {
+        return false;
+    }
+
+    struct stat fileStatus;
+    if(fstat(file, &fileStatus) != 0)
+    {
+        close(file);
+        return false;
+    }
+
+    const unsigned long fileSize   = fileStatus.st_size;
+    const unsigned long headerSize = sizeof(SparseMatrixCSRMagic) + SparseMatrixCSRHeaderLength * sizeof(IndexType);
+
+    if(offset % 8 != 0 || fileSize < offset + headerSize)
+    {
+        close(file);
+        return false;
+    }
+
+    // Private mapping : the values can be modified (e.g. NormalizeRows) without changing the file
+    void * mapped = mmap(NULL, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    close(file);
+
+    if(mapped == MAP_FAILED)
+    {
+        return false;
+    }
+
+    char *            data   = static_cast< char * >(mapped) + offset;
+    const IndexType * header = reinterpret_cast< const IndexType * >(data + sizeof(SparseMatrixCSRMagic));
+
+    const IndexType     rows       = header[0];
+    const IndexType     cols       = header[1];
+    const unsigned long nnz        = header[2];
+    const bool          transposed = (header[3] != 0);
+
+    unsigned long requiredSize = headerSize
+                               + SparseMatrixCSRAlignedSize((rows + 1UL) * sizeof(IndexType))
+                               + SparseMatrixCSRAlignedSize(nnz * sizeof(IndexType))
+                               + SparseMatrixCSRAlignedSize(nnz * sizeof(ValueType));
+    if(transposed)
+    {
+        requiredSize += SparseMatrixCSRAlignedSize((cols + 1UL) * sizeof(IndexType))
+                      + SparseMatrixCSRAlignedSize(nnz * sizeof(IndexType))
+                      + SparseMatrixCSRAlignedSize(nnz * sizeof(ValueType));
+    }
+
+    if(!std::equal(SparseMatrixCSRMagic, SparseMatrixCSRMagic + sizeof(SparseMatrixCSRMagic), data)
+       || header[4] != sizeof(ValueType) || fileSize < offset + requiredSize)
+    {
+        munmap(mapped, fileSize);
+        return false;
+    }
+
+    m_MappedFile       = mapped;
+    m_MappedFileSize   = fileSize;
+    m_NumberOfRows     = rows;
+    m_NumberOfColumns  = cols;
+    m_NumberOfNonZeros = nnz;
+
+    data += headerSize;
+    m_RowPointersData = reinterpret_cast< IndexType * >(data);
+    data += SparseMatrixCSRAlignedSize((rows + 1UL) * sizeof(IndexType));
+    m_ColumnsData = reinterpret_cast< IndexType * >(data);
+    data += SparseMatrixCSRAlignedSize(nnz * sizeof(IndexType));
+    m_ValuesData = reinterpret_cast< ValueType * >(data);
+    data += SparseMatrixCSRAlignedSize(nnz * sizeof(ValueType));
+
+    if(transposed)
+    {
+        m_TransposeRowPointersData = reinterpret_cast< IndexType * >(data);
+        data += SparseMatrixCSRAlignedSize((cols + 1UL) * sizeof(IndexType));
+        m_TransposeColumnsData = reinterpret_cast< IndexType * >(data);
+        data += SparseMatrixCSRAlignedSize(nnz * sizeof(IndexType));
+        m_TransposeValuesData = reinterpret_cast< ValueType * >(data);
+    }
+
+    m_IsTransposeComputed = transposed;
+
+    return true;
+#endif
+}
+//-------------------------------------------------------------------------------------------------
+}
@@ -41,6 +41,7 @@
 #include "vnl/vnl_sparse_matrix.h"
 
 #include "btkMacro.h"
+#include "btkSparseMatrixCSR.hxx"
 
 namespace btk
 {
@@ -59,10 +60,20 @@ class SuperResolutionCostFunction: public itk::Object
 
         typedef TImage   ImageType;
 
+        typedef btk::SparseMatrixCSR< PrecisionType >   SparseMatrixType;
+
         double GetValue(const vnl_vector< double >& _x);
 
         void GetGradient(const vnl_vector< double >& _x, vnl_vector< double >& _g);
 
+        /**
+         * @brief Compute the value and the gradient of the cost function at once.
+         * Hx and the regularization are computed only once for both, and the last evaluated
+         * point is kept, so calling GetValue, GetGradient or GetValueAndGradient again with
+         * the same x does not compute anything.
+         */
+        void GetValueAndGradient(const vnl_vector< double >& _x, double & _value, vnl_vector< double >& _g);
+
 
         itkNewMacro(Self);
 
@@ -70,17 +81,38 @@ class SuperResolutionCostFunction: public itk::Object
         itkTypeMacro(btk::SuperResolutionCostFunction, itk::Object);
 
 
-        btkSetMacro(H,vnl_sparse_matrix< PrecisionType >&);
+        /** Set H. The matrix is not copied, it must exist as long as the cost function is used. */
+        void SetH(const SparseMatrixType & _H)
+        {
+            m_H = &_H;
+            this->ResetCache();
+        }
 
-        btkSetMacro(HtY,vnl_vector< PrecisionType >&);
+        void SetHtY(vnl_vector< PrecisionType >& _HtY)
+        {
+            m_HtY = _HtY;
+            this->ResetCache();
+        }
 
-        btkSetMacro(Y,vnl_vector< PrecisionType >&);
+        void SetY(vnl_vector< PrecisionType >& _Y)
+        {
+            m_Y = _Y;
+            this->ResetCache();
+        }
 
-        btkSetMacro(Lambda, PrecisionType);
+        void SetLambda(PrecisionType _Lambda)
+        {
+            m_Lambda = _Lambda;
+            this->ResetCache();
+        }
 
         btkSetMacro(NumberOfParameters,unsigned int);
 
-        btkSetMacro(SRSize, typename ImageType::SizeType);
+        void SetSRSize(typename ImageType::SizeType _SRSize)
+        {
+            m_SRSize = _SRSize;
+            this->ResetCache();
+        }
 
 
         struct IMG_SIZE
@@ -97,6 +129,20 @@ class SuperResolutionCostFunction: public itk::Object
 
     private:
 
+        /** Compute Hx for the parameters x (nothing is done if x is the last evaluated point). */
+        void UpdateHx(const vnl_vector< double >& _x);
+
+        /** Regularization term (sum of the Charbonnier penalties of the derivatives along x, y and z) computed in a single pass. */
+        double ComputeRegularization(const vnl_vector< PrecisionType >& _x);
+
+        /** Forget the last evaluated point. */
+        void ResetCache()
+        {
+            m_IsHxComputed       = false;
+            m_IsValueComputed    = false;
+            m_IsGradientComputed = false;
+        }
+
         void
         Set(PrecisionType * _array, int _size, PrecisionType _value)
         {
@@ -183,7 +229,7 @@ class SuperResolutionCostFunction: public itk::Object
 
     private:
 
-        vnl_sparse_matrix< PrecisionType > m_H;
+        const SparseMatrixType * m_H;
 
         vnl_vector< PrecisionType > m_HtY;
 
@@ -197,6 +243,17 @@ class SuperResolutionCostFunction: public itk::Object
 
         typename ImageType::SizeType    m_SRSize;
 
+        /** Last evaluated point and the corresponding Hx, value and gradient */
+        vnl_vector< double >            m_LastX;
+        vnl_vector< PrecisionType >     m_LastXFloat;
+        vnl_vector< PrecisionType >     m_Hx;
+        double                          m_LastValue;
+        vnl_vector< double >            m_LastGradient;
+
+        bool                            m_IsHxComputed;
+        bool                            m_IsValueComputed;
+        bool                            m_IsGradientComputed;
+
 };
 }
 
@@ -38,151 +38,138 @@
 namespace btk
 {
 template< class TImage >
-SuperResolutionCostFunction< TImage >::SuperResolutionCostFunction()
+SuperResolutionCostFunction< TImage >::SuperResolutionCostFunction():m_H(NULL),m_LastValue(0.0)
 {
+    this->ResetCache();
 }
 //-------------------------------------------------------------------------------------------------
 template < class TImage >
-double SuperResolutionCostFunction< TImage >::
-GetValue(const vnl_vector<double> &_x)
+void SuperResolutionCostFunction< TImage >::
+UpdateHx(const vnl_vector<double> &_x)
 {
-    // Calculate the error with respect to the low resolution images
-
-    vnl_vector<PrecisionType>  x_float;
-    x_float = vnl_matops::d2f(_x);
-
-    vnl_vector<PrecisionType> Hx;
-    this->m_H.mult(x_float,Hx);
-
-    m_X_Size.width = m_SRSize[0];
-    m_X_Size.height = m_SRSize[1];
-    m_X_Size.depth = m_SRSize[2];
-
-//    vnl_vector<PrecisionType> Hx;
-//    this->m_H.mult(_x,Hx);
-
-    //vnl_vector<float> HxMinusY;
-    vnl_vector<PrecisionType> HxMinusY;
-    HxMinusY = Hx - this->m_Y;
-    //HxMinusY = Y - Hx;
-
-    Hx.clear();
-
-    double mse = HxMinusY.squared_magnitude()/ HxMinusY.size();
-    //double mse = HxMinusY.magnitude()/ HxMinusY.size();
-    //double mse = HxMinusY.two_norm()/ HxMinusY.size();
-    //double mse = HxMinusY.one_norm()/ HxMinusY.size();
-    //double mse = HxMinusY.rms()/ HxMinusY.size();
-
-    HxMinusY.clear();
-
-    // Calculate the square of 1st derivatives along x, y, and z
-    double reg = 0.0;
-    double regCH = 0.0;
-
-    //float* kernel = new float[2];
-    PrecisionType* kernel = new PrecisionType[2];
-    kernel[0] = -1; kernel[1] = 1;
-
-
-    vnl_vector<float> DxX;
-    DxX.set_size( x_float.size() );
-
-/*    vnl_vector<PrecisionType> DxX;
-    DxX.set_size( _x.size() )*/;
-
-    Convol3dx(x_float, DxX, m_X_Size, kernel, 2);
-    //Convol3dx(_x, DxX, m_X_Size, kernel, 2);
-
-       //for(unsigned int i=0; i<x_float.size(); i++)
-    for(unsigned int i=0; i<_x.size(); i++)
+    if(m_IsHxComputed && _x == m_LastX)
     {
-        //reg += DxX[i]*DxX[i] / x_float.size();
-        reg += DxX[i]*DxX[i] / _x.size();
-        regCH += 2* sqrt(1 + (DxX[i]*DxX[i]/ _x.size()))-2;
+        return;
     }
-    DxX.clear();
 
-    vnl_vector<float> DyX;
-    DyX.set_size( x_float.size() );
+    m_LastX = _x;
+    m_LastXFloat = vnl_matops::d2f(_x);
 
-//    vnl_vector<PrecisionType> DyX;
-//    DyX.set_size( _x.size() );
+    this->m_H->Mult(m_LastXFloat,m_Hx);
 
-    Convol3dy(x_float, DyX, m_X_Size, kernel, 2);
-    //Convol3dy(_x, DyX, m_X_Size, kernel, 2);
-    //for(unsigned int i=0; i<x_float.size(); i++)
-    for(unsigned int i=0; i<_x.size(); i++)
+    m_IsHxComputed       = true;
+    m_IsValueComputed    = false;
+    m_IsGradientComputed = false;
+}
+//-------------------------------------------------------------------------------------------------
+template < class TImage >
+double SuperResolutionCostFunction< TImage >::
+GetValue(const vnl_vector<double> &_x)
+{
+    this->UpdateHx(_x);
+
+    if(m_IsValueComputed)
     {
-        //reg += DyX[i]*DyX[i] / x_float.size();
-        reg += DyX[i]*DyX[i] / _x.size();
-        regCH += 2 * sqrt(1 + (DyX[i]*DyX[i]/ _x.size())) -2;
+        return m_LastValue;
     }
-    DyX.clear();
-
-    vnl_vector<float> DzX;
-    DzX.set_size( x_float.size() );
 
-//    vnl_vector<PrecisionType> DzX;
-//    DzX.set_size( _x.size() );
+    // Calculate the error with respect to the low resolution images
+    double mse = 0.0;
+    const long numberOfRows = m_Hx.size();
+    long i;
 
-    Convol3dz(x_float, DzX, m_X_Size, kernel, 2);
-    //Convol3dz(_x, DzX, m_X_Size, kernel, 2);
-    //for(unsigned int i=0; i<x_float.size(); i++)
-    for(unsigned int i=0; i<_x.size(); i++)
+    #pragma omp parallel for private(i) reduction(+:mse) schedule(static)
+    for(i = 0; i < numberOfRows; i++)
     {
-        //reg += DzX[i]*DzX[i] / x_float.size();
-        reg += DzX[i]*DzX[i] / _x.size();
-        regCH += 2 * sqrt(1 + (DzX[i]*DzX[i]/ _x.size())) -2;
+        double HxMinusY = m_Hx[i] - m_Y[i];
+        mse += HxMinusY * HxMinusY;
     }
-    DzX.clear();
+    mse = mse / numberOfRows;
 
-    delete[] kernel;
+    // Calculate the regularization (derivatives along x, y, and z)
+    double regCH = this->ComputeRegularization(m_LastXFloat);
 
     // Calculate the cost function by combining both terms
-    //std::cout<<"Reg : "<<reg<<", CH reg : "<<regCH<<std::endl;
-
-    double value = mse + m_Lambda*regCH;
+    //std::cout<<"CH reg : "<<regCH<<std::endl;
 
-    //std::cout << "error, mse, reg = " << value << " , " << mse << " , " <<reg<<" , "<< m_Lambda*reg << std::endl;
+    m_LastValue = mse + m_Lambda*regCH;
+    m_IsValueComputed = true;
 
-    return value;
+    return m_LastValue;
 }
 //-------------------------------------------------------------------------------------------------
 template< class TImage >
 void SuperResolutionCostFunction< TImage >::
 GetGradient(const vnl_vector< double > & _x, vnl_vector< double >& _g)
 {
-    vnl_vector<float>  x_float;
-
-    x_float = vnl_matops::d2f(_x);
+    this->UpdateHx(_x);
 
-    vnl_vector<float> Hx;
-    m_H.mult(x_float,Hx);
+    if(!m_IsGradientComputed)
+    {
+        // Calculate Ht*Hx using the transposed matrix stored in m_H
+        // (each thread computes its own part of HtHx).
+        vnl_vector<PrecisionType> HtHx;
+        m_H->TransposeMult(m_Hx,HtHx);
+
+        double factor = 2.0 / m_Y.size();
+        m_LastGradient = vnl_matops::f2d( (-m_HtY + HtHx)*factor );
+        m_IsGradientComputed = true;
+    }
 
-//    vnl_vector< PrecisionType > Hx;
-//    m_H.mult(_x,Hx);
+    _g = m_LastGradient;
+}
+//-------------------------------------------------------------------------------------------------
+template< class TImage >
+void SuperResolutionCostFunction< TImage >::
+GetValueAndGradient(const vnl_vector< double > & _x, double & _value, vnl_vector< double >& _g)
+{
+    // Hx is computed once for both the value and the gradient
+    _value = this->GetValue(_x);
+    this->GetGradient(_x,_g);
+}
+//-------------------------------------------------------------------------------------------------
+template < class TImage >
+double SuperResolutionCostFunction< TImage >::
+ComputeRegularization(const vnl_vector<PrecisionType> &_x)
+{
+    // Same as convolving x with the kernel [-1 1] along each axis (see Convol3dx, Convol3dy and Convol3dz) :
+    // forward differences, mirrored on the last row, column and slice.
+    const long width  = m_SRSize[0];
+    const long height = m_SRSize[1];
+    const long depth  = m_SRSize[2];
+    const double size = _x.size();
+    const PrecisionType * x = _x.data_block();
 
+    double regCH = 0.0;
+    long k;
 
-    // Calculate Ht*Hx. Note that this is calculated as Hx*H since
-    // Ht*Hx = (Hxt*H)t and for Vnl (Hxt*H)t = Hxt*H = Hx*H because
-    // the vnl_vector doesn't have a 2nd dimension. This allows us
-    // to save a lot of memory because we don't need to store Ht.
+    #pragma omp parallel for private(k) reduction(+:regCH) schedule(static)
+    for(k = 0; k < depth; k++)
+    {
+        long dk = (k+1 < depth) ? width*height : ( (k > 0) ? -width*height : 0 );
 
-    //vnl_vector<float> HtHx;
-    vnl_vector<PrecisionType> HtHx;
-    m_H.pre_mult(Hx,HtHx);
-    Hx.clear();
+        for(long j = 0; j < height; j++)
+        {
+            long dj = (j+1 < height) ? width : ( (j > 0) ? -width : 0 );
 
-    double factor = 2.0 / m_Y.size();
-    _g = vnl_matops::f2d( (-m_HtY + HtHx)*factor );
-    //_g = (-m_HtY + HtHx)*factor ;
+            for(long i = 0; i < width; i++)
+            {
+                long di = (i+1 < width) ? 1 : ( (i > 0) ? -1 : 0 );
+                long p  = i + width * ( j + height * k );
 
+                PrecisionType DxX = x[p] - x[p + di];
+                PrecisionType DyX = x[p] - x[p + dj];
+                PrecisionType DzX = x[p] - x[p + dk];
 
+                regCH += 2 * sqrt(1 + (DxX*DxX / size)) - 2;
+                regCH += 2 * sqrt(1 + (DyX*DyX / size)) - 2;
+                regCH += 2 * sqrt(1 + (DzX*DzX / size)) - 2;
+            }
+        }
+    }
 
-    HtHx.clear();
+    return regCH;
 }
-
 //-------------------------------------------------------------------------------------------------
 template < class TImage >
 int SuperResolutionCostFunction< TImage >::Mirror(int _pos, int _size)
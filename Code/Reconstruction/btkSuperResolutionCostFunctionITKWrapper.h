@@ -92,6 +92,12 @@ class SuperResolutionCostFunctionITKWrapper: public itk::SingleValuedCostFunctio
         virtual void GetDerivative(const ParametersType & parameters,
                                    DerivativeType & derivative) const;
 
+        /** This method returns the value and the derivative of the cost function
+      * corresponding to the specified parameters (Hx is computed only once). */
+        virtual void GetValueAndDerivative(const ParametersType & parameters,
+                                           MeasureType & value,
+                                           DerivativeType & derivative) const;
+
         /** Return the number of parameters required to compute
      *  this cost function.
      *  This method MUST be overloaded by derived classes. */
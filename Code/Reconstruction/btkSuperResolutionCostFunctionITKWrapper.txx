@@ -52,11 +52,8 @@ SuperResolutionCostFunctionITKWrapper< TImage >::SuperResolutionCostFunctionITKW
 template < class TImage >
 SuperResolutionCostFunctionITKWrapper< TImage >::~SuperResolutionCostFunctionITKWrapper()
 {
-    if(m_CostFunction !=NULL)
-    {
-        delete m_CostFunction;
-        m_CostFunction = NULL;
-    }
+    // m_CostFunction is a smart pointer, it is released automatically
+    m_CostFunction = NULL;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -64,7 +61,7 @@ template< typename TImage >
 typename SuperResolutionCostFunctionITKWrapper< TImage >::MeasureType
 SuperResolutionCostFunctionITKWrapper<TImage>::GetValue(const ParametersType &parameters) const
 {
-    MeasureType cost = this->m_CostFunction->f(parameters);
+    MeasureType cost = this->m_CostFunction->GetValue(parameters);
 
     return ( cost );
 }
@@ -76,6 +73,13 @@ void SuperResolutionCostFunctionITKWrapper< TImage >::GetDerivative(const Parame
    this->m_CostFunction->GetGradient(parameters,derivative);
 }
 
+//-------------------------------------------------------------------------------------------------
+template< typename TImage >
+void SuperResolutionCostFunctionITKWrapper< TImage >::GetValueAndDerivative(const ParametersType &parameters, MeasureType &value, DerivativeType &derivative) const
+{
+   this->m_CostFunction->GetValueAndGradient(parameters,value,derivative);
+}
+
 //-------------------------------------------------------------------------------------------------
 template< typename TImage >
 unsigned int SuperResolutionCostFunctionITKWrapper< TImage >::GetNumberOfParameters() const
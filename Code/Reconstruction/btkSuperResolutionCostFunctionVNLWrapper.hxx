@@ -72,6 +72,9 @@ class SuperResolutionCostFunctionVNLWrapper : public vnl_cost_function
         /** Get Gradient */
         virtual void gradf(vnl_vector< double > const& x, vnl_vector< double >& gradient);
 
+        /** Compute the value and/or the gradient (f or g may be NULL). Hx is computed only once for both. */
+        virtual void compute(vnl_vector< double > const& x, double *f, vnl_vector< double >* g);
+
         /** Get a pointer to the btk Cost function */
         btkGetMacro(CostFunction, typename CostFunctionType::Pointer);
 
@@ -74,6 +74,25 @@ SuperResolutionCostFunctionVNLWrapper< TImage >::gradf(const vnl_vector< double
     this->m_CostFunction->GetGradient(_x,_g);
 }
 
+//-------------------------------------------------------------------------------------------------
+template < class TImage >
+void
+SuperResolutionCostFunctionVNLWrapper< TImage >::compute(const vnl_vector< double >& _x, double *_f, vnl_vector< double >* _g)
+{
+    if(_f != NULL && _g != NULL)
+    {
+        this->m_CostFunction->GetValueAndGradient(_x,*_f,*_g);
+    }
+    else if(_f != NULL)
+    {
+        *_f = this->m_CostFunction->GetValue(_x);
+    }
+    else if(_g != NULL)
+    {
+        this->m_CostFunction->GetGradient(_x,*_g);
+    }
+}
+
 //-------------------------------------------------------------------------------------------------
 
 
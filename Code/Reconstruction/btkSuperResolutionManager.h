@@ -89,8 +89,12 @@ public:
 void SuperResolutionManager::Initialize()
 {
   tool.InitializePSF(data);
-  tool.CreateMaskHRImage(data);
-  tool.HComputation(data);
+
+  //H and the HR mask are reloaded if they have been computed for the same inputs (see SetCacheDirectory)
+  if(!tool.LoadHFromCache(data)){
+    tool.CreateMaskHRImage(data);
+    tool.HComputation(data);
+  }
 }
 
 void SuperResolutionManager::SimulateLRImages()
@@ -59,6 +59,8 @@
 #include "vnl/algo/vnl_sparse_lu.h"
 
 #include "../Denoising/btkNLMTool.h"
+#include "btkSparseMatrixCSR.hxx"
+#include "btkSRHMatrixCache.h"
 
 
 #include <sstream>
@@ -91,16 +93,19 @@ public:
 
   typedef itk::LaplacianImageFilter<itkImage , itkImage >                 itkLaplacianFilter;
 
+  typedef btk::SparseMatrixCSR<float>                                     SparseMatrixType;
+
 
   int                       m_psftype; // 0: 3D interpolated boxcar, 1: 3D oversampled boxcar
   std::vector<itkPointer>   m_PSF;
   int                       m_interpolationOrderPSF;
   int                       m_interpolationOrderIBP;
-  vnl_sparse_matrix<double> m_H;
+  SparseMatrixType          m_H;
   vnl_vector<double>         m_Y;
   vnl_vector<double>         m_X;
   float                     m_paddingValue;
   std::vector<unsigned int> m_offset;
+  std::string               m_cacheDirectory; //directory of the cache files of H (no cache if empty)
   
   SuperResolutionTools(){
     m_interpolationOrderPSF = 1;  //linear interpolation for interpolated PSF
@@ -112,7 +117,11 @@ public:
   void SetPSFInterpolationOrderIBP(int & order);
   void SetPSFComputation(int & type);
   void InitializePSF(SuperResolutionDataManager & data);
+  void SetCacheDirectory(std::string & directory);
   void HComputation(SuperResolutionDataManager & data);
+  bool LoadHFromCache(SuperResolutionDataManager & data);
+  void ComputeHCacheKey(SuperResolutionDataManager & data, btk::SRHMatrixCache & cache);
+  void InitializeXY(SuperResolutionDataManager & data);
   void UpdateX(SuperResolutionDataManager & data);
   void SimulateLRImages(SuperResolutionDataManager & data);
   double IteratedBackProjection(SuperResolutionDataManager & data, int & nlm, float & beta, int & medianIBP);
@@ -144,6 +153,13 @@ void SuperResolutionTools::SetPSFComputation(int & type)
   m_psftype = type;
 }
 
+void SuperResolutionTools::SetCacheDirectory(std::string & directory)
+{
+  //H, y and the HR mask are stored in this directory, and reloaded when the inputs are the same
+  m_cacheDirectory = directory;
+  std::cout<<"Cache directory for H: "<<directory<<"\n";
+}
+
 void SuperResolutionTools::InitializePSF(SuperResolutionDataManager & data)
 {
   //Principle: We build the PSF in LR image space (simple boxcar PSF = one anisotropic voxel) which is then interpolated or oversampled in SR space
@@ -351,65 +367,32 @@ void SuperResolutionTools::HComputation(SuperResolutionDataManager & data)
   std::cout<<"Computing the matrix H (y=Hx) + fill y and x. \n";
   //Principle: for each voxel of the LR images, we compute the influence of each voxel of the PSF (centered at the current LR voxel) and add the corresponding influence value (PSF value * interpolation weight) in the matrix H
  
-  // Set size of matrices
-  unsigned int ncols = data.m_inputHRImage->GetLargestPossibleRegion().GetNumberOfPixels();
-  
-  //m_offset is used to fill correctly the vector m_Y with the input LR image values (offset for the linear index)
-  m_offset.resize(data.m_inputLRImages.size());
-  unsigned int nrows = 0;
-  for(unsigned int im = 0; im < data.m_inputLRImages.size(); im++){
-    m_offset[im] = nrows;
-    nrows += data.m_inputLRImages[im]->GetLargestPossibleRegion().GetNumberOfPixels();
-  }
-  m_H.set_size(nrows, ncols);
-  m_Y.set_size(nrows);
-  m_Y.fill(0.0);
-  m_X.set_size(ncols);
-  m_X.fill(0.0);
-  
-  //linear index : an integer value corresponding to (x,y,z) triplet coordinates (ITK index)
-  uint lrLinearIndex = 0;
-  uint hrLinearIndex = 0;
-
-  //Temporary variables
-  itkImage::IndexType lrIndex;  //index of the current voxel in the LR image
-  itkImage::PointType lrPoint;  //physical point location of lrIndex
-  itkImage::IndexType psfIndex; //index of the current voxel in the PSF
-  itkImage::PointType psfPoint; //physical point location of psfIndex
-  itkImage::PointType transformedPoint; //Physical point location after applying affine transform
-  itkContinuousIndex  hrContIndex;  //continuous index in HR image of psfPoint
-  itkImage::IndexType hrIndex;  //index in HR image of interpolated psfPoint
+  // Set size of matrices, and fill m_X
+  this->InitializeXY(data);
+  m_H.SetSize(m_Y.size(), m_X.size());
 
   //We use linear interpolation for the estimation of point influence in matrix H 
   typedef itk::BSplineInterpolationWeightFunction<double, 3, 1> itkBSplineFunction;
-  itkBSplineFunction::Pointer bsplineFunction = itkBSplineFunction::New();
-  itkBSplineFunction::WeightsType bsplineWeights;
-  bsplineWeights.SetSize(8); // (bsplineOrder + 1)^3
-  itkBSplineFunction::IndexType   bsplineStartIndex;
-  itkBSplineFunction::IndexType   bsplineEndIndex;
-  itkBSplineFunction::SizeType    bsplineSize;
-  itkImage::RegionType            bsplineRegion;
-  
+
   //Get the size of the HR image
-  itkImage::SizeType  hrSize  = data.m_inputHRImage->GetLargestPossibleRegion().GetSize();
+  itkImage::RegionType hrRegion = data.m_inputHRImage->GetLargestPossibleRegion();
+  itkImage::SizeType   hrSize   = hrRegion.GetSize();
   
-  std::cout<<"loop over LR images\n";
-  for(uint i=0; i<data.m_inputLRImages.size(); i++){
-    std::cout<<"Adding image "<<i+1<<"\n";
-    
-    //Get the size of the current LR image
-    itkImage::SizeType  lrSize  = data.m_inputLRImages[i]->GetLargestPossibleRegion().GetSize();
+  //The PSF is only translated from one LR voxel to another: for each LR image, we store the non-null PSF values
+  //and the physical position of the corresponding PSF voxels with respect to the PSF center
+  std::vector< std::vector<double> >                           psfValues(data.m_inputLRImages.size());
+  std::vector< std::vector<itkImage::PointType::VectorType> >  psfOffsets(data.m_inputLRImages.size());
 
-    //Instantiate an iterator over the current LR image
-    itkIteratorWithIndex itLRImage(data.m_inputLRImages[i],data.m_inputLRImages[i]->GetLargestPossibleRegion());
-    
-    //Instantiate an iterator over the current PSF
-    itkIteratorWithIndex itPSF(m_PSF[i],m_PSF[i]->GetLargestPossibleRegion());
+  //H is filled by blocks of rows (one block for each slice of each LR image), each block being filled by one thread
+  std::vector<uint> blockImage;
+  std::vector<uint> blockSlice;
+
+  for(uint i=0; i<data.m_inputLRImages.size(); i++){
     
     //Set the correct direction for the PSF of the current image
     m_PSF[i]->SetDirection(data.m_inputLRImages[i]->GetDirection());
     
-    //Compute temporary variables for setting the correct origin of the PSF for every voxel of the LR image 
+    //Physical point of the center of the PSF
     itkImage::SizeType psfSize = m_PSF[i]->GetLargestPossibleRegion().GetSize();
     itkContinuousIndex psfIndexCenter;
     psfIndexCenter[0] = (psfSize[0]-1)/2.0;
@@ -417,9 +400,65 @@ void SuperResolutionTools::HComputation(SuperResolutionDataManager & data)
     psfIndexCenter[2] = (psfSize[2]-1)/2.0;
     itkImage::PointType psfPointCenter;
     m_PSF[i]->TransformContinuousIndexToPhysicalPoint(psfIndexCenter,psfPointCenter);
-    itkImage::PointType psfOrigin;
 
-    //Loop over the voxels of the current LR image
+    itkIteratorWithIndex itPSF(m_PSF[i],m_PSF[i]->GetLargestPossibleRegion());
+    for(itPSF.GoToBegin(); !itPSF.IsAtEnd(); ++itPSF){
+      if(itPSF.Get() > 0){
+        itkImage::PointType psfPoint;
+        m_PSF[i]->TransformIndexToPhysicalPoint(itPSF.GetIndex(),psfPoint);
+        psfValues[i].push_back(itPSF.Get());
+        psfOffsets[i].push_back(psfPoint - psfPointCenter);
+      }
+    }
+
+    itkImage::SizeType lrSize = data.m_inputLRImages[i]->GetLargestPossibleRegion().GetSize();
+    for(uint z=0; z<lrSize[2]; z++){
+      blockImage.push_back(i);
+      blockSlice.push_back(z);
+    }
+  }
+
+  std::cout<<"loop over LR images\n";
+  std::vector< SparseMatrixType::RowBlock > blocks(blockImage.size());
+  long b;
+
+  #pragma omp parallel for private(b) schedule(dynamic)
+  for(b = 0; b < (long)blocks.size(); b++){
+
+    uint i = blockImage[b];
+    uint z = blockSlice[b];
+
+    //Get the size of the current LR image
+    itkImage::SizeType  lrSize  = data.m_inputLRImages[i]->GetLargestPossibleRegion().GetSize();
+
+    //Temporary variables
+    itkImage::IndexType lrIndex;  //index of the current voxel in the LR image
+    itkImage::PointType lrPoint;  //physical point location of lrIndex
+    itkImage::PointType psfPoint; //physical point location of the current PSF voxel
+    itkImage::PointType transformedPoint; //Physical point location after applying affine transform
+    itkContinuousIndex  hrContIndex;  //continuous index in HR image of psfPoint
+    uint lrLinearIndex = 0;
+    uint hrLinearIndex = 0;
+
+    //B-spline weight function (not shared between threads)
+    itkBSplineFunction::Pointer bsplineFunction = itkBSplineFunction::New();
+    itkBSplineFunction::WeightsType bsplineWeights;
+    bsplineWeights.SetSize(8); // (bsplineOrder + 1)^3
+    itkBSplineFunction::IndexType   bsplineStartIndex;
+    itkBSplineFunction::IndexType   bsplineEndIndex;
+    itkBSplineFunction::SizeType    bsplineSize = bsplineFunction->GetSupportSize();
+
+    //Rows of the current slice
+    blocks[b].Initialize(m_offset[i] + z*lrSize[0]*lrSize[1], lrSize[0]*lrSize[1]);
+
+    itkImage::RegionType sliceRegion = data.m_inputLRImages[i]->GetLargestPossibleRegion();
+    sliceRegion.SetIndex(2, z);
+    sliceRegion.SetSize(2, 1);
+
+    //Instantiate an iterator over the current slice of the LR image
+    itkIteratorWithIndex itLRImage(data.m_inputLRImages[i],sliceRegion);
+
+    //Loop over the voxels of the current LR slice
     for(itLRImage.GoToBegin(); !itLRImage.IsAtEnd(); ++itLRImage){
  
       //Test on padding value (speed-up and keep H as sparse as possible)
@@ -428,115 +467,168 @@ void SuperResolutionTools::HComputation(SuperResolutionDataManager & data)
         //Coordinate in the current LR image
         lrIndex = itLRImage.GetIndex();
         
-        //std::cout<<"current LR index:"<<lrIndex[0]<<" "<<lrIndex[1]<<" "<<lrIndex[2]<<" -------------- \n";
-        
         //Compute the corresponding linear index of lrIndex
         lrLinearIndex = m_offset[i] + lrIndex[0] + lrIndex[1]*lrSize[0] + lrIndex[2]*lrSize[0]*lrSize[1];
         
         //Fill m_Y
         m_Y[lrLinearIndex] = itLRImage.Get();
         
-        //Change the origin of the PSF so that itLRImage location corresponds to the center of the PSF
+        //The PSF is centered on the current LR voxel
         data.m_inputLRImages[i]->TransformIndexToPhysicalPoint(lrIndex,lrPoint);
-        psfOrigin[0] = lrPoint[0] - psfPointCenter[0];
-        psfOrigin[1] = lrPoint[1] - psfPointCenter[1];
-        psfOrigin[2] = lrPoint[2] - psfPointCenter[2];
-        m_PSF[i]->SetOrigin(psfOrigin);
-        
-        //std::cout<<"current lr point:"<<lrPoint[0]<<" "<<lrPoint[1]<<" "<<lrPoint[2]<<" \n";
-        //std::cout<<"psfSize:"<<psfSize[0]<<" "<<psfSize[1]<<" "<<psfSize[2]<<" \n";
-        //std::cout<<"psfIndexCenter:"<<psfIndexCenter[0]<<" "<<psfIndexCenter[1]<<" "<<psfIndexCenter[2]<<"\n";
-        //std::cout<<"psfPointCenter:"<<psfPointCenter[0]<<" "<<psfPointCenter[1]<<" "<<psfPointCenter[2]<<"\n";
-        //std::cout<<"psf origin:"<<psfOrigin[0]<<" "<<psfOrigin[1]<<" "<<psfOrigin[2]<<" \n";
         
-        //Loop over the m_PSF
-        for(itPSF.GoToBegin(); !itPSF.IsAtEnd(); ++itPSF){
-                  
-          if(itPSF.Get() > 0){
-            
-            //Get coordinate in m_PSF
-            psfIndex = itPSF.GetIndex();
+        //Loop over the non-null values of the PSF
+        for(uint p=0; p<psfValues[i].size(); p++){
             
-            //Compute the physical point of psfIndex
-            m_PSF[i]->TransformIndexToPhysicalPoint(psfIndex,psfPoint);
+          psfPoint = lrPoint + psfOffsets[i][p];
             
-            //Apply estimated affine transform to psfPoint (need to apply the inverse since the transform goes from the HR image to the LR image)           
-            transformedPoint = data.m_inverseAffineTransform[i]->TransformPoint(psfPoint);
+          //Apply estimated affine transform to psfPoint (need to apply the inverse since the transform goes from the HR image to the LR image)           
+          transformedPoint = data.m_inverseAffineTransform[i]->TransformPoint(psfPoint);
             
-            //Get back to the index in the HR image
-            data.m_inputHRImage->TransformPhysicalPointToContinuousIndex(transformedPoint,hrContIndex);
-            //std::cout<<"hrContIndex no check: "<<hrContIndex[0]<<" "<<hrContIndex[1]<<" "<<hrContIndex[2]<<" \n ";
+          //Get back to the index in the HR image
+          data.m_inputHRImage->TransformPhysicalPointToContinuousIndex(transformedPoint,hrContIndex);
 
-            //Check if the continuous index hrContIndex is inside the HR image
-            if (data.m_inputHRImage->GetLargestPossibleRegion().IsInside(hrContIndex)) {
+          //Check if the continuous index hrContIndex is inside the HR image
+          if (hrRegion.IsInside(hrContIndex)) {
               
-              //std::cout<<"hrContIndex: "<<hrContIndex[0]<<" "<<hrContIndex[1]<<" "<<hrContIndex[2]<<" \n ";
-              //Get the interpolation weight using itkBSplineInterpolationWeightFunction
-              bsplineFunction->Evaluate(hrContIndex,bsplineWeights,bsplineStartIndex);
-              //std::cout<<"bsplineIndex: "<<bsplineStartIndex[0]<<" "<<bsplineStartIndex[1]<<" "<<bsplineStartIndex[2]<<"\n";
+            //Get the interpolation weight using itkBSplineInterpolationWeightFunction
+            bsplineFunction->Evaluate(hrContIndex,bsplineWeights,bsplineStartIndex);
               
-              //Get the support size for interpolation
-              bsplineSize = bsplineFunction->GetSupportSize();
+            //Check if the bspline support region is inside the HR image
+            bsplineEndIndex[0] = bsplineStartIndex[0] + bsplineSize[0];
+            bsplineEndIndex[1] = bsplineStartIndex[1] + bsplineSize[1];
+            bsplineEndIndex[2] = bsplineStartIndex[2] + bsplineSize[2];
               
-              //Check if the bspline support region is inside the HR image
-              bsplineEndIndex[0] = bsplineStartIndex[0] + bsplineSize[0];
-              bsplineEndIndex[1] = bsplineStartIndex[1] + bsplineSize[1];
-              bsplineEndIndex[2] = bsplineStartIndex[2] + bsplineSize[2];
-              
-              if( (data.m_inputHRImage->GetLargestPossibleRegion().IsInside(bsplineStartIndex)) && (data.m_inputHRImage->GetLargestPossibleRegion().IsInside(bsplineEndIndex)) ){
-                
-                //Set the support region
-                bsplineRegion.SetSize(bsplineSize);
-                bsplineRegion.SetIndex(bsplineStartIndex);
-                
-                //Instantiate an iterator on HR image over the bspline region
-                itkIteratorWithIndex itHRImage(data.m_inputHRImage,bsplineRegion);
+            if( (hrRegion.IsInside(bsplineStartIndex)) && (hrRegion.IsInside(bsplineEndIndex)) ){
                 
-                //linear index of bspline weights
-                unsigned int weightLinearIndex = 0;
+              //linear index of bspline weights
+              unsigned int weightLinearIndex = 0;
                 
-                //Loop over the support region
-                for(itHRImage.GoToBegin(); !itHRImage.IsAtEnd(); ++itHRImage){
+              //Loop over the support region (x first, as itk iterators)
+              for(uint sz=0; sz<bsplineSize[2]; sz++)
+              for(uint sy=0; sy<bsplineSize[1]; sy++)
+              for(uint sx=0; sx<bsplineSize[0]; sx++){
   
-                  //Get coordinate in HR image
-                  hrIndex = itHRImage.GetIndex();
+                //Compute the linear index of the HR voxel
+                hrLinearIndex = (bsplineStartIndex[0]+sx) + (bsplineStartIndex[1]+sy)*hrSize[0] + (bsplineStartIndex[2]+sz)*hrSize[0]*hrSize[1];
                   
-                  //Compute the corresponding linear index
-                  hrLinearIndex = hrIndex[0] + hrIndex[1]*hrSize[0] + hrIndex[2]*hrSize[0]*hrSize[1];
+                //Add weight*PSFValue to the corresponding element in H
+                blocks[b].Add(lrLinearIndex, hrLinearIndex, psfValues[i][p] * bsplineWeights[weightLinearIndex]);
+                weightLinearIndex += 1;
                   
-                  //Add weight*PSFValue to the corresponding element in H
-                  m_H(lrLinearIndex,hrLinearIndex) += itPSF.Get() * bsplineWeights[weightLinearIndex];
-                  weightLinearIndex += 1;
-                  //std::cout<<"HR point:"<<hrIndex[0]<<" "<<hrIndex[1]<<" "<<hrIndex[2]<<", weight:"<<m_H(lrLinearIndex,hrLinearIndex)<<"\n";
-                  
-                } //end of loop over the support region
+              } //end of loop over the support region
                 
-              } //end of if support region inside HR image
+            } //end of if support region inside HR image
               
-            } //end of check of hrContIndex
-
-          } //end of if itPSF > 0
+          } //end of check of hrContIndex
           
         } //end of loop over PSF
         
       } //end of if on padding value
     
-    } //end of loop over voxels of LR image
+    } //end of loop over voxels of LR slice
+
+    blocks[b].Finish();
     
-  } //end of loop over the set of LR images
+  } //end of loop over the blocks (slices of LR images)
   
+  m_H.SetRowBlocks(blocks);
+
   // Normalize m_H
-  for(uint i = 0; i < m_H.rows(); i++){
-    
-    double sum = m_H.sum_row(i);
-    
-    vnl_sparse_matrix<double>::row & r = m_H.get_row(i);
-    vnl_sparse_matrix<double>::row::iterator col_iter;
-    
-    for (col_iter = r.begin(); col_iter != r.end(); ++col_iter)
-      (*col_iter).second = (*col_iter).second / sum;
+  m_H.NormalizeRows();
+
+  // Transposed H is used for Ht.y
+  m_H.ComputeTranspose();
+
+  //Store H, y and the HR mask for the next runs on the same data
+  if(m_cacheDirectory != ""){
+    btk::SRHMatrixCache cache;
+    cache.SetDirectory(m_cacheDirectory);
+    this->ComputeHCacheKey(data, cache);
+
+    std::vector< vnl_vector<float> > vectors(2);
+    vectors[0].set_size(m_Y.size());
+    for(uint i=0; i<m_Y.size(); i++)
+      vectors[0][i] = m_Y[i];
+    vectors[1].set_size(data.m_maskHRImage->GetLargestPossibleRegion().GetNumberOfPixels());
+    vectors[1].copy_in(data.m_maskHRImage->GetBufferPointer());
+    cache.Save(m_H, vectors);
   }
+}
+
+bool SuperResolutionTools::LoadHFromCache(SuperResolutionDataManager & data)
+{
+  //Replace CreateMaskHRImage and HComputation when H has already been computed for the same inputs
+  if(m_cacheDirectory == "")
+    return false;
+
+  btk::SRHMatrixCache cache;
+  cache.SetDirectory(m_cacheDirectory);
+  this->ComputeHCacheKey(data, cache);
+
+  std::vector< vnl_vector<float> > vectors;
+  if(!cache.Load(m_H, vectors))
+    return false;
+
+  this->InitializeXY(data);
+
+  uint numberOfHRVoxels = data.m_maskHRImage->GetLargestPossibleRegion().GetNumberOfPixels();
+  if( (vectors.size() != 2) || (vectors[0].size() != m_Y.size()) || (vectors[1].size() != numberOfHRVoxels)
+      || (m_H.Rows() != m_Y.size()) || (m_H.Cols() != m_X.size()) ){
+    std::cout<<"The cache file does not match the input data, H is computed.\n";
+    m_H.Clear();
+    return false;
+  }
+
+  for(uint i=0; i<m_Y.size(); i++)
+    m_Y[i] = vectors[0][i];
+  vectors[1].copy_out(data.m_maskHRImage->GetBufferPointer());
+
+  return true;
+}
+
+void SuperResolutionTools::ComputeHCacheKey(SuperResolutionDataManager & data, btk::SRHMatrixCache & cache)
+{
+  //H depends on the LR images (geometry and values, because of the padding value), the PSFs, 
+  //the transforms and the geometry of the HR image
+  cache.Reset();
+  cache.AddValue(m_paddingValue);
+  cache.AddImage(data.m_inputHRImage.GetPointer(), false);
+
+  for(uint i=0; i<data.m_inputLRImages.size(); i++){
+    cache.AddImage(data.m_inputLRImages[i].GetPointer(), true);
+    //the direction of the PSF is the one of the LR image (set in HComputation): only size, spacing and values are used
+    itkImage::SizeType psfSize = m_PSF[i]->GetLargestPossibleRegion().GetSize();
+    for(uint d=0; d<3; d++){
+      cache.AddValue((unsigned long long)psfSize[d]);
+      cache.AddValue((double)m_PSF[i]->GetSpacing()[d]);
+    }
+    cache.AddData(m_PSF[i]->GetBufferPointer(), m_PSF[i]->GetLargestPossibleRegion().GetNumberOfPixels()*sizeof(PixelType));
+    cache.AddTransform(data.m_affineTransform[i].GetPointer());
+    cache.AddTransform(data.m_inverseAffineTransform[i].GetPointer());
+  }
+}
+
+void SuperResolutionTools::InitializeXY(SuperResolutionDataManager & data)
+{
+  unsigned int ncols = data.m_inputHRImage->GetLargestPossibleRegion().GetNumberOfPixels();
   
+  //m_offset is used to fill correctly the vector m_Y with the input LR image values (offset for the linear index)
+  m_offset.resize(data.m_inputLRImages.size());
+  unsigned int nrows = 0;
+  for(unsigned int im = 0; im < data.m_inputLRImages.size(); im++){
+    m_offset[im] = nrows;
+    nrows += data.m_inputLRImages[im]->GetLargestPossibleRegion().GetNumberOfPixels();
+  }
+  m_Y.set_size(nrows);
+  m_Y.fill(0.0);
+  m_X.set_size(ncols);
+  m_X.fill(0.0);
+
+  //linear index : an integer value corresponding to (x,y,z) triplet coordinates (ITK index)
+  uint hrLinearIndex = 0;
+  itkImage::IndexType hrIndex;  //index in HR image
+  itkImage::SizeType  hrSize  = data.m_inputHRImage->GetLargestPossibleRegion().GetSize();
+
   //Fill m_X
   //Instantiate an iterator on HR image
   itkIteratorWithIndex itHRImage(data.m_inputHRImage,data.m_inputHRImage->GetLargestPossibleRegion());
@@ -570,7 +662,7 @@ void SuperResolutionTools::SimulateLRImages(SuperResolutionDataManager & data)
   
   //Compute H * x
   vnl_vector<double> Hx;
-  m_H.mult(m_X,Hx);
+  m_H.Mult(m_X,Hx);
   
   //resize the vector of simulated input LR images
   data.m_simulatedInputLRImages.resize(data.m_inputLRImages.size());
@@ -973,15 +1065,15 @@ void SuperResolutionTools::SRUsingPseudoInverse(SuperResolutionDataManager & dat
         
     }
   } 
-  std::cout<< "Taille de H : "<<m_H.rows()<<" "<<m_H.cols()<<std::endl;
+  std::cout<< "Taille de H : "<<m_H.Rows()<<" "<<m_H.Cols()<<std::endl;
   std::cout<< "Taille de D : "<<D.rows()<<" "<<D.cols()<<std::endl;
   
   
   std::ofstream myfile_H;
   myfile_H.open ("matrix_H.txt");
-  for(uint i = 0; i < m_H.rows(); i++)
+  for(uint i = 0; i < m_H.Rows(); i++)
   {
-    for(uint j = 0; j < m_H.cols(); j++)
+    for(uint j = 0; j < m_H.Cols(); j++)
     {
       myfile_H << m_H(i,j) <<" ";
     }
@@ -1009,8 +1101,10 @@ void SuperResolutionTools::SRUsingPseudoInverse(SuperResolutionDataManager & dat
   std::cout<<"Inverse sparse matrix using LU decomposition"<<std::endl;
   //inverse of sparse matrix is not supported by vnl !!
   //Use LU decomposition (which works only with double values)
+  vnl_sparse_matrix<double>  H;
+  m_H.GetVnlSparseMatrix(H);
   vnl_sparse_matrix<double>  M;
-  M = m_H.transpose()*m_H +lambda*D.transpose()*D;
+  M = H.transpose()*H +lambda*D.transpose()*D;
   
     
   vnl_sparse_matrix<double>  invM(n,n);    
@@ -1027,8 +1121,10 @@ void SuperResolutionTools::SRUsingPseudoInverse(SuperResolutionDataManager & dat
       invM(i,j)=x(j);
   }  
   
-  invM = invM * m_H.transpose();  
-  invM.mult(m_Y,m_X);
+  //inverse(M) * Ht * y is computed as inverse(M) * (Ht * y)
+  vnl_vector<double> HtY;
+  m_H.TransposeMult(m_Y,HtY);
+  invM.mult(HtY,m_X);
   
   std::cout<<"Fill the output HR image"<<std::endl;
   data.m_outputHRImage->FillBuffer(0);
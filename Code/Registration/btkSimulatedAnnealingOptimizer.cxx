@@ -41,14 +41,14 @@ namespace btk
 
 //-------------------------------------------------------------------------------------------------
 SimulatedAnnealingOptimizer::SimulatedAnnealingOptimizer()
-    :m_CurrentValue(0.0),m_Temperature(5000),m_Iteration(2000)
+    :m_CurrentValue(0.0),m_Temperature(5000),m_Iteration(2000),m_Seed(btk::RandomNumberGenerator::GetTimeSeed())
 {
     Superclass::m_Stop = false;
 }
 //-------------------------------------------------------------------------------------------------
 void SimulatedAnnealingOptimizer::StartOptimization()
 {
-    srand(time(NULL));
+    m_Generator.Initialize(m_Seed, 0);
     if(this->m_CostFunction.IsNull() || this->m_Stop)
     {
         return;
@@ -37,6 +37,7 @@
 
 #include "btkOptimizer.h"
 #include "btkMacro.h"
+#include "btkRandomNumberGenerator.h"
 
 /* OTHERS */
 #include "cfloat"
@@ -99,6 +100,10 @@ class SimulatedAnnealingOptimizer : public btk::Optimizer
         btkSetMacro(Iteration,unsigned int);
         btkGetMacro(Iteration,unsigned int);
 
+        /** Set/Get the seed of the random numbers (default: depends on the current time) */
+        btkSetMacro(Seed,unsigned long long);
+        btkGetMacro(Seed,unsigned long long);
+
 
     protected:
 
@@ -116,7 +121,7 @@ class SimulatedAnnealingOptimizer : public btk::Optimizer
 
         inline double Random()
         {
-            return (double)rand()/(double)RAND_MAX;
+            return m_Generator.GenerateUniform();
         }
 
         ParametersType m_Range;
@@ -126,6 +131,9 @@ class SimulatedAnnealingOptimizer : public btk::Optimizer
         unsigned int m_Iteration;
         MeasureType m_CurrentValue;
 
+        unsigned long long m_Seed;
+        btk::RandomNumberGenerator m_Generator;
+
 
 };
 
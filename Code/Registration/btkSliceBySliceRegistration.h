@@ -129,6 +129,13 @@ public:
     return affineRegistration -> GetOptimizer() -> GetScales();
   }
 
+  /** Set/Get the parallel mode (default false). The slices are registered concurrently with OpenMP,
+   * each thread using its own rigid and affine registrations (metric, interpolator, optimizer)
+   * on the shared fixed and moving images. Results are the same as in serial mode. */
+  itkSetMacro( ParallelRegistration, bool );
+  itkGetMacro( ParallelRegistration, bool );
+  itkBooleanMacro( ParallelRegistration );
+
 protected:
   SliceBySliceRegistration();
   virtual ~SliceBySliceRegistration() {};
@@ -138,6 +145,9 @@ protected:
    */
   void Initialize() throw (ExceptionObject);
 
+  /** Register slice i (fixed region region) with the given registration objects, and store the result in m_TransformArray[i]. */
+  void RegisterSlice( unsigned int i, const RegionType & region, RigidRegistrationType * rigid, AffineRegistrationType * affine );
+
 private:
   SliceBySliceRegistration(const Self&); //purposely not implemented
   void operator=(const Self&); //purposely not implemented
@@ -147,6 +157,7 @@ private:
 
   TransformPointerArray       m_TransformArray;
   bool m_TransformArrayIsSet;
+  bool m_ParallelRegistration;
 
 };
 
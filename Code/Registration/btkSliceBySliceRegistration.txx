@@ -49,6 +49,7 @@ SliceBySliceRegistration<ImageType>
 ::SliceBySliceRegistration()
 {
   m_TransformArrayIsSet = false;
+  m_ParallelRegistration = false;
 }
 
 /*
@@ -105,8 +106,6 @@ SliceBySliceRegistration<ImageType>
   affineRegistration->SetMovingImage( this -> GetMovingImage() );
   affineRegistration->SetFixedImage(  this -> GetFixedImage() );
 
-  RigidTransformType::Pointer transform = RigidTransformType::New();
-
   IndexType start = this -> GetFixedImageRegion().GetIndex();
   SizeType  size  = this -> GetFixedImageRegion().GetSize();
 
@@ -118,39 +117,111 @@ SliceBySliceRegistration<ImageType>
   unsigned int y2 = y1 + size[1] -1;
   unsigned int z2 = z1 + size[2] -1;
 
+  // Fixed region of each slice
+
+  std::vector< RegionType > fixedImageRegions( z2 - z1 + 1 );
+
   for ( unsigned int i=z1; i<=z2; i++ )
   {
-    // Fixed region for slice i
-
-    RegionType fixedImageRegion;
     IndexType  fixedImageRegionIndex;
     SizeType   fixedImageRegionSize;
 
     fixedImageRegionIndex[0] = x1; fixedImageRegionIndex[1]= y1; fixedImageRegionIndex[2]= i;
     fixedImageRegionSize[0]  = x2 - x1 + 1; fixedImageRegionSize[1] = y2 - y1 + 1; fixedImageRegionSize[2] = 1;
 
-    fixedImageRegion.SetIndex(fixedImageRegionIndex);
-    fixedImageRegion.SetSize(fixedImageRegionSize);
+    fixedImageRegions[i-z1].SetIndex(fixedImageRegionIndex);
+    fixedImageRegions[i-z1].SetSize(fixedImageRegionSize);
+  }
+
+  if ( !m_ParallelRegistration )
+  {
+    for ( unsigned int i=z1; i<=z2; i++ )
+    {
+      this -> RegisterSlice( i, fixedImageRegions[i-z1], rigidRegistration, affineRegistration );
+    } // end for in z
+  }
+  else
+  {
+    // Slices are independent: each thread registers its slices with its own registration objects.
+    // The first error (in slice order) is thrown once all the slices are processed.
+
+    int numberOfSlices = z2 - z1 + 1;
+    int k;
+    int failedSlice = -1;
+    ExceptionObject error;
+
+    #pragma omp parallel private(k)
+    {
+      typename RigidRegistrationType::Pointer  threadRigidRegistration  = RigidRegistrationType::New();
+      typename AffineRegistrationType::Pointer threadAffineRegistration = AffineRegistrationType::New();
+
+      threadRigidRegistration->SetMovingImage(  this -> GetMovingImage() );
+      threadRigidRegistration->SetFixedImage(   this -> GetFixedImage()  );
+
+      threadAffineRegistration->SetMovingImage( this -> GetMovingImage() );
+      threadAffineRegistration->SetFixedImage(  this -> GetFixedImage() );
+
+      #pragma omp for schedule(dynamic)
+      for ( k=0; k<numberOfSlices; k++ )
+      {
+        try
+        {
+          this -> RegisterSlice( z1 + k, fixedImageRegions[k], threadRigidRegistration, threadAffineRegistration );
+        }
+        catch( itk::ExceptionObject & err )
+        {
+          #pragma omp critical
+          {
+            if ( failedSlice < 0 || k < failedSlice )
+            {
+              failedSlice = k;
+              error = err;
+            }
+          }
+        }
+
+        // Keep the affine registration of the last slice, as in serial mode (see GetOptimizerScales)
+        if ( k == numberOfSlices - 1 )
+        {
+          affineRegistration = threadAffineRegistration;
+        }
+      }
+    }
+
+    if ( failedSlice >= 0 )
+    {
+      throw error;
+    }
+  }
+
+}
+
+template < typename ImageType >
+void
+SliceBySliceRegistration<ImageType>
+::RegisterSlice( unsigned int i, const RegionType & fixedImageRegion, RigidRegistrationType * rigid, AffineRegistrationType * affine )
+{
+    RigidTransformType::Pointer transform = RigidTransformType::New();
 
     ParametersType initialAffineParameters( 12 );
 
     if (!m_TransformArrayIsSet)
     {
 
-      rigidRegistration->SetFixedImageRegion( fixedImageRegion );
+      rigid->SetFixedImageRegion( fixedImageRegion );
 
       try
       {
-        //rigidRegistration -> StartRegistration();// FIXME : in ITK4 StartRegistration() is replaced by Update()
-        rigidRegistration->Update();
+        //rigid -> StartRegistration();// FIXME : in ITK4 StartRegistration() is replaced by Update()
+        rigid->Update();
       }
       catch( itk::ExceptionObject & err )
       {
         throw err;
       }
 
-      ParametersType finalParameters = rigidRegistration -> GetLastTransformParameters();
-      PointType      transformCenter = rigidRegistration -> GetTransformCenter();
+      ParametersType finalParameters = rigid -> GetLastTransformParameters();
+      PointType      transformCenter = rigid -> GetTransformCenter();
 
       // Initialize affine
       transform -> SetCenter( transformCenter);
@@ -177,30 +248,26 @@ SliceBySliceRegistration<ImageType>
 
     }
 
-    affineRegistration->SetFixedImageRegion( fixedImageRegion );
-    affineRegistration->SetInitialTransformParameters( initialAffineParameters );
+    affine->SetFixedImageRegion( fixedImageRegion );
+    affine->SetInitialTransformParameters( initialAffineParameters );
 
 //    std::cout << "Initial affine parameters = " << initialAffineParameters << std::endl;
 
     try
       {
-      //affineRegistration -> StartRegistration();// FIXME : in ITK4 StartRegistration() is replaced by Update()
-      affineRegistration->Update();
+      //affine -> StartRegistration();// FIXME : in ITK4 StartRegistration() is replaced by Update()
+      affine->Update();
       }
     catch( itk::ExceptionObject & err )
       {
       throw err;
       }
 
-//    finalParameters = affineRegistration->GetLastTransformParameters();
-
-//    std::cout << "Final affine parameters ( z = " << i << " ) " << affineRegistration->GetLastTransformParameters() << std::endl;
+//    std::cout << "Final affine parameters ( z = " << i << " ) " << affine->GetLastTransformParameters() << std::endl;
 
     m_TransformArray[i] -> SetIdentity();
-    m_TransformArray[i] -> SetCenter( affineRegistration->GetTransformCenter() );
-    m_TransformArray[i] -> SetParameters( affineRegistration->GetLastTransformParameters() );
-
-  } // end for in z
+    m_TransformArray[i] -> SetCenter( affine->GetTransformCenter() );
+    m_TransformArray[i] -> SetParameters( affine->GetLastTransformParameters() );
 
 }
 
@@ -165,6 +165,13 @@ public:
   itkSetMacro( Iterations, unsigned int );
   itkGetMacro( Iterations, unsigned int );
 
+  /** Set/Get the parallel mode (default false). The slices are registered concurrently with OpenMP,
+   * each thread using its own rigid registration (metric, interpolator, optimizer) on the shared
+   * fixed and moving images. Results are the same as in serial mode. */
+  itkSetMacro( ParallelRegistration, bool );
+  itkGetMacro( ParallelRegistration, bool );
+  itkBooleanMacro( ParallelRegistration );
+
 
 protected:
   SliceBySliceRigidRegistration();
@@ -175,6 +182,12 @@ protected:
    */
   void Initialize() throw (itk::ExceptionObject);
 
+  /** Create a registration configured for one slice (images, mask, iterations). */
+  RegistrationPointer NewSliceRegistration() const;
+
+  /** Register slice i with the given registration, starting from the current parameters of the slice transform. */
+  ParametersType RegisterSlice( unsigned int i, RegistrationType * registration ) const;
+
 
 
 private:
@@ -197,6 +210,7 @@ private:
   ImageRegionType                  m_FixedImageRegion;
 
   unsigned int 										 m_Iterations;
+  bool                             m_ParallelRegistration;
 
 };
 
@@ -17,6 +17,7 @@ SliceBySliceRigidRegistration<ImageType>
   m_ImageMask = 0;
   m_Transform = 0;
   m_Iterations = 200;
+  m_ParallelRegistration = false;
 }
 
 /*
@@ -29,12 +30,7 @@ SliceBySliceRigidRegistration<ImageType>
 {
   // Configure registration
 
-  m_Registration = RegistrationType::New();
-  m_Registration -> SetFixedImage(  m_FixedImage  );
-  m_Registration -> SetMovingImage( m_MovingImage );
-  m_Registration -> InitializeWithTransform();
-  m_Registration -> SetEnableObserver( false );
-  m_Registration -> SetIterations( m_Iterations );
+  m_Registration = this -> NewSliceRegistration();
 
   // TODO We have to decide after checking the results which one is the
   // the default behavior
@@ -48,7 +44,6 @@ SliceBySliceRigidRegistration<ImageType>
 //      std::cout << "image mask IS defined" << std::endl;
       typename MaskType::Pointer mask = MaskType::New();
       mask -> SetImage( m_ImageMask );
-      m_Registration -> SetFixedImageMask( m_ImageMask );
       m_ROI = mask -> GetAxisAlignedBoundingBoxRegion();
     }
     
@@ -85,8 +80,72 @@ SliceBySliceRigidRegistration<ImageType>
     unsigned int k1 =  m_ROI.GetIndex()[2];
     unsigned int k2 =  k1 + m_ROI.GetSize()[2] -1;
 
-    for ( unsigned int i = k1; i <= k2; i++ )
+    int numberOfSlices = k2 - k1 + 1;
+    int k;
+
+    // Final parameters are set in the slice by slice transform once all slices are registered
+    // (the transform is shared by the threads in parallel mode)
+    ParametersArrayType finalParameters( numberOfSlices );
+
+    if ( !m_ParallelRegistration )
+    {
+      for ( k = 0; k < numberOfSlices; k++ )
+      {
+        finalParameters[k] = this -> RegisterSlice( k1 + k, m_Registration );
+      } // end for in z
+    }
+    else
+    {
+      #pragma omp parallel private(k)
+      {
+        RegistrationPointer registration = this -> NewSliceRegistration();
+
+        #pragma omp for schedule(dynamic)
+        for ( k = 0; k < numberOfSlices; k++ )
+        {
+          finalParameters[k] = this -> RegisterSlice( k1 + k, registration );
+        }
+      }
+    }
+
+    for ( k = 0; k < numberOfSlices; k++ )
     {
+      m_Transform -> SetSliceParameters( k1 + k, finalParameters[k] );
+    }
+
+}
+
+/*
+ * Creates the registration of one slice
+ */
+template < typename ImageType >
+typename SliceBySliceRigidRegistration<ImageType>::RegistrationPointer
+SliceBySliceRigidRegistration<ImageType>
+::NewSliceRegistration() const
+{
+  RegistrationPointer registration = RegistrationType::New();
+  registration -> SetFixedImage(  m_FixedImage  );
+  registration -> SetMovingImage( m_MovingImage );
+  registration -> InitializeWithTransform();
+  registration -> SetEnableObserver( false );
+  registration -> SetIterations( m_Iterations );
+
+  if ( m_ImageMask )
+  {
+    registration -> SetFixedImageMask( m_ImageMask );
+  }
+
+  return registration;
+}
+
+/*
+ * Registers one slice
+ */
+template < typename ImageType >
+typename SliceBySliceRigidRegistration<ImageType>::ParametersType
+SliceBySliceRigidRegistration<ImageType>
+::RegisterSlice( unsigned int i, RegistrationType * registration ) const
+{
 //      std::cout << "Registering slice " << i << std::endl;
 
       // Fixed region for slice i
@@ -104,19 +163,16 @@ SliceBySliceRigidRegistration<ImageType>
       fixedImageRegion.SetIndex(fixedImageRegionIndex);
       fixedImageRegion.SetSize(fixedImageRegionSize);
 
-      ParametersType initialRigidParameters( 6 );
-      ParametersType finalParameters;
-
-      m_Registration -> SetFixedImageRegion( fixedImageRegion );
-      m_Registration -> SetInitialTransformParameters( m_Transform -> GetSliceTransform(i) -> GetParameters() );
-      m_Registration -> SetTransformCenter( m_Transform -> GetSliceTransform(i) -> GetCenter() );
+      registration -> SetFixedImageRegion( fixedImageRegion );
+      registration -> SetInitialTransformParameters( m_Transform -> GetSliceTransform(i) -> GetParameters() );
+      registration -> SetTransformCenter( m_Transform -> GetSliceTransform(i) -> GetCenter() );
 
 //      std::cout << "Initial registration parameters = " << m_Transform -> GetSliceTransform(i) -> GetParameters() << std::endl;
 
       try
         {
-        //m_Registration -> StartRegistration();// FIXME : in ITK4 StartRegistration() is replaced by Update()
-        m_Registration->Update();
+        //registration -> StartRegistration();// FIXME : in ITK4 StartRegistration() is replaced by Update()
+        registration->Update();
         }
       catch( itk::ExceptionObject & err )
         {
@@ -128,14 +184,9 @@ SliceBySliceRigidRegistration<ImageType>
   //      return EXIT_FAILURE;
         }
 
-      finalParameters = m_Registration -> GetLastTransformParameters();
-
-//      std::cout << "Final rigid parameters = " << finalParameters << std::endl;
-
-      m_Transform -> SetSliceParameters( i, finalParameters );
-
-    } // end for in z
+//      std::cout << "Final rigid parameters = " << registration -> GetLastTransformParameters() << std::endl;
 
+      return registration -> GetLastTransformParameters();
 }
 
 /*
@@ -110,6 +110,12 @@ class SlicesIntersectionITKCostFunction: public itk::SingleValuedCostFunction
         virtual void GetDerivative(const ParametersType & parameters,
                                    DerivativeType & derivative) const;
 
+        /** This method returns both the value and the derivative of the cost function
+      * (computed in a single evaluation). */
+        virtual void GetValueAndDerivative(const ParametersType & parameters,
+                                           MeasureType & value,
+                                           DerivativeType & derivative) const;
+
         /** Return the number of parameters required to compute
      *  this cost function.
      *  This method MUST be overloaded by derived classes. */
@@ -97,6 +97,14 @@ void SlicesIntersectionITKCostFunction< TImage >::GetDerivative(const Parameters
 }
 //-------------------------------------------------------------------------------------------------
 template< typename TImage >
+void SlicesIntersectionITKCostFunction< TImage >::GetValueAndDerivative(const ParametersType &parameters, MeasureType &value, DerivativeType &derivative) const
+{
+    // The value is computed along with the gradient, f() returns it without a new evaluation
+    derivative = m_VNLCostFunction->GetGradient(parameters);
+    value = m_VNLCostFunction->f(parameters);
+}
+//-------------------------------------------------------------------------------------------------
+template< typename TImage >
 unsigned int SlicesIntersectionITKCostFunction< TImage >::GetNumberOfParameters() const
 {
     return m_NumberOfParameters;
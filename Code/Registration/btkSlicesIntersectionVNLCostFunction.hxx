@@ -37,6 +37,8 @@
 #define BTKSlicesIntersectionVNLCostFunction_HXX
 
 #include "vnl/vnl_cost_function.h"
+#include "vnl/vnl_matrix_fixed.h"
+#include "vnl/vnl_math.h"
 #include "itkImage.h"
 #include "itkLinearInterpolateImageFunction.h"
 #include "itkNearestNeighborInterpolateImageFunction.h"
@@ -170,7 +172,11 @@ public:
 
     void GetTransformsWithParams(const vnl_vector<double> &x) const;
 
+    /** Analytic gradient of the cost function (stepsize is kept for compatibility and is not used) */
     virtual vnl_vector<double>GetGradient(vnl_vector<double> const& x,double stepsize = 0.8) const;
+
+    /** Compute the value and the gradient of the cost function in a single pass (used by vnl optimizers) */
+    virtual void compute(vnl_vector<double> const& x, double *value, vnl_vector<double> *gradient);
      /** Intialization */
      void Initialize();
 
@@ -179,6 +185,13 @@ public:
 
       inline void ComputeIntersectionsOfAllSlices();
 
+     /** Tell that the transform of a slice has been modified outside of the cost function
+      * (its geometry is computed again at the next evaluation, other slices are kept). */
+     void InvalidateSliceGeometry(unsigned int _image, unsigned int _slice) const;
+
+     /** Tell that the transforms of all slices have been modified outside of the cost function */
+     void InvalidateAllSlicesGeometry() const;
+
 protected:
 
      /** Compute squared Difference between two voxels */
@@ -198,8 +211,48 @@ protected:
       {
           return (double)( std::sqrt((ReferenceVoxel - MovingVoxel) * (ReferenceVoxel - MovingVoxel )));
       }
-      /** Found starting and ending point of an intersection line (if existing) */
-      bool FoundIntersectionPoints(unsigned int _fixedImage, unsigned int _fixedSlice, unsigned int _movingImage, unsigned int _movingSlice, typename ImageType::PointType &Point1, typename ImageType::PointType &Point2) const;
+      /** Compute the value of the cost function, and its gradient if gradient is not NULL */
+      double ComputeValueAndGradient(const vnl_vector<double> &x, vnl_vector<double> *gradient) const;
+
+      /** Derivatives of m_X(point) with respect to the 6 parameters (angles in degrees) */
+      void ComputeParametersJacobian(const typename ImageType::PointType &point, vnl_matrix_fixed<double,3,6> &jacobian) const;
+
+      /** Spatial gradient (in index space) of the linear interpolation of an image */
+      void EvaluateGradientAtContinuousIndex(const ImageType *image, const ContinuousIndexType &index, double gradient[3]) const;
+
+      /**
+       * @brief Geometry of a slice used for the search of intersection lines.
+       * Physical points of the edges do not depend on the transforms and are computed once in Initialize().
+       * Points moved by the transform of the slice are computed again only when this transform changes.
+       */
+      struct SliceGeometry
+      {
+          std::vector< typename ImageType::PointType > EdgePoints; /** Points of the edges 1-2, 2-3, 3-4 and 4-1 (see FoundIntersectionPoints) */
+          std::vector< typename ImageType::PointType > TransformedEdgePoints; /** EdgePoints moved by the transform of the slice */
+          unsigned int EdgeEnds[4]; /** End (excluded) of each edge in EdgePoints */
+          bool IsUpToDate; /** TransformedEdgePoints corresponds to the current transform */
+      };
+
+      /** Compute the points of the edges of a slice */
+      void InitializeSliceGeometry(unsigned int _image, unsigned int _slice);
+
+      /** Compute the transformed points of the edges of a slice if its transform has changed */
+      void UpdateSliceGeometry(unsigned int _image, unsigned int _slice) const;
+
+      /** Bounding box, in the continuous index space of an image, of 4 points moved by a transform (if not NULL) */
+      void ComputeIndexBoundingBox(const ImageType *image, const TransformType *transform, const typename ImageType::PointType points[4], double min[3], double max[3]) const;
+
+      /** Set candidates[s] to true for the slices s whose slab (in index space, with a margin) overlaps the bounding box min,max */
+      void MarkCandidateSlices(const double min[3], const double max[3], const typename ImageType::SizeType &size, double margin, std::vector< bool > &candidates) const;
+
+      /** Broad phase of the search of intersections: bounding boxes (in index space) of the moving slice and of the
+       * fixed slices are compared, candidates[s] is false only if fixed slice s can not intersect the moving slice. */
+      void ComputeCandidateSlices(unsigned int _fixedImage, unsigned int _movingImage, unsigned int _movingSlice, std::vector< bool > &candidates) const;
+
+      /** Found starting and ending point of an intersection line (if existing).
+       * If not NULL, PointXOnMovingSlice tells if the point was found on an edge of the moving slice (true) or of the fixed one (false). */
+      bool FoundIntersectionPoints(unsigned int _fixedImage, unsigned int _fixedSlice, unsigned int _movingImage, unsigned int _movingSlice, typename ImageType::PointType &Point1, typename ImageType::PointType &Point2,
+                                   bool *Point1OnMovingSlice = NULL, bool *Point2OnMovingSlice = NULL) const;
 
       /** Found starting and ending point of an intersection line (if existing) */
       bool FoundIntersectionPoints2(unsigned int _fixedImage, unsigned int _fixedSlice, unsigned int _movingImage, unsigned int _movingSlice, typename ImageType::PointType &Point1, typename ImageType::PointType &Point2) const;
@@ -307,6 +360,14 @@ private :
 
     std::vector< std::vector< typename ImageType::PointType > > m_Points2;
     std::vector< std::vector< bool > > m_Intersections;
+
+    mutable std::vector< SliceGeometry > m_SliceGeometry; /** Geometry of all slices (stack index) */
+
+    std::vector< bool > m_OrthogonalImages; /** Images orthogonal to the moving one */
+
+    mutable bool m_CachedValueIsValid; /** Value of the last evaluation (computed with the gradient, reused by f()) */
+    mutable double m_CachedValue;
+    mutable vnl_vector<double> m_CachedParameters;
 };
 
 }
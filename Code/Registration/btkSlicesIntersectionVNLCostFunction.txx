@@ -11,7 +11,7 @@ namespace btk
 template<class TImage>
 SlicesIntersectionVNLCostFunction<TImage>::SlicesIntersectionVNLCostFunction(unsigned int dim)
     :vnl_cost_function(dim),m_NumberOfPointsOfLine(100),m_VerboseMode(false),m_MovingImageNum(0),m_MovingSliceNum(0)
-    ,m_Intersection(false)
+    ,m_Intersection(false),m_CachedValueIsValid(false),m_CachedValue(0.0)
 {
 }
 //-------------------------------------------------------------------------------------------------
@@ -43,6 +43,16 @@ void SlicesIntersectionVNLCostFunction<TImage>::Initialize()
         }
         m_Stack.resize(linearSize);
 
+        // Points of the edges of all slices (used for the search of intersections)
+        m_SliceGeometry.resize(linearSize);
+        for(unsigned int i = 0; i<m_NumberOfImages; i++)
+        {
+            for(unsigned int s = 0; s < m_Images[i]->GetLargestPossibleRegion().GetSize()[2]; s++)
+            {
+                this->InitializeSliceGeometry(i,s);
+            }
+        }
+
 
         m_X = TransformType::New();
         m_X->SetIdentity();
@@ -63,6 +73,15 @@ void SlicesIntersectionVNLCostFunction<TImage>::Initialize()
         m_Images[m_MovingImageNum]->TransformContinuousIndexToPhysicalPoint(centerIndex,center);
         m_X->SetCenter(center);
 
+        // Orthogonality of the images with the moving one (non orthogonal images are not used)
+        m_OrthogonalImages.resize(m_NumberOfImages);
+        for(unsigned int i = 0; i<m_NumberOfImages; i++)
+        {
+            m_OrthogonalImages[i] = btk::ImageHelper<ImageType>::AreOrthos(m_Images[m_MovingImageNum],m_Images[i]);
+        }
+
+        m_CachedValueIsValid = false;
+
         std::pair<unsigned int, unsigned int> RefImSlice;
         RefImSlice.first = 1;
         RefImSlice.second = m_Images[1]->GetLargestPossibleRegion().GetSize()[2]/2;
@@ -83,32 +102,19 @@ void SlicesIntersectionVNLCostFunction<TImage>::Initialize()
 template<class TImage>
 vnl_vector<double> SlicesIntersectionVNLCostFunction<TImage>::GetGradient(const vnl_vector<double> &x, double stepsize) const
 {
-//    //finite difference
-    vnl_vector<double> tx = x;
+    // Analytic gradient (the step size of the former finite differences is not used anymore).
+    // The value is computed in the same pass and kept for the next call of f() at the same position.
     vnl_vector<double> gradient(x.size());
-    double h = stepsize;
-    for (int i = 0; i < dim; ++i)
-    {
-        double tplus = x[i] + h;
-        tx[i] = tplus;
-        double fplus = this->f(tx);
+    this->ComputeValueAndGradient(x, &gradient);
 
-        double tminus = x[i] - h;
-        tx[i] = tminus;
-        double fminus = this->f(tx);
-
-        gradient[i] = (fplus - fminus) / (tplus - tminus);
-        tx[i] = x[i];
-    }
     return gradient;
-
-
 }
 //-------------------------------------------------------------------------------------------------
 template< class TImage>
 bool
 SlicesIntersectionVNLCostFunction<TImage>::
-FoundIntersectionPoints(unsigned int _fixedImage, unsigned int _fixedSlice, unsigned int _movingImage, unsigned int _movingSlice, typename ImageType::PointType &Point1, typename ImageType::PointType &Point2) const
+FoundIntersectionPoints(unsigned int _fixedImage, unsigned int _fixedSlice, unsigned int _movingImage, unsigned int _movingSlice, typename ImageType::PointType &Point1, typename ImageType::PointType &Point2,
+                        bool *Point1OnMovingSlice, bool *Point2OnMovingSlice) const
 {
 
 
@@ -129,14 +135,9 @@ FoundIntersectionPoints(unsigned int _fixedImage, unsigned int _fixedSlice, unsi
     Point2[1] = 0;
     Point2[2] = 0;
 
-    // 4 corner of moving slice:
-    typename ImageType::IndexType MovingCorner1, MovingCorner2, MovingCorner3, MovingCorner4;
-
-    // 4 corners of fixed slice :
-    typename ImageType::IndexType FixedCorner1, FixedCorner2, FixedCorner3, FixedCorner4;
-
     typename ImageType::RegionType MovingRegion, FixedRegion;
     typename ImageType::SizeType MovingRgSize, FixedRgSize;
+    typename ImageType::IndexType MovingCorner1, FixedCorner1;
 
 
     MovingRgSize = m_Images[_movingImage]->GetLargestPossibleRegion().GetSize();
@@ -145,16 +146,8 @@ FoundIntersectionPoints(unsigned int _fixedImage, unsigned int _fixedSlice, unsi
     FixedRgSize = m_Images[_fixedImage]->GetLargestPossibleRegion().GetSize();
     FixedRgSize[2] = 1;
 
-
     MovingCorner1[0] = 0; MovingCorner1[1] = 0; MovingCorner1[2] = _movingSlice;
-    MovingCorner2[0] = 0; MovingCorner2[1] = m_Images[_movingImage]->GetLargestPossibleRegion().GetSize()[1] - 1; MovingCorner2[2] = _movingSlice;
-    MovingCorner3[0] = m_Images[_movingImage]->GetLargestPossibleRegion().GetSize()[0] - 1; MovingCorner3[1] = m_Images[_movingImage]->GetLargestPossibleRegion().GetSize()[1] - 1;MovingCorner3[2] = _movingSlice;
-    MovingCorner4[0] = m_Images[_movingImage]->GetLargestPossibleRegion().GetSize()[0] - 1;MovingCorner4[1] = 0; MovingCorner4[2] = _movingSlice;
-
     FixedCorner1[0] = 0; FixedCorner1[1] = 0; FixedCorner1[2] = _fixedSlice;
-    FixedCorner2[0] = 0; FixedCorner2[1] = m_Images[_fixedImage]->GetLargestPossibleRegion().GetSize()[1] - 1; FixedCorner2[2] = _fixedSlice;
-    FixedCorner3[0] = m_Images[_fixedImage]->GetLargestPossibleRegion().GetSize()[0] - 1; FixedCorner3[1] = m_Images[_fixedImage]->GetLargestPossibleRegion().GetSize()[1] - 1;FixedCorner3[2] = _fixedSlice;
-    FixedCorner4[0] = m_Images[_fixedImage]->GetLargestPossibleRegion().GetSize()[0] - 1;FixedCorner4[1] = 0; FixedCorner4[2] = _fixedSlice;
 
     MovingRegion.SetIndex(MovingCorner1);
     FixedRegion.SetIndex(FixedCorner1);
@@ -163,59 +156,42 @@ FoundIntersectionPoints(unsigned int _fixedImage, unsigned int _fixedSlice, unsi
     FixedRegion.SetSize(FixedRgSize);
 
 
-    typename ImageType::PointType CurrentPoint, TCurrentPoint, CorrespondingPoint;
+    typename ImageType::PointType TCurrentPoint, CorrespondingPoint;
     bool FoundP1, FoundP2, intersection;
 
     intersection = FoundP1 = FoundP2 = false;
 
-    typename ImageType::IndexType  CurrentIndex;
     typename Interpolator::ContinuousIndexType CorrespondingIndex;
 
-    typedef itk::LineConstIterator<ImageType> LineIterator;
-
-    std::vector<LineIterator> IteratorTab;
-
-
-    LineIterator itM12(m_Images[_movingImage], MovingCorner1, MovingCorner2);
-    LineIterator itM23(m_Images[_movingImage], MovingCorner2, MovingCorner3);
-    LineIterator itM34(m_Images[_movingImage], MovingCorner3, MovingCorner4);
-    LineIterator itM41(m_Images[_movingImage], MovingCorner4, MovingCorner1);
-
-
-    // for the fixed slice we take the opposite
-    LineIterator itF12(m_Images[_fixedImage], FixedCorner1, FixedCorner4);
-    LineIterator itF23(m_Images[_fixedImage], FixedCorner4, FixedCorner3);
-    LineIterator itF34(m_Images[_fixedImage], FixedCorner3, FixedCorner2);
-    LineIterator itF41(m_Images[_fixedImage], FixedCorner2, FixedCorner1);
-
-    IteratorTab.push_back(itM12);
-    IteratorTab.push_back(itM23);
-    IteratorTab.push_back(itM34);
-    IteratorTab.push_back(itM41);
-    IteratorTab.push_back(itF12);
-    IteratorTab.push_back(itF23);
-    IteratorTab.push_back(itF34);
-    IteratorTab.push_back(itF41);
+    // Points of the edges are computed once (see InitializeSliceGeometry)
+    this->UpdateSliceGeometry(_fixedImage, _fixedSlice);
 
+    std::pair< unsigned int, unsigned int > MovingImageSlice(_movingImage, _movingSlice), FixedImageSlice(_fixedImage, _fixedSlice);
+    const SliceGeometry & MovingGeometry = m_SliceGeometry[this->ReturnStackIndexFromImageAndSlice(MovingImageSlice)];
+    const SliceGeometry & FixedGeometry = m_SliceGeometry[this->ReturnStackIndexFromImageAndSlice(FixedImageSlice)];
 
     std::vector<typename ImageType::PointType> P1, P2;
     //TODO: This part is very complex, is there a way to simplify it ?
     // We iterate over each edge of slices for found starting and ending points of intersection
-    for(unsigned int i = 0; i< IteratorTab.size(); i++)
+    for(unsigned int i = 0; i< 8; i++)
     {
-        LineIterator it = IteratorTab[i];
+        // i 0-3 for moving slice (edges 1-2, 2-3, 3-4, 4-1), and i 4-7 for fixed slice
+        // for the fixed slice we take the opposite (edges 1-4, 4-3, 3-2, 2-1)
+        const SliceGeometry & Geometry = (i<4) ? MovingGeometry : FixedGeometry;
+        unsigned int edge = (i<4) ? i : 7-i;
+        unsigned int edgeBegin = (edge == 0) ? 0 : Geometry.EdgeEnds[edge-1];
+        unsigned int edgeSize = Geometry.EdgeEnds[edge] - edgeBegin;
+
         bool ConsecutivePoint = true;
         unsigned int countPoint = 0;
-       for(it.GoToBegin(); !it.IsAtEnd(); ++it)
+        for(unsigned int n = 0; n < edgeSize; n++)
         {
+            unsigned int CurrentPointIndex = (i<4) ? edgeBegin + n : edgeBegin + edgeSize - 1 - n;
 
-            CurrentIndex = it.GetIndex();
-            // i 0-3 for moving slice, and i 4-7 for fixed slice
             if(i<4)// Moving Slice
             {
-                m_Images[_movingImage]->TransformIndexToPhysicalPoint(CurrentIndex, CurrentPoint);
                 // Apply X
-                TCurrentPoint = m_X->TransformPoint(CurrentPoint);// use m_Transform[_movingImage] instead
+                TCurrentPoint = m_X->TransformPoint(MovingGeometry.EdgePoints[CurrentPointIndex]);// use m_Transform[_movingImage] instead
                 //TCurrentPoint = m_Transforms[_movingImage]->TransformPoint(CurrentPoint);
                 // Apply Inverse of the Optimized founded transform (if not identity)
                 CorrespondingPoint = m_InverseTransforms[_fixedImage]->TransformPoint(TCurrentPoint);
@@ -282,6 +258,7 @@ FoundIntersectionPoints(unsigned int _fixedImage, unsigned int _fixedSlice, unsi
 //                        Point1[1] = Point1[1]/P1.size();
 //                        Point1[2] = Point1[2]/P1.size();
                         FoundP1 = true;
+                        if(Point1OnMovingSlice) *Point1OnMovingSlice = true;
 
                         P1.clear();
                         break;
@@ -313,6 +290,7 @@ FoundIntersectionPoints(unsigned int _fixedImage, unsigned int _fixedSlice, unsi
 //                        Point2[1] = Point2[1]/P2.size();
 //                        Point2[2] = Point2[2]/P2.size();
                         FoundP2 = true;
+                        if(Point2OnMovingSlice) *Point2OnMovingSlice = true;
 
                         P2.clear();
                         break;
@@ -324,9 +302,8 @@ FoundIntersectionPoints(unsigned int _fixedImage, unsigned int _fixedSlice, unsi
             //TODO : Duplication of code...
             else // fixed slice
             {
-                m_Images[_fixedImage]->TransformIndexToPhysicalPoint(CurrentIndex, CurrentPoint);
-                //Apply transform of the fixedImage (if not identity)
-                TCurrentPoint = m_Transforms[_fixedImage]->TransformPoint(CurrentPoint);
+                //Transform of the fixedImage (if not identity) is already applied
+                TCurrentPoint = FixedGeometry.TransformedEdgePoints[CurrentPointIndex];
                 //Apply inverse of X for return in the moving slice space
                 CorrespondingPoint = m_InverseX->TransformPoint(TCurrentPoint); // use m_InverseTransforms instead
                 //CorrespondingPoint = m_InverseTransforms[_movingImage]->TransformPoint(TCurrentPoint);
@@ -387,6 +364,7 @@ FoundIntersectionPoints(unsigned int _fixedImage, unsigned int _fixedSlice, unsi
 //                        Point1[1] = Point1[1]/P1.size();
 //                        Point1[2] = Point1[2]/P1.size();
                         FoundP1 = true;
+                        if(Point1OnMovingSlice) *Point1OnMovingSlice = false;
 
                         P1.clear();
                         break;
@@ -416,6 +394,7 @@ FoundIntersectionPoints(unsigned int _fixedImage, unsigned int _fixedSlice, unsi
 //                        Point2[1] = Point2[1]/P2.size();
 //                        Point2[2] = Point2[2]/P2.size();
                         FoundP2 = true;
+                        if(Point2OnMovingSlice) *Point2OnMovingSlice = false;
 
                         P2.clear();
                         break;
@@ -435,7 +414,6 @@ FoundIntersectionPoints(unsigned int _fixedImage, unsigned int _fixedSlice, unsi
 
     }
     // Cleaning
-    IteratorTab.clear();
     P1.clear();
     P2.clear();
 
@@ -449,6 +427,202 @@ FoundIntersectionPoints(unsigned int _fixedImage, unsigned int _fixedSlice, unsi
     }
 
 
+}
+//-------------------------------------------------------------------------------------------------
+template<class TImage>
+void SlicesIntersectionVNLCostFunction<TImage>::InitializeSliceGeometry(unsigned int _image, unsigned int _slice)
+{
+    std::pair< unsigned int, unsigned int > ImageSlice(_image, _slice);
+    SliceGeometry & Geometry = m_SliceGeometry[this->ReturnStackIndexFromImageAndSlice(ImageSlice)];
+
+    typename ImageType::SizeType size = m_Images[_image]->GetLargestPossibleRegion().GetSize();
+
+    // Corners as in FoundIntersectionPoints (1: (0,0), 2: (0,y), 3: (x,y), 4: (x,0))
+    typename ImageType::IndexType Corners[4];
+    Corners[0][0] = 0;         Corners[0][1] = 0;         Corners[0][2] = _slice;
+    Corners[1][0] = 0;         Corners[1][1] = size[1]-1; Corners[1][2] = _slice;
+    Corners[2][0] = size[0]-1; Corners[2][1] = size[1]-1; Corners[2][2] = _slice;
+    Corners[3][0] = size[0]-1; Corners[3][1] = 0;         Corners[3][2] = _slice;
+
+    typedef itk::LineConstIterator<ImageType> LineIterator;
+
+    typename ImageType::PointType CurrentPoint;
+    Geometry.EdgePoints.clear();
+
+    for(unsigned int edge = 0; edge < 4; edge++)
+    {
+        LineIterator it(m_Images[_image], Corners[edge], Corners[(edge+1)%4]);
+
+        for(it.GoToBegin(); !it.IsAtEnd(); ++it)
+        {
+            m_Images[_image]->TransformIndexToPhysicalPoint(it.GetIndex(), CurrentPoint);
+            Geometry.EdgePoints.push_back(CurrentPoint);
+        }
+
+        Geometry.EdgeEnds[edge] = Geometry.EdgePoints.size();
+    }
+
+    Geometry.TransformedEdgePoints.clear();
+    Geometry.IsUpToDate = false;
+}
+//-------------------------------------------------------------------------------------------------
+template<class TImage>
+void SlicesIntersectionVNLCostFunction<TImage>::UpdateSliceGeometry(unsigned int _image, unsigned int _slice) const
+{
+    std::pair< unsigned int, unsigned int > ImageSlice(_image, _slice);
+    SliceGeometry & Geometry = m_SliceGeometry[this->ReturnStackIndexFromImageAndSlice(ImageSlice)];
+
+    if(Geometry.IsUpToDate)
+    {
+        return;
+    }
+
+    Geometry.TransformedEdgePoints.resize(Geometry.EdgePoints.size());
+
+    for(unsigned int i = 0; i < Geometry.EdgePoints.size(); i++)
+    {
+        Geometry.TransformedEdgePoints[i] = m_Transforms[_image]->TransformPoint(Geometry.EdgePoints[i]);
+    }
+
+    Geometry.IsUpToDate = true;
+}
+//-------------------------------------------------------------------------------------------------
+template<class TImage>
+void SlicesIntersectionVNLCostFunction<TImage>::InvalidateSliceGeometry(unsigned int _image, unsigned int _slice) const
+{
+    std::pair< unsigned int, unsigned int > ImageSlice(_image, _slice);
+    unsigned int index = this->ReturnStackIndexFromImageAndSlice(ImageSlice);
+
+    if(index < m_SliceGeometry.size())
+    {
+        m_SliceGeometry[index].IsUpToDate = false;
+    }
+
+    m_CachedValueIsValid = false;
+}
+//-------------------------------------------------------------------------------------------------
+template<class TImage>
+void SlicesIntersectionVNLCostFunction<TImage>::InvalidateAllSlicesGeometry() const
+{
+    for(unsigned int i = 0; i < m_SliceGeometry.size(); i++)
+    {
+        m_SliceGeometry[i].IsUpToDate = false;
+    }
+
+    m_CachedValueIsValid = false;
+}
+//-------------------------------------------------------------------------------------------------
+template<class TImage>
+void SlicesIntersectionVNLCostFunction<TImage>::
+ComputeIndexBoundingBox(const ImageType *image, const TransformType *transform, const typename ImageType::PointType points[4], double min[3], double max[3]) const
+{
+    ContinuousIndexType index;
+
+    for(unsigned int c = 0; c < 4; c++)
+    {
+        if(transform)
+        {
+            image->TransformPhysicalPointToContinuousIndex(transform->TransformPoint(points[c]), index);
+        }
+        else
+        {
+            image->TransformPhysicalPointToContinuousIndex(points[c], index);
+        }
+
+        for(unsigned int d = 0; d < 3; d++)
+        {
+            min[d] = (c == 0) ? index[d] : std::min(min[d], index[d]);
+            max[d] = (c == 0) ? index[d] : std::max(max[d], index[d]);
+        }
+    }
+}
+//-------------------------------------------------------------------------------------------------
+template<class TImage>
+void SlicesIntersectionVNLCostFunction<TImage>::
+MarkCandidateSlices(const double min[3], const double max[3], const typename ImageType::SizeType &size, double margin, std::vector< bool > &candidates) const
+{
+    if(max[0] < -0.5 - margin || min[0] > size[0] - 0.5 + margin ||
+       max[1] < -0.5 - margin || min[1] > size[1] - 0.5 + margin)
+    {
+        return;
+    }
+
+    int first = std::max(0, (int)std::ceil(min[2] - 0.5 - margin));
+    int last = std::min((int)candidates.size() - 1, (int)std::floor(max[2] + 0.5 + margin));
+
+    for(int s = first; s <= last; s++)
+    {
+        candidates[s] = true;
+    }
+}
+//-------------------------------------------------------------------------------------------------
+template<class TImage>
+void SlicesIntersectionVNLCostFunction<TImage>::
+ComputeCandidateSlices(unsigned int _fixedImage, unsigned int _movingImage, unsigned int _movingSlice, std::vector< bool > &candidates) const
+{
+    // FoundIntersectionPoints looks for points of the edges of the moving slice (moved by X) inside the fixed slice,
+    // and for points of the edges of the fixed slice (moved by its transform) inside the moving slice.
+    // Edges lie in the rectangle of the 4 corners of the slice and the transforms are affine, so the bounding box
+    // of the 4 moved corners contains all the tested points. A small margin avoids rejections due to rounding errors.
+    const double margin = 1e-3;
+
+    typename ImageType::SizeType FixedSize = m_Images[_fixedImage]->GetLargestPossibleRegion().GetSize();
+    typename ImageType::SizeType MovingSize = m_Images[_movingImage]->GetLargestPossibleRegion().GetSize();
+    int numberOfFixedSlices = FixedSize[2];
+
+    candidates.assign(numberOfFixedSlices, false);
+
+    std::pair< unsigned int, unsigned int > MovingImageSlice(_movingImage, _movingSlice);
+    const SliceGeometry & MovingGeometry = m_SliceGeometry[this->ReturnStackIndexFromImageAndSlice(MovingImageSlice)];
+
+    typename ImageType::PointType Corners[4];
+    double Min[3], Max[3];
+
+    // Edges of the moving slice in the fixed slices
+    for(unsigned int c = 0; c < 4; c++)
+    {
+        Corners[c] = m_X->TransformPoint(MovingGeometry.EdgePoints[(c == 0) ? 0 : MovingGeometry.EdgeEnds[c-1]]);
+    }
+
+    this->ComputeIndexBoundingBox(m_Images[_fixedImage], NULL, Corners, Min, Max);
+
+    // Points outside the fixed image are not moved by the inverse slice by slice transform
+    this->MarkCandidateSlices(Min, Max, FixedSize, margin, candidates);
+
+    // Points inside the fixed image are moved by the inverse transform of the fixed slice they belong to
+    int firstSlice = std::max(0, (int)std::floor(Min[2] + 0.5) - 1);
+    int lastSlice = std::min(numberOfFixedSlices - 1, (int)std::floor(Max[2] + 0.5) + 1);
+
+    for(int k = firstSlice; k <= lastSlice; k++)
+    {
+        this->ComputeIndexBoundingBox(m_Images[_fixedImage], m_InverseTransforms[_fixedImage]->GetSliceTransform(k), Corners, Min, Max);
+        this->MarkCandidateSlices(Min, Max, FixedSize, margin, candidates);
+    }
+
+    // Edges of the fixed slices in the moving slice
+    for(int s = 0; s < numberOfFixedSlices; s++)
+    {
+        if(candidates[s])
+        {
+            continue;
+        }
+
+        this->UpdateSliceGeometry(_fixedImage, s);
+
+        std::pair< unsigned int, unsigned int > FixedImageSlice(_fixedImage, s);
+        const SliceGeometry & FixedGeometry = m_SliceGeometry[this->ReturnStackIndexFromImageAndSlice(FixedImageSlice)];
+
+        for(unsigned int c = 0; c < 4; c++)
+        {
+            Corners[c] = FixedGeometry.TransformedEdgePoints[(c == 0) ? 0 : FixedGeometry.EdgeEnds[c-1]];
+        }
+
+        this->ComputeIndexBoundingBox(m_Images[_movingImage], m_InverseX, Corners, Min, Max);
+
+        candidates[s] = Max[0] >= -0.5 - margin && Min[0] <= MovingSize[0] - 0.5 + margin &&
+                        Max[1] >= -0.5 - margin && Min[1] <= MovingSize[1] - 0.5 + margin &&
+                        Max[2] >= _movingSlice - 0.5 - margin && Min[2] <= _movingSlice + 0.5 + margin;
+    }
 }
 //-------------------------------------------------------------------------------------------------
 template<class TImage>
@@ -480,21 +654,128 @@ GetTransformsWithParams(const vnl_vector<double> &x) const
 
         m_Transforms[im]->SetSliceParameters(sl,params);
     }
+
+    this->InvalidateAllSlicesGeometry();
 }
 
 //-------------------------------------------------------------------------------------------------
 template<class TImage>
 double SlicesIntersectionVNLCostFunction<TImage>::f(const vnl_vector<double> &x) const
+{
+    // The value may have been computed along with the gradient
+    if(m_CachedValueIsValid && x == m_CachedParameters)
+    {
+        return m_CachedValue;
+    }
+
+    return this->ComputeValueAndGradient(x, NULL);
+}
+//-------------------------------------------------------------------------------------------------
+template<class TImage>
+void SlicesIntersectionVNLCostFunction<TImage>::compute(const vnl_vector<double> &x, double *value, vnl_vector<double> *gradient)
+{
+    if(gradient)
+    {
+        *gradient = this->GetGradient(x);
 
+        if(value)
+        {
+            *value = m_CachedValue;
+        }
+    }
+    else if(value)
+    {
+        *value = this->f(x);
+    }
+}
+//-------------------------------------------------------------------------------------------------
+template<class TImage>
+void SlicesIntersectionVNLCostFunction<TImage>::
+EvaluateGradientAtContinuousIndex(const ImageType *image, const ContinuousIndexType &index, double gradient[3]) const
 {
+    // Derivatives of the trilinear interpolation (neighbors are clamped to the buffer, as the linear interpolator does)
+    const typename ImageType::RegionType & region = image->GetBufferedRegion();
+    const VoxelType *buffer = image->GetBufferPointer();
+
+    long i0[3], i1[3];
+    double w[3];
 
+    for(unsigned int d = 0; d < 3; d++)
+    {
+        long first = region.GetIndex()[d];
+        long last  = first + (long)region.GetSize()[d] - 1;
+        long base  = (long)std::floor(index[d]);
+
+        w[d]  = index[d] - base;
+        i0[d] = std::min(std::max(base, first), last) - first;
+        i1[d] = std::min(std::max(base + 1, first), last) - first;
+    }
 
+    const long nx = region.GetSize()[0];
+    const long ny = region.GetSize()[1];
+
+    double v[2][2][2];
+    for(unsigned int c = 0; c < 8; c++)
+    {
+        long ix = (c & 1) ? i1[0] : i0[0];
+        long iy = (c & 2) ? i1[1] : i0[1];
+        long iz = (c & 4) ? i1[2] : i0[2];
+
+        v[(c >> 2) & 1][(c >> 1) & 1][c & 1] = buffer[ix + nx * (iy + ny * iz)];
+    }
+
+    double wx[2] = { 1.0 - w[0], w[0] };
+    double wy[2] = { 1.0 - w[1], w[1] };
+    double wz[2] = { 1.0 - w[2], w[2] };
+
+    // v[z][y][x]
+    gradient[0] = gradient[1] = gradient[2] = 0.0;
+    for(unsigned int a = 0; a < 2; a++)
+    {
+        for(unsigned int b = 0; b < 2; b++)
+        {
+            gradient[0] += wz[a] * wy[b] * (v[a][b][1] - v[a][b][0]);
+            gradient[1] += wz[a] * wx[b] * (v[a][1][b] - v[a][0][b]);
+            gradient[2] += wy[a] * wx[b] * (v[1][a][b] - v[0][a][b]);
+        }
+    }
+}
+//-------------------------------------------------------------------------------------------------
+template<class TImage>
+void SlicesIntersectionVNLCostFunction<TImage>::
+ComputeParametersJacobian(const typename ImageType::PointType &point, vnl_matrix_fixed<double,3,6> &jacobian) const
+{
+    // Derivatives of m_X(point) with respect to the optimized parameters (angles are in degrees)
+    TransformType::JacobianType transformJacobian;
+    m_X->ComputeJacobianWithRespectToParameters(point, transformJacobian);
+
+    for(unsigned int i = 0; i < 3; i++)
+    {
+        for(unsigned int p = 0; p < 6; p++)
+        {
+            jacobian(i,p) = transformJacobian(i,p) * ( (p < 3) ? vnl_math::pi / 180.0 : 1.0 );
+        }
+    }
+}
+//-------------------------------------------------------------------------------------------------
+template<class TImage>
+double SlicesIntersectionVNLCostFunction<TImage>::ComputeValueAndGradient(const vnl_vector<double> &x, vnl_vector<double> *gradient) const
+{
     // Initials values
     double        CostFunction = 0.0;
     unsigned long NumberOfIntersectedVoxels = 0;
     double        SumOfIntersectedVoxels = 0.0;
     unsigned int  NumberOfIntersectedSlices = 0;
 
+    // Sum of the derivatives of the absolute differences (same role as SumOfIntersectedVoxels)
+    vnl_vector<double> SumOfDerivatives(6, 0.0);
+
+    if(gradient)
+    {
+        gradient->set_size(x.size());
+        gradient->fill(0.0);
+    }
+
     TransformType::ParametersType params;
     params.SetSize(x.size());
     params = m_X->GetParameters();
@@ -516,12 +797,35 @@ double SlicesIntersectionVNLCostFunction<TImage>::f(const vnl_vector<double> &x)
         std::cout<<"Input parameters : "<<params<<std::endl;
     }
 
+    // Derivatives of the continuous index of the moving image with respect to the physical point
+    vnl_matrix_fixed<double,3,3> MovingIndexJacobian;
+    if(gradient)
+    {
+        typename ImageType::PointType Origin, Shifted;
+        ContinuousIndexType OriginIndex, ShiftedIndex;
+        Origin.Fill(0.0);
+        m_Images[m_MovingImageNum]->TransformPhysicalPointToContinuousIndex(Origin, OriginIndex);
+
+        for(unsigned int j = 0; j < 3; j++)
+        {
+            Shifted = Origin;
+            Shifted[j] += 1.0;
+            m_Images[m_MovingImageNum]->TransformPhysicalPointToContinuousIndex(Shifted, ShiftedIndex);
+
+            for(unsigned int i = 0; i < 3; i++)
+            {
+                MovingIndexJacobian(i,j) = ShiftedIndex[i] - OriginIndex[i];
+            }
+        }
+    }
+
     for(unsigned int s = 0; s< m_SlicesGroup.size(); s++)
     {
         if(m_SlicesGroup[s] == m_GroupNum)
         {
             m_Transforms[m_MovingImageNum]->SetSliceParameters(s, params);
             m_Transforms[m_MovingImageNum]->GetInverse(m_InverseTransforms[m_MovingImageNum]);
+            this->InvalidateSliceGeometry(m_MovingImageNum, s);
             // Set Optimizer's parameters in transformation
             m_X->SetParameters(params);
 
@@ -531,6 +835,9 @@ double SlicesIntersectionVNLCostFunction<TImage>::f(const vnl_vector<double> &x)
 
             m_X->GetInverse(m_InverseX);
 
+            // Derivatives of m_InverseX(point) with respect to the point
+            vnl_matrix_fixed<double,3,3> InverseRotation = m_InverseX->GetMatrix().GetVnlMatrix();
+
             unsigned int ifixed = 0;
 
 
@@ -539,58 +846,46 @@ double SlicesIntersectionVNLCostFunction<TImage>::f(const vnl_vector<double> &x)
             {
                 unsigned int numberOfFixedSlices = m_Images[ifixed]->GetLargestPossibleRegion().GetSize()[2];
 
-                // Test if images are orthogonals, if not don't use it !
-                bool AreOrthos = btk::ImageHelper<ImageType>::AreOrthos(m_Images[m_MovingImageNum],m_Images[ifixed]);
-
-                // if current image is different of moving image AND if they are orthogonals
-                if(ifixed != m_MovingImageNum && AreOrthos)
+                // if current image is different of moving image AND if they are orthogonals (if not don't use it !)
+                if(ifixed != m_MovingImageNum && m_OrthogonalImages[ifixed])
                 {
-                    unsigned int sfixed = 0;
+                    int sfixed = 0;
+
+                    // Points of the edges of the fixed slices (only computed again if their transform has changed)
+                    #pragma omp parallel for private(sfixed) schedule(dynamic)
+                    for(sfixed = 0; sfixed < (int)numberOfFixedSlices; sfixed++)
+                    {
+                        this->UpdateSliceGeometry(ifixed, sfixed);
+                    }
+
+                    // Fixed slices that can not intersect the moving one are skipped
+                    std::vector< bool > CandidateSlices;
+                    this->ComputeCandidateSlices(ifixed, m_MovingImageNum, s, CandidateSlices);
+
+                    // Derivatives of the sum for each fixed slice (summed after the parallel loop)
+                    std::vector< vnl_vector<double> > SliceDerivatives;
+                    if(gradient)
+                    {
+                        SliceDerivatives.assign(numberOfFixedSlices, vnl_vector<double>(6, 0.0));
+                    }
 
                     /* PARALLELIZATION : Use of reduction to avoid use of #pragma omp critical
                      * Each thread have a local copy of both NumberOfIntersectedVoxels and SumOfIntersectedVoxels
                      * At the end we sum all local copys into a global one.
                      **/
                     #pragma omp parallel for private(sfixed) schedule(dynamic)\
-                    reduction(+:NumberOfIntersectedVoxels) reduction(+:SumOfIntersectedVoxels)
+                    reduction(+:NumberOfIntersectedVoxels) reduction(+:SumOfIntersectedVoxels) reduction(+:NumberOfIntersectedSlices)
 
-                    for(sfixed = 0; sfixed < numberOfFixedSlices; sfixed++)
+                    for(sfixed = 0; sfixed < (int)numberOfFixedSlices; sfixed++)
                     {
                         // Check for starting point and ending point
                         typename ImageType::PointType Point1, Point2;
+                        bool Point1OnMovingSlice = false, Point2OnMovingSlice = false;
 
                         /* Point 1 is the starting point, point 2 the ending one, if there is no intersection the function return false
                         the function is looking for an intersection between fixed slice (sfixed) in fixed image (ifixed)
                         and the moving one (m_MovingImageNum,m_MovingSliceNum) */
-
-                        //TODO: we can improve computed time by precomputing intersections points outside this loop (Point1, Point2 and intersection will be vectors)
-                        //Not sure if we loose time or not...
-                        //ITK
-                        bool intersection = this->FoundIntersectionPoints(ifixed,sfixed,m_MovingImageNum,s,Point1,Point2);
-
-
-                        //VTK
-//                        bool intersection = false;
-
-//                            typedef SliceIntersectionFilter<ImageType> intersectionFilter;
-//                            typename intersectionFilter::Pointer filter = intersectionFilter::New();
-//                            filter->SetImage1(m_Images[ifixed]);
-//                            filter->SetImage2(m_Images[m_MovingImageNum]);
-//                            filter->SetSlice1(sfixed);
-//                            filter->SetSlice2(s);
-//                            filter->SetTransform1(m_Transforms[ifixed]);
-//                            filter->SetTransform2(m_X);
-
-//                            filter->Update();
-
-//                            intersection = filter->GetIsIntersection();
-//                            Point1 = filter->GetPoint1();
-//                            Point2 = filter->GetPoint2();
-
-
-
-
-
+                        bool intersection = CandidateSlices[sfixed] && this->FoundIntersectionPoints(ifixed,sfixed,m_MovingImageNum,s,Point1,Point2,&Point1OnMovingSlice,&Point2OnMovingSlice);
 
                         // If we have found an intersection
                         if(intersection)
@@ -602,10 +897,7 @@ double SlicesIntersectionVNLCostFunction<TImage>::f(const vnl_vector<double> &x)
                             itk::Vector<double,3> P12;
                             typename Interpolator::ContinuousIndexType IndexFixed, IndexMoving;
                             typename ImageType::IndexType MaskIndexFx,MaskIndexMv;
-
-        //                    P12[0] = Point2[0] - Point1[0];
-        //                    P12[1] = Point2[1] - Point1[1];
-        //                    P12[2] = Point2[2] - Point1[2];
+                            bool FirstOnMovingSlice, LastOnMovingSlice;
 
                             //Looking for the first point and the last point :
                             double p1 = std::sqrt((Point1[0]* Point1[0]) + (Point1[1]* Point1[1]) + (Point1[2]* Point1[2]));
@@ -615,6 +907,8 @@ double SlicesIntersectionVNLCostFunction<TImage>::f(const vnl_vector<double> &x)
                             {
                                 Pfirst = Point2;
                                 Plast = Point1;
+                                FirstOnMovingSlice = Point2OnMovingSlice;
+                                LastOnMovingSlice = Point1OnMovingSlice;
                                //
                                 P12[0] = Point1[0] - Point2[0];
                                 P12[1] = Point1[1] - Point2[1];
@@ -625,6 +919,8 @@ double SlicesIntersectionVNLCostFunction<TImage>::f(const vnl_vector<double> &x)
                             {
                                 Pfirst = Point1;
                                 Plast = Point2;
+                                FirstOnMovingSlice = Point1OnMovingSlice;
+                                LastOnMovingSlice = Point2OnMovingSlice;
                                 //
                                 P12[0] = Point2[0] - Point1[0];
                                 P12[1] = Point2[1] - Point1[1];
@@ -636,25 +932,51 @@ double SlicesIntersectionVNLCostFunction<TImage>::f(const vnl_vector<double> &x)
                             double EuclideanDist = std::sqrt((P12[0]* P12[0]) + (P12[1]* P12[1]) + (P12[2]* P12[2]));
                             // Set the number of points equal to this distance times the spacing in mm (in x direction)
                             int NumberOfPoints = std::floor(EuclideanDist);// * m_Images[ifixed]->GetSpacing()[0];
-                            //std::cout<<"Using "<<NumberOfPoints<<" intersection points."<<std::endl;
-
 
-                            // Loop Over intersection line points
-                            //for(unsigned int i = 0; i<m_NumberOfPointsOfLine; i++)// user set a fixed number of points
-                            for(unsigned int i=0; i<NumberOfPoints;i++)// a point each mm
-                            //for(float i=0.0; i<NumberOfPoints; i=i+space)// a point each spacing
+                            // Geometry of the intersection line, used for the derivatives:
+                            // the end points found on the edges of the moving slice move with m_X, those found on the
+                            // edges of the fixed slice do not move, and the points of the line are interpolated between them.
+                            vnl_matrix_fixed<double,3,6> FirstJacobian, LastJacobian;
+                            vnl_matrix_fixed<double,3,3> FixedIndexJacobian;
+                            if(gradient && NumberOfPoints > 0)
                             {
-                                //P = Point1 + (P12 * i/(m_NumberOfPointsOfLine-1));//if m_NumberOfPointsOfLine is used
+                                FirstJacobian.fill(0.0);
+                                LastJacobian.fill(0.0);
 
-                                //Compute the point
-                                //P = Point1 + (P12 * i/(NumberOfPoints));
-                                P = Pfirst + (P12 * i/(NumberOfPoints));
+                                if(FirstOnMovingSlice)
+                                {
+                                    this->ComputeParametersJacobian(m_InverseX->TransformPoint(Pfirst), FirstJacobian);
+                                }
+                                if(LastOnMovingSlice)
+                                {
+                                    this->ComputeParametersJacobian(m_InverseX->TransformPoint(Plast), LastJacobian);
+                                }
 
+                                // Derivatives of the continuous index of the fixed image (the transform of the fixed slice is
+                                // affine, it is differentiated at the middle of the line)
+                                typename ImageType::PointType Middle = Pfirst + P12 * 0.5, Shifted;
+                                ContinuousIndexType MiddleIndex, ShiftedIndex;
+                                const double h = 1e-3;
+                                m_Images[ifixed]->TransformPhysicalPointToContinuousIndex(m_InverseTransforms[ifixed]->TransformPoint(Middle), MiddleIndex);
 
-                                //std::cout<<"P-->"<<P<<std::endl;
+                                for(unsigned int j = 0; j < 3; j++)
+                                {
+                                    Shifted = Middle;
+                                    Shifted[j] += h;
+                                    m_Images[ifixed]->TransformPhysicalPointToContinuousIndex(m_InverseTransforms[ifixed]->TransformPoint(Shifted), ShiftedIndex);
 
-                                //On peut accélerer ce calcul en travaillant dans l'espace image (?) de l'image moving
-                                //en optimisant également le nombre de test sur les masques
+                                    for(unsigned int i = 0; i < 3; i++)
+                                    {
+                                        FixedIndexJacobian(i,j) = (ShiftedIndex[i] - MiddleIndex[i]) / h;
+                                    }
+                                }
+                            }
+
+                            // Loop Over intersection line points
+                            for(int i=0; i<NumberOfPoints;i++)// a point each mm
+                            {
+                                //Compute the point
+                                P = Pfirst + (P12 * i/(NumberOfPoints));
 
                                 // Point in fixed image
                                 Pfixed = m_InverseTransforms[ifixed]->TransformPoint(P);
@@ -679,13 +1001,36 @@ double SlicesIntersectionVNLCostFunction<TImage>::f(const vnl_vector<double> &x)
                                         movingVoxel = m_Interpolators[m_MovingImageNum]->EvaluateAtContinuousIndex(IndexMoving);
                                         fixedVoxel = m_Interpolators[ifixed]->EvaluateAtContinuousIndex(IndexFixed);
 
-                                        //SumOfIntersectedVoxels += SquaredDifference(fixedVoxel,movingVoxel); // MSE
                                         SumOfIntersectedVoxels += AbsoluteDifference(fixedVoxel,movingVoxel); //MAE
-                                        //SumOfIntersectedVoxels += RootSquaredDifference(fixedVoxel,movingVoxel); //RSE
                                         NumberOfIntersectedVoxels++;// we count each point
 
-                                        //std::cout<<"Number of Points:"<<NumberOfIntersectedVoxels<<std::endl;
-
+                                        if(gradient && fixedVoxel != movingVoxel)
+                                        {
+                                            // Displacement of the point of the line, and of its position in the moving slice
+                                            double lambda = (double)i / NumberOfPoints;
+                                            vnl_matrix_fixed<double,3,6> PointJacobian = FirstJacobian * (1.0 - lambda) + LastJacobian * lambda;
+                                            vnl_matrix_fixed<double,3,6> MovingJacobian;
+                                            this->ComputeParametersJacobian(Pmoving, MovingJacobian);
+
+                                            vnl_matrix_fixed<double,3,6> FixedIndexDerivatives  = FixedIndexJacobian * PointJacobian;
+                                            vnl_matrix_fixed<double,3,6> MovingIndexDerivatives = MovingIndexJacobian * (InverseRotation * (PointJacobian - MovingJacobian));
+
+                                            double fixedGradient[3], movingGradient[3];
+                                            this->EvaluateGradientAtContinuousIndex(m_Images[ifixed], IndexFixed, fixedGradient);
+                                            this->EvaluateGradientAtContinuousIndex(m_Images[m_MovingImageNum], IndexMoving, movingGradient);
+
+                                            double sign = (fixedVoxel > movingVoxel) ? 1.0 : -1.0;
+
+                                            for(unsigned int p = 0; p < 6; p++)
+                                            {
+                                                double derivative = 0.0;
+                                                for(unsigned int d = 0; d < 3; d++)
+                                                {
+                                                    derivative += fixedGradient[d] * FixedIndexDerivatives(d,p) - movingGradient[d] * MovingIndexDerivatives(d,p);
+                                                }
+                                                SliceDerivatives[sfixed][p] += sign * derivative;
+                                            }
+                                        }
 
                                     }//End if inside masks
                                 }//End if IsInsideBuffer
@@ -693,6 +1038,14 @@ double SlicesIntersectionVNLCostFunction<TImage>::f(const vnl_vector<double> &x)
 
                         }//End If intersection
                     }//end of loop over SLICES
+
+                    if(gradient)
+                    {
+                        for(unsigned int sl = 0; sl < numberOfFixedSlices; sl++)
+                        {
+                            SumOfDerivatives += SliceDerivatives[sl];
+                        }
+                    }
                 }// end if image = reference
             }// end loop over IMAGES
 
@@ -701,6 +1054,13 @@ double SlicesIntersectionVNLCostFunction<TImage>::f(const vnl_vector<double> &x)
             {
                 CostFunction += (SumOfIntersectedVoxels/(double)NumberOfIntersectedVoxels *1.0) ;
 
+                if(gradient)
+                {
+                    for(unsigned int p = 0; p < 6 && p < x.size(); p++)
+                    {
+                        (*gradient)[p] += SumOfDerivatives[p] / (double)NumberOfIntersectedVoxels;
+                    }
+                }
             }
 
             if(m_VerboseMode)
@@ -720,16 +1080,22 @@ double SlicesIntersectionVNLCostFunction<TImage>::f(const vnl_vector<double> &x)
     {
         CostFunction = 0.0;
         m_Intersection = false;
+
+        if(gradient)
+        {
+            gradient->fill(0.0);
+        }
     }
     else
     {
         m_Intersection = true;
     }
 
-    return CostFunction;
-    //return CostFunction * CostFunction; //squared
-
+    m_CachedParameters   = x;
+    m_CachedValue        = CostFunction;
+    m_CachedValueIsValid = true;
 
+    return CostFunction;
 }
 //-------------------------------------------------------------------------------------------------
 template<class TImage>
@@ -47,6 +47,8 @@ knowledge of the CeCILL-B license and that you accept its terms.
 
 #include "itkChiSquareDistribution.h"
 
+#include "btkSlabSchedule.h"
+
 #include <string>
 #include <iomanip>
 #include <sstream>
@@ -845,60 +847,45 @@ void LabelFusionTool<T>::ComputeOutput()
     for(unsigned int i=0; i!= q.GetIndexDimension(); i++)
       q[i] = m_halfPatchSize[i];
 
-    if(m_blockwise == 1){
+    //step between two processed voxels : 1 for blockwise, halfPatchSize+1 for fast blockwise
+    int step[3] = {1, 1, 1};
+    if(m_blockwise == 1)
       std::cout<<"blockwise approach\n";
-      #pragma omp parallel for private(x,y,z) schedule(dynamic)
-      for(z=0; z < (int)m_size[2]; z++)
-        for(y=0; y < (int)m_size[1]; y++)
-          for(x=0; x < (int)m_size[0]; x++){
-	    typename itkTImage::IndexType p;
-	    p[0] = x;
-	    p[1] = y;
-	    p[2] = z;
-
-	    if( m_maskImage->GetPixel(p) > 0 ){	  
-	      itkTPointer patch = itkTImage::New();
-              double wmax;
-              if(m_normalization == 0) wmax = GetLabelPatch(p, patch);
-              else wmax = GetLabelPatchUsingNormalization(p, patch);
-              double weight = 1.0; //images of the training set have the same weight (basic option. the other option could be to set weight equal to sum)
-              if(m_aggregation == 0) weight = wmax;
-              if(patch->GetPixel(q) != -1){ // label = -1 means no relevant example has been found
-                #pragma omp critical
-                AddLabelPatchToLabelImage(p, patch, weight);
-              }
-	    }
-          }
-    }
     if(m_blockwise == 2){
       std::cout<<"fast blockwise approach\n";
-      #pragma omp parallel for private(x,y,z) schedule(dynamic)
-      for(z=0; z < (int)m_size[2]; z++)
-        if( z%(m_halfPatchSize[2]+1) == 0){
-        for(y=0; y < (int)m_size[1]; y++)
-          if( y%(m_halfPatchSize[1]+1) == 0){
-          for(x=0; x < (int)m_size[0]; x++)
-            if( x%(m_halfPatchSize[0]+1) == 0 ){
-	      typename itkTImage::IndexType p;
-	      p[0] = x;
-	      p[1] = y;
-	      p[2] = z;
-
-	      if( m_maskImage->GetPixel(p) > 0 ){	  
-  	        itkTPointer patch = itkTImage::New();
-                double wmax;
-                if(m_normalization == 0) wmax = GetLabelPatch(p, patch);
-                else wmax = GetLabelPatchUsingNormalization(p, patch);
-                double weight = 1.0; //images of the training set have the same weight (basic option. the other option could be to set weight equal to sum)
-                if(m_aggregation == 0) weight = wmax;
-                if(patch->GetPixel(q) != -1){ // label = -1 means no relevant example has been found
-                  #pragma omp critical
-                  AddLabelPatchToLabelImage(p, patch, weight);
+      for(unsigned int i=0; i<3; i++)
+        step[i] = m_halfPatchSize[i]+1;
+    }
+
+    //patches centered in slabs of the same colour do not overlap : no lock is needed for the aggregation
+    btk::SlabSchedule schedule(m_size[2], m_halfPatchSize[2]);
+
+    if(m_blockwise <= 2){
+      #pragma omp parallel private(x,y,z)
+      for(int color = 0; color < 2; color++){
+        #pragma omp for schedule(dynamic)
+        for(int slab = color; slab < schedule.GetNumberOfSlabs(); slab += 2)
+          for(z = schedule.GetSlabBegin(slab); z < schedule.GetSlabEnd(slab); z++)
+            if( z%step[2] == 0 )
+            for(y=0; y < (int)m_size[1]; y+=step[1])
+              for(x=0; x < (int)m_size[0]; x+=step[0]){
+                typename itkTImage::IndexType p;
+                p[0] = x;
+                p[1] = y;
+                p[2] = z;
+
+                if( m_maskImage->GetPixel(p) > 0 ){
+                  itkTPointer patch = itkTImage::New();
+                  double wmax;
+                  if(m_normalization == 0) wmax = GetLabelPatch(p, patch);
+                  else wmax = GetLabelPatchUsingNormalization(p, patch);
+                  double weight = 1.0; //images of the training set have the same weight (basic option. the other option could be to set weight equal to sum)
+                  if(m_aggregation == 0) weight = wmax;
+                  if(patch->GetPixel(q) != -1) // label = -1 means no relevant example has been found
+                    AddLabelPatchToLabelImage(p, patch, weight);
                 }
-	      }
-            }
-          }
-        }
+              }
+      }
     }
 
     std::cout<<"Find the highest weight and assign the final labels ...\n";
@@ -977,58 +964,44 @@ void LabelFusionTool<T>::ComputeOutput_groupwise()
     for(unsigned int i=0; i!= q.GetIndexDimension(); i++)
       q[i] = m_halfPatchSize[i];
 
-    if(m_blockwise == 1){
+    //step between two processed voxels : 1 for blockwise, halfPatchSize+1 for fast blockwise
+    int step[3] = {1, 1, 1};
+    if(m_blockwise == 1)
       std::cout<<"blockwise approach\n";
-      #pragma omp parallel for private(x,y,z) schedule(dynamic)
-      for(z=0; z < (int)m_size[2]; z++)
-        for(y=0; y < (int)m_size[1]; y++)
-          for(x=0; x < (int)m_size[0]; x++){
-            typename itkTImage::IndexType p;
-            p[0] = x;
-            p[1] = y;
-            p[2] = z;
-
-            if( m_maskImage->GetPixel(p) > 0 ){	  
-              itkTPointer patch = itkTImage::New();
-
-              //vector (1D patch) to store the cumulative weight for each label
-              std::vector< std::map<T, float> > vectorMap;
-              GetFuzzyLabelPatch(p, patch, vectorMap);
-
-              #pragma omp critical
-              AddFuzzyLabelPatchToLabelImage(p, patch, vectorMap);
-
-            }
-          }
-    }
     if(m_blockwise == 2){
       std::cout<<"fast blockwise approach\n";
-      #pragma omp parallel for private(x,y,z) schedule(dynamic)
-      for(z=0; z < (int)m_size[2]; z++)
-        if( z%(m_halfPatchSize[2]+1) == 0){
-        for(y=0; y < (int)m_size[1]; y++)
-          if( y%(m_halfPatchSize[1]+1) == 0){
-          for(x=0; x < (int)m_size[0]; x++)
-            if( x%(m_halfPatchSize[0]+1) == 0 ){
-              typename itkTImage::IndexType p;
-              p[0] = x;
-              p[1] = y;
-              p[2] = z;
-
-              if( m_maskImage->GetPixel(p) > 0 ){	  
-                itkTPointer patch = itkTImage::New();
-
-                //vector (1D patch) to store the cumulative weight for each label
-                std::vector< std::map<T, float> > vectorMap;
-                GetFuzzyLabelPatch(p, patch, vectorMap);
-
-                #pragma omp critical
-                AddFuzzyLabelPatchToLabelImage(p, patch, vectorMap);
+      for(unsigned int i=0; i<3; i++)
+        step[i] = m_halfPatchSize[i]+1;
+    }
 
+    //patches centered in slabs of the same colour do not overlap : no lock is needed for the aggregation
+    btk::SlabSchedule schedule(m_size[2], m_halfPatchSize[2]);
+
+    if(m_blockwise <= 2){
+      #pragma omp parallel private(x,y,z)
+      for(int color = 0; color < 2; color++){
+        #pragma omp for schedule(dynamic)
+        for(int slab = color; slab < schedule.GetNumberOfSlabs(); slab += 2)
+          for(z = schedule.GetSlabBegin(slab); z < schedule.GetSlabEnd(slab); z++)
+            if( z%step[2] == 0 )
+            for(y=0; y < (int)m_size[1]; y+=step[1])
+              for(x=0; x < (int)m_size[0]; x+=step[0]){
+                typename itkTImage::IndexType p;
+                p[0] = x;
+                p[1] = y;
+                p[2] = z;
+
+                if( m_maskImage->GetPixel(p) > 0 ){
+                  itkTPointer patch = itkTImage::New();
+
+                  //vector (1D patch) to store the cumulative weight for each label
+                  std::vector< std::map<T, float> > vectorMap;
+                  GetFuzzyLabelPatch(p, patch, vectorMap);
+
+                  AddFuzzyLabelPatchToLabelImage(p, patch, vectorMap);
+                }
               }
-            }
-          }
-        }
+      }
     }
 
     std::cout<<"Find the highest weight and assign the final labels ...\n";
@@ -1110,52 +1083,42 @@ void LabelFusionTool<T>::ComputeDenoisedOutput()
   }
   if(m_blockwise >= 1){
 
-    if(m_blockwise == 1){
+    //step between two processed voxels : 1 for blockwise, halfPatchSize+1 for fast blockwise
+    int step[3] = {1, 1, 1};
+    if(m_blockwise == 1)
       std::cout<<"blockwise denoising\n";
-      #pragma omp parallel for private(x,y,z) schedule(dynamic)
-      for(z=0; z < (int)m_size[2]; z++)
-        for(y=0; y < (int)m_size[1]; y++)
-          for(x=0; x < (int)m_size[0]; x++){
-            typename itkTImage::IndexType p;
-            p[0] = x;
-            p[1] = y;
-            p[2] = z;
-
-            if( m_maskImage->GetPixel(p) > 0 ){	  
-              itkFloatPointer patch = itkFloatImage::New();
-              double sum = GetDenoisedPatch(p, patch);             
-              double weight = 1.0;
-              if(m_aggregation == 0) weight = sum;
-              #pragma omp critical
-              AddPatchToImage(p, patch, denoisedImage, m_weightImage, weight);
-            }
-          }
-    }
     if(m_blockwise == 2){
       std::cout<<"fast blockwise denoising\n";
-      #pragma omp parallel for private(x,y,z) schedule(dynamic)
-      for(z=0; z < (int)m_size[2]; z++)
-        if( z%(m_halfPatchSize[2]+1) == 0){
-        for(y=0; y < (int)m_size[1]; y++)
-          if( y%(m_halfPatchSize[1]+1) == 0){
-          for(x=0; x < (int)m_size[0]; x++)
-            if( x%(m_halfPatchSize[0]+1) == 0 ){
-              typename itkTImage::IndexType p;
-              p[0] = x;
-              p[1] = y;
-              p[2] = z;
-
-              if( m_maskImage->GetPixel(p) > 0 ){	  
-                itkFloatPointer patch = itkFloatImage::New();
-                double sum = GetDenoisedPatch(p, patch);
-                double weight = 1.0;
-                if(m_aggregation == 0) weight = sum;
-                #pragma omp critical
-                AddPatchToImage(p, patch, denoisedImage, m_weightImage, weight);
+      for(unsigned int i=0; i<3; i++)
+        step[i] = m_halfPatchSize[i]+1;
+    }
+
+    //patches centered in slabs of the same colour do not overlap : no lock is needed for the aggregation
+    btk::SlabSchedule schedule(m_size[2], m_halfPatchSize[2]);
+
+    if(m_blockwise <= 2){
+      #pragma omp parallel private(x,y,z)
+      for(int color = 0; color < 2; color++){
+        #pragma omp for schedule(dynamic)
+        for(int slab = color; slab < schedule.GetNumberOfSlabs(); slab += 2)
+          for(z = schedule.GetSlabBegin(slab); z < schedule.GetSlabEnd(slab); z++)
+            if( z%step[2] == 0 )
+            for(y=0; y < (int)m_size[1]; y+=step[1])
+              for(x=0; x < (int)m_size[0]; x+=step[0]){
+                typename itkTImage::IndexType p;
+                p[0] = x;
+                p[1] = y;
+                p[2] = z;
+
+                if( m_maskImage->GetPixel(p) > 0 ){
+                  itkFloatPointer patch = itkFloatImage::New();
+                  double sum = GetDenoisedPatch(p, patch);
+                  double weight = 1.0;
+                  if(m_aggregation == 0) weight = sum;
+                  AddPatchToImage(p, patch, denoisedImage, m_weightImage, weight);
+                }
               }
-            }
-          }
-        }
+      }
     }
 
     itkTIterator maskImageIt( m_maskImage, m_maskImage->GetLargestPossibleRegion() );
@@ -1224,54 +1187,44 @@ void LabelFusionTool<T>::ComputeHROutput()
   }
   if(m_blockwise >= 1){
     
-    if(m_blockwise == 1){
+    //step between two processed voxels : 1 for blockwise, halfPatchSize+1 for fast blockwise
+    int step[3] = {1, 1, 1};
+    if(m_blockwise == 1)
       std::cout<<"blockwise HR estimation\n";
-      #pragma omp parallel for private(x,y,z) schedule(dynamic)
-      for(z=0; z < (int)m_size[2]; z++)
-        for(y=0; y < (int)m_size[1]; y++)
-          for(x=0; x < (int)m_size[0]; x++){
-            typename itkTImage::IndexType p;
-            p[0] = x;
-            p[1] = y;
-            p[2] = z;
-            
-            if( m_maskImage->GetPixel(p) > 0 ){	  
-              itkFloatPointer patch = itkFloatImage::New();
-              double sum = GetHRPatch(p, patch);             
-              double weight = 1.0;
-              if(m_aggregation == 0) weight = sum;
-              #pragma omp critical
-              AddPatchToImage(p, patch, HRImage, m_weightImage, weight);
-            }
-          }
-    }
     if(m_blockwise == 2){
       std::cout<<"fast blockwise HR estimation\n";
-      #pragma omp parallel for private(x,y,z) schedule(dynamic)
-      for(z=0; z < (int)m_size[2]; z++)
-        if( z%(m_halfPatchSize[2]+1) == 0){
-          for(y=0; y < (int)m_size[1]; y++)
-            if( y%(m_halfPatchSize[1]+1) == 0){
-              for(x=0; x < (int)m_size[0]; x++)
-                if( x%(m_halfPatchSize[0]+1) == 0 ){
-                  typename itkTImage::IndexType p;
-                  p[0] = x;
-                  p[1] = y;
-                  p[2] = z;
-                  
-                  if( m_maskImage->GetPixel(p) > 0 ){	  
-                    itkFloatPointer patch = itkFloatImage::New();
-                    double sum = GetHRPatch(p, patch);
-                    double weight = 1.0;
-                    if(m_aggregation == 0) weight = sum;
-                    #pragma omp critical
-                    AddPatchToImage(p, patch, HRImage, m_weightImage, weight);
-                  }
+      for(unsigned int i=0; i<3; i++)
+        step[i] = m_halfPatchSize[i]+1;
+    }
+
+    //patches centered in slabs of the same colour do not overlap : no lock is needed for the aggregation
+    btk::SlabSchedule schedule(m_size[2], m_halfPatchSize[2]);
+
+    if(m_blockwise <= 2){
+      #pragma omp parallel private(x,y,z)
+      for(int color = 0; color < 2; color++){
+        #pragma omp for schedule(dynamic)
+        for(int slab = color; slab < schedule.GetNumberOfSlabs(); slab += 2)
+          for(z = schedule.GetSlabBegin(slab); z < schedule.GetSlabEnd(slab); z++)
+            if( z%step[2] == 0 )
+            for(y=0; y < (int)m_size[1]; y+=step[1])
+              for(x=0; x < (int)m_size[0]; x+=step[0]){
+                typename itkTImage::IndexType p;
+                p[0] = x;
+                p[1] = y;
+                p[2] = z;
+
+                if( m_maskImage->GetPixel(p) > 0 ){
+                  itkFloatPointer patch = itkFloatImage::New();
+                  double sum = GetHRPatch(p, patch);
+                  double weight = 1.0;
+                  if(m_aggregation == 0) weight = sum;
+                  AddPatchToImage(p, patch, HRImage, m_weightImage, weight);
                 }
-            }
-        }
+              }
+      }
     }
-    
+
     itkTIterator maskImageIt( m_maskImage, m_maskImage->GetLargestPossibleRegion() );
     itkFloatIterator weightIt( m_weightImage, m_weightImage->GetLargestPossibleRegion() );
     //weight normalization    
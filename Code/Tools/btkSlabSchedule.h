@@ -0,0 +1,118 @@
+/*==========================================================================
+
+  © Université de Strasbourg - Centre National de la Recherche Scientifique
+
+  Date: 18/10/2026
+  Author(s): agent (agent@local)
+
+  This software is governed by the CeCILL-B license under French law and
+  abiding by the rules of distribution of free software.  You can  use,
+  modify and/ or redistribute the software under the terms of the CeCILL-B
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and  rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty  and the software's author,  the holder of the
+  economic rights,  and the successive licensors  have only  limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading,  using,  modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean  that it is complicated to manipulate,  and  that  also
+  therefore means  that it is reserved for developers  and  experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and,  more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL-B license and that you accept its terms.
+
+==========================================================================*/
+
+#ifndef BTK_SLAB_SCHEDULE_H
+#define BTK_SLAB_SCHEDULE_H
+
+namespace btk
+{
+
+/**
+ * @class SlabSchedule
+ * @brief Two-colour partition of an image into z-slabs for lock-free blockwise aggregation.
+ *
+ * The image is cut into slabs of at least 2 * halfPatchSize slices. A patch centered in a slab
+ * can only write into this slab and its two direct neighbours, so slabs of the same colour
+ * (even or odd slab index) never write to the same voxels and can be processed concurrently
+ * without any lock:
+ * @code
+ * for(int color = 0; color < 2; color++)
+ * {
+ *   #pragma omp for schedule(dynamic)
+ *   for(int slab = color; slab < schedule.GetNumberOfSlabs(); slab += 2)
+ *     for(int z = schedule.GetSlabBegin(slab); z < schedule.GetSlabEnd(slab); z++)
+ *       ... aggregate the patch centered at z ...
+ * }
+ * @endcode
+ * The implicit barrier at the end of each omp for loop separates the two colours. Since each voxel
+ * receives its contributions in a fixed order, the result does not depend on the number of threads.
+ * @author agent
+ * @ingroup Tools
+ */
+class SlabSchedule
+{
+public:
+    /**
+     * @brief Constructor.
+     * @param imageSize Number of slices of the image (size along z).
+     * @param halfPatchSize Half size of the patches along z.
+     */
+    SlabSchedule(unsigned int imageSize, unsigned int halfPatchSize)
+    {
+        m_ImageSize      = static_cast< int >(imageSize);
+        m_SlabThickness  = 2 * static_cast< int >(halfPatchSize);
+
+        if(m_SlabThickness < 1)
+        {
+            m_SlabThickness = 1;
+        }
+
+        m_NumberOfSlabs = (m_ImageSize + m_SlabThickness - 1) / m_SlabThickness;
+    }
+
+    /**
+     * @brief Number of slabs (both colours).
+     */
+    int GetNumberOfSlabs() const
+    {
+        return m_NumberOfSlabs;
+    }
+
+    /**
+     * @brief First slice of a slab.
+     */
+    int GetSlabBegin(int slab) const
+    {
+        return slab * m_SlabThickness;
+    }
+
+    /**
+     * @brief Last slice (excluded) of a slab.
+     */
+    int GetSlabEnd(int slab) const
+    {
+        int end = (slab + 1) * m_SlabThickness;
+        return (end < m_ImageSize) ? end : m_ImageSize;
+    }
+
+private:
+    int m_ImageSize;     /**< Number of slices */
+    int m_SlabThickness; /**< Number of slices of a slab */
+    int m_NumberOfSlabs; /**< Number of slabs */
+};
+
+} // namespace btk
+
+#endif // BTK_SLAB_SCHEDULE_H
@@ -0,0 +1,647 @@
+/*==========================================================================
+
+  © Université de Strasbourg - Centre National de la Recherche Scientifique
+
+  Date: 18/10/2026
+  Author(s): agent (agent@local)
+
+  This software is governed by the CeCILL-B license under French law and
+  abiding by the rules of distribution of free software.  You can  use,
+  modify and/ or redistribute the software under the terms of the CeCILL-B
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and  rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty  and the software's author,  the holder of the
+  economic rights,  and the successive licensors  have only  limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading,  using,  modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean  that it is complicated to manipulate,  and  that  also
+  therefore means  that it is reserved for developers  and  experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and,  more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL-B license and that you accept its terms.
+
+==========================================================================*/
+
+
+#include "btkFiberDistanceEngine.h"
+
+// STL includes
+#include "algorithm"
+#include "limits"
+#include "cmath"
+
+
+namespace btk
+{
+
+/**
+ * @brief Compare the centers of two bounding boxes along an axis (used to split the k-d tree).
+ */
+class FiberBoundsCenterComparison
+{
+    public:
+        FiberBoundsCenterComparison(const float *bounds, unsigned int axis) : m_Bounds(bounds), m_Axis(axis)
+        {
+            // ----
+        }
+
+        bool operator()(unsigned int a, unsigned int b) const
+        {
+            return m_Bounds[6*a + 2*m_Axis] + m_Bounds[6*a + 2*m_Axis + 1] < m_Bounds[6*b + 2*m_Axis] + m_Bounds[6*b + 2*m_Axis + 1];
+        }
+
+    private:
+        const float *m_Bounds;
+        unsigned int m_Axis;
+};
+
+//----------------------------------------------------------------------------------------
+
+FiberDistanceEngine::FiberDistanceEngine() : m_NumberOfPointsPerFiber(20), m_DistanceType(ASYMMETRIC_CHAMFER), m_Alpha(0.5f), m_NumberOfFibers(0)
+{
+    // ----
+}
+
+//----------------------------------------------------------------------------------------
+
+unsigned int FiberDistanceEngine::GetNumberOfFibers() const
+{
+    return m_NumberOfFibers;
+}
+
+//----------------------------------------------------------------------------------------
+
+void FiberDistanceEngine::SetFibers(const std::vector< std::vector< float > > & fibers)
+{
+    m_NumberOfPointsPerFiber = std::max(2u, std::min(m_NumberOfPointsPerFiber, (unsigned int)MaximumNumberOfPointsPerFiber));
+    m_NumberOfFibers = fibers.size();
+
+    unsigned int numberOfPoints   = m_NumberOfPointsPerFiber;
+    unsigned int numberOfSegments = m_NumberOfPointsPerFiber - 1;
+
+    m_X.assign(m_NumberOfFibers * numberOfPoints, 0.0f);
+    m_Y.assign(m_NumberOfFibers * numberOfPoints, 0.0f);
+    m_Z.assign(m_NumberOfFibers * numberOfPoints, 0.0f);
+    m_DirectionX.assign(m_NumberOfFibers * numberOfSegments, 0.0f);
+    m_DirectionY.assign(m_NumberOfFibers * numberOfSegments, 0.0f);
+    m_DirectionZ.assign(m_NumberOfFibers * numberOfSegments, 0.0f);
+    m_Bounds.assign(m_NumberOfFibers * 6, 0.0f);
+
+    int i;
+
+    #pragma omp parallel for private(i) schedule(dynamic,256)
+    for(i = 0; i < (int)m_NumberOfFibers; i++)
+    {
+        this->ResampleFiber(fibers[i], i);
+        this->ComputeFiberGeometry(i);
+    }
+
+    this->BuildTree();
+}
+
+//----------------------------------------------------------------------------------------
+
+void FiberDistanceEngine::ResampleFiber(const std::vector< float > & points, unsigned int fiber)
+{
+    float *x = &m_X[fiber * m_NumberOfPointsPerFiber];
+    float *y = &m_Y[fiber * m_NumberOfPointsPerFiber];
+    float *z = &m_Z[fiber * m_NumberOfPointsPerFiber];
+
+    unsigned int numberOfInputPoints = points.size() / 3;
+
+    if(numberOfInputPoints == 0)
+    {
+        return;
+    }
+
+    // Cumulative arc length
+    std::vector< float > length(numberOfInputPoints, 0.0f);
+
+    for(unsigned int p = 1; p < numberOfInputPoints; p++)
+    {
+        float dx = points[3*p+0] - points[3*(p-1)+0];
+        float dy = points[3*p+1] - points[3*(p-1)+1];
+        float dz = points[3*p+2] - points[3*(p-1)+2];
+
+        length[p] = length[p-1] + std::sqrt(dx*dx + dy*dy + dz*dz);
+    }
+
+    float totalLength = length[numberOfInputPoints-1];
+
+    if(totalLength <= 0.0f)
+    {
+        std::fill(x, x + m_NumberOfPointsPerFiber, points[0]);
+        std::fill(y, y + m_NumberOfPointsPerFiber, points[1]);
+        std::fill(z, z + m_NumberOfPointsPerFiber, points[2]);
+        return;
+    }
+
+    // Points uniformly spaced along the fiber (linear interpolation on the segments)
+    unsigned int segment = 0;
+
+    for(unsigned int k = 0; k < m_NumberOfPointsPerFiber; k++)
+    {
+        float s = totalLength * k / (m_NumberOfPointsPerFiber - 1);
+
+        while(segment < numberOfInputPoints - 2 && length[segment+1] < s)
+        {
+            segment++;
+        }
+
+        float segmentLength = length[segment+1] - length[segment];
+        float t = (segmentLength > 0.0f) ? (s - length[segment]) / segmentLength : 0.0f;
+        t = std::max(0.0f, std::min(1.0f, t));
+
+        x[k] = (1.0f - t) * points[3*segment+0] + t * points[3*(segment+1)+0];
+        y[k] = (1.0f - t) * points[3*segment+1] + t * points[3*(segment+1)+1];
+        z[k] = (1.0f - t) * points[3*segment+2] + t * points[3*(segment+1)+2];
+    }
+}
+
+//----------------------------------------------------------------------------------------
+
+void FiberDistanceEngine::ComputeFiberGeometry(unsigned int fiber)
+{
+    const float *x = &m_X[fiber * m_NumberOfPointsPerFiber];
+    const float *y = &m_Y[fiber * m_NumberOfPointsPerFiber];
+    const float *z = &m_Z[fiber * m_NumberOfPointsPerFiber];
+
+    float *bounds = &m_Bounds[6 * fiber];
+    bounds[0] = *std::min_element(x, x + m_NumberOfPointsPerFiber);
+    bounds[1] = *std::max_element(x, x + m_NumberOfPointsPerFiber);
+    bounds[2] = *std::min_element(y, y + m_NumberOfPointsPerFiber);
+    bounds[3] = *std::max_element(y, y + m_NumberOfPointsPerFiber);
+    bounds[4] = *std::min_element(z, z + m_NumberOfPointsPerFiber);
+    bounds[5] = *std::max_element(z, z + m_NumberOfPointsPerFiber);
+
+    unsigned int numberOfSegments = m_NumberOfPointsPerFiber - 1;
+    float *u = &m_DirectionX[fiber * numberOfSegments];
+    float *v = &m_DirectionY[fiber * numberOfSegments];
+    float *w = &m_DirectionZ[fiber * numberOfSegments];
+
+    for(unsigned int s = 0; s < numberOfSegments; s++)
+    {
+        float dx = x[s+1] - x[s];
+        float dy = y[s+1] - y[s];
+        float dz = z[s+1] - z[s];
+        float norm = std::sqrt(dx*dx + dy*dy + dz*dz);
+
+        if(norm > 0.0f)
+        {
+            u[s] = dx / norm;
+            v[s] = dy / norm;
+            w[s] = dz / norm;
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------
+
+void FiberDistanceEngine::ComputeDirectedDistances(unsigned int i, unsigned int j, float & chamfer, float & hausdorff) const
+{
+    const unsigned int numberOfPoints = m_NumberOfPointsPerFiber;
+
+    const float *xi = &m_X[i * numberOfPoints], *yi = &m_Y[i * numberOfPoints], *zi = &m_Z[i * numberOfPoints];
+    const float *xj = &m_X[j * numberOfPoints], *yj = &m_Y[j * numberOfPoints], *zj = &m_Z[j * numberOfPoints];
+
+    // Squared distance of each point of fiber i to fiber j.
+    // The inner loop runs over the points of fiber i, so that it is vectorized (no reduction).
+    float distances[MaximumNumberOfPointsPerFiber];
+    std::fill(distances, distances + numberOfPoints, std::numeric_limits< float >::max());
+
+    for(unsigned int b = 0; b < numberOfPoints; b++)
+    {
+        const float bx = xj[b], by = yj[b], bz = zj[b];
+
+        for(unsigned int a = 0; a < numberOfPoints; a++)
+        {
+            float dx = xi[a] - bx;
+            float dy = yi[a] - by;
+            float dz = zi[a] - bz;
+            float d  = dx*dx + dy*dy + dz*dz;
+
+            distances[a] = (d < distances[a]) ? d : distances[a];
+        }
+    }
+
+    float sum = 0.0f, maximum = 0.0f;
+
+    for(unsigned int a = 0; a < numberOfPoints; a++)
+    {
+        sum     += std::sqrt(distances[a]);
+        maximum  = std::max(maximum, distances[a]);
+    }
+
+    chamfer   = sum / numberOfPoints;
+    hausdorff = std::sqrt(maximum);
+}
+
+//----------------------------------------------------------------------------------------
+
+float FiberDistanceEngine::Chamfer(unsigned int i, unsigned int j) const
+{
+    if(i == j)
+    {
+        return 0.0f;
+    }
+
+    float chamfer, hausdorff;
+    this->ComputeDirectedDistances(i, j, chamfer, hausdorff);
+
+    return chamfer;
+}
+
+//----------------------------------------------------------------------------------------
+
+float FiberDistanceEngine::Hausdorff(unsigned int i, unsigned int j) const
+{
+    if(i == j)
+    {
+        return 0.0f;
+    }
+
+    float chamfer, hausdorff;
+    this->ComputeDirectedDistances(i, j, chamfer, hausdorff);
+
+    return hausdorff;
+}
+
+//----------------------------------------------------------------------------------------
+
+float FiberDistanceEngine::Orientation(unsigned int i, unsigned int j) const
+{
+    if(i == j)
+    {
+        return 0.0f;
+    }
+
+    const unsigned int numberOfSegments = m_NumberOfPointsPerFiber - 1;
+
+    const float *ui = &m_DirectionX[i * numberOfSegments], *vi = &m_DirectionY[i * numberOfSegments], *wi = &m_DirectionZ[i * numberOfSegments];
+    const float *uj = &m_DirectionX[j * numberOfSegments], *vj = &m_DirectionY[j * numberOfSegments], *wj = &m_DirectionZ[j * numberOfSegments];
+
+    float orientation = 0.0f;
+
+    for(unsigned int s = 0; s < numberOfSegments; s++)
+    {
+        orientation += 1.0f - std::fabs(ui[s]*uj[s] + vi[s]*vj[s] + wi[s]*wj[s]);
+    }
+
+    return orientation;
+}
+
+//----------------------------------------------------------------------------------------
+
+float FiberDistanceEngine::MinimumAverageDirectFlip(unsigned int i, unsigned int j) const
+{
+    if(i == j)
+    {
+        return 0.0f;
+    }
+
+    const unsigned int numberOfPoints = m_NumberOfPointsPerFiber;
+
+    const float *xi = &m_X[i * numberOfPoints], *yi = &m_Y[i * numberOfPoints], *zi = &m_Z[i * numberOfPoints];
+    const float *xj = &m_X[j * numberOfPoints], *yj = &m_Y[j * numberOfPoints], *zj = &m_Z[j * numberOfPoints];
+
+    float direct = 0.0f, flip = 0.0f;
+
+    for(unsigned int k = 0; k < numberOfPoints; k++)
+    {
+        float dx = xi[k] - xj[k];
+        float dy = yi[k] - yj[k];
+        float dz = zi[k] - zj[k];
+
+        direct += std::sqrt(dx*dx + dy*dy + dz*dz);
+    }
+
+    for(unsigned int k = 0; k < numberOfPoints; k++)
+    {
+        unsigned int l = numberOfPoints - 1 - k;
+        float dx = xi[k] - xj[l];
+        float dy = yi[k] - yj[l];
+        float dz = zi[k] - zj[l];
+
+        flip += std::sqrt(dx*dx + dy*dy + dz*dz);
+    }
+
+    return std::min(direct, flip) / numberOfPoints;
+}
+
+//----------------------------------------------------------------------------------------
+
+float FiberDistanceEngine::Evaluate(unsigned int i, unsigned int j) const
+{
+    if(i == j)
+    {
+        return 0.0f;
+    }
+
+    float chamferIJ = 0.0f, hausdorffIJ = 0.0f, chamferJI = 0.0f, hausdorffJI = 0.0f;
+
+    switch(m_DistanceType)
+    {
+        case ASYMMETRIC_CHAMFER:
+            return this->Chamfer(i, j);
+
+        case ASYMMETRIC_HAUSDORFF:
+            return this->Hausdorff(i, j);
+
+        case CHAMFER_HAUSDORFF:
+            this->ComputeDirectedDistances(i, j, chamferIJ, hausdorffIJ);
+            return m_Alpha * hausdorffIJ + (1.0f - m_Alpha) * chamferIJ;
+
+        case SYMMETRIC_CHAMFER:
+        case SYMMETRIC_HAUSDORFF:
+        case SYMMETRIC_CHAMFER_HAUSDORFF:
+        case ORIENTATION_SYMMETRIC_CHAMFER:
+        case ORIENTATION_SYMMETRIC_HAUSDORFF:
+            this->ComputeDirectedDistances(i, j, chamferIJ, hausdorffIJ);
+            this->ComputeDirectedDistances(j, i, chamferJI, hausdorffJI);
+            break;
+
+        case ORIENTATION:
+            return this->Orientation(i, j);
+
+        case MINIMUM_AVERAGE_DIRECT_FLIP:
+            return this->MinimumAverageDirectFlip(i, j);
+    }
+
+    float chamfer   = 0.5f * (chamferIJ + chamferJI);
+    float hausdorff = 0.5f * (hausdorffIJ + hausdorffJI);
+
+    switch(m_DistanceType)
+    {
+        case SYMMETRIC_CHAMFER:
+            return chamfer;
+
+        case SYMMETRIC_HAUSDORFF:
+            return hausdorff;
+
+        case SYMMETRIC_CHAMFER_HAUSDORFF:
+            return m_Alpha * hausdorff + (1.0f - m_Alpha) * chamfer;
+
+        case ORIENTATION_SYMMETRIC_CHAMFER:
+            return m_Alpha * this->Orientation(i, j) + (1.0f - m_Alpha) * chamfer;
+
+        case ORIENTATION_SYMMETRIC_HAUSDORFF:
+            return m_Alpha * this->Orientation(i, j) + (1.0f - m_Alpha) * hausdorff;
+
+        default:
+            return 0.0f;
+    }
+}
+
+//----------------------------------------------------------------------------------------
+
+float FiberDistanceEngine::BoxDistance(const float *a, const float *b)
+{
+    float distance = 0.0f;
+
+    for(unsigned int axis = 0; axis < 3; axis++)
+    {
+        float gap = std::max(0.0f, std::max(b[2*axis] - a[2*axis+1], a[2*axis] - b[2*axis+1]));
+        distance += gap * gap;
+    }
+
+    return std::sqrt(distance);
+}
+
+//----------------------------------------------------------------------------------------
+
+float FiberDistanceEngine::BoundingBoxDistance(unsigned int i, unsigned int j) const
+{
+    return BoxDistance(&m_Bounds[6*i], &m_Bounds[6*j]);
+}
+
+//----------------------------------------------------------------------------------------
+
+float FiberDistanceEngine::GetLowerBoundFactor() const
+{
+    // Any point of fiber i is at least at the distance between the bounding boxes from any
+    // point of fiber j, so all point-based distances are larger than the boxes distance.
+    switch(m_DistanceType)
+    {
+        case ORIENTATION_SYMMETRIC_CHAMFER:
+        case ORIENTATION_SYMMETRIC_HAUSDORFF:
+            return 1.0f - m_Alpha;
+
+        case ORIENTATION:
+            return 0.0f;
+
+        default:
+            return 1.0f;
+    }
+}
+
+//----------------------------------------------------------------------------------------
+
+void FiberDistanceEngine::BuildTree()
+{
+    m_TreeNodes.clear();
+    m_TreeFibers.resize(m_NumberOfFibers);
+
+    for(unsigned int i = 0; i < m_NumberOfFibers; i++)
+    {
+        m_TreeFibers[i] = i;
+    }
+
+    if(m_NumberOfFibers > 0)
+    {
+        m_TreeNodes.reserve(2 * m_NumberOfFibers / 8 + 1);
+        this->BuildNode(0, m_NumberOfFibers);
+    }
+}
+
+//----------------------------------------------------------------------------------------
+
+unsigned int FiberDistanceEngine::BuildNode(unsigned int first, unsigned int count)
+{
+    unsigned int index = m_TreeNodes.size();
+    m_TreeNodes.push_back(TreeNode());
+
+    // Union of the bounding boxes and extent of their centers
+    TreeNode node;
+    float centerBounds[6];
+
+    for(unsigned int axis = 0; axis < 3; axis++)
+    {
+        node.bounds[2*axis]   = centerBounds[2*axis]   =  std::numeric_limits< float >::max();
+        node.bounds[2*axis+1] = centerBounds[2*axis+1] = -std::numeric_limits< float >::max();
+    }
+
+    for(unsigned int f = first; f < first + count; f++)
+    {
+        const float *bounds = &m_Bounds[6 * m_TreeFibers[f]];
+
+        for(unsigned int axis = 0; axis < 3; axis++)
+        {
+            float center = 0.5f * (bounds[2*axis] + bounds[2*axis+1]);
+
+            node.bounds[2*axis]   = std::min(node.bounds[2*axis], bounds[2*axis]);
+            node.bounds[2*axis+1] = std::max(node.bounds[2*axis+1], bounds[2*axis+1]);
+            centerBounds[2*axis]   = std::min(centerBounds[2*axis], center);
+            centerBounds[2*axis+1] = std::max(centerBounds[2*axis+1], center);
+        }
+    }
+
+    node.first = first;
+    node.count = count;
+    node.left  = 0;
+    node.right = 0;
+
+    // Nodes of more than 8 fibers are split
+    if(count > 8)
+    {
+        // Split at the median of the centers along the largest extent
+        unsigned int splitAxis = 0;
+
+        for(unsigned int axis = 1; axis < 3; axis++)
+        {
+            if(centerBounds[2*axis+1] - centerBounds[2*axis] > centerBounds[2*splitAxis+1] - centerBounds[2*splitAxis])
+            {
+                splitAxis = axis;
+            }
+        }
+
+        unsigned int half = count / 2;
+        std::nth_element(m_TreeFibers.begin() + first, m_TreeFibers.begin() + first + half, m_TreeFibers.begin() + first + count,
+                         FiberBoundsCenterComparison(&m_Bounds[0], splitAxis));
+
+        node.left  = this->BuildNode(first, half);
+        node.right = this->BuildNode(first + half, count - half);
+    }
+
+    m_TreeNodes[index] = node;
+
+    return index;
+}
+
+//----------------------------------------------------------------------------------------
+
+void FiberDistanceEngine::FindCandidates(unsigned int query, float radius, std::vector< unsigned int > & candidates) const
+{
+    candidates.clear();
+
+    if(radius < 0.0f)
+    {
+        candidates.resize(m_NumberOfFibers);
+
+        for(unsigned int i = 0; i < m_NumberOfFibers; i++)
+        {
+            candidates[i] = i;
+        }
+
+        return;
+    }
+
+    if(m_TreeNodes.empty())
+    {
+        return;
+    }
+
+    const float *queryBounds = &m_Bounds[6 * query];
+
+    std::vector< unsigned int > stack;
+    stack.push_back(0);
+
+    while(!stack.empty())
+    {
+        const TreeNode & node = m_TreeNodes[stack.back()];
+        stack.pop_back();
+
+        if(BoxDistance(queryBounds, node.bounds) > radius)
+        {
+            continue;
+        }
+
+        if(node.left == 0) // leaf
+        {
+            for(unsigned int f = node.first; f < node.first + node.count; f++)
+            {
+                if(BoxDistance(queryBounds, &m_Bounds[6 * m_TreeFibers[f]]) <= radius)
+                {
+                    candidates.push_back(m_TreeFibers[f]);
+                }
+            }
+        }
+        else
+        {
+            stack.push_back(node.right);
+            stack.push_back(node.left);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+}
+
+//----------------------------------------------------------------------------------------
+
+void FiberDistanceEngine::ComputeNeighborGraph(const std::vector< unsigned int > & queries, float radius, NeighborGraph & graph) const
+{
+    int numberOfQueries = queries.size();
+
+    // Only the fibers whose bounding box is close enough may be neighbors
+    float lowerBoundFactor = this->GetLowerBoundFactor();
+    float searchRadius     = (radius < 0.0f || lowerBoundFactor <= 0.0f) ? -1.0f : radius / lowerBoundFactor;
+
+    std::vector< std::vector< unsigned int > > indices(numberOfQueries);
+    std::vector< std::vector< float > >        distances(numberOfQueries);
+
+    int q;
+
+    #pragma omp parallel for private(q) schedule(dynamic)
+    for(q = 0; q < numberOfQueries; q++)
+    {
+        std::vector< unsigned int > candidates;
+        this->FindCandidates(queries[q], searchRadius, candidates);
+
+        indices[q].reserve(candidates.size());
+        distances[q].reserve(candidates.size());
+
+        for(unsigned int c = 0; c < candidates.size(); c++)
+        {
+            float distance = this->Evaluate(queries[q], candidates[c]);
+
+            if(radius < 0.0f || distance <= radius)
+            {
+                indices[q].push_back(candidates[c]);
+                distances[q].push_back(distance);
+            }
+        }
+    }
+
+    // Compressed rows
+    graph.pointers.resize(numberOfQueries + 1);
+    graph.pointers[0] = 0;
+
+    for(q = 0; q < numberOfQueries; q++)
+    {
+        graph.pointers[q+1] = graph.pointers[q] + indices[q].size();
+    }
+
+    graph.indices.resize(graph.pointers[numberOfQueries]);
+    graph.distances.resize(graph.pointers[numberOfQueries]);
+
+    for(q = 0; q < numberOfQueries; q++)
+    {
+        std::copy(indices[q].begin(), indices[q].end(), graph.indices.begin() + graph.pointers[q]);
+        std::copy(distances[q].begin(), distances[q].end(), graph.distances.begin() + graph.pointers[q]);
+
+        std::vector< unsigned int >().swap(indices[q]);
+        std::vector< float >().swap(distances[q]);
+    }
+}
+
+} // namespace btk
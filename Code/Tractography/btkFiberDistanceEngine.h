@@ -0,0 +1,292 @@
+/*==========================================================================
+
+  © Université de Strasbourg - Centre National de la Recherche Scientifique
+
+  Date: 18/10/2026
+  Author(s): agent (agent@local)
+
+  This software is governed by the CeCILL-B license under French law and
+  abiding by the rules of distribution of free software.  You can  use,
+  modify and/ or redistribute the software under the terms of the CeCILL-B
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and  rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty  and the software's author,  the holder of the
+  economic rights,  and the successive licensors  have only  limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading,  using,  modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean  that it is complicated to manipulate,  and  that  also
+  therefore means  that it is reserved for developers  and  experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and,  more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL-B license and that you accept its terms.
+
+==========================================================================*/
+
+
+#ifndef BTK_FIBER_DISTANCE_ENGINE_H
+#define BTK_FIBER_DISTANCE_ENGINE_H
+
+// STL includes
+#include "vector"
+
+// Local includes
+#include "btkMacro.h"
+
+
+namespace btk
+{
+
+/**
+ * @class FiberDistanceEngine
+ * @brief Distances between fibers for the clustering of large tractograms.
+ *
+ * Fibers are resampled to the same number of points (uniformly along their arc length) and
+ * stored in three flat arrays of coordinates (one per axis), so that the distance kernels
+ * work on contiguous memory and are vectorized by the compiler.
+ *
+ * The distance between two fibers is never smaller than the distance between their bounding
+ * boxes. A k-d tree over the bounding boxes is used to find, for a query fiber, the only
+ * fibers that can be closer than a given radius, so that a thresholded neighbor graph is
+ * computed without evaluating all the pairs of fibers.
+ *
+ * Distances are not symmetric in general: Evaluate(i,j) follows Distance_measure(f_i,f_j) of
+ * the clustering application (mean/max over the points of fiber i of the distance to fiber j).
+ * @author agent
+ * @ingroup Tractography
+ */
+class FiberDistanceEngine
+{
+    public:
+        typedef FiberDistanceEngine Self;
+
+        /**
+         * @brief Distance measures between fibers (values match the clustering application's options).
+         */
+        enum DistanceType
+        {
+            ASYMMETRIC_CHAMFER = 1,
+            SYMMETRIC_CHAMFER = 2,
+            ASYMMETRIC_HAUSDORFF = 3,
+            SYMMETRIC_HAUSDORFF = 4,
+            CHAMFER_HAUSDORFF = 5,
+            SYMMETRIC_CHAMFER_HAUSDORFF = 6,
+            ORIENTATION_SYMMETRIC_CHAMFER = 7,
+            ORIENTATION_SYMMETRIC_HAUSDORFF = 8,
+            ORIENTATION = 9,
+            MINIMUM_AVERAGE_DIRECT_FLIP = 11
+        };
+
+        /**
+         * @brief Sparse graph of neighbors (compressed rows: the neighbors of the i-th query are
+         * indices[pointers[i]] ... indices[pointers[i+1]-1]).
+         */
+        struct NeighborGraph
+        {
+            std::vector< unsigned long > pointers;
+            std::vector< unsigned int >  indices;
+            std::vector< float >         distances;
+        };
+
+        /**
+         * @brief Maximal number of points of a resampled fiber.
+         */
+        enum { MaximumNumberOfPointsPerFiber = 256 };
+
+    public:
+        /**
+         * @brief Constructor (20 points per fiber, asymmetric Chamfer distance, alpha = 0.5).
+         */
+        FiberDistanceEngine();
+
+        /**
+         * @brief Resample and store the fibers, then build the k-d tree of their bounding boxes.
+         * @param fibers Points of each fiber (x0,y0,z0,x1,y1,z1,...).
+         */
+        void SetFibers(const std::vector< std::vector< float > > & fibers);
+
+        /**
+         * @brief Get the number of fibers.
+         * @return Number of fibers.
+         */
+        unsigned int GetNumberOfFibers() const;
+
+        btkSetMacro(NumberOfPointsPerFiber, unsigned int);
+        btkGetMacro(NumberOfPointsPerFiber, unsigned int);
+
+        btkSetMacro(DistanceType, DistanceType);
+        btkGetMacro(DistanceType, DistanceType);
+
+        /**
+         * @brief Weight of the first term of the combined distances (in [0,1]).
+         */
+        btkSetMacro(Alpha, float);
+        btkGetMacro(Alpha, float);
+
+        /**
+         * @brief Distance between two fibers (measure given by the distance type).
+         * @param i Index of the first fiber.
+         * @param j Index of the second fiber.
+         * @return Distance from fiber i to fiber j.
+         */
+        float Evaluate(unsigned int i, unsigned int j) const;
+
+        /**
+         * @brief Mean distance from the points of fiber i to fiber j (asymmetric Chamfer distance).
+         */
+        float Chamfer(unsigned int i, unsigned int j) const;
+
+        /**
+         * @brief Maximal distance from the points of fiber i to fiber j (asymmetric Hausdorff distance).
+         */
+        float Hausdorff(unsigned int i, unsigned int j) const;
+
+        /**
+         * @brief Local orientation measure (sum over segments of 1-|cos| between the directions of the fibers).
+         */
+        float Orientation(unsigned int i, unsigned int j) const;
+
+        /**
+         * @brief Minimum average direct-flip distance (mean distance between corresponding points,
+         * fiber j being taken in both directions).
+         */
+        float MinimumAverageDirectFlip(unsigned int i, unsigned int j) const;
+
+        /**
+         * @brief Distance between the bounding boxes of two fibers.
+         */
+        float BoundingBoxDistance(unsigned int i, unsigned int j) const;
+
+        /**
+         * @brief Find the fibers whose bounding box is closer than a radius to the one of a query fiber.
+         * @param query Index of the query fiber.
+         * @param radius Radius (all the fibers are returned if the radius is negative).
+         * @param candidates Indices of the fibers found (in increasing order).
+         */
+        void FindCandidates(unsigned int query, float radius, std::vector< unsigned int > & candidates) const;
+
+        /**
+         * @brief Compute the neighbors of query fibers (fibers j such that Evaluate(query,j) <= radius).
+         * Distances of the pairs that can not be closer than the radius are not evaluated.
+         * @param queries Indices of the query fibers.
+         * @param radius Radius of the neighborhood (all the fibers are neighbors if the radius is negative).
+         * @param graph Output graph (one row per query, neighbors in increasing order).
+         */
+        void ComputeNeighborGraph(const std::vector< unsigned int > & queries, float radius, NeighborGraph & graph) const;
+
+    private:
+        /**
+         * @brief Resample a fiber with m_NumberOfPointsPerFiber points uniformly spaced along its arc length.
+         * @param points Points of the fiber (x0,y0,z0,x1,...).
+         * @param fiber Index of the fiber in the coordinates arrays.
+         */
+        void ResampleFiber(const std::vector< float > & points, unsigned int fiber);
+
+        /**
+         * @brief Compute the bounding box and the unit directions of the segments of a fiber.
+         * @param fiber Index of the fiber.
+         */
+        void ComputeFiberGeometry(unsigned int fiber);
+
+        /**
+         * @brief Compute the distance of each point of fiber i to fiber j.
+         * @param i Index of the first fiber.
+         * @param j Index of the second fiber.
+         * @param chamfer Mean of the distances (asymmetric Chamfer distance).
+         * @param hausdorff Maximum of the distances (asymmetric Hausdorff distance).
+         */
+        void ComputeDirectedDistances(unsigned int i, unsigned int j, float & chamfer, float & hausdorff) const;
+
+        /**
+         * @brief Build the k-d tree of the bounding boxes.
+         */
+        void BuildTree();
+
+        /**
+         * @brief Build a node of the k-d tree on the fibers m_TreeFibers[first,first+count).
+         * @return Index of the node.
+         */
+        unsigned int BuildNode(unsigned int first, unsigned int count);
+
+        /**
+         * @brief Distance between two bounding boxes (xmin,xmax,ymin,ymax,zmin,zmax).
+         */
+        static float BoxDistance(const float * a, const float * b);
+
+        /**
+         * @brief Lower bound of the distance as a factor of the distance between the bounding boxes.
+         */
+        float GetLowerBoundFactor() const;
+
+    private:
+        /**
+         * @brief Node of the k-d tree.
+         */
+        struct TreeNode
+        {
+            float        bounds[6];
+            unsigned int first;
+            unsigned int count;
+            unsigned int left;
+            unsigned int right;
+        };
+
+        /**
+         * @brief Number of points of the resampled fibers.
+         */
+        unsigned int m_NumberOfPointsPerFiber;
+
+        /**
+         * @brief Distance measure used by Evaluate.
+         */
+        DistanceType m_DistanceType;
+
+        /**
+         * @brief Weight of the combined distances.
+         */
+        float m_Alpha;
+
+        /**
+         * @brief Number of fibers.
+         */
+        unsigned int m_NumberOfFibers;
+
+        /**
+         * @brief Coordinates of the resampled points (fiber after fiber).
+         */
+        std::vector< float > m_X, m_Y, m_Z;
+
+        /**
+         * @brief Unit directions of the segments (fiber after fiber).
+         */
+        std::vector< float > m_DirectionX, m_DirectionY, m_DirectionZ;
+
+        /**
+         * @brief Bounding boxes of the fibers (xmin,xmax,ymin,ymax,zmin,zmax).
+         */
+        std::vector< float > m_Bounds;
+
+        /**
+         * @brief Nodes of the k-d tree (the root is the first node).
+         */
+        std::vector< TreeNode > m_TreeNodes;
+
+        /**
+         * @brief Fibers ordered by the k-d tree (each node covers a range of this array).
+         */
+        std::vector< unsigned int > m_TreeFibers;
+};
+
+} // namespace btk
+
+#endif // BTK_FIBER_DISTANCE_ENGINE_H
@@ -60,7 +60,7 @@ ImportanceDensity::ImportanceDensity(DiffusionModel::Pointer model, DiffusionSig
 
 //----------------------------------------------------------------------------------------
 
-GradientDirection ImportanceDensity::GetMeanDirection(PhysicalPoint pk, GradientDirection vkm1)
+GradientDirection ImportanceDensity::GetMeanDirection(PhysicalPoint pk, GradientDirection vkm1, RandomNumberGenerator &generator)
 {
     std::vector< GradientDirection > maxima = m_Model->MeanDirectionsAt(pk, vkm1, m_AngleThreshold);
 
@@ -79,7 +79,7 @@ GradientDirection ImportanceDensity::GetMeanDirection(PhysicalPoint pk, Gradient
         }
 
         // Simulate x~U(0,1)
-        double x = (static_cast< double >(std::rand()) / static_cast< double >(RAND_MAX)) * sum;
+        double x = generator.GenerateUniform() * sum;
 
         // compare to intervals and choose the mean direction
         bool      found = false;
@@ -112,47 +112,24 @@ GradientDirection ImportanceDensity::GetMeanDirection(PhysicalPoint pk, Gradient
 
 //----------------------------------------------------------------------------------------
 
-GradientDirection ImportanceDensity::Simulate(GradientDirection meanDirection, double concentration)
+GradientDirection ImportanceDensity::Simulate(GradientDirection meanDirection, double concentration, RandomNumberGenerator &generator)
 {
-    // Simulate the vMF distribution with mean (0,0,1)
-    double        y = static_cast< double >(std::rand()) / static_cast< double >(RAND_MAX);
-    double        w = (1.0 / concentration) * std::log( std::exp(-concentration) + concentration * ((2.0/concentration) * (std::exp(concentration) - std::exp(-concentration))/2.0) * y);
-    double    theta = ( static_cast< double >(std::rand()) / static_cast< double >(RAND_MAX)) * m_2pi;
-    double constant = std::sqrt(1-w*w);
+    GradientDirection x;
+    VonMisesFisherProbabilityDensity::Simulate(meanDirection, concentration, generator, 1, &x);
 
-    GradientDirection x(constant*std::cos(theta), constant*std::sin(theta), w);
+    return x;
+}
+
+//----------------------------------------------------------------------------------------
 
-    // Rotate if necessary
-    if(meanDirection[0] != 0 || meanDirection[1] != 0 || meanDirection[2] != 1) // modal direction is not (0,0,1)
+void ImportanceDensity::Simulate(GradientDirection meanDirection, double concentration, RandomNumberGenerator &generator, unsigned int numberOfSamples, std::vector< GradientDirection > &samples)
+{
+    samples.resize(numberOfSamples);
+
+    if(numberOfSamples > 0)
     {
-        SphericalDirection mu = meanDirection.GetSphericalDirection();
-
-        // Rotations from (0,0,1) to current modal direction
-        double cosTheta = std::cos(mu[0]);
-        double sinTheta = std::sin(mu[0]);
-        double cosPhi   = std::cos(mu[1]);
-        double sinPhi   = std::sin(mu[1]);
-
-        // Ry(theta)
-        // | cos(theta)  0  sin(theta)  |   |x|
-        // |     0       1       0      | . |y|
-        // |-sin(theta)  0   cos(theta) |   |z|
-        double Ryx = cosTheta * x[0] + sinTheta * x[2];
-        double Ryy = x[1];
-        double Ryz = -sinTheta * x[0] + cosTheta * x[2];
-
-        // Rz(phi)
-        // | cos(phi)  -sin(phi)  0 |   |x|
-        // | sin(phi)   cos(phi)  0 | . |y|
-        // |    0          0      1 |   |z|
-        x[0] = cosPhi * Ryx - sinPhi * Ryy;
-        x[1] = sinPhi * Ryx + cosPhi * Ryy;
-        x[2] = Ryz;
-
-        x.UpdateSphericalCoordinates();
+        VonMisesFisherProbabilityDensity::Simulate(meanDirection, concentration, generator, numberOfSamples, &samples[0]);
     }
-
-    return x;
 }
 
 //----------------------------------------------------------------------------------------
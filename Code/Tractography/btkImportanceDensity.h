@@ -44,6 +44,7 @@
 #include "btkGradientDirection.h"
 #include "btkDiffusionModel.h"
 #include "btkDiffusionSignal.h"
+#include "btkRandomNumberGenerator.h"
 
 namespace btk
 {
@@ -81,17 +82,29 @@ class ImportanceDensity
          * @brief Compute the mean direction
          * @param pk Current position.
          * @param vkm1 Last direction.
+         * @param generator Random number generator (used to choose between several maxima).
          * @return The mean direction.
          */
-        GradientDirection GetMeanDirection(PhysicalPoint pk, GradientDirection vkm1);
+        GradientDirection GetMeanDirection(PhysicalPoint pk, GradientDirection vkm1, RandomNumberGenerator &generator);
 
         /**
          * @brief Simulate the importance density.
          * @param meanDirection Mean direction of the simulation.
          * @param concentration Concentration parameter.
+         * @param generator Random number generator.
          * @return Simulated direction.
          */
-        GradientDirection Simulate(GradientDirection meanDirection, double concentration);
+        GradientDirection Simulate(GradientDirection meanDirection, double concentration, RandomNumberGenerator &generator);
+
+        /**
+         * @brief Simulate several directions of the importance density.
+         * @param meanDirection Mean direction of the simulation.
+         * @param concentration Concentration parameter.
+         * @param generator Random number generator.
+         * @param numberOfSamples Number of directions to simulate.
+         * @param samples Simulated directions (output).
+         */
+        void Simulate(GradientDirection meanDirection, double concentration, RandomNumberGenerator &generator, unsigned int numberOfSamples, std::vector< GradientDirection > &samples);
 
         /**
          * @brief Evaluate the importance density.
@@ -50,9 +50,14 @@
 
 #include "sstream"
 #include "cfloat"
+#include "cmath"
+#include "vector"
+#include "algorithm"
 
 // Local includes
 #include "btkImageHelper.h"
+#include "btkPriorLogarithmLookUpTable.h"
+#include "btkSphericalBucketIndex.h"
 
 
 // Definitions
@@ -85,13 +90,13 @@ void ParticleFilteringTractographyAlgorithm::Initialize()
     // Probability map
     m_ProbabilityMap = btk::ImageHelper< DiffusionSignal,ProbabilityMap >::CreateNewImageFromPhysicalSpaceOf(m_DiffusionSignal);
 
-    // Set number of threads to 1 (multi-threading is supported by opem mp instead)
-    //this->SetNumberOfThreads(1); // NOTE : now the seed propagation is not multi-threaded, so we thread on seeds instead...
+    // Seeds are processed in parallel by the superclass: the densities are only read during the
+    // propagation and the random numbers come from the generator of each seed.
 }
 
 //----------------------------------------------------------------------------------------
 
-vtkSmartPointer< vtkPolyData > ParticleFilteringTractographyAlgorithm::PropagateSeed(Self::PhysicalPoint point)
+vtkSmartPointer< vtkPolyData > ParticleFilteringTractographyAlgorithm::PropagateSeed(Self::PhysicalPoint point, RandomNumberGenerator &generator)
 {
     // Diffusion directions provided by the model at point
     std::vector< btk::GradientDirection > nextDirections = m_DiffusionModel->MeanDirectionsAt(point);
@@ -113,7 +118,7 @@ vtkSmartPointer< vtkPolyData > ParticleFilteringTractographyAlgorithm::Propagate
 
         btk::GradientDirection nextDirection = *it;
 
-        this->PropagateSeed(points, nextDirection);
+        this->PropagateSeed(points, nextDirection, generator);
 
         //
         // Build graphical fiber
@@ -154,7 +159,7 @@ vtkSmartPointer< vtkPolyData > ParticleFilteringTractographyAlgorithm::Propagate
 
 //----------------------------------------------------------------------------------------
 
-void ParticleFilteringTractographyAlgorithm::PropagateSeed(std::vector< Self::PhysicalPoint > &points, GradientDirection nextDirection)
+void ParticleFilteringTractographyAlgorithm::PropagateSeed(std::vector< Self::PhysicalPoint > &points, GradientDirection nextDirection, RandomNumberGenerator &generator)
 {
 //    btkTicTocInit();
 //    btkTic();
@@ -168,12 +173,14 @@ void ParticleFilteringTractographyAlgorithm::PropagateSeed(std::vector< Self::Ph
     // Get the first point
     PhysicalPoint x0 = points.back();
 
-    // Initial sampling
-//    #pragma omp parallel for default(shared) schedule(dynamic)
+    // Initial sampling (the initial density is the same for all particles, so the directions are simulated at once)
+    std::vector< GradientDirection > initialDirections;
+    m_ImportanceDensity.Simulate(nextDirection, m_ImportanceDensity.EstimateConcentrationParameter(nextDirection, x0), generator, m_NumberOfParticles, initialDirections);
+
     for(unsigned int m = 0; m < m_NumberOfParticles; m++)
     {
-        // Simulate a direction using initial density
-        GradientDirection v0 = m_ImportanceDensity.Simulate(nextDirection, m_ImportanceDensity.EstimateConcentrationParameter(nextDirection, x0)) * m_ParticleStepSize;
+        // Simulated direction using initial density
+        GradientDirection v0 = initialDirections[m] * m_ParticleStepSize;
 
         // Move particle (inside the mask)
         Self::PhysicalPoint x1 = x0 + v0;
@@ -209,7 +216,7 @@ void ParticleFilteringTractographyAlgorithm::PropagateSeed(std::vector< Self::Ph
                 Self::PhysicalPoint   xk = cloud[m].GetLastPoint();
 
                 // Simulate next direction
-                GradientDirection mu = m_ImportanceDensity.GetMeanDirection(xk, vkm1);
+                GradientDirection mu = m_ImportanceDensity.GetMeanDirection(xk, vkm1, generator);
 
                 double         kappa;
                 GradientDirection vk;
@@ -217,12 +224,12 @@ void ParticleFilteringTractographyAlgorithm::PropagateSeed(std::vector< Self::Ph
                 if(mu.IsNull())
                 {
                     kappa = m_PriorDensity.GetConcentration();
-                    vk    = m_ImportanceDensity.Simulate(vkm1, kappa) * m_ParticleStepSize;
+                    vk    = m_ImportanceDensity.Simulate(vkm1, kappa, generator) * m_ParticleStepSize;
                 }
                 else // mean is not null
                 {
                     kappa = m_ImportanceDensity.EstimateConcentrationParameter(mu, xk);
-                    vk    = m_ImportanceDensity.Simulate(mu, kappa) * m_ParticleStepSize;
+                    vk    = m_ImportanceDensity.Simulate(mu, kappa, generator) * m_ParticleStepSize;
                 }
 
                 // Move particle and update weight (inside mask)
@@ -292,7 +299,7 @@ void ParticleFilteringTractographyAlgorithm::PropagateSeed(std::vector< Self::Ph
         // keeping proportionnality of weights
         if(ESS < m_ResamplingThreshold)
         {
-            this->ResampleParticlesCloud(cloud, numberOfActiveParticles);
+            this->ResampleParticlesCloud(cloud, numberOfActiveParticles, generator);
         }
 
         numberOfIterations++;
@@ -313,7 +320,7 @@ void ParticleFilteringTractographyAlgorithm::PropagateSeed(std::vector< Self::Ph
 
 //----------------------------------------------------------------------------------------
 
-void ParticleFilteringTractographyAlgorithm::ResampleParticlesCloud(std::vector< Particle > &cloud, unsigned numberOfActiveParticles)
+void ParticleFilteringTractographyAlgorithm::ResampleParticlesCloud(std::vector< Particle > &cloud, unsigned numberOfActiveParticles, RandomNumberGenerator &generator)
 {
     // Initialize
     double cumulative = 0.0;
@@ -342,7 +349,7 @@ void ParticleFilteringTractographyAlgorithm::ResampleParticlesCloud(std::vector<
         if(cloud[m].IsActive())
         {
             // Simulate x ~ U(0,1)
-            double x = static_cast< double >(rand()) / static_cast< double >(RAND_MAX);
+            double x = generator.GenerateUniform();
 
             bool found = false;
             unsigned int i = 0;
@@ -570,72 +577,169 @@ void ParticleFilteringTractographyAlgorithm::ComputeMaximumAPosteriori(std::vect
             }
         } // for each particle
 
+        // The prior is affine in the scalar product of the vectors and its logarithm is only defined
+        // (and a transition possible) where it is positive: a.b > minimumScalarProduct.
+        double               prior0 = m_PriorDensity.Evaluate(0.0);
+        double minimumScalarProduct = -prior0 / (m_PriorDensity.Evaluate(1.0) - prior0);
+
+        // Paths lengths, maximal norm of the vectors and flat copies of the points and vectors of each step
+        std::vector< unsigned int > pathLength(m_NumberOfParticles);
+        std::vector< double > points(3*numberOfIterations*m_NumberOfParticles, 0.0), vectors(3*numberOfIterations*m_NumberOfParticles, 0.0);
+        double maximumNorm = 0.0;
+
+        for(unsigned int m = 0; m < m_NumberOfParticles; m++)
+        {
+            pathLength[m] = cloud[m].GetPathLength()-1;
+
+            for(unsigned int k = 0; k <= pathLength[m] && k < numberOfIterations; k++)
+            {
+                PhysicalPoint     x = cloud[m].GetPointAtStep(k);
+                double *pointOfStep = &points[3*INDEX(k,m)];
+                pointOfStep[0] = x[0]; pointOfStep[1] = x[1]; pointOfStep[2] = x[2];
+
+                if(k < pathLength[m])
+                {
+                    GradientDirection  v = cloud[m].GetVectorAtStep(k);
+                    double *vectorOfStep = &vectors[3*INDEX(k,m)];
+                    vectorOfStep[0] = v[0]; vectorOfStep[1] = v[1]; vectorOfStep[2] = v[2];
+
+                    maximumNorm = std::max(maximumNorm, std::sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]));
+                }
+            }
+        } // for each particle
+
+        PriorLogarithmLookUpTable logPrior(m_PriorDensity, std::max(minimumScalarProduct, -maximumNorm*maximumNorm), maximumNorm*maximumNorm, 4096);
+
+        // Cells of the bucket index are about the size of the support of the prior
+        double supportCosine = (maximumNorm > 0.0) ? minimumScalarProduct / (maximumNorm*maximumNorm) : 2.0;
+        unsigned int numberOfBands = (supportCosine > -1.0 && supportCosine < 1.0) ? static_cast< unsigned int >(std::ceil(M_PI / std::acos(supportCosine))) : 1;
+        SphericalBucketIndex bucketIndex(std::max(4u, std::min(64u, numberOfBands)));
+
+        // Seeds are already propagated in parallel by the threads of the algorithm
+        bool parallel = (this->GetNumberOfThreads() == 1);
+
         for(unsigned int k = 1; k < t; k++)
         {
-            for(unsigned int m = 0; m < m_NumberOfParticles; m++)
+            // Particles which may precede another one at step k (the test only depends on the preceding particle)
+            std::vector< unsigned int > previousParticles;
+
+            for(unsigned int i = 0; i < m_NumberOfParticles; i++)
             {
-                if(k+1 < cloud[m].GetPathLength()-1)
+                if(k < pathLength[i])
                 {
-                    double max        = DBL_MIN;
-                    unsigned int imax = 0;
+                    const double *actual_xkp1_i = &points[3*INDEX(k+1,i)];
+                    const double *xk_i          = &points[3*INDEX(k,i)];
+                    const double *vk_i          = &vectors[3*INDEX(k,i)];
+
+                    double dx = xk_i[0] + vk_i[0] - actual_xkp1_i[0];
+                    double dy = xk_i[1] + vk_i[1] - actual_xkp1_i[1];
+                    double dz = xk_i[2] + vk_i[2] - actual_xkp1_i[2];
+
+                    if(dx*dx + dy*dy + dz*dz < 1.0)
+                    {
+                        previousParticles.push_back(i);
+                    }
+                }
+            } // for each particle
+
+            std::vector< double > previousVectors(vectors.begin() + 3*INDEX(k,0), vectors.begin() + 3*INDEX(k+1,0));
+            bucketIndex.Build(previousVectors, previousParticles);
 
-                    PhysicalPoint xkp1_m = cloud[m].GetPointAtStep(k+1);
+            int m;
 
-                    for(unsigned int i = 0; i < m_NumberOfParticles; i++)
+            #pragma omp parallel private(m) if(parallel)
+            {
+                std::vector< unsigned int > candidates;
+
+                #pragma omp for schedule(dynamic)
+                for(m = 0; m < (int)m_NumberOfParticles; m++)
+                {
+                    if(k+1 < pathLength[m])
                     {
-                        if(k < cloud[i].GetPathLength()-1)
+                        double max        = DBL_MIN;
+                        unsigned int imax = 0;
+                        bool found        = false;
+
+                        const double *xkp1_m = &points[3*INDEX(k+1,m)];
+                        const double *vkp1_m = &vectors[3*INDEX(k+1,m)];
+
+                        // Only the particles whose vector is in the support of the prior are candidates
+                        double norm = std::sqrt(vkp1_m[0]*vkp1_m[0] + vkp1_m[1]*vkp1_m[1] + vkp1_m[2]*vkp1_m[2]);
+                        double minimumCosine;
+
+                        if(minimumScalarProduct < 0.0)
+                            minimumCosine = -1.0;
+                        else if(norm > 0.0 && maximumNorm > 0.0)
+                            minimumCosine = minimumScalarProduct / (norm * maximumNorm);
+                        else
+                            minimumCosine = 2.0;
+
+                        bucketIndex.Query(vkp1_m, minimumCosine, candidates);
+
+                        for(unsigned int c = 0; c < candidates.size(); c++)
                         {
-                            PhysicalPoint actual_xkp1_i = cloud[i].GetPointAtStep(k+1);
-                            PhysicalPoint should_xkp1_i = cloud[i].GetPointAtStep(k) + cloud[i].GetVectorAtStep(k);
-                            double    distance_particle = std::sqrt( (actual_xkp1_i[0]-xkp1_m[0])*(actual_xkp1_i[0]-xkp1_m[0]) + (actual_xkp1_i[1]-xkp1_m[1])*(actual_xkp1_i[1]-xkp1_m[1]) + (actual_xkp1_i[2]-xkp1_m[2])*(actual_xkp1_i[2]-xkp1_m[2]));
-                            double      distance_points = std::sqrt( (should_xkp1_i[0]-actual_xkp1_i[0])*(should_xkp1_i[0]-actual_xkp1_i[0]) + (should_xkp1_i[1]-actual_xkp1_i[1])*(should_xkp1_i[1]-actual_xkp1_i[1]) + (should_xkp1_i[2]-actual_xkp1_i[2])*(should_xkp1_i[2]-actual_xkp1_i[2]));
+                            unsigned int i = candidates[c];
+
+                            const double *actual_xkp1_i = &points[3*INDEX(k+1,i)];
+                            const double *vk_i          = &previousVectors[3*i];
 
-                            if(distance_points < 1.0 && distance_particle < 1.0)
+                            double dx = actual_xkp1_i[0] - xkp1_m[0];
+                            double dy = actual_xkp1_i[1] - xkp1_m[1];
+                            double dz = actual_xkp1_i[2] - xkp1_m[2];
+
+                            if(dx*dx + dy*dy + dz*dz < 1.0)
                             {
-                                assert(INDEX(k-1,i) < delta.size());
-                                double tmp = delta[INDEX(k-1,i)] + std::log(m_PriorDensity.Evaluate(cloud[m].GetVectorAtStep(k+1), cloud[i].GetVectorAtStep(k)));
+                                double scalarProduct = vkp1_m[0]*vk_i[0] + vkp1_m[1]*vk_i[1] + vkp1_m[2]*vk_i[2];
 
-                                if(tmp > max)
+                                if(scalarProduct > minimumScalarProduct)
                                 {
-                                    max  = tmp;
-                                    imax = i;
+                                    assert(INDEX(k-1,i) < delta.size());
+                                    double tmp = delta[INDEX(k-1,i)] + logPrior.Evaluate(scalarProduct);
+
+                                    // Candidates are not visited in order: keep the first particle in case of equality
+                                    if(tmp > max || (found && tmp == max && i < imax))
+                                    {
+                                        max   = tmp;
+                                        imax  = i;
+                                        found = true;
+                                    }
                                 }
                             }
-                        }
-                    } // for each other particle
+                        } // for each candidate particle
 
-                    if(btkFloatingEqual(max, DBL_MIN)) // no maximum found
-                    {
-                        assert(INDEX(k,m) < delta.size());
-                        delta[INDEX(k,m)] = cloud[m].GetLikelihoodAtStep(k);
-                        psi[INDEX(k-1,m)] = m;
-                    }
-                    else // max != MIN_REAL
-                    {
-                        assert(INDEX(k,m) < delta.size());
-                        delta[INDEX(k,m)] = cloud[m].GetLikelihoodAtStep(k) + max;
-                        psi[INDEX(k-1,m)] = imax;
-                    }
-                }
-                else // k+1 >= cloud[m].GetPathLength()-1
-                {
-                    if(k == 1)
-                    {
-                        assert(INDEX(1,m) < delta.size());
-                        assert(INDEX(0,m) < delta.size());
-                        delta[INDEX(1,m)] = delta[INDEX(0,m)];
+                        if(!found) // no maximum found
+                        {
+                            assert(INDEX(k,m) < delta.size());
+                            delta[INDEX(k,m)] = cloud[m].GetLikelihoodAtStep(k);
+                            psi[INDEX(k-1,m)] = m;
+                        }
+                        else // max != MIN_REAL
+                        {
+                            assert(INDEX(k,m) < delta.size());
+                            delta[INDEX(k,m)] = cloud[m].GetLikelihoodAtStep(k) + max;
+                            psi[INDEX(k-1,m)] = imax;
+                        }
                     }
-                    else // k > 1
+                    else // k+1 >= cloud[m].GetPathLength()-1
                     {
-                        assert(INDEX(k,m) < delta.size());
-                        assert(INDEX(k-1,m) < delta.size());
-                        assert(INDEX(k-2,m) < delta.size());
-                        delta[INDEX(k,m)] = delta[INDEX(k-1,m)] + std::abs(delta[INDEX(k-1,m)] - delta[INDEX(k-2,m)]);
-                    }
+                        if(k == 1)
+                        {
+                            assert(INDEX(1,m) < delta.size());
+                            assert(INDEX(0,m) < delta.size());
+                            delta[INDEX(1,m)] = delta[INDEX(0,m)];
+                        }
+                        else // k > 1
+                        {
+                            assert(INDEX(k,m) < delta.size());
+                            assert(INDEX(k-1,m) < delta.size());
+                            assert(INDEX(k-2,m) < delta.size());
+                            delta[INDEX(k,m)] = delta[INDEX(k-1,m)] + std::abs(delta[INDEX(k-1,m)] - delta[INDEX(k-2,m)]);
+                        }
 
-                    psi[INDEX(k-1,m)] = m;
-                }
-            } // for each particle
+                        psi[INDEX(k-1,m)] = m;
+                    }
+                } // for each particle
+            } // omp parallel
         } // for each step
 
 
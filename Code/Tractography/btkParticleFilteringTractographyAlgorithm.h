@@ -108,23 +108,26 @@ class ParticleFilteringTractographyAlgorithm : public TractographyAlgorithm
         /**
          * @brief Propagate using the tractography algorithm at a seed point.
          * @param point Seed point.
+         * @param generator Random number generator of the seed.
          */
-        virtual vtkSmartPointer< vtkPolyData > PropagateSeed(Self::PhysicalPoint point);
+        virtual vtkSmartPointer< vtkPolyData > PropagateSeed(Self::PhysicalPoint point, RandomNumberGenerator &generator);
 
     private:
         /**
          * @brief Propagate a seed using a particle filter.
          * @param points Vector of points initilized with the coordinates of the seed.
          * @param nextDirection First direction of propagation.
+         * @param generator Random number generator of the seed.
          */
-        void PropagateSeed(std::vector< Self::PhysicalPoint > &points, btk::GradientDirection nextDirection);
+        void PropagateSeed(std::vector< Self::PhysicalPoint > &points, btk::GradientDirection nextDirection, RandomNumberGenerator &generator);
 
         /**
          * @brief Resampling function of the particles' cloud.
          * @param cloud Cloud of particles to resample.
          * @param numberOfActiveParticles Number of currently active particles
+         * @param generator Random number generator of the seed.
          */
-        void ResampleParticlesCloud(std::vector< Particle > &cloud, unsigned int numberOfActiveParticles);
+        void ResampleParticlesCloud(std::vector< Particle > &cloud, unsigned int numberOfActiveParticles, RandomNumberGenerator &generator);
 
         /**
          * @brief Save the particles' cloud in file (filename si 'cloud-[world coordinates]-pathlength.vtk').
@@ -133,7 +136,7 @@ class ParticleFilteringTractographyAlgorithm : public TractographyAlgorithm
         void SaveCloud(std::vector< Particle > &cloud);
 
         /**
-         * @brief Compute a probability map from a cloud of particles.
+         * @brief Compute a probability map from a cloud of particles (not thread-safe: the map is shared by all seeds).
          * @param cloud Cloud of particles defining the probability.
          */
         void ComputeProbabilityMap(std::vector< Particle > &cloud);
@@ -36,6 +36,10 @@
 #include "btkPriorDensity.h"
 
 
+// Local includes
+#include "btkVonMisesFisherProbabilityDensity.h"
+
+
 namespace btk
 {
 
@@ -56,9 +60,6 @@ PriorDensity::PriorDensity(double concentration) : m_Concentration(concentration
 void PriorDensity::Initialize()
 {
     m_NormalizationCoefficient = std::log(m_Concentration / (m_2pi * (std::exp(m_Concentration) - std::exp(-m_Concentration))));
-    m_InverseConcentration     = 1.0 / m_Concentration;
-    m_SimulationTerm           = std::exp(-m_Concentration);
-    m_SimulationCoefficient    = m_Concentration * ((2.0/m_Concentration) * (std::exp(m_Concentration) - std::exp(-m_Concentration))/2.0);
 }
 
 //----------------------------------------------------------------------------------------
@@ -70,45 +71,17 @@ double PriorDensity::Evaluate(GradientDirection vk, GradientDirection vkm1)
 
 //----------------------------------------------------------------------------------------
 
-GradientDirection PriorDensity::Simulate(GradientDirection vkm1)
+double PriorDensity::Evaluate(double scalarProduct)
+{
+    return m_NormalizationCoefficient + (scalarProduct * m_Concentration);
+}
+
+//----------------------------------------------------------------------------------------
+
+GradientDirection PriorDensity::Simulate(GradientDirection vkm1, RandomNumberGenerator &generator)
 {
-    // Simulate the vMF distribution with mean (0,0,1)
-    double        y = static_cast< double >(std::rand()) / static_cast< double >(RAND_MAX);
-    double        w = m_InverseConcentration * std::log( m_SimulationTerm + m_SimulationCoefficient * y);
-    double    theta = ( static_cast< double >(std::rand()) / static_cast< double >(RAND_MAX)) * m_2pi;
-    double constant = std::sqrt(1-w*w);
-
-    GradientDirection x(constant*std::cos(theta), constant*std::sin(theta), w);
-
-    // Rotate if necessary
-    if(vkm1[0] != 0 || vkm1[1] != 0 || vkm1[2] != 1) // modal direction is not (0,0,1)
-    {
-        SphericalDirection mu = vkm1.GetSphericalDirection();
-
-        // Rotations from (0,0,1) to current modal direction
-        double cosTheta = std::cos(mu[0]);
-        double sinTheta = std::sin(mu[0]);
-        double cosPhi   = std::cos(mu[1]);
-        double sinPhi   = std::sin(mu[1]);
-
-        // Ry(theta)
-        // | cos(theta)  0  sin(theta)  |   |x|
-        // |     0       1       0      | . |y|
-        // |-sin(theta)  0   cos(theta) |   |z|
-        double Ryx = cosTheta * x[0] + sinTheta * x[2];
-        double Ryy = x[1];
-        double Ryz = -sinTheta * x[0] + cosTheta * x[2];
-
-        // Rz(phi)
-        // | cos(phi)  -sin(phi)  0 |   |x|
-        // | sin(phi)   cos(phi)  0 | . |y|
-        // |    0          0      1 |   |z|
-        x[0] = cosPhi * Ryx - sinPhi * Ryy;
-        x[1] = sinPhi * Ryx + cosPhi * Ryy;
-        x[2] = Ryz;
-
-        x.UpdateSphericalCoordinates();
-    }
+    GradientDirection x;
+    VonMisesFisherProbabilityDensity::Simulate(vkm1, m_Concentration, generator, 1, &x);
 
     return x;
 }
@@ -39,6 +39,7 @@
 // Local includes
 #include "btkMacro.h"
 #include "btkGradientDirection.h"
+#include "btkRandomNumberGenerator.h"
 
 namespace btk
 {
@@ -72,12 +73,20 @@ class PriorDensity
          */
         double Evaluate(GradientDirection vk, GradientDirection vkm1);
 
+        /**
+         * @brief Evaluate the prior density from the scalar product of the current and previous vectors.
+         * @param scalarProduct Scalar product of the current and previous vectors.
+         * @return The value of the prior density (the same as Evaluate(vk,vkm1)).
+         */
+        double Evaluate(double scalarProduct);
+
         /**
          * @brief Simulate the prior density with the mean direction
-         * @param mean Mean direction.
+         * @param vkm1 Mean direction.
+         * @param generator Random number generator.
          * @return The simulated direction.
          */
-        GradientDirection Simulate(GradientDirection vkm1);
+        GradientDirection Simulate(GradientDirection vkm1, RandomNumberGenerator &generator);
 
     private:
         /**
@@ -100,21 +109,6 @@ class PriorDensity
          * @brief Precomputed normalization constant.
          */
         double m_NormalizationCoefficient;
-
-        /**
-         * @brief Precomputed constant.
-         */
-        double m_SimulationTerm;
-
-        /**
-         * @brief Precomputed constant.
-         */
-        double m_SimulationCoefficient;
-
-        /**
-         * @brief Precomputed constant.
-         */
-        double m_InverseConcentration;
 };
 
 } // namespace btk
@@ -0,0 +1,109 @@
+/*==========================================================================
+
+  © Université de Strasbourg - Centre National de la Recherche Scientifique
+
+  Date: 18/10/2026
+  Author(s): agent (agent@local)
+
+  This software is governed by the CeCILL-B license under French law and
+  abiding by the rules of distribution of free software.  You can  use,
+  modify and/ or redistribute the software under the terms of the CeCILL-B
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and  rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty  and the software's author,  the holder of the
+  economic rights,  and the successive licensors  have only  limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading,  using,  modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean  that it is complicated to manipulate,  and  that  also
+  therefore means  that it is reserved for developers  and  experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and,  more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL-B license and that you accept its terms.
+
+==========================================================================*/
+
+
+#ifndef BTK_PRIOR_LOGARITHM_LOOK_UP_TABLE_H
+#define BTK_PRIOR_LOGARITHM_LOOK_UP_TABLE_H
+
+// STL includes
+#include "vector"
+#include "cmath"
+
+// Local includes
+#include "btkPriorDensity.h"
+
+
+namespace btk
+{
+
+/**
+ * @brief Logarithm of the prior density as a function of the scalar product of the vectors (used by the maximum a posteriori).
+ * The prior density is affine in the scalar product, so its logarithm is tabulated on its support and linearly
+ * interpolated. It is computed exactly in the first cells of the table, where the density is close to 0.
+ * @author agent
+ * @ingroup Tractography
+ */
+class PriorLogarithmLookUpTable
+{
+    public:
+        PriorLogarithmLookUpTable(PriorDensity &prior, double minimumScalarProduct, double maximumScalarProduct, unsigned int size) : m_Minimum(minimumScalarProduct), m_InverseStep(0.0), m_Size(size)
+        {
+            m_Intercept = prior.Evaluate(0.0);
+            m_Slope     = prior.Evaluate(1.0) - m_Intercept;
+
+            double step = (maximumScalarProduct - minimumScalarProduct) / m_Size;
+
+            if(step > 0.0)
+            {
+                m_InverseStep = 1.0 / step;
+            }
+
+            m_Values.resize(m_Size+1);
+
+            for(unsigned int j = 0; j <= m_Size; j++)
+            {
+                m_Values[j] = std::log(m_Intercept + m_Slope * (m_Minimum + j * step));
+            }
+        }
+
+        double Evaluate(double scalarProduct) const
+        {
+            double position = (scalarProduct - m_Minimum) * m_InverseStep;
+
+            if(position < NumberOfExactCells || position >= m_Size)
+            {
+                return std::log(m_Intercept + m_Slope * scalarProduct);
+            }
+
+            unsigned int j = static_cast< unsigned int >(position);
+            double       f = position - j;
+
+            return m_Values[j] + f * (m_Values[j+1] - m_Values[j]);
+        }
+
+    private:
+        static const unsigned int NumberOfExactCells = 64;
+
+        double m_Intercept;
+        double m_Slope;
+        double m_Minimum;
+        double m_InverseStep;
+        unsigned int m_Size;
+        std::vector< double > m_Values;
+};
+
+} // namespace btk
+
+#endif // BTK_PRIOR_LOGARITHM_LOOK_UP_TABLE_H
@@ -0,0 +1,170 @@
+/*==========================================================================
+
+  © Université de Strasbourg - Centre National de la Recherche Scientifique
+
+  Date: 18/10/2026
+  Author(s): agent (agent@local)
+
+  This software is governed by the CeCILL-B license under French law and
+  abiding by the rules of distribution of free software.  You can  use,
+  modify and/ or redistribute the software under the terms of the CeCILL-B
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and  rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty  and the software's author,  the holder of the
+  economic rights,  and the successive licensors  have only  limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading,  using,  modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean  that it is complicated to manipulate,  and  that  also
+  therefore means  that it is reserved for developers  and  experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and,  more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL-B license and that you accept its terms.
+
+==========================================================================*/
+
+
+#ifndef BTK_SPHERICAL_BUCKET_INDEX_H
+#define BTK_SPHERICAL_BUCKET_INDEX_H
+
+// STL includes
+#include "vector"
+#include "cmath"
+#include "algorithm"
+
+
+namespace btk
+{
+
+/**
+ * @brief Spherical bucket index of vectors (cells of a latitude-longitude grid of the unit sphere).
+ * It gives the vectors which may be in a cone around a direction (used to prune transitions outside the support of the prior).
+ * @author agent
+ * @ingroup Tractography
+ */
+class SphericalBucketIndex
+{
+    public:
+        SphericalBucketIndex(unsigned int numberOfBands) : m_NumberOfBands(numberOfBands), m_NumberOfSectors(2*numberOfBands), m_CellSize(M_PI / numberOfBands)
+        {
+            m_CellStart.assign(m_NumberOfBands*m_NumberOfSectors+1, 0);
+        }
+
+        /**
+         * @brief Build the index.
+         * @param vectors Vectors (3 values per element).
+         * @param elements Elements to add in the index (in increasing order).
+         */
+        void Build(const std::vector< double > &vectors, const std::vector< unsigned int > &elements)
+        {
+            std::vector< unsigned int > cells(elements.size());
+            std::fill(m_CellStart.begin(), m_CellStart.end(), 0);
+
+            for(unsigned int e = 0; e < elements.size(); e++)
+            {
+                cells[e] = this->GetCell(&vectors[3*elements[e]]);
+                m_CellStart[cells[e]+1]++;
+            }
+
+            for(unsigned int c = 0; c < m_CellStart.size()-1; c++)
+            {
+                m_CellStart[c+1] += m_CellStart[c];
+            }
+
+            // Counting sort (elements stay in increasing order in each cell)
+            std::vector< unsigned int > position(m_CellStart.begin(), m_CellStart.end()-1);
+            m_Elements.resize(elements.size());
+
+            for(unsigned int e = 0; e < elements.size(); e++)
+            {
+                m_Elements[position[cells[e]]++] = elements[e];
+            }
+        }
+
+        /**
+         * @brief Get the elements which may be in the cone around a vector.
+         * @param vector Axis of the cone.
+         * @param minimumCosine Cosine of the half angle of the cone.
+         * @param elements Elements (output).
+         */
+        void Query(const double *vector, double minimumCosine, std::vector< unsigned int > &elements) const
+        {
+            elements.clear();
+
+            if(minimumCosine > 1.0)
+            {
+                return;
+            }
+
+            if(minimumCosine <= -1.0)
+            {
+                elements = m_Elements;
+                return;
+            }
+
+            double radius = std::acos(minimumCosine);
+            double  theta = this->GetTheta(vector);
+            double    phi = std::atan2(vector[1], vector[0]);
+
+            int firstBand = std::max(0, static_cast< int >(std::floor((theta - radius) / m_CellSize)));
+            int  lastBand = std::min(static_cast< int >(m_NumberOfBands)-1, static_cast< int >(std::floor((theta + radius) / m_CellSize)));
+
+            int firstSector = 0, numberOfSectors = m_NumberOfSectors;
+
+            // Range of longitudes of the cone, when it does not contain a pole
+            if(theta - radius > 0.0 && theta + radius < M_PI)
+            {
+                double deltaPhi = std::asin(std::min(1.0, std::sin(radius) / std::sin(theta)));
+
+                firstSector     = static_cast< int >(std::floor((phi - deltaPhi + M_PI) / m_CellSize));
+                numberOfSectors = std::min(static_cast< int >(m_NumberOfSectors), static_cast< int >(std::floor((phi + deltaPhi + M_PI) / m_CellSize)) - firstSector + 1);
+            }
+
+            for(int b = firstBand; b <= lastBand; b++)
+            {
+                for(int s = 0; s < numberOfSectors; s++)
+                {
+                    unsigned int cell = b*m_NumberOfSectors + (firstSector + s + m_NumberOfSectors) % m_NumberOfSectors;
+
+                    elements.insert(elements.end(), m_Elements.begin() + m_CellStart[cell], m_Elements.begin() + m_CellStart[cell+1]);
+                }
+            }
+        }
+
+    private:
+        double GetTheta(const double *vector) const
+        {
+            double norm = std::sqrt(vector[0]*vector[0] + vector[1]*vector[1] + vector[2]*vector[2]);
+
+            return (norm > 0.0) ? std::acos(std::max(-1.0, std::min(1.0, vector[2] / norm))) : 0.0;
+        }
+
+        unsigned int GetCell(const double *vector) const
+        {
+            int   band = std::min(static_cast< int >(m_NumberOfBands)-1, static_cast< int >(this->GetTheta(vector) / m_CellSize));
+            int sector = static_cast< int >((std::atan2(vector[1], vector[0]) + M_PI) / m_CellSize) % m_NumberOfSectors;
+
+            return band*m_NumberOfSectors + sector;
+        }
+
+        unsigned int m_NumberOfBands;
+        unsigned int m_NumberOfSectors;
+        double       m_CellSize;
+
+        std::vector< unsigned int > m_CellStart;
+        std::vector< unsigned int > m_Elements;
+};
+
+} // namespace btk
+
+#endif // BTK_SPHERICAL_BUCKET_INDEX_H
@@ -68,7 +68,7 @@ void StreamlineTractographyAlgorithm::PrintSelf(std::ostream &os, itk::Indent in
 
 //----------------------------------------------------------------------------------------
 
-vtkSmartPointer< vtkPolyData > StreamlineTractographyAlgorithm::PropagateSeed(Self::PhysicalPoint point)
+vtkSmartPointer< vtkPolyData > StreamlineTractographyAlgorithm::PropagateSeed(Self::PhysicalPoint point, RandomNumberGenerator &generator)
 {
     // Diffusion directions provided by the model at point
     std::vector< btk::GradientDirection > nextDirections = m_DiffusionModel->MeanDirectionsAt(point);
@@ -93,8 +93,9 @@ class StreamlineTractographyAlgorithm : public btk::TractographyAlgorithm
         /**
          * @brief Propagate using the tractography algorithm at a seed point.
          * @param point Seed point.
+         * @param generator Random number generator (not used, the algorithm is deterministic).
          */
-        virtual vtkSmartPointer< vtkPolyData > PropagateSeed(Self::PhysicalPoint point);
+        virtual vtkSmartPointer< vtkPolyData > PropagateSeed(Self::PhysicalPoint point, RandomNumberGenerator &generator);
 
     private:
         /**
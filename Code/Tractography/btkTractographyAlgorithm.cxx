@@ -66,7 +66,7 @@ static itk::SimpleFastMutexLock mutex;
 namespace btk
 {
 
-TractographyAlgorithm::TractographyAlgorithm() : m_RegionsOfInterest(NULL), m_SeedSpacing(1), m_SeedLabels(), m_OutputFibers(), m_OutputIndicesOfLabels(), m_DiffusionSignal(NULL), m_DiffusionModel(NULL), m_Mask(NULL), Superclass()
+TractographyAlgorithm::TractographyAlgorithm() : m_RegionsOfInterest(NULL), m_SeedSpacing(1), m_RandomSeed(0), m_Seeds(), m_SeedFibers(), m_NextSeed(0), m_SeedLabels(), m_OutputFibers(), m_OutputIndicesOfLabels(), m_DiffusionSignal(NULL), m_DiffusionModel(NULL), m_Mask(NULL), Superclass()
 {
     // ----
 }
@@ -96,9 +96,15 @@ void TractographyAlgorithm::Update()
     object->SetImage(objectCaster->GetOutput());
     m_RegionsOfInterest->SetRequestedRegion(object->GetAxisAlignedBoundingBoxRegion());
 
+    // Build the list of seeds and the queue of the threads
+    this->InitializeSeeds();
+
+    m_SeedFibers.assign(m_Seeds.size(), vtkSmartPointer< vtkPolyData >());
+    m_NextSeed = 0;
+
     // Initialize the progress bar
     this->SetProgress(0);
-    m_ProgressStep = 1.0 / static_cast< double >(m_RegionsOfInterest->GetRequestedRegion().GetNumberOfPixels());
+    m_ProgressStep = 1.0 / static_cast< double >(std::max< std::size_t >(m_Seeds.size(), 1));
 
     // Set up the multithreaded processing
     ThreadStruct str;
@@ -110,6 +116,9 @@ void TractographyAlgorithm::Update()
     // Multithread the execution
     this->GetMultiThreader()->SingleMethodExecute();
 
+    // Build the output in the order of the seeds (does not depend on the threads)
+    this->GatherOutputFibers();
+
     // Update progress to 1
     this->SetProgress(1);
     this->InvokeEvent(itk::ProgressEvent());
@@ -126,95 +135,119 @@ void TractographyAlgorithm::Initialize()
 
 ITK_THREAD_RETURN_TYPE TractographyAlgorithm::ThreaderCallback(void *arg)
 {
-    ThreadStruct *str;
-    itk::ThreadIdType  total, threadId, threadCount;
-
-    threadId    = ( (itk::MultiThreader::ThreadInfoStruct *)( arg ) )->ThreadID;
-    threadCount = ( (itk::MultiThreader::ThreadInfoStruct *)( arg ) )->NumberOfThreads;
-
-    str = (ThreadStruct *)( ( (itk::MultiThreader::ThreadInfoStruct *)( arg ) )->UserData );
+    itk::ThreadIdType threadId = ( (itk::MultiThreader::ThreadInfoStruct *)( arg ) )->ThreadID;
+    ThreadStruct *str = (ThreadStruct *)( ( (itk::MultiThreader::ThreadInfoStruct *)( arg ) )->UserData );
 
-    // execute the actual method with appropriate roi region
-    // first find out how many pieces extent can be split into.
-    LabelImage::RegionType splitRegion;
-    total = str->Filter->SplitRequestedRegion(threadId, threadCount, splitRegion);
-
-    if (threadId < total)
-    {
-        str->Filter->ThreadedGenerateData(splitRegion, threadId);
-    }
-    // else
-    //   {
-    //   otherwise don't use this thread. Sometimes the threads dont
-    //   break up very well and it is just as efficient to leave a
-    //   few threads idle.
-    //   }
+    // Seeds are not split statically between threads (the propagation time is very different
+    // from a seed to another), each thread takes the next seed in the queue when it is free.
+    str->Filter->ThreadedGenerateData(threadId);
 
     return ITK_THREAD_RETURN_VALUE;
 }
 
 //----------------------------------------------------------------------------------------
 
-void TractographyAlgorithm::ThreadedGenerateData(const LabelImage::RegionType &region, itk::ThreadIdType threadId)
+void TractographyAlgorithm::InitializeSeeds()
 {
-    LabelIterator it(m_RegionsOfInterest, region);
+    m_Seeds.clear();
+
+    LabelIterator it(m_RegionsOfInterest, m_RegionsOfInterest->GetRequestedRegion());
 
     unsigned int numberOfSelectedLabels = m_SeedLabels.size();
 
     for(it.GoToBegin(); !it.IsAtEnd(); ++it)
     {
-        unsigned int label = it.Get();
+        short label = it.Get();
 
         // If the label of the current voxel has to bee processed
-        if(label > 0 && (numberOfSelectedLabels == 0 || *std::find(m_SeedLabels.begin(), m_SeedLabels.end(), label) == label))
+        if(label > 0 && (numberOfSelectedLabels == 0 || std::find(m_SeedLabels.begin(), m_SeedLabels.end(), label) != m_SeedLabels.end()))
         {
             // Get the physical point
             Self::LabelImage::IndexType labelIndex = it.GetIndex();
 
-            Self::PhysicalPoint point;
-            m_RegionsOfInterest->TransformIndexToPhysicalPoint(labelIndex, point);
+            Self::Seed seed;
+            seed.Label = label;
+            m_RegionsOfInterest->TransformIndexToPhysicalPoint(labelIndex, seed.Point);
 
             // Check if the physical point is in the mask
             Self::MaskImage::IndexType maskIndex;
-            m_Mask->TransformPhysicalPointToIndex(point, maskIndex);
 
-            if(m_Mask->GetPixel(maskIndex)  != 0)
+            if(m_Mask->TransformPhysicalPointToIndex(seed.Point, maskIndex) && m_Mask->GetPixel(maskIndex) != 0)
             {
-                // Initialize vector
-                vtkSmartPointer< vtkPolyData > currentFiber = NULL;
-
-                // Start tractography from seed point
-                currentFiber = this->PropagateSeed(point);
-
-                // Save data
-                mutex.Lock();
+                m_Seeds.push_back(seed);
+            }
+        }
+    } // for each voxel of the label image
+}
 
-                for(int l = m_OutputFibers.size(); l < label; l++)
-                {
-                    m_OutputIndicesOfLabels.push_back(-1);
-                }
+//----------------------------------------------------------------------------------------
 
-                if(m_OutputIndicesOfLabels[label-1] == -1)
-                {
-                    m_OutputFibers.push_back(vtkSmartPointer< vtkAppendPolyData >::New());
-                    m_OutputIndicesOfLabels[label-1] = m_OutputFibers.size()-1;
-                }
+bool TractographyAlgorithm::GetNextSeed(unsigned int &seedIndex)
+{
+    bool found = false;
 
-                if(currentFiber != NULL)
-                {
-                    m_OutputFibers[m_OutputIndicesOfLabels[label-1]]->AddInput(currentFiber);
-                }
+    mutex.Lock();
 
-                mutex.Unlock();
-            }
-        }
+    if(m_NextSeed < m_Seeds.size())
+    {
+        seedIndex = m_NextSeed++;
+        found     = true;
 
         // Update progress
-        mutex.Lock();
         this->SetProgress(this->GetProgress() + m_ProgressStep);
         this->InvokeEvent(itk::ProgressEvent());
-        mutex.Unlock();
-    } // for each seed in region
+    }
+
+    mutex.Unlock();
+
+    return found;
+}
+
+//----------------------------------------------------------------------------------------
+
+void TractographyAlgorithm::ThreadedGenerateData(itk::ThreadIdType threadId)
+{
+    unsigned int seedIndex = 0;
+
+    while(this->GetNextSeed(seedIndex))
+    {
+        // The random stream only depends on the seed, so that the results do not depend on the threads
+        RandomNumberGenerator generator(m_RandomSeed, seedIndex);
+
+        // Start tractography from seed point (each seed has its own output, no lock is needed)
+        m_SeedFibers[seedIndex] = this->PropagateSeed(m_Seeds[seedIndex].Point, generator);
+    } // for each seed in the queue
+}
+
+//----------------------------------------------------------------------------------------
+
+void TractographyAlgorithm::GatherOutputFibers()
+{
+    m_OutputFibers.clear();
+    m_OutputIndicesOfLabels.clear();
+
+    for(unsigned int s = 0; s < m_Seeds.size(); s++)
+    {
+        unsigned short label = m_Seeds[s].Label;
+
+        while(m_OutputIndicesOfLabels.size() < label)
+        {
+            m_OutputIndicesOfLabels.push_back(-1);
+        }
+
+        if(m_OutputIndicesOfLabels[label-1] == -1)
+        {
+            m_OutputFibers.push_back(vtkSmartPointer< vtkAppendPolyData >::New());
+            m_OutputIndicesOfLabels[label-1] = m_OutputFibers.size()-1;
+        }
+
+        if(m_SeedFibers[s] != NULL)
+        {
+            m_OutputFibers[m_OutputIndicesOfLabels[label-1]]->AddInput(m_SeedFibers[s]);
+        }
+    } // for each seed
+
+    m_SeedFibers.clear();
 }
 
 //----------------------------------------------------------------------------------------
@@ -242,63 +275,6 @@ void TractographyAlgorithm::ResampleLabelImage()
 
 //----------------------------------------------------------------------------------------
 
-unsigned int TractographyAlgorithm::SplitRequestedRegion(unsigned int i, unsigned int num, LabelImage::RegionType &splitRegion)
-{
-    // Get the output pointer
-    LabelImage *labelPtr = m_RegionsOfInterest.GetPointer();
-
-    const LabelImage::SizeType &requestedRegionSize = labelPtr->GetRequestedRegion().GetSize();
-
-    int splitAxis;
-    LabelImage::IndexType splitIndex;
-    LabelImage::SizeType splitSize;
-
-    // Initialize the splitRegion to the output requested region
-    splitRegion = labelPtr->GetRequestedRegion();
-    splitIndex = splitRegion.GetIndex();
-    splitSize = splitRegion.GetSize();
-
-    // split on the outermost dimension available
-    splitAxis = labelPtr->GetImageDimension() - 1;
-    while ( requestedRegionSize[splitAxis] == 1 )
-    {
-        --splitAxis;
-        if ( splitAxis < 0 )
-        { // cannot split
-            itkDebugMacro("  Cannot Split");
-            return 1;
-        }
-    }
-
-    // determine the actual number of pieces that will be generated
-    LabelImage::SizeType::SizeValueType range = requestedRegionSize[splitAxis];
-    unsigned int valuesPerThread = itk::Math::Ceil< unsigned int >(range / (double)num);
-    unsigned int maxThreadIdUsed = itk::Math::Ceil< unsigned int >(range / (double)valuesPerThread) - 1;
-
-    // Split the region
-    if ( i < maxThreadIdUsed )
-    {
-        splitIndex[splitAxis] += i * valuesPerThread;
-        splitSize[splitAxis] = valuesPerThread;
-    }
-    if ( i == maxThreadIdUsed )
-    {
-        splitIndex[splitAxis] += i * valuesPerThread;
-        // last thread needs to process the "rest" dimension being split
-        splitSize[splitAxis] = splitSize[splitAxis] - i * valuesPerThread;
-    }
-
-    // set the split region ivars
-    splitRegion.SetIndex(splitIndex);
-    splitRegion.SetSize(splitSize);
-
-    itkDebugMacro("  Split Piece: " << splitRegion);
-
-    return maxThreadIdUsed + 1;
-}
-
-//----------------------------------------------------------------------------------------
-
 std::vector< vtkSmartPointer< vtkAppendPolyData > > TractographyAlgorithm::GetOutputFiber() const
 {
     std::vector< vtkSmartPointer< vtkAppendPolyData > > labeledFibers;
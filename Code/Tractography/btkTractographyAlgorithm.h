@@ -50,11 +50,13 @@
 // VTK includes
 #include "vtkSmartPointer.h"
 #include "vtkAppendPolyData.h"
+#include "vtkPolyData.h"
 
 // Local includes
 #include "btkMacro.h"
 #include "btkDiffusionSignal.h"
 #include "btkDiffusionModel.h"
+#include "btkRandomNumberGenerator.h"
 
 namespace btk
 {
@@ -96,6 +98,9 @@ class TractographyAlgorithm : public itk::ProcessObject
         btkSetMacro(SeedSpacing, float);
         btkGetMacro(SeedSpacing, float);
 
+        btkSetMacro(RandomSeed, unsigned int);
+        btkGetMacro(RandomSeed, unsigned int);
+
         /**
          * @brief Run the algorithm.
          */
@@ -131,9 +136,16 @@ class TractographyAlgorithm : public itk::ProcessObject
         virtual void Initialize();
 
         /**
-         * @brief Split the requested region of the label image (for parallel processing).
+         * @brief Build the list of seeds (selected labels inside the mask), in the scan order of the label image.
+         */
+        virtual void InitializeSeeds();
+
+        /**
+         * @brief Get the next seed to process (shared work queue of the threads).
+         * @param seedIndex Index of the next seed.
+         * @return False if all seeds have already been taken.
          */
-        virtual unsigned int SplitRequestedRegion(unsigned int i, unsigned int num, LabelImage::RegionType &splitRegion);
+        bool GetNextSeed(unsigned int &seedIndex);
 
         /**
          * @brief Callback routine used by the threading library.
@@ -141,16 +153,24 @@ class TractographyAlgorithm : public itk::ProcessObject
         static ITK_THREAD_RETURN_TYPE ThreaderCallback(void *arg);
 
         /**
-         * @brief The execute method for each thread.
+         * @brief The execute method for each thread (seeds are taken from the queue until it is empty).
+         * @param threadId Index of the thread.
+         */
+        virtual void ThreadedGenerateData(itk::ThreadIdType threadId);
+
+        /**
+         * @brief Append the fibers of the seeds to the output of their label, in the order of the seeds.
          */
-        virtual void ThreadedGenerateData(const LabelImage::RegionType &region, itk::ThreadIdType threadId);
+        virtual void GatherOutputFibers();
 
         /**
          * @brief Propagate using the tractography algorithm at a seed point.
+         * This method is called concurrently by several threads, so it must not modify the filter.
          * @param point Seed point.
+         * @param generator Random number generator of the seed (its stream only depends on the index of the seed).
          * @return Fiber path estimate of the current seed.
          */
-        virtual vtkSmartPointer< vtkPolyData > PropagateSeed(Self::PhysicalPoint point) = 0;
+        virtual vtkSmartPointer< vtkPolyData > PropagateSeed(Self::PhysicalPoint point, RandomNumberGenerator &generator) = 0;
 
     protected:
         /**
@@ -176,6 +196,15 @@ class TractographyAlgorithm : public itk::ProcessObject
             Self::Pointer Filter;
         };
 
+        /**
+         * @brief Seed point and its label.
+         */
+        struct Seed
+        {
+            Self::PhysicalPoint Point;
+            unsigned short      Label;
+        };
+
     private:
         /**
          * @brief Image of regions of interest (seed regions for tractography algorithm).
@@ -192,6 +221,26 @@ class TractographyAlgorithm : public itk::ProcessObject
          */
         float m_SeedSpacing;
 
+        /**
+         * @brief Seed of the random number generators (the generator of each seed point is initialized with this seed and the index of the seed point).
+         */
+        unsigned int m_RandomSeed;
+
+        /**
+         * @brief Seed points to process.
+         */
+        std::vector< Seed > m_Seeds;
+
+        /**
+         * @brief Estimated fiber of each seed point (each thread only writes the elements of its own seeds).
+         */
+        std::vector< vtkSmartPointer< vtkPolyData > > m_SeedFibers;
+
+        /**
+         * @brief Index of the next seed to process.
+         */
+        unsigned int m_NextSeed;
+
         /**
          * @brief Estimated fibers for each label represented by VTK polydata lines.
          */
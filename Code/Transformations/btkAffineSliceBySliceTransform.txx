@@ -64,7 +64,7 @@ AffineSliceBySliceTransform<TScalarType,NDimensions, TPixelType>
     }
     else
     {
-        Tp = m_TransformList[ index[2] ] -> TransformPoint( Tp );
+        Tp = this -> TransformPointOfSlice( index[2], p );
     }
 
     return Tp;
@@ -198,6 +198,7 @@ Initialize()
     m_TransformList[i] -> SetCenter(centerPoint);
   }
 
+  this -> UpdateSliceMatrices();
   this -> Modified();
 }
 
@@ -234,6 +235,7 @@ Initialize( TransformBase * t )
     m_TransformList[i] -> SetParameters( t -> GetParameters() );
   }
 
+  this -> UpdateSliceMatrices();
   this -> Modified();
 }
 
@@ -274,6 +276,7 @@ SetParameters( const ParametersType & parameters )
 
   }
 
+  this -> UpdateSliceMatrices();
   this -> Modified();
 }
 
@@ -314,6 +317,7 @@ SetFixedParameters( const ParametersType & fp )
     m_TransformList[j] -> SetCenter ( c );
   }
 
+  this -> UpdateSliceMatrices();
   this -> Modified();
 
 }
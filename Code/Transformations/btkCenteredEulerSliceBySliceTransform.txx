@@ -64,7 +64,7 @@ CenteredEulerSliceBySliceTransform<TScalarType,NDimensions,TPixelType>
     }
     else
     {
-        Tp = m_TransformList[ index[2] ] -> TransformPoint( Tp );
+        Tp = this -> TransformPointOfSlice( index[2], p );
     }
 
     return Tp;
@@ -199,6 +199,7 @@ Initialize()
         m_TransformList[i] -> SetCenter(centerPoint);
     }
 
+    this -> UpdateSliceMatrices();
     this -> Modified();
 }
 
@@ -240,6 +241,7 @@ Initialize( TransformBase * t )
 
     }
 
+    this -> UpdateSliceMatrices();
     this -> Modified();
 }
 
@@ -281,6 +283,7 @@ SetParameters( const ParametersType & parameters )
 
     }
 
+    this -> UpdateSliceMatrices();
     this -> Modified();
 }
 
@@ -321,6 +324,7 @@ SetFixedParameters( const ParametersType & fp )
         m_TransformList[j] -> SetCenter ( c );
     }
 
+    this -> UpdateSliceMatrices();
     this -> Modified();
 
 }
@@ -155,6 +155,7 @@ public:
   void SetSliceParameters( unsigned int i, const ParametersType & parameters )
   {
     this->m_TransformList[i] -> SetParameters( parameters );
+    this -> UpdateSliceMatrix(i);
     this -> Modified();
   }
 
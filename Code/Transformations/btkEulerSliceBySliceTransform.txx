@@ -64,7 +64,7 @@ EulerSliceBySliceTransform<TScalarType,NDimensions,TPixelType>
     }
     else
     {
-        Tp = this->m_TransformList[ index[2] ] -> TransformPoint( Tp );
+        Tp = this -> TransformPointOfSlice( index[2], p );
     }
 
     return Tp;
@@ -200,6 +200,7 @@ Initialize()
         m_TransformList[i] -> SetCenter(centerPoint);
     }
 
+    this -> UpdateSliceMatrices();
     this -> Modified();
 }
 
@@ -238,6 +239,7 @@ Initialize( TransformType * t )
         //m_TransformList[i] -> SetParameters( t -> GetParameters() );
     }
 
+    this -> UpdateSliceMatrices();
     this -> Modified();
 }
 
@@ -278,6 +280,7 @@ SetParameters( const ParametersType & parameters )
 
     }
 
+    this -> UpdateSliceMatrices();
     this -> Modified();
 }
 
@@ -318,6 +321,7 @@ SetFixedParameters( const ParametersType & fp )
         m_TransformList[j] -> SetCenter ( c );
     }
 
+    this -> UpdateSliceMatrices();
     this -> Modified();
 
 }
@@ -40,7 +40,7 @@ namespace btk
 {
 
 RandomSliceBySliceTransformGenerator::RandomSliceBySliceTransformGenerator():m_NumberOfParameters(6),m_MaxRotation(5),m_MaxTranslation(5),
-    m_VerboseMode(false)
+    m_VerboseMode(false),m_Seed(btk::RandomNumberGenerator::GetTimeSeed())
 {
     m_ActiveParameters.set_size(m_NumberOfParameters);
     m_ActiveParameters.Fill(1);
@@ -98,7 +98,7 @@ void RandomSliceBySliceTransformGenerator::Update()
 
     //Slice N°i random transformation :
     Rigid3DTransformType::Pointer RandomTransform = Rigid3DTransformType::New();
-    srand(time(NULL));
+    btk::RandomNumberGenerator generator(m_Seed, 0);
 
 
     Rigid3DTransformType::ParametersType randomParams(RandomTransform->GetNumberOfParameters());
@@ -110,21 +110,21 @@ void RandomSliceBySliceTransformGenerator::Update()
         randomParams.Fill(0);
         m_Transform->SetSliceParameters(i, randomParams);
 
-        int rndm = rand()%10;
+        int rndm = generator.GenerateInteger(10);
         RandomTransform->SetIdentity();
         Rigid3DTransformType::ParametersType randomParams(RandomTransform->GetNumberOfParameters());
 
         if(rndm >= threshold)
         {
-            int rot_trans = rand()%3;
+            int rot_trans = generator.GenerateInteger(3);
 
             //Rotation
             if(rot_trans == 0)
             {
-                int paramR = rand()%3 ; // x y and z
+                int paramR = generator.GenerateInteger(3) ; // x y and z
                 if(m_ActiveParameters[paramR] == 1)
                 {
-                    randomParams[paramR] = rand()/((double)RAND_MAX/std::abs(m_MaxRotation - m_MinRotation )) - std::abs(m_MinRotation);
+                    randomParams[paramR] = generator.GenerateUniform(m_MinRotation, m_MaxRotation);
                 }
 
             }
@@ -132,25 +132,25 @@ void RandomSliceBySliceTransformGenerator::Update()
             else if(rot_trans == 1)
             {
 
-                int paramT = (rand()%3) + 3;
+                int paramT = generator.GenerateInteger(3) + 3;
                 if(m_ActiveParameters[paramT] == 1)
                 {
-                    randomParams[paramT] = rand()/((double)RAND_MAX/ std::abs(m_MaxTranslation - m_MinTranslation)) - std::abs(m_MinTranslation);
+                    randomParams[paramT] = generator.GenerateUniform(m_MinTranslation, m_MaxTranslation);
                 }
 
             }
             //Rotation and translation
             else
             {
-                int paramR = rand()%3;
-                int paramT = (rand()%3) + 3;
+                int paramR = generator.GenerateInteger(3);
+                int paramT = generator.GenerateInteger(3) + 3;
                 if(m_ActiveParameters[paramR] == 1)
                 {
-                    randomParams[paramR] = rand()/((double)RAND_MAX/std::abs(m_MaxRotation - m_MinRotation )) - std::abs(m_MinRotation);
+                    randomParams[paramR] = generator.GenerateUniform(m_MinRotation, m_MaxRotation);
                 }
                 if(m_ActiveParameters[paramT] == 1)
                 {
-                    randomParams[paramT] = rand()/((double)RAND_MAX/ std::abs(m_MaxTranslation - m_MinTranslation)) - std::abs(m_MinTranslation);
+                    randomParams[paramT] = generator.GenerateUniform(m_MinTranslation, m_MaxTranslation);
                 }
 
             }
@@ -42,6 +42,7 @@
 
 #include "btkEulerSliceBySliceTransform.h"
 #include "btkMacro.h"
+#include "btkRandomNumberGenerator.h"
 
 
 namespace btk
@@ -86,6 +87,10 @@ class RandomSliceBySliceTransformGenerator: public itk::Object
         btkSetMacro(VerboseMode,bool);
         btkGetMacro(VerboseMode,bool);
 
+        /** Set/Get the seed of the random numbers (default: depends on the current time). */
+        btkSetMacro(Seed,unsigned long long);
+        btkGetMacro(Seed,unsigned long long);
+
 
     protected:
         RandomSliceBySliceTransformGenerator();
@@ -106,6 +111,8 @@ class RandomSliceBySliceTransformGenerator: public itk::Object
 
         bool                    m_VerboseMode;
 
+        unsigned long long      m_Seed;
+
 
 };
 
@@ -158,6 +158,7 @@ public:
   void SetSliceParameters( unsigned int i, const ParametersType & parameters )
   {
     m_TransformList[i] -> SetParameters( parameters );
+    this -> UpdateSliceMatrix(i);
     this -> Modified();
   }
 
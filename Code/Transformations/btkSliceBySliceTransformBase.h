@@ -41,6 +41,8 @@
 #include "itkImage.h"
 #include "itkContinuousIndex.h"
 #include "list"
+#include "vector"
+#include "algorithm"
 
 namespace btk
 {
@@ -190,7 +192,99 @@ public:
 
    // virtual void GetInverse(Self *) const = 0;
 
+    /**
+     * @brief Transform a point with the transformation of a given slice.
+     * Unlike TransformPoint(p), the slice is not searched from the index of the point in the image
+     * (the point is transformed even if it is outside the image), and the cached matrix of the slice
+     * is used instead of a call to the slice transformation.
+     * @param slice Index of the slice.
+     * @param p Point to transform.
+     * @return Transformed point.
+     */
+    OutputPointType TransformPointOfSlice(unsigned int slice, const InputPointType & p) const
+    {
+        // The cache is not filled (it is updated by the derived transformations)
+        if((slice + 1) * SliceMatrixSize > m_SliceMatrices.size())
+        {
+            return this -> GetSliceTransform(slice) -> TransformPoint(p);
+        }
+
+        const TScalarType * m = &m_SliceMatrices[slice * SliceMatrixSize];
+        OutputPointType Tp;
+
+        for(unsigned int i = 0; i < NDimensions; i++)
+        {
+            Tp[i] = m[i*(NDimensions+1) + NDimensions];
+
+            for(unsigned int j = 0; j < NDimensions; j++)
+            {
+                Tp[i] += m[i*(NDimensions+1) + j] * p[j];
+            }
+        }
+
+        return Tp;
+    }
 
+    /**
+     * @brief Transform several points with the transformation of a given slice (see TransformPointOfSlice).
+     * The coefficients of the matrix are loaded once for all the points, so that the loop can be vectorized.
+     * @param slice Index of the slice.
+     * @param input Points to transform.
+     * @param output Transformed points (can be the input array).
+     * @param numberOfPoints Number of points.
+     */
+    void TransformPointsOfSlice(unsigned int slice, const InputPointType * input, OutputPointType * output, unsigned long numberOfPoints) const
+    {
+        if((slice + 1) * SliceMatrixSize > m_SliceMatrices.size())
+        {
+            for(unsigned long n = 0; n < numberOfPoints; n++)
+            {
+                output[n] = this -> GetSliceTransform(slice) -> TransformPoint(input[n]);
+            }
+
+            return;
+        }
+
+        TScalarType m[SliceMatrixSize];
+        std::copy(&m_SliceMatrices[slice * SliceMatrixSize], &m_SliceMatrices[slice * SliceMatrixSize] + SliceMatrixSize, m);
+
+        for(unsigned long n = 0; n < numberOfPoints; n++)
+        {
+            TScalarType p[NDimensions];
+            for(unsigned int j = 0; j < NDimensions; j++)
+            {
+                p[j] = input[n][j];
+            }
+
+            for(unsigned int i = 0; i < NDimensions; i++)
+            {
+                TScalarType value = m[i*(NDimensions+1) + NDimensions];
+
+                for(unsigned int j = 0; j < NDimensions; j++)
+                {
+                    value += m[i*(NDimensions+1) + j] * p[j];
+                }
+
+                output[n][i] = value;
+            }
+        }
+    }
+
+    /**
+     * @brief Update the cached matrices of all the slices.
+     * It is done by SetParameters, SetSliceParameters, SetFixedParameters and Initialize. It must be called
+     * if a transformation returned by GetSliceTransform is modified directly.
+     */
+    void UpdateSliceMatrices()
+    {
+        unsigned int numberOfSlices = this -> GetNumberOfSlices();
+        m_SliceMatrices.resize(numberOfSlices * SliceMatrixSize);
+
+        for(unsigned int i = 0; i < numberOfSlices; i++)
+        {
+            this -> UpdateSliceMatrix(i);
+        }
+    }
 
   protected:
       /** Default constructor. Otherwise we get a run time warning from itkTransform. */
@@ -198,7 +292,34 @@ public:
 
     virtual ~SliceBySliceTransformBase(){}
 
+    /** Update the cached matrix of a slice (nothing is done if the cache has not been sized by UpdateSliceMatrices). */
+    void UpdateSliceMatrix(unsigned int slice)
+    {
+        if((slice + 1) * SliceMatrixSize > m_SliceMatrices.size())
+        {
+            return;
+        }
+
+        const TransformType * t = this -> GetSliceTransform(slice);
+        TScalarType * m = &m_SliceMatrices[slice * SliceMatrixSize];
+
+        for(unsigned int i = 0; i < NDimensions; i++)
+        {
+            for(unsigned int j = 0; j < NDimensions; j++)
+            {
+                m[i*(NDimensions+1) + j] = t -> GetMatrix()[i][j];
+            }
+            m[i*(NDimensions+1) + NDimensions] = t -> GetOffset()[i];
+        }
+    }
+
   private:
+    /** Size of the matrix of a slice (rows of the matrix followed by the offset). */
+    static const unsigned int SliceMatrixSize = NDimensions*(NDimensions+1);
+
+    /** Matrices of the slices: SliceMatrixSize values per slice. */
+    std::vector< TScalarType > m_SliceMatrices;
+
     /** List of transforms. */
 //    TransformPointerList       m_TransformList;
 //    ImagePointerType           m_Image;
@@ -90,6 +90,7 @@ int main(int argc, char** argv)
     TCLAP::ValueArg< int >       numberOfStartingEstimateArg  ("","start","number of starting estimates (per rotation axis) (default: 3)",false,3,"int",cmd);
     TCLAP::ValueArg< int >       orderInterpolationArg ("","order","order of the interpolation spline",false,1,"int",cmd);
     TCLAP::SwitchArg             useImageCenterSwitchArg("","useImageCenter","Use image center for transform initialization instead of file headers",cmd,false);
+    TCLAP::SwitchArg             parallelSearchSwitchArg("","parallel","Register the starting estimates concurrently (OpenMP), each thread with its own copy of the cost function",cmd,false);
     
     //TODO
 
@@ -120,6 +121,7 @@ int main(int argc, char** argv)
     rotationRange[2] = rotationZRangeArg.getValue();
     int samplingRate = numberOfStartingEstimateArg.getValue();
     int interpolationOrder = orderInterpolationArg.getValue();
+    bool useParallelSearch = parallelSearchSwitchArg.isSet();
 
 
 
@@ -301,12 +303,14 @@ int main(int argc, char** argv)
     std::vector< std::pair< vnl_vector< double >, double > > pairOfCandidates(candidates.size());
 
     std::cout<<"Run registration for each set of candidate parameters\n";
+    std::vector< vnl_vector< double > > registeredCandidates;
+    std::vector< double >               candidateCosts;
+    btk::PandoraBoxRegistrationFilters::RegisterStartingPoints(*myCostFunction, candidates, registeredCandidates, candidateCosts, tmpParameterRange, tmpTolerance, 1e-3, useParallelSearch);
+
     for(unsigned int i=0; i < candidates.size(); i++)
     {
-        btk::PandoraBoxRegistrationFilters::Register3DImages(*myCostFunction, candidates[i], outputParam, tmpParameterRange, tmpTolerance);
-        //std::cout<<"Estimated parameters : "<<outputParam<<std::endl;
-        pairOfCandidates[i].first = outputParam;
-        pairOfCandidates[i].second = (*myCostFunction)(outputParam);
+        pairOfCandidates[i].first = registeredCandidates[i];
+        pairOfCandidates[i].second = candidateCosts[i];
         //A cost function value equal to 0 is not possible (meaning that there is no more overlap between the two images.
         if(pairOfCandidates[i].second == 0)
             pairOfCandidates[i].second = std::numeric_limits<double>::max();
@@ -380,12 +384,19 @@ int main(int argc, char** argv)
         }
 
     //Run registration for each set of parameters
+    std::vector< vnl_vector< double > > perturbations(numberOfBestCandidates * numberOfPerturbations);
+    for(unsigned int i=0; i < numberOfBestCandidates * numberOfPerturbations; i++)
+        perturbations[i] = pairOfParamsAndCostFunctionValues[i].first;
+
+    std::vector< vnl_vector< double > > registeredPerturbations;
+    std::vector< double >               perturbationCosts;
+    btk::PandoraBoxRegistrationFilters::RegisterStartingPoints(*myCostFunction, perturbations, registeredPerturbations, perturbationCosts, tmpParameterRange, tmpTolerance, 1e-3, useParallelSearch);
+
     for(unsigned int i=0; i < numberOfBestCandidates * numberOfPerturbations; i++)
     {
-        btk::PandoraBoxRegistrationFilters::Register3DImages(*myCostFunction, pairOfParamsAndCostFunctionValues[i].first, outputParam, tmpParameterRange, tmpTolerance);
         //No check of improvement -> this might be an issue
-        pairOfParamsAndCostFunctionValues[i].first = outputParam;
-        pairOfParamsAndCostFunctionValues[i].second = (*myCostFunction)(outputParam);
+        pairOfParamsAndCostFunctionValues[i].first = registeredPerturbations[i];
+        pairOfParamsAndCostFunctionValues[i].second = perturbationCosts[i];
         //A cost function value equal to 0 is not possible (meaning that there is no more overlap between the two images.
         if(pairOfParamsAndCostFunctionValues[i].second == 0)
             pairOfParamsAndCostFunctionValues[i].second = std::numeric_limits<double>::max();
@@ -400,6 +411,7 @@ int main(int argc, char** argv)
     vnl_vector< double > bestParamSoFar(inputParam.size(),0);
 
     bestParamSoFar = pairOfParamsAndCostFunctionValues[0].first;
+    outputParam    = bestParamSoFar;
 
 
     //THE OTHER SCALES ****************************************************************************************
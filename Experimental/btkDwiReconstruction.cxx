@@ -82,6 +82,7 @@ int main(int argc, char *argv[])
         TCLAP::ValueArg< std::string >  outFileNameArg ("o", "output", "output", true, "", "string", cmd);
         TCLAP::SwitchArg                volumeRegistrationArg("","volumeRegistration", "Enable volume to volume registration", cmd, false);
         TCLAP::SwitchArg                sliceRegistrationArg("","sliceRegistration", "Enable slice by slice registration", cmd, false);
+        TCLAP::SwitchArg                parallelVolumeRegistrationArg("","parallelVolumeRegistration", "Register the volumes concurrently (blocks of consecutive volumes)", cmd, false);
         TCLAP::ValueArg<double>         radiusArg("","radius", "Only for WSH: radius of neighbor search", false, false, "double", cmd);
 
 
@@ -96,6 +97,7 @@ int main(int argc, char *argv[])
 
         bool   volumeRegistration   = volumeRegistrationArg.getValue();
         bool   sliceRegistration    = sliceRegistrationArg.getValue();
+        bool   parallelVolumeRegistration = parallelVolumeRegistrationArg.getValue();
         double radius               = radiusArg.getValue();
 
 
@@ -127,6 +129,8 @@ int main(int argc, char *argv[])
         //                          registration
         // - SetSliceRegistration:  true if you want to compute a slice by slice
         //                          registration
+        // - SetParallelVolumeRegistration: true if the volumes are registered
+        //                          concurrently
         // - GetOutput:             Return a pointer of DiffusionDataset
         //                          (Cf. Diffusion/DiffusionDataset.h
         // Note additional output: the registred sequence as "Registred_sequence.nii.gz"
@@ -145,6 +149,7 @@ int main(int argc, char *argv[])
 
         }
         Reconstruction -> SetVolumeRegistration(volumeRegistration);
+        Reconstruction -> SetParallelVolumeRegistration(parallelVolumeRegistration);
         Reconstruction -> SetSliceRegistration(sliceRegistration);
         Reconstruction -> Update();
 
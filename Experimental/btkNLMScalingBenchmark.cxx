@@ -0,0 +1,183 @@
+/*
+ Copyright or © or Copr. Université de Strasbourg - Centre National de la Recherche Scientifique
+
+ 18 october 2026
+ agent@local
+
+ This software is governed by the CeCILL-B license under French law and
+ abiding by the rules of distribution of free software.  You can  use,
+ modify and/ or redistribute the software under the terms of the CeCILL-B
+ license as circulated by CEA, CNRS and INRIA at the following URL
+ "http://www.cecill.info".
+
+ As a counterpart to the access to the source code and  rights to copy,
+ modify and redistribute granted by the license, users are provided only
+ with a limited warranty  and the software's author,  the holder of the
+ economic rights,  and the successive licensors  have only  limited
+ liability.
+
+ In this respect, the user's attention is drawn to the risks associated
+ with loading,  using,  modifying and/or developing or reproducing the
+ software by the user in light of its specific status of free software,
+ that may mean  that it is complicated to manipulate,  and  that  also
+ therefore means  that it is reserved for developers  and  experienced
+ professionals having in-depth computer knowledge. Users are therefore
+ encouraged to load and test the software's suitability as regards their
+ requirements in conditions enabling the security of their systems and/or
+ data to be ensured and,  more generally, to use and operate it in the
+ same conditions as regards security.
+
+ The fact that you are presently reading this means that you have had
+ knowledge of the CeCILL-B license and that you accept its terms.
+ */
+
+/*
+ Scaling benchmark of the NLM denoising (btk::NLMTool) : the same denoising is run with 1 to N threads
+ and the wall time, the speedup and the maximum difference with the single-thread output are reported.
+*/
+
+/* Standard includes */
+#include <tclap/CmdLine.h>
+#include "vector"
+#include "iomanip"
+#include "cmath"
+#include "algorithm"
+#include "ctime"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Itk includes */
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageDuplicator.h"
+#include "itkImageRegionConstIterator.h"
+
+/*Btk includes*/
+#include "btkNLMTool.h"
+
+
+int main(int argc, char** argv)
+{
+  try {
+
+    TCLAP::CmdLine cmd("Scaling benchmark of the NLM denoising (1 to N threads)", ' ', "0.1", true);
+
+    TCLAP::ValueArg<std::string> inputImageArg ("i","image_file","input image file",true,"","string",cmd);
+    TCLAP::ValueArg<std::string> inputMaskArg  ("m","mask_file","filename of the mask image",false,"","string",cmd);
+    TCLAP::ValueArg< float >     paddingArg    ("p","pad","padding value (used if no mask image is provided, default is 0)",false,0,"float",cmd);
+    TCLAP::ValueArg< int >       hwnArg        ("","hwn","patch half size (default is 1)",false,1,"int",cmd);
+    TCLAP::ValueArg< int >       hwvsArg       ("","hwvs","half size of the volume search area (default is 5)",false,5,"int",cmd);
+    TCLAP::ValueArg< int >       blockArg      ("","block","0: pointwise, 1: blockwise, 2: fast blockwise (default is 1)",false,1,"int",cmd);
+    TCLAP::ValueArg< int >       threadsArg    ("t","threads","maximum number of threads (default is the number of processors)",false,0,"int",cmd);
+
+    // Parse the args.
+    cmd.parse( argc, argv );
+
+    typedef float PixelType;
+    typedef itk::Image< PixelType, 3 >        ImageType;
+    typedef ImageType::Pointer                ImagePointer;
+    typedef itk::ImageFileReader< ImageType > ReaderType;
+    typedef itk::ImageDuplicator< ImageType > DuplicatorType;
+
+    ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName( inputImageArg.getValue() );
+    reader->Update();
+    ImagePointer inputImage = reader->GetOutput();
+
+    ImagePointer maskImage;
+    if(inputMaskArg.getValue() != "")
+    {
+      ReaderType::Pointer maskReader = ReaderType::New();
+      maskReader->SetFileName( inputMaskArg.getValue() );
+      maskReader->Update();
+      maskImage = maskReader->GetOutput();
+    }
+
+#ifdef _OPENMP
+    int maxThreads = threadsArg.getValue();
+    if(maxThreads <= 0)
+    {
+      maxThreads = omp_get_num_procs();
+    }
+#else
+    // Built without OpenMP: only the serial run is possible
+    int maxThreads = 1;
+#endif
+
+    //1, 2, 4, ... threads, always finishing with the maximum number of threads
+    std::vector<int> numberOfThreads;
+    for(int threads = 1; threads < maxThreads; threads *= 2)
+    {
+      numberOfThreads.push_back(threads);
+    }
+    numberOfThreads.push_back(maxThreads);
+
+    ImagePointer referenceOutput;
+    double referenceTime = 0;
+
+    std::cout<<std::setw(10)<<"threads"<<std::setw(15)<<"time (s)"<<std::setw(12)<<"speedup"<<std::setw(15)<<"max diff"<<std::endl;
+
+    for(unsigned int i = 0; i < numberOfThreads.size(); i++)
+    {
+      int threads = numberOfThreads[i];
+#ifdef _OPENMP
+      omp_set_num_threads(threads);
+#endif
+
+      btk::NLMTool<PixelType> myTool;
+      myTool.SetInput(inputImage);
+      if(maskImage.IsNotNull())
+        myTool.SetMaskImage(maskImage);
+      else
+        myTool.SetPaddingValue(paddingArg.getValue());
+      myTool.SetPatchSize(hwnArg.getValue());
+      myTool.SetSpatialBandwidth(hwvsArg.getValue());
+      myTool.SetCentralPointStrategy(-1);
+      myTool.SetBlockwiseStrategy(blockArg.getValue());
+      myTool.SetOptimizationStrategy(1);
+      myTool.SetLowerThresholds(0.95, 0.5);
+      myTool.SetSmoothing(1);
+
+#ifdef _OPENMP
+      double start = omp_get_wtime();
+      myTool.ComputeOutput();
+      double elapsed = omp_get_wtime() - start;
+#else
+      std::clock_t start = std::clock();
+      myTool.ComputeOutput();
+      double elapsed = static_cast< double >(std::clock() - start) / CLOCKS_PER_SEC;
+#endif
+
+      DuplicatorType::Pointer duplicator = DuplicatorType::New();
+      duplicator->SetInputImage( myTool.GetOutput() );
+      duplicator->Update();
+      ImagePointer output = duplicator->GetOutput();
+
+      double maxDiff = 0;
+      if(threads == 1)
+      {
+        referenceOutput = output;
+        referenceTime   = elapsed;
+      }
+      else
+      {
+        itk::ImageRegionConstIterator< ImageType > refIt( referenceOutput, referenceOutput->GetLargestPossibleRegion() );
+        itk::ImageRegionConstIterator< ImageType > outIt( output, output->GetLargestPossibleRegion() );
+        for(refIt.GoToBegin(), outIt.GoToBegin(); !refIt.IsAtEnd(); ++refIt, ++outIt)
+        {
+          maxDiff = std::max(maxDiff, (double)std::fabs(refIt.Get() - outIt.Get()));
+        }
+      }
+
+      std::cout<<std::setw(10)<<threads<<std::setw(15)<<elapsed<<std::setw(12)<<referenceTime / elapsed<<std::setw(15)<<maxDiff<<std::endl;
+    }
+
+    return EXIT_SUCCESS;
+
+  } catch (TCLAP::ArgException &e)  // catch any exceptions
+  { std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl; }
+
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,333 @@
+/*==========================================================================
+
+  © Université de Strasbourg - Centre National de la Recherche Scientifique
+
+  Date: 18/10/2026
+  Author(s): agent (agent@local)
+
+  This software is governed by the CeCILL-B license under French law and
+  abiding by the rules of distribution of free software.  You can  use,
+  modify and/ or redistribute the software under the terms of the CeCILL-B
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and  rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty  and the software's author,  the holder of the
+  economic rights,  and the successive licensors  have only  limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading,  using,  modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean  that it is complicated to manipulate,  and  that  also
+  therefore means  that it is reserved for developers  and  experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and,  more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL-B license and that you accept its terms.
+
+==========================================================================*/
+
+
+#include "btkPriorDensity.h"
+#include "btkPriorLogarithmLookUpTable.h"
+#include "btkSphericalBucketIndex.h"
+#include "btkRandomNumberGenerator.h"
+
+#include "vector"
+#include "cmath"
+#include "cstdlib"
+#include "iostream"
+#include "algorithm"
+
+
+/**
+ * @brief Random vector of norm in [minimumNorm,maximumNorm].
+ */
+static void RandomVector(btk::RandomNumberGenerator &generator, double minimumNorm, double maximumNorm, double *vector)
+{
+    double norm = 0.0;
+
+    do
+    {
+        vector[0] = generator.GenerateUniform(-1.0, 1.0);
+        vector[1] = generator.GenerateUniform(-1.0, 1.0);
+        vector[2] = generator.GenerateUniform(-1.0, 1.0);
+        norm = std::sqrt(vector[0]*vector[0] + vector[1]*vector[1] + vector[2]*vector[2]);
+    } while(norm < 1e-3 || norm > 1.0);
+
+    double scale = generator.GenerateUniform(minimumNorm, maximumNorm) / norm;
+    vector[0] *= scale; vector[1] *= scale; vector[2] *= scale;
+}
+
+/**
+ * @brief Cosine of the angle between two vectors.
+ */
+static double Cosine(const double *a, const double *b)
+{
+    return (a[0]*b[0] + a[1]*b[1] + a[2]*b[2]) / (std::sqrt(a[0]*a[0] + a[1]*a[1] + a[2]*a[2]) * std::sqrt(b[0]*b[0] + b[1]*b[1] + b[2]*b[2]));
+}
+
+/**
+ * @brief Test the pruning of the maximum a posteriori of the particle filtering tractography against an exhaustive search:
+ * the tabulated logarithm of the prior must match the exact logarithm, the spherical bucket index must return all the
+ * vectors of a cone, and the best transition found among the candidates must be the one found among all the particles.
+ */
+int main(int, char*[])
+{
+    std::cout << "Maximum a posteriori pruning test" << std::endl;
+
+    btk::RandomNumberGenerator generator(0, 0);
+    bool testPassed = true;
+
+    //
+    // Tabulated logarithm of the prior
+    //
+
+    btk::PriorDensity prior(30.0);
+
+    double               prior0 = prior.Evaluate(0.0);
+    double minimumScalarProduct = -prior0 / (prior.Evaluate(1.0) - prior0);
+    double maximumScalarProduct = 1.0;
+
+    btk::PriorLogarithmLookUpTable logPrior(prior, std::max(minimumScalarProduct, -maximumScalarProduct), maximumScalarProduct, 4096);
+
+    double maximumLogError = 0.0;
+
+    for(unsigned int n = 0; n < 100000; n++)
+    {
+        // Scalar products of the support, with many samples close to its lower bound
+        double scalarProduct = (n % 2 == 0) ? generator.GenerateUniform(minimumScalarProduct, maximumScalarProduct) : minimumScalarProduct + std::pow(10.0, generator.GenerateUniform(-12.0, -1.0));
+
+        if(scalarProduct > minimumScalarProduct && scalarProduct <= maximumScalarProduct + 0.1)
+        {
+            maximumLogError = std::max(maximumLogError, std::abs(logPrior.Evaluate(scalarProduct) - std::log(prior.Evaluate(scalarProduct))));
+        }
+    }
+
+    std::cout << "- Maximal error of the tabulated logarithm of the prior: " << maximumLogError << std::endl;
+
+    if(!(maximumLogError < 1e-4))
+    {
+        std::cout << "  Tabulated logarithm of the prior failed !" << std::endl;
+        testPassed = false;
+    }
+
+    //
+    // Cone queries of the spherical bucket index
+    //
+
+    const unsigned int numberOfVectors = 2000;
+    std::vector< double > vectors(3*numberOfVectors);
+    std::vector< unsigned int > elements;
+
+    for(unsigned int e = 0; e < numberOfVectors; e++)
+    {
+        RandomVector(generator, 0.2, 0.6, &vectors[3*e]);
+
+        // Only a part of the vectors is indexed
+        if(generator.GenerateInteger(3) != 0)
+        {
+            elements.push_back(e);
+        }
+    }
+
+    const double cosines[] = { -1.5, -1.0, -0.5, 0.0, 0.3, 0.7, 0.9, 0.99, 0.999, 1.0, 1.5 };
+    const unsigned int bands[] = { 1, 4, 13, 64 };
+
+    unsigned int numberOfMissedElements = 0, numberOfWrongElements = 0;
+
+    for(unsigned int b = 0; b < 4; b++)
+    {
+        btk::SphericalBucketIndex bucketIndex(bands[b]);
+        bucketIndex.Build(vectors, elements);
+
+        std::vector< unsigned int > candidates;
+
+        for(unsigned int q = 0; q < 200; q++)
+        {
+            double query[3];
+            RandomVector(generator, 0.2, 0.6, query);
+
+            // Some queries along the poles
+            if(q < 4)
+            {
+                query[0] = query[1] = 0.0;
+                query[2] = (q % 2 == 0) ? 0.5 : -0.5;
+            }
+
+            for(unsigned int c = 0; c < 11; c++)
+            {
+                bucketIndex.Query(query, cosines[c], candidates);
+
+                std::vector< unsigned int > sortedCandidates(candidates);
+                std::sort(sortedCandidates.begin(), sortedCandidates.end());
+
+                // Candidates are indexed elements, returned once
+                if(std::adjacent_find(sortedCandidates.begin(), sortedCandidates.end()) != sortedCandidates.end())
+                {
+                    numberOfWrongElements++;
+                }
+
+                for(unsigned int i = 0; i < sortedCandidates.size(); i++)
+                {
+                    if(!std::binary_search(elements.begin(), elements.end(), sortedCandidates[i]))
+                    {
+                        numberOfWrongElements++;
+                    }
+                }
+
+                // All the elements of the cone are candidates (elements on the border of the cone are not checked)
+                for(unsigned int e = 0; e < elements.size(); e++)
+                {
+                    if(Cosine(&vectors[3*elements[e]], query) > cosines[c] + 1e-9 && !std::binary_search(sortedCandidates.begin(), sortedCandidates.end(), elements[e]))
+                    {
+                        numberOfMissedElements++;
+                    }
+                }
+            } // for each cosine
+        } // for each query
+    } // for each grid
+
+    std::cout << "- Elements of the cones missed by the bucket index: " << numberOfMissedElements << std::endl;
+    std::cout << "- Wrong elements returned by the bucket index: " << numberOfWrongElements << std::endl;
+
+    if(numberOfMissedElements > 0 || numberOfWrongElements > 0)
+    {
+        std::cout << "  Spherical bucket index failed !" << std::endl;
+        testPassed = false;
+    }
+
+    //
+    // Best transition (as in ParticleFilteringTractographyAlgorithm::ComputeMaximumAPosteriori)
+    //
+
+    const unsigned int numberOfParticles = 300;
+    const double              vectorNorm = 1.0;
+
+    double minimumPriorScalarProduct = minimumScalarProduct;
+    btk::PriorLogarithmLookUpTable transitionLogPrior(prior, std::max(minimumPriorScalarProduct, -vectorNorm*vectorNorm), vectorNorm*vectorNorm, 4096);
+
+    // Previous vectors are spread around a main direction so that many transitions are possible
+    std::vector< double > previousVectors(3*numberOfParticles), delta(numberOfParticles);
+    std::vector< unsigned int > previousParticles;
+
+    for(unsigned int i = 0; i < numberOfParticles; i++)
+    {
+        double *v = &previousVectors[3*i];
+        RandomVector(generator, 1.0, 1.0, v);
+        v[2] += 4.0;
+
+        double norm = std::sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+        v[0] *= vectorNorm / norm; v[1] *= vectorNorm / norm; v[2] *= vectorNorm / norm;
+
+        delta[i] = generator.GenerateUniform(-20.0, 0.0);
+
+        if(generator.GenerateInteger(4) != 0)
+        {
+            previousParticles.push_back(i);
+        }
+    }
+
+    double supportCosine = minimumPriorScalarProduct / (vectorNorm*vectorNorm);
+    unsigned int numberOfBands = (supportCosine > -1.0 && supportCosine < 1.0) ? static_cast< unsigned int >(std::ceil(M_PI / std::acos(supportCosine))) : 1;
+    btk::SphericalBucketIndex transitionIndex(std::max(4u, std::min(64u, numberOfBands)));
+    transitionIndex.Build(previousVectors, previousParticles);
+
+    unsigned int numberOfDifferentTransitions = 0, numberOfTransitions = 0;
+    std::vector< unsigned int > candidates;
+
+    for(unsigned int m = 0; m < numberOfParticles; m++)
+    {
+        double v[3];
+        RandomVector(generator, 1.0, 1.0, v);
+        v[2] += 4.0;
+
+        double norm = std::sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+        v[0] *= vectorNorm / norm; v[1] *= vectorNorm / norm; v[2] *= vectorNorm / norm;
+
+        // Exhaustive search
+        double exhaustiveMax = 0.0;
+        unsigned int exhaustiveImax = 0;
+        bool exhaustiveFound = false;
+
+        for(unsigned int p = 0; p < previousParticles.size(); p++)
+        {
+            unsigned int i = previousParticles[p];
+            const double *vk_i = &previousVectors[3*i];
+            double scalarProduct = v[0]*vk_i[0] + v[1]*vk_i[1] + v[2]*vk_i[2];
+
+            if(scalarProduct > minimumPriorScalarProduct)
+            {
+                double tmp = delta[i] + transitionLogPrior.Evaluate(scalarProduct);
+
+                if(!exhaustiveFound || tmp > exhaustiveMax)
+                {
+                    exhaustiveMax   = tmp;
+                    exhaustiveImax  = i;
+                    exhaustiveFound = true;
+                }
+            }
+        }
+
+        // Search among the candidates of the bucket index
+        double minimumCosine = (minimumPriorScalarProduct < 0.0) ? -1.0 : minimumPriorScalarProduct / (vectorNorm*vectorNorm);
+        transitionIndex.Query(v, minimumCosine, candidates);
+
+        double prunedMax = 0.0;
+        unsigned int prunedImax = 0;
+        bool prunedFound = false;
+
+        for(unsigned int c = 0; c < candidates.size(); c++)
+        {
+            unsigned int i = candidates[c];
+            const double *vk_i = &previousVectors[3*i];
+            double scalarProduct = v[0]*vk_i[0] + v[1]*vk_i[1] + v[2]*vk_i[2];
+
+            if(scalarProduct > minimumPriorScalarProduct)
+            {
+                double tmp = delta[i] + transitionLogPrior.Evaluate(scalarProduct);
+
+                if(!prunedFound || tmp > prunedMax || (tmp == prunedMax && i < prunedImax))
+                {
+                    prunedMax   = tmp;
+                    prunedImax  = i;
+                    prunedFound = true;
+                }
+            }
+        }
+
+        if(exhaustiveFound)
+        {
+            numberOfTransitions++;
+        }
+
+        if(exhaustiveFound != prunedFound || (exhaustiveFound && (exhaustiveImax != prunedImax || exhaustiveMax != prunedMax)))
+        {
+            numberOfDifferentTransitions++;
+        }
+    }
+
+    std::cout << "- Transitions found by the exhaustive search: " << numberOfTransitions << "/" << numberOfParticles << std::endl;
+    std::cout << "- Transitions differing between the pruned and the exhaustive searches: " << numberOfDifferentTransitions << std::endl;
+
+    if(numberOfDifferentTransitions > 0 || numberOfTransitions == 0)
+    {
+        std::cout << "  Pruned transitions failed !" << std::endl;
+        testPassed = false;
+    }
+
+    if(!testPassed)
+    {
+        std::cout << "Test failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Test passed." << std::endl;
+    return EXIT_SUCCESS;
+}
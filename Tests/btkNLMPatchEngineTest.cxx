@@ -0,0 +1,294 @@
+/*==========================================================================
+
+  © Université de Strasbourg - Centre National de la Recherche Scientifique
+
+  Date: 18/10/2026
+  Author(s): agent (agent@local)
+
+  This software is governed by the CeCILL-B license under French law and
+  abiding by the rules of distribution of free software.  You can  use,
+  modify and/ or redistribute the software under the terms of the CeCILL-B
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and  rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty  and the software's author,  the holder of the
+  economic rights,  and the successive licensors  have only  limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading,  using,  modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean  that it is complicated to manipulate,  and  that  also
+  therefore means  that it is reserved for developers  and  experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and,  more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL-B license and that you accept its terms.
+
+==========================================================================*/
+
+
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+#include "btkNLMPatchEngine.h"
+#include "btkNLMTool.h"
+#include "btkRandomNumberGenerator.h"
+
+#include "vector"
+#include "cmath"
+#include "cstdlib"
+#include "iostream"
+#include "algorithm"
+
+
+typedef float                                PixelType;
+typedef itk::Image< PixelType,3 >            ImageType;
+typedef btk::NLMPatchEngine< PixelType >     EngineType;
+typedef btk::NLMTool< PixelType >            ToolType;
+typedef itk::ImageRegionIteratorWithIndex< ImageType > IteratorType;
+
+/**
+ * @brief Squared L2 distance between two ITK patches.
+ */
+static double ReferencePatchDistance(ImageType::Pointer p, ImageType::Pointer q)
+{
+    const PixelType *dataP = p->GetBufferPointer();
+    const PixelType *dataQ = q->GetBufferPointer();
+    double distance = 0.0;
+
+    for(unsigned long k = 0; k < p->GetLargestPossibleRegion().GetNumberOfPixels(); k++)
+    {
+        double difference = dataP[k] - dataQ[k];
+        distance += difference*difference;
+    }
+
+    return distance;
+}
+
+/**
+ * @brief Compare the flat-buffer patch engine with the ITK patches of NLMTool (GetPatch) on a random image.
+ * @param generator Random number generator.
+ * @param size Size of the image.
+ * @param spacing Spacing of the image.
+ * @param h Half size of the patch (in voxels of the smallest spacing, as given to NLMTool).
+ * @return True if all results are the same.
+ */
+static bool TestPatchEngine(btk::RandomNumberGenerator &generator, const ImageType::SizeType &size, const ImageType::SpacingType &spacing, int h)
+{
+    bool passed = true;
+
+    ImageType::RegionType region;
+    region.SetSize(size);
+
+    ImageType::Pointer image = ImageType::New();
+    image->SetRegions(region);
+    image->SetSpacing(spacing);
+    image->Allocate();
+
+    IteratorType it(image, region);
+
+    for(it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+        it.Set(static_cast< PixelType >(generator.GenerateUniform(0.0, 100.0)));
+    }
+
+    // Reference ITK patches
+    ToolType tool;
+    tool.SetInput(image);
+    tool.SetPatchSize(h);
+
+    ImageType::Pointer itkPatchP = ImageType::New();
+    ImageType::Pointer itkPatchQ = ImageType::New();
+    tool.CreatePatch(itkPatchP);
+    tool.CreatePatch(itkPatchQ);
+
+    ImageType::SizeType fullPatchSize = itkPatchP->GetLargestPossibleRegion().GetSize(), halfPatchSize;
+    halfPatchSize[0] = (fullPatchSize[0]-1)/2;
+    halfPatchSize[1] = (fullPatchSize[1]-1)/2;
+    halfPatchSize[2] = (fullPatchSize[2]-1)/2;
+
+    std::cout << "- Image " << size << ", spacing " << spacing << ", half patch size " << halfPatchSize << std::endl;
+
+    // Patch engine
+    EngineType engine;
+    engine.SetImageSize(size);
+    engine.SetHalfPatchSize(halfPatchSize);
+
+    const unsigned long numberOfPixelsInPatch = itkPatchP->GetLargestPossibleRegion().GetNumberOfPixels();
+    ImageType::IndexType center;
+    center[0] = halfPatchSize[0]; center[1] = halfPatchSize[1]; center[2] = halfPatchSize[2];
+
+    if(engine.GetNumberOfPixelsInPatch() != numberOfPixelsInPatch || engine.GetCentralOffset() != (unsigned long)itkPatchP->ComputeOffset(center))
+    {
+        std::cout << "  Size of the patches failed !" << std::endl;
+        return false;
+    }
+
+    const PixelType *buffer = image->GetBufferPointer();
+    std::vector< PixelType > patch(numberOfPixelsInPatch), scratchP(numberOfPixelsInPatch), scratchQ(numberOfPixelsInPatch), accumulated(numberOfPixelsInPatch);
+
+    // Summed-area table of the image
+    std::vector< double > table;
+    engine.AllocateSummedAreaTable(table);
+
+    for(it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+        table[engine.ComputeTableOffset(it.GetIndex()[0], it.GetIndex()[1], it.GetIndex()[2])] = it.Get();
+    }
+
+    engine.ComputeSummedAreaTable(table);
+
+    // Sum of the patches added to the image
+    std::vector< PixelType > patchesSum(region.GetNumberOfPixels(), 0), patchesWeight(region.GetNumberOfPixels(), 0);
+
+    unsigned int numberOfWrongPatches = 0, numberOfWrongOffsets = 0;
+    double maximumDistanceError = 0.0, maximumAccumulationError = 0.0, maximumBoxSumError = 0.0;
+
+    for(it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+        ImageType::IndexType p = it.GetIndex(), q;
+
+        // Another voxel (near the border half of the time)
+        for(unsigned int d = 0; d < 3; d++)
+        {
+            q[d] = (generator.GenerateInteger(2) == 0) ? generator.GenerateInteger(size[d]) : ((generator.GenerateInteger(2) == 0) ? 0 : size[d]-1);
+        }
+
+        tool.GetPatch(p, itkPatchP);
+        tool.GetPatch(q, itkPatchQ);
+
+        if(engine.ComputeOffset(p) != (unsigned long)image->ComputeOffset(p))
+        {
+            numberOfWrongOffsets++;
+        }
+
+        // Contiguous (zero padded) patch
+        engine.GetPatch(buffer, p, &patch[0]);
+
+        if(!std::equal(patch.begin(), patch.end(), itkPatchP->GetBufferPointer()))
+        {
+            numberOfWrongPatches++;
+        }
+
+        // Distance between views (strided in the image or copied in the scratch arrays)
+        EngineType::PatchView viewP = engine.GetPatchView(buffer, p, &scratchP[0]);
+        EngineType::PatchView viewQ = engine.GetPatchView(buffer, q, &scratchQ[0]);
+
+        double referenceDistance = ReferencePatchDistance(itkPatchP, itkPatchQ);
+
+        maximumDistanceError = std::max(maximumDistanceError, std::abs(engine.PatchDistance(viewP, viewQ) - referenceDistance) / (1.0 + referenceDistance));
+        maximumDistanceError = std::max(maximumDistanceError, std::abs(engine.PatchDistance(engine.GetContiguousView(&patch[0]), viewQ) - referenceDistance) / (1.0 + referenceDistance));
+
+        // Weighted sum of patches
+        double weight = generator.GenerateUniform(0.0, 1.0);
+        std::fill(accumulated.begin(), accumulated.end(), 0);
+        engine.AccumulatePatch(&accumulated[0], viewP, 1.0);
+        engine.AccumulatePatch(&accumulated[0], viewQ, weight);
+
+        for(unsigned long k = 0; k < numberOfPixelsInPatch; k++)
+        {
+            double reference = itkPatchP->GetBufferPointer()[k] + weight * itkPatchQ->GetBufferPointer()[k];
+            maximumAccumulationError = std::max(maximumAccumulationError, std::abs(accumulated[k] - reference) / (1.0 + std::abs(reference)));
+        }
+
+        // Sum of the patch in O(1)
+        double referenceSum = 0.0;
+
+        for(unsigned long k = 0; k < numberOfPixelsInPatch; k++)
+        {
+            referenceSum += itkPatchP->GetBufferPointer()[k];
+        }
+
+        maximumBoxSumError = std::max(maximumBoxSumError, std::abs(engine.BoxSum(table, p) - referenceSum) / (1.0 + std::abs(referenceSum)));
+
+        // Each voxel of the image receives its own value from all the patches covering it
+        engine.AddPatchToImage(p, &patch[0], &patchesSum[0], &patchesWeight[0], 1.0);
+    }
+
+    // Number of patches covering each voxel
+    unsigned int numberOfWrongAggregations = 0;
+
+    for(it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+        ImageType::IndexType v = it.GetIndex();
+        long numberOfPatches = 1;
+
+        for(unsigned int d = 0; d < 3; d++)
+        {
+            long first = std::max(0L, (long)v[d] - (long)halfPatchSize[d]);
+            long  last = std::min((long)size[d]-1, (long)v[d] + (long)halfPatchSize[d]);
+            numberOfPatches *= last - first + 1;
+        }
+
+        unsigned long offset = image->ComputeOffset(v);
+
+        if(patchesWeight[offset] != numberOfPatches || std::abs(patchesSum[offset] - numberOfPatches * it.Get()) > 1e-4 * numberOfPatches * (1.0 + it.Get()))
+        {
+            numberOfWrongAggregations++;
+        }
+    }
+
+    std::cout << "  Wrong patches: " << numberOfWrongPatches << ", wrong offsets: " << numberOfWrongOffsets << ", wrong aggregated voxels: " << numberOfWrongAggregations << std::endl;
+    std::cout << "  Maximal relative error of the distances: " << maximumDistanceError << ", of the weighted sums: " << maximumAccumulationError << ", of the box sums: " << maximumBoxSumError << std::endl;
+
+    if(numberOfWrongPatches > 0 || numberOfWrongOffsets > 0 || numberOfWrongAggregations > 0)
+    {
+        std::cout << "  Patches failed !" << std::endl;
+        passed = false;
+    }
+
+    if(!(maximumDistanceError < 1e-5 && maximumAccumulationError < 1e-5 && maximumBoxSumError < 1e-5))
+    {
+        std::cout << "  Distances or sums failed !" << std::endl;
+        passed = false;
+    }
+
+    return passed;
+}
+
+/**
+ * @brief Test the flat-buffer patch engine of NLMTool against the ITK patches (zero padded crops of the image):
+ * patch extraction, views, distances, weighted sums, aggregation and summed-area tables, for isotropic
+ * and anisotropic images, and patches larger than the image.
+ */
+int main(int, char*[])
+{
+    std::cout << "NLM patch engine test" << std::endl;
+
+    btk::RandomNumberGenerator generator(0, 0);
+    bool testPassed = true;
+
+    ImageType::SizeType size;
+    ImageType::SpacingType spacing;
+
+    // Isotropic image
+    size[0] = 9; size[1] = 8; size[2] = 7;
+    spacing[0] = 1.0; spacing[1] = 1.0; spacing[2] = 1.0;
+    testPassed &= TestPatchEngine(generator, size, spacing, 1);
+
+    // Anisotropic image (the patch is smaller along z)
+    size[0] = 10; size[1] = 9; size[2] = 6;
+    spacing[0] = 1.0; spacing[1] = 1.0; spacing[2] = 2.5;
+    testPassed &= TestPatchEngine(generator, size, spacing, 2);
+
+    // Patches larger than the image along some axes
+    size[0] = 7; size[1] = 6; size[2] = 3;
+    spacing[0] = 1.0; spacing[1] = 1.0; spacing[2] = 1.0;
+    testPassed &= TestPatchEngine(generator, size, spacing, 3);
+
+    if(!testPassed)
+    {
+        std::cout << "Test failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Test passed." << std::endl;
+    return EXIT_SUCCESS;
+}
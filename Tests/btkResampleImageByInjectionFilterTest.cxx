@@ -0,0 +1,339 @@
+/*==========================================================================
+
+  © Université de Strasbourg - Centre National de la Recherche Scientifique
+
+  Date: 18/10/2026
+  Author(s): agent (agent@local)
+
+  This software is governed by the CeCILL-B license under French law and
+  abiding by the rules of distribution of free software.  You can  use,
+  modify and/ or redistribute the software under the terms of the CeCILL-B
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and  rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty  and the software's author,  the holder of the
+  economic rights,  and the successive licensors  have only  limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading,  using,  modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean  that it is complicated to manipulate,  and  that  also
+  therefore means  that it is reserved for developers  and  experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and,  more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL-B license and that you accept its terms.
+
+==========================================================================*/
+
+
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageMaskSpatialObject.h"
+#include "itkGaussianSpatialFunction.h"
+
+#include "btkResampleImageByInjectionFilter.h"
+#include "btkEulerSliceBySliceTransform.h"
+#include "btkRandomNumberGenerator.h"
+
+#include "vector"
+#include "cmath"
+#include "cstdlib"
+#include "iostream"
+#include "algorithm"
+
+
+typedef float                                                         PixelType;
+typedef itk::Image< PixelType,3 >                                     ImageType;
+typedef itk::Image< unsigned char,3 >                                 MaskImageType;
+typedef itk::ImageMaskSpatialObject< 3 >                              MaskType;
+typedef btk::EulerSliceBySliceTransform< double,3,PixelType >         TransformType;
+typedef btk::ResampleImageByInjectionFilter< ImageType,ImageType >    ResamplerType;
+typedef itk::ImageRegionIteratorWithIndex< ImageType >                IteratorType;
+typedef itk::ImageRegionIteratorWithIndex< MaskImageType >            MaskIteratorType;
+typedef itk::GaussianSpatialFunction< double,3,ImageType::PointType > GaussianFunctionType;
+
+/**
+ * @brief Create a low resolution image with random intensities.
+ */
+static ImageType::Pointer CreateLowResolutionImage(btk::RandomNumberGenerator &generator, const ImageType::DirectionType &direction, const ImageType::PointType &origin)
+{
+    ImageType::SizeType size;
+    size[0] = 12; size[1] = 12; size[2] = 6;
+
+    ImageType::SpacingType spacing;
+    spacing[0] = 1.0; spacing[1] = 1.0; spacing[2] = 2.0;
+
+    ImageType::RegionType region;
+    region.SetSize(size);
+
+    ImageType::Pointer image = ImageType::New();
+    image->SetRegions(region);
+    image->SetSpacing(spacing);
+    image->SetOrigin(origin);
+    image->SetDirection(direction);
+    image->Allocate();
+
+    IteratorType it(image, region);
+
+    for(it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+        it.Set(static_cast< PixelType >(generator.GenerateUniform(0.0, 100.0)));
+    }
+
+    return image;
+}
+
+/**
+ * @brief Create a slice by slice transform with a small random motion for each slice.
+ */
+static TransformType::Pointer CreateTransform(btk::RandomNumberGenerator &generator, ImageType::Pointer image)
+{
+    TransformType::Pointer transform = TransformType::New();
+    transform->SetImage(image);
+    transform->Initialize();
+
+    for(unsigned int i = 0; i < image->GetLargestPossibleRegion().GetSize()[2]; i++)
+    {
+        TransformType::ParametersType parameters(6);
+        parameters[0] = generator.GenerateUniform(-0.05, 0.05);
+        parameters[1] = generator.GenerateUniform(-0.05, 0.05);
+        parameters[2] = generator.GenerateUniform(-0.05, 0.05);
+        parameters[3] = generator.GenerateUniform(-0.5, 0.5);
+        parameters[4] = generator.GenerateUniform(-0.5, 0.5);
+        parameters[5] = generator.GenerateUniform(-0.5, 0.5);
+
+        transform->SetSliceParameters(i, parameters);
+    }
+
+    return transform;
+}
+
+/**
+ * @brief Reference injection (Gaussian PSF splatting of each voxel of each slice in its neighborhood of the
+ * output image, as in the original implementation with neighborhood iterators).
+ */
+static std::vector< double > ReferenceInjection(const std::vector< ImageType::Pointer > &images, const std::vector< TransformType::Pointer > &transforms, ImageType::Pointer reference, MaskImageType::Pointer maskImage)
+{
+    ImageType::RegionType outputRegion = reference->GetLargestPossibleRegion();
+    ImageType::SpacingType outputSpacing = reference->GetSpacing();
+
+    std::vector< double > sum(outputRegion.GetNumberOfPixels(), 0.0), weight(outputRegion.GetNumberOfPixels(), 0.0);
+
+    MaskType::Pointer mask = MaskType::New();
+    mask->SetImage(maskImage);
+
+    GaussianFunctionType::Pointer gaussian = GaussianFunctionType::New();
+    gaussian->SetNormalized(false);
+
+    GaussianFunctionType::ArrayType mean;
+    mean[0] = 0; mean[1] = 0; mean[2] = 0;
+    gaussian->SetMean(mean);
+
+    double cst = 2*std::sqrt(2*std::log(2.0));
+
+    for(unsigned int im = 0; im < images.size(); im++)
+    {
+        ImageType::DirectionType inputDirection = images[im]->GetDirection();
+        ImageType::SpacingType inputSpacing = images[im]->GetSpacing();
+
+        GaussianFunctionType::ArrayType sigma;
+        sigma[0] = inputSpacing[0]/cst;
+        sigma[1] = inputSpacing[1]/cst;
+        sigma[2] = inputSpacing[2]/cst;
+        gaussian->SetSigma(sigma);
+
+        long radius[3];
+        radius[0] = std::ceil(inputSpacing[2] / outputSpacing[0]);
+        radius[1] = std::ceil(inputSpacing[2] / outputSpacing[1]);
+        radius[2] = std::ceil(inputSpacing[2] / outputSpacing[2]);
+
+        itk::ImageRegionConstIteratorWithIndex< ImageType > inputIt(images[im], images[im]->GetLargestPossibleRegion());
+
+        for(inputIt.GoToBegin(); !inputIt.IsAtEnd(); ++inputIt)
+        {
+            ImageType::IndexType inputIndex = inputIt.GetIndex();
+            const TransformType::TransformType *sliceTransform = transforms[im]->GetSliceTransform(inputIndex[2]);
+
+            vnl_matrix< double > NQd;
+            NQd = sliceTransform->GetMatrix().GetVnlMatrix();
+            vnl_vector< double > dir[3];
+
+            for(unsigned int d = 0; d < 3; d++)
+            {
+                vnl_vector< double > inputDir(3);
+                inputDir[0] = inputDirection(0,d);
+                inputDir[1] = inputDirection(1,d);
+                inputDir[2] = inputDirection(2,d);
+                dir[d] = NQd*inputDir;
+            }
+
+            ImageType::PointType physicalPoint, transformedPoint, nbPoint, rotPoint;
+            images[im]->TransformIndexToPhysicalPoint(inputIndex, physicalPoint);
+            transformedPoint = sliceTransform->TransformPoint(physicalPoint);
+
+            ImageType::IndexType outputIndex, nbIndex;
+            reference->TransformPhysicalPointToIndex(transformedPoint, outputIndex);
+
+            for(long dz = -radius[2]; dz <= radius[2]; dz++)
+            for(long dy = -radius[1]; dy <= radius[1]; dy++)
+            for(long dx = -radius[0]; dx <= radius[0]; dx++)
+            {
+                nbIndex[0] = outputIndex[0] + dx;
+                nbIndex[1] = outputIndex[1] + dy;
+                nbIndex[2] = outputIndex[2] + dz;
+
+                if(!outputRegion.IsInside(nbIndex))
+                {
+                    continue;
+                }
+
+                reference->TransformIndexToPhysicalPoint(nbIndex, nbPoint);
+
+                if(mask->IsInside(nbPoint))
+                {
+                    vnl_vector< double > diffPoint = nbPoint.GetVnlVector() - transformedPoint.GetVnlVector();
+                    rotPoint[0] = dot_product(diffPoint, dir[0]);
+                    rotPoint[1] = dot_product(diffPoint, dir[1]);
+                    rotPoint[2] = dot_product(diffPoint, dir[2]);
+
+                    double value = gaussian->Evaluate(rotPoint);
+
+                    unsigned long offset = reference->ComputeOffset(nbIndex);
+                    sum[offset] += inputIt.Get() * value;
+                    weight[offset] += value;
+                }
+            }
+        }
+    }
+
+    std::vector< double > output(outputRegion.GetNumberOfPixels(), 0.0);
+
+    for(unsigned long k = 0; k < output.size(); k++)
+    {
+        if(weight[k] != 0)
+        {
+            output[k] = sum[k] / weight[k];
+        }
+    }
+
+    return output;
+}
+
+/**
+ * @brief Test the injection filter (precomputed PSF kernels, rasterized mask and parallel z-slabs) against a
+ * brute-force Gaussian splatting, for two low resolution images (axial and rotated) with slice motions and a
+ * partial mask.
+ */
+int main(int, char*[])
+{
+    std::cout << "Injection test" << std::endl;
+
+    btk::RandomNumberGenerator generator(0, 0);
+
+    // Low resolution images : an axial one, and one with a rotated direction
+    ImageType::DirectionType direction;
+    direction.SetIdentity();
+
+    ImageType::PointType origin;
+    origin[0] = 0.0; origin[1] = 0.0; origin[2] = 0.0;
+
+    std::vector< ImageType::Pointer > images;
+    images.push_back(CreateLowResolutionImage(generator, direction, origin));
+
+    double angle = 0.3;
+    direction(0,0) = std::cos(angle); direction(0,1) = -std::sin(angle);
+    direction(1,0) = std::sin(angle); direction(1,1) =  std::cos(angle);
+    origin[0] = 2.0; origin[1] = -1.5; origin[2] = 0.5;
+    images.push_back(CreateLowResolutionImage(generator, direction, origin));
+
+    std::vector< TransformType::Pointer > transforms;
+    transforms.push_back(CreateTransform(generator, images[0]));
+    transforms.push_back(CreateTransform(generator, images[1]));
+
+    // High resolution reference image
+    ImageType::SizeType size;
+    size[0] = 14; size[1] = 14; size[2] = 13;
+
+    ImageType::SpacingType spacing;
+    spacing[0] = 1.0; spacing[1] = 1.0; spacing[2] = 1.0;
+
+    ImageType::RegionType region;
+    region.SetSize(size);
+
+    ImageType::Pointer reference = ImageType::New();
+    reference->SetRegions(region);
+    reference->SetSpacing(spacing);
+    reference->Allocate();
+    reference->FillBuffer(0);
+
+    // Mask of the reference image (a ball)
+    MaskImageType::Pointer maskImage = MaskImageType::New();
+    maskImage->SetRegions(region);
+    maskImage->SetSpacing(spacing);
+    maskImage->Allocate();
+
+    MaskIteratorType maskIt(maskImage, region);
+
+    for(maskIt.GoToBegin(); !maskIt.IsAtEnd(); ++maskIt)
+    {
+        MaskImageType::IndexType index = maskIt.GetIndex();
+        double distance = (index[0]-7.0)*(index[0]-7.0) + (index[1]-7.0)*(index[1]-7.0) + (index[2]-6.0)*(index[2]-6.0);
+        maskIt.Set(distance < 36.0 ? 1 : 0);
+    }
+
+    // Injection filter
+    ResamplerType::Pointer resampler = ResamplerType::New();
+
+    for(unsigned int im = 0; im < images.size(); im++)
+    {
+        resampler->AddInput(images[im]);
+        resampler->AddRegion(images[im]->GetLargestPossibleRegion());
+        resampler->SetTransform(im, transforms[im]);
+    }
+
+    resampler->UseReferenceImageOn();
+    resampler->SetReferenceImage(reference);
+    resampler->SetImageMask(maskImage);
+    resampler->Update();
+
+    ImageType::Pointer output = resampler->GetOutput();
+
+    // Reference injection
+    std::vector< double > referenceOutput = ReferenceInjection(images, transforms, reference, maskImage);
+
+    double maximumError = 0.0;
+    unsigned int numberOfInjectedVoxels = 0;
+
+    IteratorType outputIt(output, region);
+
+    for(outputIt.GoToBegin(); !outputIt.IsAtEnd(); ++outputIt)
+    {
+        double expected = referenceOutput[output->ComputeOffset(outputIt.GetIndex())];
+        maximumError = std::max(maximumError, std::abs(outputIt.Get() - expected) / (1.0 + std::abs(expected)));
+
+        if(expected != 0)
+        {
+            numberOfInjectedVoxels++;
+        }
+    }
+
+    std::cout << "- Injected voxels: " << numberOfInjectedVoxels << ", maximal relative error: " << maximumError << std::endl;
+
+    if(numberOfInjectedVoxels == 0 || !(maximumError < 1e-4))
+    {
+        std::cout << "Test failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Test passed." << std::endl;
+    return EXIT_SUCCESS;
+}
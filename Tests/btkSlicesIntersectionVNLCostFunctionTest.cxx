@@ -0,0 +1,232 @@
+/*==========================================================================
+
+  © Université de Strasbourg - Centre National de la Recherche Scientifique
+
+  Date: 18/10/2026
+  Author(s): agent (agent@local)
+
+  This software is governed by the CeCILL-B license under French law and
+  abiding by the rules of distribution of free software.  You can  use,
+  modify and/ or redistribute the software under the terms of the CeCILL-B
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and  rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty  and the software's author,  the holder of the
+  economic rights,  and the successive licensors  have only  limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading,  using,  modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean  that it is complicated to manipulate,  and  that  also
+  therefore means  that it is reserved for developers  and  experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and,  more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL-B license and that you accept its terms.
+
+==========================================================================*/
+
+
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+
+#include "btkSlicesIntersectionVNLCostFunction.hxx"
+#include "btkEulerSliceBySliceTransform.h"
+
+#include "vector"
+#include "cmath"
+#include "cstdlib"
+#include "iostream"
+#include "algorithm"
+
+
+typedef itk::Image< double,3 >                                     ImageType;
+typedef itk::Image< unsigned char,3 >                              MaskType;
+typedef btk::SlicesIntersectionVNLCostFunction< ImageType >        CostFunctionType;
+typedef btk::EulerSliceBySliceTransform< double,3,double >         TransformType;
+typedef itk::ImageRegionIteratorWithIndex< ImageType >             IteratorType;
+typedef itk::ImageRegionIteratorWithIndex< MaskType >              MaskIteratorType;
+
+/**
+ * @brief Create an image whose intensity is an affine function of the physical point
+ * (the linear interpolation is exact, so the cost function has no kink inside the voxels).
+ */
+static ImageType::Pointer CreateImage(const ImageType::SizeType &size, const ImageType::SpacingType &spacing, const ImageType::PointType &origin, const ImageType::DirectionType &direction, double offset)
+{
+    ImageType::RegionType region;
+    region.SetSize(size);
+
+    ImageType::Pointer image = ImageType::New();
+    image->SetRegions(region);
+    image->SetSpacing(spacing);
+    image->SetOrigin(origin);
+    image->SetDirection(direction);
+    image->Allocate();
+
+    IteratorType it(image, region);
+    ImageType::PointType point;
+
+    for(it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+        image->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+        it.Set(offset + 2.0*point[0] + 3.0*point[1] + 1.5*point[2]);
+    }
+
+    return image;
+}
+
+/**
+ * @brief Create the mask of an image (the first slice is excluded: the linear interpolator extrapolates
+ * half a voxel before the first slice, where the analytic gradient uses the clamped neighbors).
+ */
+static MaskType::Pointer CreateMask(ImageType::Pointer image)
+{
+    MaskType::Pointer mask = MaskType::New();
+    mask->SetRegions(image->GetLargestPossibleRegion());
+    mask->SetSpacing(image->GetSpacing());
+    mask->SetOrigin(image->GetOrigin());
+    mask->SetDirection(image->GetDirection());
+    mask->Allocate();
+
+    MaskIteratorType it(mask, mask->GetLargestPossibleRegion());
+
+    for(it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+        it.Set(it.GetIndex()[2] > 0 ? 1 : 0);
+    }
+
+    return mask;
+}
+
+/**
+ * @brief Compare the analytic gradient of the cost function with centred finite differences.
+ * @param images Images (axial and coronal).
+ * @param movingImage Number of the moving image.
+ * @param movingSlice Number of the moving slice.
+ * @return True if the gradients are the same.
+ */
+static bool TestGradient(std::vector< ImageType::Pointer > &images, unsigned int movingImage, unsigned int movingSlice)
+{
+    std::vector< MaskType::Pointer > masks;
+    std::vector< TransformType::Pointer > transforms, inverseTransforms;
+
+    for(unsigned int i = 0; i < images.size(); i++)
+    {
+        masks.push_back(CreateMask(images[i]));
+
+        TransformType::Pointer transform = TransformType::New();
+        transform->SetImage(images[i]);
+        transform->Initialize();
+
+        TransformType::Pointer inverseTransform = TransformType::New();
+        inverseTransform->SetImage(images[i]);
+        inverseTransform->Initialize();
+        transform->GetInverse(inverseTransform);
+
+        transforms.push_back(transform);
+        inverseTransforms.push_back(inverseTransform);
+    }
+
+    // The moving slice is alone in its group
+    std::vector< unsigned int > slicesGroup(images[movingImage]->GetLargestPossibleRegion().GetSize()[2], 1);
+    slicesGroup[movingSlice] = 0;
+
+    CostFunctionType costFunction(6);
+    costFunction.SetImages(images);
+    costFunction.SetMasks(masks);
+    costFunction.SetTransforms(transforms);
+    costFunction.SetInverseTransforms(inverseTransforms);
+    costFunction.SetMovingImageNum(movingImage);
+    costFunction.SetMovingSliceNum(movingSlice);
+    costFunction.SetSlicesGroup(slicesGroup);
+    costFunction.SetGroupNum(0);
+    costFunction.Initialize();
+
+    // Small motion (angles in degrees, translations in mm)
+    vnl_vector< double > x(6);
+    x[0] = 0.5; x[1] = -0.4; x[2] = 0.6;
+    x[3] = 0.1; x[4] = 0.0;  x[5] = -0.15;
+
+    vnl_vector< double > gradient = costFunction.GetGradient(x);
+    double value = costFunction.f(x);
+
+    std::cout << "- Moving image " << movingImage << ", slice " << movingSlice << ", cost function: " << value << std::endl;
+
+    if(!costFunction.GetIntersection())
+    {
+        std::cout << "  No intersection found !" << std::endl;
+        return false;
+    }
+
+    const double h = 1e-4;
+    double maximumError = 0.0;
+
+    for(unsigned int p = 0; p < 6; p++)
+    {
+        vnl_vector< double > xPlus = x, xMinus = x;
+        xPlus[p] += h;
+        xMinus[p] -= h;
+
+        double finiteDifference = (costFunction.f(xPlus) - costFunction.f(xMinus)) / (2.0*h);
+
+        std::cout << "  Parameter " << p << ": analytic " << gradient[p] << ", finite differences " << finiteDifference << std::endl;
+        maximumError = std::max(maximumError, std::abs(gradient[p] - finiteDifference) / (1.0 + std::abs(finiteDifference)));
+    }
+
+    std::cout << "  Maximal relative error: " << maximumError << std::endl;
+
+    return maximumError < 1e-4;
+}
+
+/**
+ * @brief Test the analytic gradient of the slice intersection cost function against finite differences,
+ * for a moving axial slice (end points of the intersection lines on the moving slice) and a moving
+ * coronal slice (end points on the fixed slices).
+ */
+int main(int, char*[])
+{
+    std::cout << "Slices intersection gradient test" << std::endl;
+
+    std::vector< ImageType::Pointer > images;
+
+    ImageType::SizeType size;
+    ImageType::SpacingType spacing;
+    ImageType::PointType origin;
+    ImageType::DirectionType direction;
+
+    // Axial image (the spacing along x keeps the length of the intersection lines away from an integer)
+    size[0] = 16; size[1] = 16; size[2] = 8;
+    spacing[0] = 0.9; spacing[1] = 1.0; spacing[2] = 2.0;
+    origin[0] = 0.0; origin[1] = 0.0; origin[2] = 0.0;
+    direction.SetIdentity();
+    images.push_back(CreateImage(size, spacing, origin, direction, 70.0));
+
+    // Coronal image, larger than the axial one in the slice plane (edges of its slices are outside the axial image)
+    size[0] = 22; size[1] = 10; size[2] = 7;
+    spacing[0] = 1.0; spacing[1] = 2.0; spacing[2] = 2.0;
+    origin[0] = -3.0; origin[1] = 1.3; origin[2] = -1.3;
+    direction.Fill(0.0);
+    direction(0,0) = 1.0; direction(2,1) = 1.0; direction(1,2) = 1.0;
+    images.push_back(CreateImage(size, spacing, origin, direction, 50.0));
+
+    bool testPassed = true;
+
+    testPassed &= TestGradient(images, 0, 3);
+    testPassed &= TestGradient(images, 1, 3);
+
+    if(!testPassed)
+    {
+        std::cout << "Test failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Test passed." << std::endl;
+    return EXIT_SUCCESS;
+}
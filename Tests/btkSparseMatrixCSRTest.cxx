@@ -0,0 +1,326 @@
+/*==========================================================================
+
+  © Université de Strasbourg - Centre National de la Recherche Scientifique
+
+  Date: 18/10/2026
+  Author(s): agent (agent@local)
+
+  This software is governed by the CeCILL-B license under French law and
+  abiding by the rules of distribution of free software.  You can  use,
+  modify and/ or redistribute the software under the terms of the CeCILL-B
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and  rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty  and the software's author,  the holder of the
+  economic rights,  and the successive licensors  have only  limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading,  using,  modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean  that it is complicated to manipulate,  and  that  also
+  therefore means  that it is reserved for developers  and  experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and,  more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL-B license and that you accept its terms.
+
+==========================================================================*/
+
+
+#include "btkSparseMatrixCSR.hxx"
+#include "btkRandomNumberGenerator.h"
+
+#include "vnl/vnl_vector.h"
+#include "vnl/vnl_sparse_matrix.h"
+
+#include "vector"
+#include "cmath"
+#include "cstdlib"
+#include "cstdio"
+#include "fstream"
+#include "iostream"
+#include "algorithm"
+
+
+typedef btk::SparseMatrixCSR< float > MatrixType;
+
+/**
+ * @brief Maximal absolute difference between two vectors, relative to the maximal absolute value of the reference.
+ */
+template < class TValue >
+static double RelativeError(const vnl_vector< TValue > &v, const vnl_vector< double > &reference)
+{
+    double error = 0.0, norm = 0.0;
+
+    if(v.size() != reference.size())
+    {
+        return 1.0;
+    }
+
+    for(unsigned int i = 0; i < reference.size(); i++)
+    {
+        error = std::max(error, std::abs(v[i] - reference[i]));
+        norm  = std::max(norm, std::abs(reference[i]));
+    }
+
+    return (norm > 0.0) ? error / norm : error;
+}
+
+/**
+ * @brief Compare the products by H and Ht, the values and the sums of the rows of a CSR matrix with a vnl sparse matrix.
+ */
+static bool CompareMatrices(btk::RandomNumberGenerator &generator, const MatrixType &H, vnl_sparse_matrix< double > &reference, const vnl_vector< float > &x, const vnl_vector< float > &y, const std::string &name)
+{
+    bool passed = true;
+
+    vnl_vector< double > xd(x.size()), yd(y.size()), referenceHx, referenceHty;
+
+    for(unsigned int j = 0; j < x.size(); j++)
+    {
+        xd[j] = x[j];
+    }
+
+    for(unsigned int i = 0; i < y.size(); i++)
+    {
+        yd[i] = y[i];
+    }
+
+    reference.mult(xd, referenceHx);
+    reference.pre_mult(yd, referenceHty);
+
+    vnl_vector< float > Hx, Hty;
+    H.Mult(x, Hx);
+    H.TransposeMult(y, Hty);
+
+    double errorHx  = RelativeError(Hx, referenceHx);
+    double errorHty = RelativeError(Hty, referenceHty);
+
+    // Values and sums of the rows
+    double errorValues = 0.0, errorSums = 0.0;
+    unsigned long numberOfNonZeros = 0;
+
+    for(unsigned int i = 0; i < reference.rows(); i++)
+    {
+        vnl_sparse_matrix< double >::row &r = reference.get_row(i);
+        numberOfNonZeros += r.size();
+
+        for(vnl_sparse_matrix< double >::row::const_iterator it = r.begin(); it != r.end(); ++it)
+        {
+            errorValues = std::max(errorValues, std::abs(H(i, (*it).first) - (*it).second));
+        }
+
+        // Some positions which are not stored
+        unsigned int column = generator.GenerateInteger(reference.cols());
+        errorValues = std::max(errorValues, std::abs(H(i, column) - reference.get(i, column)));
+
+        errorSums = std::max(errorSums, std::abs(H.SumRow(i) - reference.sum_row(i)));
+    }
+
+    std::cout << "- " << name << ": error of H.x " << errorHx << ", of Ht.y " << errorHty << ", of the values " << errorValues << ", of the sums of the rows " << errorSums << std::endl;
+
+    if(!(errorHx < 1e-5 && errorHty < 1e-5 && errorValues < 1e-5 && errorSums < 1e-4))
+    {
+        std::cout << "  " << name << " failed !" << std::endl;
+        passed = false;
+    }
+
+    if(numberOfNonZeros != H.GetNumberOfNonZeros() || reference.rows() != H.Rows() || reference.cols() != H.Cols())
+    {
+        std::cout << "  " << name << " failed (size or number of non-zero values) !" << std::endl;
+        passed = false;
+    }
+
+    return passed;
+}
+
+/**
+ * @brief Test the CSR matrix used for the observation matrix H of super-resolution against vnl_sparse_matrix:
+ * construction from row blocks (with duplicated positions), products by H and Ht (with and without the transposed
+ * matrix), normalization of the rows, conversion to vnl_sparse_matrix and mapping of a file written by Write.
+ */
+int main(int, char*[])
+{
+    std::cout << "Sparse matrix CSR test" << std::endl;
+
+    btk::RandomNumberGenerator generator(0, 0);
+    bool testPassed = true;
+
+    const unsigned int    numberOfRows = 1000;
+    const unsigned int numberOfColumns = 600;
+
+    vnl_sparse_matrix< double > reference(numberOfRows, numberOfColumns);
+
+    // Blocks of different sizes, some rows are not in any block (empty rows)
+    const unsigned int blockRows[] = { 0, 1, 120, 121, 400, 401, 700, 950 };
+    std::vector< MatrixType::RowBlock > blocks(7);
+
+    for(unsigned int b = 0; b < blocks.size(); b++)
+    {
+        unsigned int firstRow = blockRows[b] + (b == 3 ? 10 : 0);
+        unsigned int lastRow  = blockRows[b+1];
+
+        blocks[b].Initialize(firstRow, lastRow - firstRow);
+
+        for(unsigned int i = firstRow; i < lastRow; i++)
+        {
+            // Some empty rows in the blocks
+            unsigned int numberOfValues = (i % 7 == 0) ? 0 : generator.GenerateInteger(20);
+            unsigned int   centralColumn = (i * numberOfColumns) / numberOfRows;
+
+            for(unsigned int k = 0; k < numberOfValues; k++)
+            {
+                // Columns are taken around the diagonal, so that some positions are added several times
+                unsigned int column = (centralColumn + generator.GenerateInteger(8)) % numberOfColumns;
+                float         value = static_cast< float >(generator.GenerateUniform(0.01, 1.0));
+
+                blocks[b].Add(i, column, value);
+                reference(i, column) += value;
+            }
+        }
+
+        blocks[b].Finish();
+    }
+
+    MatrixType H;
+    H.SetSize(numberOfRows, numberOfColumns);
+    H.SetRowBlocks(blocks);
+
+    vnl_vector< float > x(numberOfColumns), y(numberOfRows);
+
+    for(unsigned int j = 0; j < numberOfColumns; j++)
+    {
+        x[j] = static_cast< float >(generator.GenerateUniform(-1.0, 1.0));
+    }
+
+    for(unsigned int i = 0; i < numberOfRows; i++)
+    {
+        y[i] = static_cast< float >(generator.GenerateUniform(-1.0, 1.0));
+    }
+
+    testPassed &= CompareMatrices(generator, H, reference, x, y, "Matrix");
+
+    H.ComputeTranspose();
+    testPassed &= CompareMatrices(generator, H, reference, x, y, "Matrix with its transpose");
+
+    //
+    // Normalization of the rows (as done for H in SRHMatrixComputation)
+    //
+
+    for(unsigned int i = 0; i < reference.rows(); i++)
+    {
+        double sum = reference.sum_row(i);
+
+        vnl_sparse_matrix< double >::row &r = reference.get_row(i);
+
+        for(vnl_sparse_matrix< double >::row::iterator it = r.begin(); it != r.end(); ++it)
+        {
+            (*it).second = (*it).second / sum;
+        }
+    }
+
+    H.NormalizeRows();
+
+    if(H.IsTransposeComputed())
+    {
+        std::cout << "  The transpose should be computed again after the normalization !" << std::endl;
+        testPassed = false;
+    }
+
+    H.ComputeTranspose();
+    testPassed &= CompareMatrices(generator, H, reference, x, y, "Normalized matrix");
+
+    //
+    // Conversion to vnl_sparse_matrix
+    //
+
+    vnl_sparse_matrix< double > converted;
+    H.GetVnlSparseMatrix(converted);
+
+    MatrixType::RowBlock convertedBlock;
+    convertedBlock.Initialize(0, numberOfRows);
+
+    for(unsigned int i = 0; i < converted.rows(); i++)
+    {
+        vnl_sparse_matrix< double >::row &r = converted.get_row(i);
+
+        for(vnl_sparse_matrix< double >::row::const_iterator it = r.begin(); it != r.end(); ++it)
+        {
+            convertedBlock.Add(i, (*it).first, static_cast< float >((*it).second));
+        }
+    }
+
+    convertedBlock.Finish();
+
+    std::vector< MatrixType::RowBlock > convertedBlocks(1, convertedBlock);
+    MatrixType convertedH;
+    convertedH.SetSize(converted.rows(), converted.cols());
+    convertedH.SetRowBlocks(convertedBlocks);
+
+    testPassed &= CompareMatrices(generator, convertedH, reference, x, y, "Matrix converted to vnl_sparse_matrix");
+
+    //
+    // Mapping of a file (the matrix is written after a header of 8 bytes)
+    //
+
+    const std::string fileName = "btkSparseMatrixCSRTest.bin";
+
+    {
+        std::ofstream file(fileName.c_str(), std::ios::binary);
+        const char header[8] = { 'H', 'E', 'A', 'D', 'E', 'R', 0, 0 };
+        file.write(header, sizeof(header));
+        H.Write(file);
+    }
+
+    MatrixType mappedH;
+
+    if(!mappedH.MapFile(fileName, 8) || !mappedH.IsMapped() || !mappedH.IsTransposeComputed())
+    {
+        std::cout << "  Mapping of the file failed !" << std::endl;
+        testPassed = false;
+    }
+    else
+    {
+        vnl_vector< float > Hx, mappedHx, Hty, mappedHty;
+
+        H.Mult(x, Hx);
+        mappedH.Mult(x, mappedHx);
+        H.TransposeMult(y, Hty);
+        mappedH.TransposeMult(y, mappedHty);
+
+        if(Hx != mappedHx || Hty != mappedHty || mappedH.GetNumberOfNonZeros() != H.GetNumberOfNonZeros())
+        {
+            std::cout << "  Mapped matrix differs from the written one !" << std::endl;
+            testPassed = false;
+        }
+
+        testPassed &= CompareMatrices(generator, mappedH, reference, x, y, "Mapped matrix");
+    }
+
+    // A wrong offset is rejected
+    MatrixType wrongH;
+
+    if(wrongH.MapFile(fileName, 0) || wrongH.MapFile(fileName, 4))
+    {
+        std::cout << "  Mapping of a wrong position should fail !" << std::endl;
+        testPassed = false;
+    }
+
+    mappedH.Clear();
+    std::remove(fileName.c_str());
+
+    if(!testPassed)
+    {
+        std::cout << "Test failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Test passed." << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,230 @@
+/*==========================================================================
+
+  © Université de Strasbourg - Centre National de la Recherche Scientifique
+
+  Date: 18/10/2026
+  Author(s): agent (agent@local)
+
+  This software is governed by the CeCILL-B license under French law and
+  abiding by the rules of distribution of free software.  You can  use,
+  modify and/ or redistribute the software under the terms of the CeCILL-B
+  license as circulated by CEA, CNRS and INRIA at the following URL
+  "http://www.cecill.info".
+
+  As a counterpart to the access to the source code and  rights to copy,
+  modify and redistribute granted by the license, users are provided only
+  with a limited warranty  and the software's author,  the holder of the
+  economic rights,  and the successive licensors  have only  limited
+  liability.
+
+  In this respect, the user's attention is drawn to the risks associated
+  with loading,  using,  modifying and/or developing or reproducing the
+  software by the user in light of its specific status of free software,
+  that may mean  that it is complicated to manipulate,  and  that  also
+  therefore means  that it is reserved for developers  and  experienced
+  professionals having in-depth computer knowledge. Users are therefore
+  encouraged to load and test the software's suitability as regards their
+  requirements in conditions enabling the security of their systems and/or
+  data to be ensured and,  more generally, to use and operate it in the
+  same conditions as regards security.
+
+  The fact that you are presently reading this means that you have had
+  knowledge of the CeCILL-B license and that you accept its terms.
+
+==========================================================================*/
+
+
+#include "btkSphericalHarmonicsTable.h"
+#include "btkSphericalHarmonics.h"
+#include "btkSphericalDirection.h"
+#include "btkRandomNumberGenerator.h"
+
+#include "vector"
+#include "cmath"
+#include "cstdlib"
+#include "iostream"
+#include "algorithm"
+
+
+/**
+ * @brief Value of a function given by its SH coefficients, computed with the analytical basis.
+ */
+static double EvaluateReference(const btk::SphericalDirection &u, unsigned int order, const std::vector< float > &coefficients, const std::vector< float > &weights)
+{
+    double value = 0.0;
+    unsigned int k = 0;
+
+    for(unsigned int l = 0; l <= order; l += 2)
+    {
+        for(int m = -(int)l; m <= (int)l; m++)
+        {
+            value += btk::SphericalHarmonics::ComputeBasis(u, l, m) * (weights.empty() ? 1.0 : weights[k]) * coefficients[k];
+            k++;
+        }
+    }
+
+    return value;
+}
+
+/**
+ * @brief Test the tabulated spherical harmonics basis against the analytical basis: exact values at the nodes of the grid
+ * (with and without weights), interpolated values in random directions, periodicity in azimuth and dot product.
+ */
+int main(int, char*[])
+{
+    std::cout << "Spherical harmonics table test" << std::endl;
+
+    btk::RandomNumberGenerator generator(0, 0);
+    bool testPassed = true;
+
+    const unsigned int           order = 4;
+    const unsigned int thetaResolution = 90;
+    const unsigned int numberOfCoefficients = (order+1)*(order+2)/2;
+
+    std::vector< float > coefficients(numberOfCoefficients), weights(numberOfCoefficients), noWeights;
+
+    for(unsigned int k = 0; k < numberOfCoefficients; k++)
+    {
+        coefficients[k] = static_cast< float >(generator.GenerateUniform(-1.0, 1.0));
+    }
+
+    // Weights depending on the order only (as the Funk-Radon transform)
+    for(unsigned int l = 0, k = 0; l <= order; l += 2)
+    {
+        for(int m = -(int)l; m <= (int)l; m++, k++)
+        {
+            weights[k] = 1.0f / (1.0f + l);
+        }
+    }
+
+    btk::SphericalHarmonicsTable table, weightedTable;
+    table.Initialize(order, thetaResolution);
+    weightedTable.Initialize(order, thetaResolution, weights);
+
+    if(!table.IsInitialized() || table.GetNumberOfCoefficients() != numberOfCoefficients)
+    {
+        std::cout << "  Initialization failed !" << std::endl;
+        testPassed = false;
+    }
+
+    //
+    // Values at the nodes (interpolation or nearest node give the same values)
+    //
+
+    double maximumNodeError = 0.0;
+
+    for(unsigned int i = 0; i <= thetaResolution; i++)
+    {
+        for(unsigned int j = 0; j < 2*thetaResolution; j++)
+        {
+            btk::SphericalDirection u(static_cast< float >(i * M_PI / thetaResolution), static_cast< float >(j * M_PI / thetaResolution));
+
+            double reference         = EvaluateReference(u, order, coefficients, noWeights);
+            double weightedReference = EvaluateReference(u, order, coefficients, weights);
+
+            table.UseInterpolationOff();
+            maximumNodeError = std::max(maximumNodeError, std::abs(table.Evaluate(u, &coefficients[0]) - reference));
+            maximumNodeError = std::max(maximumNodeError, std::abs(weightedTable.Evaluate(u, &coefficients[0]) - weightedReference));
+
+            table.UseInterpolationOn();
+            maximumNodeError = std::max(maximumNodeError, std::abs(table.Evaluate(u, &coefficients[0]) - reference));
+        }
+    }
+
+    std::cout << "- Maximal error at the nodes: " << maximumNodeError << std::endl;
+
+    if(!(maximumNodeError < 1e-4))
+    {
+        std::cout << "  Values at the nodes failed !" << std::endl;
+        testPassed = false;
+    }
+
+    //
+    // Interpolated values in random directions
+    //
+
+    double maximumInterpolationError = 0.0, maximumReference = 0.0;
+    table.UseInterpolationOn();
+
+    for(unsigned int n = 0; n < 10000; n++)
+    {
+        double z = generator.GenerateUniform(-1.0, 1.0);
+        btk::SphericalDirection u(static_cast< float >(std::acos(z)), static_cast< float >(generator.GenerateUniform(0.0, 2.0*M_PI)));
+
+        double reference = EvaluateReference(u, order, coefficients, noWeights);
+
+        maximumReference          = std::max(maximumReference, std::abs(reference));
+        maximumInterpolationError = std::max(maximumInterpolationError, std::abs(table.Evaluate(u, &coefficients[0]) - reference));
+    }
+
+    std::cout << "- Maximal error of the interpolation: " << maximumInterpolationError << " (maximal value: " << maximumReference << ")" << std::endl;
+
+    if(!(maximumInterpolationError < 1e-2 * maximumReference))
+    {
+        std::cout << "  Interpolated values failed !" << std::endl;
+        testPassed = false;
+    }
+
+    //
+    // Periodicity in azimuth
+    //
+
+    double maximumPeriodicityError = 0.0;
+
+    for(unsigned int n = 0; n < 1000; n++)
+    {
+        float theta = static_cast< float >(generator.GenerateUniform(0.0, M_PI));
+        float   phi = static_cast< float >(generator.GenerateUniform(0.0, 2.0*M_PI));
+
+        double value = table.Evaluate(btk::SphericalDirection(theta, phi), &coefficients[0]);
+
+        maximumPeriodicityError = std::max(maximumPeriodicityError, std::abs(table.Evaluate(btk::SphericalDirection(theta, phi - 2.0*M_PI), &coefficients[0]) - value));
+        maximumPeriodicityError = std::max(maximumPeriodicityError, std::abs(table.Evaluate(btk::SphericalDirection(theta, phi + 2.0*M_PI), &coefficients[0]) - value));
+    }
+
+    std::cout << "- Maximal error of the periodicity in azimuth: " << maximumPeriodicityError << std::endl;
+
+    if(!(maximumPeriodicityError < 1e-3))
+    {
+        std::cout << "  Periodicity in azimuth failed !" << std::endl;
+        testPassed = false;
+    }
+
+    //
+    // Dot product
+    //
+
+    double maximumDotProductError = 0.0;
+
+    for(unsigned int size = 1; size <= 45; size++)
+    {
+        std::vector< float > a(size), b(size);
+        double reference = 0.0;
+
+        for(unsigned int k = 0; k < size; k++)
+        {
+            a[k] = static_cast< float >(generator.GenerateUniform(-1.0, 1.0));
+            b[k] = static_cast< float >(generator.GenerateUniform(-1.0, 1.0));
+            reference += static_cast< double >(a[k]) * b[k];
+        }
+
+        maximumDotProductError = std::max(maximumDotProductError, std::abs(btk::SphericalHarmonicsTable::DotProduct(&a[0], &b[0], size) - reference));
+    }
+
+    std::cout << "- Maximal error of the dot product: " << maximumDotProductError << std::endl;
+
+    if(!(maximumDotProductError < 1e-5))
+    {
+        std::cout << "  Dot product failed !" << std::endl;
+        testPassed = false;
+    }
+
+    if(!testPassed)
+    {
+        std::cout << "Test failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Test passed." << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -150,6 +150,7 @@ int main(int argc, char *argv[])
 
         // Options
         TCLAP::ValueArg< float > kernelBandwidthArg("b", "kernel_bandwidth", "Bandwidth of the kernel use for cost function", false, 1.0, "positive real", cmd);
+        TCLAP::SwitchArg exactBandwidthOptimizationArg("", "exact_bandwidth", "Optimize the kernel bandwidth with a Newton method reaching the minimum of the cost (default: gradient descent)", cmd);
 
         // Parsing arguments
         cmd.parse(argc, argv);
@@ -163,6 +164,7 @@ int main(int argc, char *argv[])
         std::string                 outputFileName = outputFileNameArg.getValue();
 
         float kernelBandwidth = kernelBandwidthArg.getValue();
+        bool  exactBandwidthOptimization = exactBandwidthOptimizationArg.getValue();
 
 
         //
@@ -335,6 +337,7 @@ int main(int argc, char *argv[])
             btk::NadarayaWatsonReconstructionErrorFunction::Pointer kernelCostFunction = btk::NadarayaWatsonReconstructionErrorFunction::New();
             kernelCostFunction->SetBandwidthMatrix(&H);
             kernelCostFunction->SetImagesWeightVector(&w);
+            kernelCostFunction->SetExactBandwidthOptimization(exactBandwidthOptimization);
             costFunction = kernelCostFunction;
 
             // Initialize cost function
@@ -97,6 +97,7 @@ int main(int argc, char *argv[])
         TCLAP::ValueArg< unsigned int > numberOfSamplesPerFeatureArg("s","number_of_samples", "Number of samples per feature (for reconstruction, default; 3)",false, 3, "positive integer", cmd);
         TCLAP::ValueArg< float >                  kernelBandwidthArg("b", "kernel_bandwidth", "Bandwidth of the kernel use for cost function", false, 1.0, "positive real", cmd);
         TCLAP::SwitchArg                 populationReconstructionArg("", "population", "Reconstruct the initial population", cmd);
+        TCLAP::SwitchArg               exactBandwidthOptimizationArg("", "exact_bandwidth", "Optimize the kernel bandwidth with a Newton method reaching the minimum of the cost (default: gradient descent)", cmd);
 
         // Parsing arguments
         cmd.parse(argc, argv);
@@ -111,6 +112,7 @@ int main(int argc, char *argv[])
         unsigned int numberOfSamplesPerFeature = numberOfSamplesPerFeatureArg.getValue();
         float                  kernelBandwidth = kernelBandwidthArg.getValue();
         bool          populationReconstruction = populationReconstructionArg.getValue();
+        bool        exactBandwidthOptimization = exactBandwidthOptimizationArg.getValue();
 
 
         //
@@ -320,6 +322,7 @@ int main(int argc, char *argv[])
         btk::NadarayaWatsonReconstructionErrorFunction::Pointer kernelCostFunction = btk::NadarayaWatsonReconstructionErrorFunction::New();
         kernelCostFunction->SetBandwidthMatrix(&H);
         kernelCostFunction->SetImagesWeightVector(&w);
+        kernelCostFunction->SetExactBandwidthOptimization(exactBandwidthOptimization);
         costFunction = kernelCostFunction;
 
         // Initialize cost function
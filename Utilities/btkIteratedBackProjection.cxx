@@ -78,6 +78,7 @@ int main( int argc, char *argv[] )
     TCLAP::ValueArg<int> ibpOrderArg      ("","ibpOrder","Order for the B-spline interpolation during image backprojections (0: nearest neighbor, 1: trilinear etc.)", false,5,"int",cmd);
     TCLAP::ValueArg<int> psfArg           ("p","psftype","Type of the PSF (0: interpolated boxcar, 1: oversampled boxcar (default), 2: Gaussian)", false,1,"int",cmd);
     TCLAP::ValueArg<int> medArg           ("","medianIBP","Type of filtering on the error map (0: mean of error maps (default), 1: median)", false,0,"int",cmd);
+    TCLAP::ValueArg<std::string> cacheArg ("","hcache","Directory where the matrix H is stored and reloaded when the same inputs are used (no cache by default).", false,"","string",cmd);
     
     
     // Parse the argv array.
@@ -97,6 +98,7 @@ int main( int argc, char *argv[] )
     int ibpOrder                 = ibpOrderArg.getValue();
     int psftype                  = psfArg.getValue();
     int medianIBP                = medArg.getValue();
+    std::string cache_directory  = cacheArg.getValue();
     
     // typedefs
     const   unsigned int    Dimension = 3;
@@ -136,6 +138,8 @@ int main( int argc, char *argv[] )
     
     btkSRM.tool.SetPSFInterpolationOrderIBP(ibpOrder);
     btkSRM.tool.SetPSFComputation(psftype);
+    if(cache_directory != "")
+      btkSRM.tool.SetCacheDirectory(cache_directory);
     
     btkSRM.Initialize();
     
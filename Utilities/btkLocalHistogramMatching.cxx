@@ -44,7 +44,7 @@
 /*Btk includes*/
 #include "btkImageHelper.h"
 #include "btkPatch.h"
-#include "btkPatchTool.h"
+#include "btkLocalMeanAndVarianceNormalization.h"
 
 
 int main (int argc, char* argv[])
@@ -93,179 +93,49 @@ int main (int argc, char* argv[])
   ShortImagePointer refImage   = btk::ImageHelper<ShortImageType>::ReadImage(ref_file);  
   ShortImagePointer maskImage  = btk::ImageHelper<ShortImageType>::ReadOrCreateImage(mask_file, inputImage, 1);
   
-  //Create empty ouput image
-  ShortImagePointer outputImage = btk::ImageHelper<ShortImageType>::CreateNewImageFromPhysicalSpaceOf(inputImage.GetPointer());
-
   std::cout<<"Performing local histogram matching\n";
-  itkShortIterator maskImageIt( maskImage, maskImage->GetLargestPossibleRegion());
-  itkShortIterator inputImageIt( inputImage, inputImage->GetLargestPossibleRegion());    
-  
-  FloatImagePointer weightImage = btk::ImageHelper<ShortImageType,FloatImageType>::CreateNewImageFromPhysicalSpaceOf(inputImage.GetPointer());
 
-  //compute characteristics of the input image
-  ShortImageType::RegionType  region  = inputImage->GetLargestPossibleRegion();
-  ShortImageType::SizeType    size    = region.GetSize();
-  ShortImageType::SpacingType spacing = inputImage->GetSpacing();
-  
-  int x,y,z;
-  if(block == 0)
-  {
-    std::cout<<"pointwise HM"<<std::endl;
+  //Half patch size (taking into account possible image anisotropy)
+  btk::Patch<short> tmpPatch;
+  tmpPatch.Initialize(inputImage,hwn);
 
-    #pragma omp parallel for private(x,y,z) schedule(dynamic)
-    for(z=0; z < (int)size[2]; z++)
-    {
-      for(y=0; y < (int)size[1]; y++)
-      {
-				for(x=0; x < (int)size[0]; x++)
-				{
-	  			ShortImageType::IndexType index;
-	  			index[0] = x;
-	  			index[1] = y;
-	  			index[2] = z;
-	  
-	  			if( maskImage->GetPixel(index) > 0 )
-          {
- 	    			btk::PatchTool<short,float> myPatchTool;
-  
-	    			btk::Patch<short> inputPatch;
-	    			inputPatch.Initialize(inputImage,hwn);
-	    			inputPatch.ComputePatch(index, inputImage);
-  
-				    btk::Patch<short> refPatch;
-	   			 	refPatch.Initialize(refImage,hwn);
-	    			refPatch.ComputePatch(index, refImage);
+  ShortImageType::SizeType halfPatchSize = tmpPatch.GetHalfPatchSize();
 
-	  			  btk::Patch<float> outputPatch;
-	  			  myPatchTool.CreatePatchFromAnotherPatch(inputPatch, outputPatch);
-	  			  
-	    			//outputPatch.Initialize(outputImage,hwn);
-	    			//outputPatch.ComputePatch(index, outputImage);
+  //Local means and variances of both images are computed once for all the patches (running sums),
+  //the blockwise modes average the estimates of all the patches containing a voxel (no short rounding
+  //during the aggregation)
+  btk::LocalMeanAndVarianceNormalization<short> normalization;
+  normalization.SetInputImage(inputImage);
+  normalization.SetReferenceImage(refImage);
+  normalization.SetMaskImage(maskImage);
+  normalization.SetHalfPatchSize(halfPatchSize);
 
-	    			myPatchTool.PatchIntensityNormalizationUsingMeanAndVariance(inputPatch, refPatch, outputPatch);
-	      
-	    			outputImage->SetPixel( index, (short)outputPatch.GetCentralValue() );
-	  			}
-				}
-  		}
-    }
-      
-  }    
+  ShortImageType::SizeType blockStep;
+  blockStep.Fill(1);
+
+  if(block == 0)
+  {
+    std::cout<<"pointwise HM"<<std::endl;
+    normalization.SetBlockwise(false);
+  }
   if(block == 1)
   {
-    std::cout<<"blockwise HM"<<std::endl;    
-    #pragma omp parallel for private(x,y,z) schedule(dynamic)
-    for(z=0; z < (int)size[2]; z++)
-    {
-      for(y=0; y < (int)size[1]; y++)
-      {
-				for(x=0; x < (int)size[0]; x++)
-				{
-	  			ShortImageType::IndexType index;
-	  			index[0] = x;
-				  index[1] = y;
-				  index[2] = z;
-	  
-				  if( maskImage->GetPixel(index) > 0 )
-          {
-  	    		btk::PatchTool<short,float> myPatchTool;
-              
-	    			btk::Patch<short> inputPatch;
-	    			inputPatch.Initialize(inputImage,hwn);
-	    			inputPatch.ComputePatch(index, inputImage);
-  
-				    btk::Patch<short> refPatch;
-	   			 	refPatch.Initialize(refImage,hwn);
-	    			refPatch.ComputePatch(index, refImage);
-
-	  			  btk::Patch<float> outputPatch;
-	  			  myPatchTool.CreatePatchFromAnotherPatch(inputPatch, outputPatch);
-	 
-	    			myPatchTool.PatchIntensityNormalizationUsingMeanAndVariance(inputPatch, refPatch, outputPatch);
-
-            #pragma omp critical	      
-				    myPatchTool.AddPatchToImage(index, outputPatch, outputImage, weightImage, 1.0);
-	  			}
-				}
-      }
-    }
+    std::cout<<"blockwise HM"<<std::endl;
+    normalization.SetBlockwise(true);
   }
   if(block == 2)
   {
     std::cout<<"fast blockwise HM"<<std::endl;
+    normalization.SetBlockwise(true);
 
-    btk::Patch<short> tmpPatch;
-    tmpPatch.Initialize(inputImage,hwn);
-    
-    ShortImageType::SizeType halfPatchSize = tmpPatch.GetHalfPatchSize();
-
-    #pragma omp parallel for private(x,y,z) schedule(dynamic)
-    for(z=0; z < (int)size[2]; z++)
-    {
-      if( z%(halfPatchSize[2]+1) == 0)
-      {
-				for(y=0; y < (int)size[1]; y++)
-        {
-	  			if( y%(halfPatchSize[1]+1) == 0)
-	  			{
-	    			for(x=0; x < (int)size[0]; x++)
-	    			{
-	      			if( x%(halfPatchSize[0]+1) == 0)
-	      			{
-
-								ShortImageType::IndexType index;
-								index[0] = x;
-								index[1] = y;
-								index[2] = z;
-	  
-								if( maskImage->GetPixel(index) > 0 )
-								{
-              
-         	    		btk::PatchTool<short,float> myPatchTool;
-
-				    			btk::Patch<short> inputPatch;
-	    						inputPatch.Initialize(inputImage,hwn);
-	    						inputPatch.ComputePatch(index, inputImage);
-  
-							    btk::Patch<short> refPatch;
-	   						 	refPatch.Initialize(refImage,hwn);
-	    						refPatch.ComputePatch(index, refImage);
-
-				  			  btk::Patch<float> outputPatch;
-	  						  myPatchTool.CreatePatchFromAnotherPatch(inputPatch, outputPatch);
-
-	    						myPatchTool.PatchIntensityNormalizationUsingMeanAndVariance(inputPatch, refPatch, outputPatch);
-
-                  #pragma omp critical	      
-								  myPatchTool.AddPatchToImage(index, outputPatch, outputImage, weightImage, 1.0);
-								}
-				      }
-				    }
-				  }
-				}
-      }
-    }
-  }
-  //Normalization of the output image using the weight image
-  //this steps can be improved by considering float images for all the computations (currently outputImage is in short)
-  //note that blockwise techniques can introduce also some smoothing in the final estimate because of the aggregation strategy (mean of estimates)
-  if(block >= 1)
-  {
-    itkFloatIterator weightIt( weightImage, weightImage->GetLargestPossibleRegion() );
-    itkShortIterator outputIt( outputImage, outputImage->GetLargestPossibleRegion() );
-    for ( outputIt.GoToBegin(), weightIt.GoToBegin(); !outputIt.IsAtEnd(); ++outputIt, ++weightIt)
-    {
-      if( weightIt.Get() > 0 )
-      {
-        outputIt.Set( outputIt.Get() / weightIt.Get() );
-      }
-    }
+    for(unsigned int i = 0; i < Dimension; i++)
+      blockStep[i] = halfPatchSize[i]+1;
   }
+  normalization.SetBlockStep(blockStep);
+  normalization.Update();
+
+  ShortImagePointer outputImage = normalization.GetOutputImage();
 
-  
-  
-  
-  
   btk::ImageHelper<ShortImageType>::WriteImage(outputImage, output_file);
 
   
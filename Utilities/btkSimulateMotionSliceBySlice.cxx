@@ -40,6 +40,7 @@
 #include "btkIOTransformHelper.h"
 #include "btkApplyTransformToImageFilter.h"
 #include "btkMathFunctions.h"
+#include "btkRandomNumberGenerator.h"
 
 /* ITK */
 #include "itkImage.h"
@@ -72,6 +73,7 @@ int main(int argc, char* argv[])
     TCLAP::ValueArg<int> motionLevelArg("l","level","level of motion. (1,2,3 or 4 for all slices)",false,2,"int",cmd);
     TCLAP::ValueArg<double> rotationLevelArg("","rotMax","Rotation max in degree.",false,5,"int",cmd);
     TCLAP::ValueArg<double> translationLevelArg("","traMax","Translation max in mm.",false,5,"int",cmd);
+    TCLAP::ValueArg<unsigned long> seedArg("","seed","Seed of the random numbers (default: depends on the current time).",false,0,"unsigned int",cmd);
 
 
     typedef btk::EulerSliceBySliceTransform<double,3>      RigidSliceBySliceTransformation;
@@ -95,6 +97,7 @@ int main(int argc, char* argv[])
     int level = motionLevelArg.getValue();
     double rotMax = rotationLevelArg.getValue();
     double traMax = translationLevelArg.getValue();
+    unsigned long long seed = seedArg.isSet() ? seedArg.getValue() : btk::RandomNumberGenerator::GetTimeSeed();
 
      rotMax = btk::MathFunctions::DegreesToRadians(rotMax);
 
@@ -147,7 +150,7 @@ int main(int argc, char* argv[])
 
     //Slice N°i random transformation :
     RigidTransformation::Pointer RandomTransform = RigidTransformation::New();
-    srand(time(NULL));
+    btk::RandomNumberGenerator generator(seed, 0);
 
     int NSlices = globalTransform->GetNumberOfSlices();
 
@@ -161,7 +164,7 @@ int main(int argc, char* argv[])
 
 
         std::cout<<"Slice N° : "<<i<<std::endl;
-        int rndm = rand()%10;
+        int rndm = generator.GenerateInteger(10);
         RandomTransform->SetIdentity();
         RigidTransformation::ParametersType randomParams(RandomTransform->GetNumberOfParameters());
 
@@ -169,29 +172,29 @@ int main(int argc, char* argv[])
         {
             std::cout<<"Apply a Motion"<<std::endl;
 
-            int rot_trans = rand()%3;
+            int rot_trans = generator.GenerateInteger(3);
 
             //Rotation
             if(rot_trans == 0)
             {
-                int paramR = rand()%3 ; // x y and z
-                randomParams[paramR] = rand()/((double)RAND_MAX/std::abs(rotMax - rotMin )) - std::abs(rotMin);
+                int paramR = generator.GenerateInteger(3) ; // x y and z
+                randomParams[paramR] = generator.GenerateUniform(rotMin, rotMax);
             }
             //Translation
             else if(rot_trans == 1)
             {
                 //if translation on z wanted change %2 in %3
-                int paramT = (rand()%2) + 3; // only x and y          
-                randomParams[paramT] = rand()/((double)RAND_MAX/ std::abs(traMax - traMin)) - std::abs(traMin);
+                int paramT = generator.GenerateInteger(2) + 3; // only x and y          
+                randomParams[paramT] = generator.GenerateUniform(traMin, traMax);
             }
             //Rotation and translation
             else
             {
-                int paramR = rand()%3;
+                int paramR = generator.GenerateInteger(3);
                 //if translation on z wanted change %2 in %3
-                int paramT = (rand()%2) + 3;
-                randomParams[paramR] = rand()/((double)RAND_MAX/std::abs(rotMax - rotMin )) - std::abs(rotMin);
-                randomParams[paramT] = rand()/((double)RAND_MAX/ std::abs(traMax - traMin)) - std::abs(traMin);
+                int paramT = generator.GenerateInteger(2) + 3;
+                randomParams[paramR] = generator.GenerateUniform(rotMin, rotMax);
+                randomParams[paramT] = generator.GenerateUniform(traMin, traMax);
             }
 
 